@@ -0,0 +1,17 @@
+# A long program which is compiled but whose blocks never run, so that the
+# corpus measures the front end. Generated rather than committed because
+# it's 27,000 lines of the same block.
+awk 'BEGIN {
+  for(i = 0; i < 3000; i++) {
+    print "if(false) {"
+    print "  mut a = " i " + 2 * 3 - 4 // 2;"
+    print "  b = a < " i " <= 10 < 20 and not (a == 3 or a != 4);"
+    print "  while(a > 0) {"
+    print "    a = a - 1;"
+    print "    if(b) { break; } else { continue; }"
+    print "  }"
+    print "  println(a, b, Int(b), Bool(" i "));"
+    print "}"
+  }
+  print "nil;"
+}'
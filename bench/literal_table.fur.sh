@@ -0,0 +1,8 @@
+# A program which is mostly a large table of integer and string literals,
+# for the cost of compiling and loading constants.
+awk 'BEGIN {
+  quote = sprintf("%c", 39)
+  for(i = 0; i < 3000; i++) print "t" i " = " (i * 7919) % 100003 ";"
+  for(i = 0; i < 200; i++) print "s" i " = " quote "entry number " i " in the literal table" quote ";"
+  print "t0 + t1 + t1000 + t2999;"
+}'
@@ -0,0 +1,124 @@
+#ifdef BENCH
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+static bool isFirstReport = true;
+
+uint64_t Bench_now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+size_t Bench_currentRSS() {
+  /*
+   * The second field of /proc/self/statm is the resident set size in pages.
+   * Where that isn't available we fall back to the peak, which is less
+   * useful for measuring deltas but still gives an upper bound.
+   */
+  FILE* statm = fopen("/proc/self/statm", "r");
+
+  if(statm == NULL) return Bench_peakRSS();
+
+  size_t pages = 0;
+  size_t residentPages = 0;
+  int matched = fscanf(statm, "%zu %zu", &pages, &residentPages);
+  fclose(statm);
+
+  if(matched != 2) return Bench_peakRSS();
+
+  return residentPages * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+size_t Bench_peakRSS() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // ru_maxrss is in kilobytes on Linux
+  return (size_t)usage.ru_maxrss * 1024;
+}
+
+size_t Bench_parameter(const char* name, size_t defaultValue) {
+  const char* text = getenv(name);
+
+  if(text == NULL || *text == '\0') return defaultValue;
+
+  return (size_t)strtoull(text, NULL, 10);
+}
+
+void Bench_begin() {
+  printf("[\n");
+}
+
+void Bench_report(const char* benchmark, const char* metric, double value, const char* unit) {
+  if(isFirstReport) {
+    isFirstReport = false;
+  } else {
+    printf(",\n");
+  }
+
+  printf(
+    "  { \"benchmark\": \"%s\", \"metric\": \"%s\", \"value\": %.3f, \"unit\": \"%s\" }",
+    benchmark,
+    metric,
+    value,
+    unit
+  );
+  fflush(stdout);
+}
+
+static int compareDoubles(const void* a, const void* b) {
+  double da = *((const double*)a);
+  double db = *((const double*)b);
+  return (da > db) - (da < db);
+}
+
+void Bench_measure(const char* benchmark, void (*fn)(void*), void* context, size_t opsPerCall) {
+  size_t warmup = Bench_parameter("FUR_BENCH_WARMUP", 3);
+  size_t repetitions = Bench_parameter("FUR_BENCH_REPETITIONS", 10);
+  assert(repetitions > 0);
+
+  size_t calls = 1;
+
+  for(;;) {
+    uint64_t start = Bench_now();
+    for(size_t i = 0; i < calls; i++) fn(context);
+    uint64_t elapsed = Bench_now() - start;
+
+    if(elapsed >= 10000000u || calls >= ((size_t)1 << 30)) break;
+    calls *= 2;
+  }
+
+  for(size_t r = 0; r < warmup; r++) {
+    for(size_t i = 0; i < calls; i++) fn(context);
+  }
+
+  double samples[repetitions];
+
+  for(size_t r = 0; r < repetitions; r++) {
+    uint64_t start = Bench_now();
+    for(size_t i = 0; i < calls; i++) fn(context);
+    uint64_t elapsed = Bench_now() - start;
+
+    samples[r] = (double)elapsed / ((double)calls * opsPerCall);
+  }
+
+  qsort(samples, repetitions, sizeof(double), compareDoubles);
+
+  Bench_report(benchmark, "ns_per_op", samples[repetitions / 2], "ns");
+  Bench_report(benchmark, "ns_per_op_min", samples[0], "ns");
+  Bench_report(benchmark, "ops_per_repetition", (double)calls * opsPerCall, "count");
+}
+
+void Bench_end() {
+  printf("\n]\n");
+}
+
+#endif
@@ -0,0 +1,13 @@
+echo '#include <stdio.h>'
+echo '#include <stdlib.h>'
+echo '#include <string.h>'
+echo
+find src -name '*.h' | sed 's|.*|#include "../&"|g'
+echo
+echo '#define DO_BENCH(b) if(argc == 1 || strstr(#b, argv[1])) { fprintf(stderr, "%s\\n", #b); b(); }'
+echo 'int main(int argc, char* argv[]) {'
+echo '  Bench_begin();'
+grep --no-filename '^void bench_' src/*.h | sed -E 's/void (bench_[A-Za-z_0-9]*)\(\);/  DO_BENCH(\1);/g'
+echo '  Bench_end();'
+echo '  return 0;'
+echo '}'
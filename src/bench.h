@@ -0,0 +1,36 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * Benchmarks mirror the unit tests: they live in the .c file of the code
+ * they measure, inside #ifdef BENCH, are named bench_ followed by what they
+ * measure, are void, and take no arguments. src/bench.c.sh collects them
+ * into bin/bench.
+ *
+ * Results are reported as a single JSON array on stdout so that runs on
+ * different commits can be diffed by tools, while progress goes to stderr.
+ */
+
+uint64_t Bench_now();
+size_t Bench_currentRSS();
+size_t Bench_peakRSS();
+size_t Bench_parameter(const char* name, size_t defaultValue);
+
+void Bench_report(const char* benchmark, const char* metric, double value, const char* unit);
+
+/*
+ * Calls fn(context) repeatedly and reports the median and minimum time per
+ * operation, where each call performs opsPerCall operations. The number of
+ * calls per repetition is calibrated so that one repetition takes about
+ * 10ms, then FUR_BENCH_WARMUP warmup repetitions are discarded before
+ * FUR_BENCH_REPETITIONS measured repetitions.
+ */
+void Bench_measure(const char* benchmark, void (*fn)(void*), void* context, size_t opsPerCall);
+
+void Bench_begin();
+void Bench_end();
+
+#endif
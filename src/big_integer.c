@@ -0,0 +1,741 @@
+#include <assert.h>
+#include <string.h>
+
+#include "big_integer.h"
+
+/*
+ * Below this many limbs in the shorter operand, Karatsuba's extra additions
+ * and allocations cost more than the multiplications they save.
+ */
+#define BIG_INTEGER_KARATSUBA_THRESHOLD 32
+
+static ObjBigInteger* BigInteger_new(size_t count) {
+  ObjBigInteger* self = malloc(sizeof(ObjBigInteger) + sizeof(uint32_t) * count);
+
+  // TODO Handle this
+  assert(self != NULL);
+
+  self->obj.type = OBJ_BIG_INTEGER;
+  self->obj.next = NULL;
+  self->isNegative = false;
+  self->count = count;
+  memset(self->limbs, 0, sizeof(uint32_t) * count);
+
+  return self;
+}
+
+// Drops leading zero limbs, which arithmetic may leave behind
+static ObjBigInteger* BigInteger_trim(ObjBigInteger* self) {
+  while(self->count > 0 && self->limbs[self->count - 1] == 0) self->count--;
+
+  if(self->count == 0) self->isNegative = false;
+
+  return self;
+}
+
+ObjBigInteger* BigInteger_fromInteger(int64_t i) {
+  // Work with the magnitude as unsigned so that INT64_MIN doesn't overflow
+  uint64_t magnitude = i < 0 ? -(uint64_t)i : (uint64_t)i;
+
+  ObjBigInteger* self = BigInteger_new(2);
+  self->isNegative = i < 0;
+  self->limbs[0] = (uint32_t)magnitude;
+  self->limbs[1] = (uint32_t)(magnitude >> 32);
+
+  return BigInteger_trim(self);
+}
+
+void BigInteger_del(ObjBigInteger* self) {
+  free(self);
+}
+
+bool BigInteger_toInteger(ObjBigInteger* self, int64_t* result) {
+  if(self->count > 2) return false;
+
+  uint64_t magnitude = 0;
+  if(self->count > 0) magnitude = self->limbs[0];
+  if(self->count > 1) magnitude |= (uint64_t)(self->limbs[1]) << 32;
+
+  if(self->isNegative) {
+    if(magnitude > (uint64_t)INT64_MAX + 1) return false;
+    *result = magnitude == (uint64_t)INT64_MAX + 1 ? INT64_MIN : -(int64_t)magnitude;
+  } else {
+    if(magnitude > (uint64_t)INT64_MAX) return false;
+    *result = (int64_t)magnitude;
+  }
+
+  return true;
+}
+
+/*
+ * The functions below work on magnitudes as bare limb arrays, so that
+ * Karatsuba multiplication can work on parts of its operands in place.
+ */
+
+static int Limbs_compare(const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+  if(aCount != bCount) return aCount < bCount ? -1 : 1;
+
+  for(size_t i = aCount; i > 0; i--) {
+    if(a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1] ? -1 : 1;
+  }
+
+  return 0;
+}
+
+/*
+ * Writes a + b to the first aCount limbs of out and returns the carry out
+ * of the top limb. Requires aCount >= bCount. out may be a.
+ */
+static uint32_t Limbs_add(uint32_t* out, const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+  assert(aCount >= bCount);
+
+  uint64_t carry = 0;
+
+  for(size_t i = 0; i < aCount; i++) {
+    uint64_t sum = (uint64_t)(a[i]) + (i < bCount ? b[i] : 0) + carry;
+    out[i] = (uint32_t)sum;
+    carry = sum >> 32;
+  }
+
+  return (uint32_t)carry;
+}
+
+/*
+ * Writes a - b to the first aCount limbs of out. Requires a >= b, so there
+ * is never a borrow out of the top limb. out may be a.
+ */
+static void Limbs_subtract(uint32_t* out, const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+  assert(aCount >= bCount);
+
+  uint64_t borrow = 0;
+
+  for(size_t i = 0; i < aCount; i++) {
+    uint64_t difference = (uint64_t)(a[i]) - (i < bCount ? b[i] : 0) - borrow;
+    out[i] = (uint32_t)difference;
+    borrow = (difference >> 32) & 1;
+  }
+
+  assert(borrow == 0);
+}
+
+// Writes a * b to the aCount + bCount limbs of out
+static void Limbs_multiplySchoolbook(uint32_t* out, const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+  memset(out, 0, sizeof(uint32_t) * (aCount + bCount));
+
+  for(size_t i = 0; i < aCount; i++) {
+    uint64_t carry = 0;
+
+    for(size_t j = 0; j < bCount; j++) {
+      uint64_t product = (uint64_t)(a[i]) * b[j] + out[i + j] + carry;
+      out[i + j] = (uint32_t)product;
+      carry = product >> 32;
+    }
+
+    out[i + bCount] = (uint32_t)carry;
+  }
+}
+
+static size_t Limbs_trimmedCount(const uint32_t* limbs, size_t count) {
+  while(count > 0 && limbs[count - 1] == 0) count--;
+  return count;
+}
+
+/*
+ * Writes a * b to the aCount + bCount limbs of out, using Karatsuba's
+ * method once both operands are long enough. Splitting each operand at m
+ * limbs into a1 * B^m + a0 and b1 * B^m + b0, the product is
+ *
+ *   z2 * B^2m + (z1 - z2 - z0) * B^m + z0
+ *
+ * where z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1) * (b0 + b1): three
+ * half-size multiplications rather than four.
+ */
+static void Limbs_multiply(uint32_t* out, const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+  if(aCount < bCount) {
+    const uint32_t* swapLimbs = a;
+    a = b;
+    b = swapLimbs;
+
+    size_t swapCount = aCount;
+    aCount = bCount;
+    bCount = swapCount;
+  }
+
+  if(bCount < BIG_INTEGER_KARATSUBA_THRESHOLD) {
+    Limbs_multiplySchoolbook(out, a, aCount, b, bCount);
+    return;
+  }
+
+  size_t m = (aCount + 1) / 2;
+  size_t productCount = aCount + bCount;
+
+  if(bCount <= m) {
+    /*
+     * b is too short to split, so multiply it by each half of a, which
+     * keeps the recursive multiplications balanced.
+     */
+    memset(out + m + bCount, 0, sizeof(uint32_t) * (productCount - m - bCount));
+    Limbs_multiply(out, a, m, b, bCount);
+
+    size_t highCount = aCount - m + bCount;
+    uint32_t* high = malloc(sizeof(uint32_t) * highCount);
+
+    // TODO Handle this
+    assert(high != NULL);
+
+    Limbs_multiply(high, a + m, aCount - m, b, bCount);
+
+    uint32_t carry = Limbs_add(out + m, out + m, productCount - m, high, highCount);
+    assert(carry == 0);
+
+    free(high);
+    return;
+  }
+
+  const uint32_t* a0 = a;
+  const uint32_t* a1 = a + m;
+  const uint32_t* b0 = b;
+  const uint32_t* b1 = b + m;
+  size_t a1Count = aCount - m;
+  size_t b1Count = bCount - m;
+
+  // z0 and z2 go straight into the low and high parts of out
+  Limbs_multiply(out, a0, m, b0, m);
+  Limbs_multiply(out + 2 * m, a1, a1Count, b1, b1Count);
+
+  uint32_t* sums = malloc(sizeof(uint32_t) * (2 * (m + 1) + 2 * (m + 1)));
+
+  // TODO Handle this
+  assert(sums != NULL);
+
+  uint32_t* aSum = sums;
+  uint32_t* bSum = sums + m + 1;
+  uint32_t* z1 = sums + 2 * (m + 1);
+
+  aSum[m] = Limbs_add(aSum, a0, m, a1, a1Count);
+  bSum[m] = Limbs_add(bSum, b0, m, b1, b1Count);
+
+  Limbs_multiply(z1, aSum, m + 1, bSum, m + 1);
+  Limbs_subtract(z1, z1, 2 * (m + 1), out, 2 * m);
+  Limbs_subtract(z1, z1, 2 * (m + 1), out + 2 * m, a1Count + b1Count);
+
+  /*
+   * z1 is now a0 * b1 + a1 * b0, which is short enough to fit in out above
+   * B^m, though its buffer has leading zeros which don't.
+   */
+  size_t z1Count = Limbs_trimmedCount(z1, 2 * (m + 1));
+  assert(z1Count <= productCount - m);
+
+  uint32_t carry = Limbs_add(out + m, out + m, productCount - m, z1, z1Count);
+  assert(carry == 0);
+
+  free(sums);
+}
+
+/*
+ * Divides the count limbs of u in place by a single limb and returns the
+ * remainder.
+ */
+static uint32_t Limbs_divideBySingle(uint32_t* u, size_t count, uint32_t divisor) {
+  uint64_t remainder = 0;
+
+  for(size_t i = count; i > 0; i--) {
+    uint64_t current = (remainder << 32) | u[i - 1];
+    u[i - 1] = (uint32_t)(current / divisor);
+    remainder = current % divisor;
+  }
+
+  return (uint32_t)remainder;
+}
+
+/*
+ * Writes the uCount - vCount + 1 limbs of u / v to q, using Knuth's
+ * Algorithm D (The Art of Computer Programming, volume 2, 4.3.1). Requires
+ * vCount >= 2, uCount >= vCount and no leading zeros in v.
+ */
+static void Limbs_divide(uint32_t* q, const uint32_t* u, size_t uCount, const uint32_t* v, size_t vCount) {
+  assert(vCount >= 2 && uCount >= vCount && v[vCount - 1] != 0);
+
+  const uint64_t base = (uint64_t)1 << 32;
+
+  /*
+   * Normalize by shifting both operands left until the top bit of v is set,
+   * which keeps each estimated quotient limb within 2 of the real one.
+   */
+  int shift = __builtin_clz(v[vCount - 1]);
+
+  uint32_t* normalized = malloc(sizeof(uint32_t) * (vCount + uCount + 1));
+
+  // TODO Handle this
+  assert(normalized != NULL);
+
+  uint32_t* vn = normalized;
+  uint32_t* un = normalized + vCount;
+
+  for(size_t i = vCount - 1; i > 0; i--) {
+    vn[i] = (v[i] << shift) | (uint32_t)((uint64_t)(v[i - 1]) >> (32 - shift));
+  }
+  vn[0] = v[0] << shift;
+
+  un[uCount] = (uint32_t)((uint64_t)(u[uCount - 1]) >> (32 - shift));
+  for(size_t i = uCount - 1; i > 0; i--) {
+    un[i] = (u[i] << shift) | (uint32_t)((uint64_t)(u[i - 1]) >> (32 - shift));
+  }
+  un[0] = u[0] << shift;
+
+  for(size_t j = uCount - vCount + 1; j > 0; j--) {
+    size_t k = j - 1;
+
+    // Estimate the quotient limb from the top two limbs of the remainder
+    uint64_t numerator = ((uint64_t)(un[k + vCount]) << 32) | un[k + vCount - 1];
+    uint64_t qHat = numerator / vn[vCount - 1];
+    uint64_t rHat = numerator % vn[vCount - 1];
+
+    while(qHat >= base || qHat * vn[vCount - 2] > ((rHat << 32) | un[k + vCount - 2])) {
+      qHat--;
+      rHat += vn[vCount - 1];
+      if(rHat >= base) break;
+    }
+
+    // Multiply and subtract
+    int64_t borrow = 0;
+    int64_t t;
+
+    for(size_t i = 0; i < vCount; i++) {
+      uint64_t product = qHat * vn[i];
+      t = (int64_t)(un[i + k]) - borrow - (int64_t)(product & 0xFFFFFFFF);
+      un[i + k] = (uint32_t)t;
+      borrow = (int64_t)(product >> 32) - (t >> 32);
+    }
+
+    t = (int64_t)(un[k + vCount]) - borrow;
+    un[k + vCount] = (uint32_t)t;
+
+    q[k] = (uint32_t)qHat;
+
+    // The estimate was one too large, which is rare, so add v back
+    if(t < 0) {
+      q[k]--;
+
+      uint64_t carry = 0;
+
+      for(size_t i = 0; i < vCount; i++) {
+        uint64_t sum = (uint64_t)(un[i + k]) + vn[i] + carry;
+        un[i + k] = (uint32_t)sum;
+        carry = sum >> 32;
+      }
+
+      un[k + vCount] += (uint32_t)carry;
+    }
+  }
+
+  free(normalized);
+}
+
+ObjBigInteger* BigInteger_negate(ObjBigInteger* self) {
+  ObjBigInteger* result = BigInteger_new(self->count);
+  memcpy(result->limbs, self->limbs, sizeof(uint32_t) * self->count);
+  result->isNegative = !(self->isNegative);
+  return BigInteger_trim(result);
+}
+
+/*
+ * Adds a and b, with b's sign flipped if isSubtraction, as a magnitude sum
+ * if the signs match and a magnitude difference otherwise.
+ */
+static ObjBigInteger* BigInteger_addSigned(ObjBigInteger* a, ObjBigInteger* b, bool isSubtraction) {
+  bool bIsNegative = b->isNegative != isSubtraction;
+
+  if(a->isNegative == bIsNegative) {
+    if(a->count < b->count) {
+      ObjBigInteger* swap = a;
+      a = b;
+      b = swap;
+    }
+
+    ObjBigInteger* result = BigInteger_new(a->count + 1);
+    result->limbs[a->count] = Limbs_add(result->limbs, a->limbs, a->count, b->limbs, b->count);
+    result->isNegative = bIsNegative;
+    return BigInteger_trim(result);
+  }
+
+  // The result has the sign of whichever has the larger magnitude
+  bool resultIsNegative = a->isNegative;
+
+  if(Limbs_compare(a->limbs, a->count, b->limbs, b->count) < 0) {
+    ObjBigInteger* swap = a;
+    a = b;
+    b = swap;
+    resultIsNegative = bIsNegative;
+  }
+
+  ObjBigInteger* result = BigInteger_new(a->count);
+  Limbs_subtract(result->limbs, a->limbs, a->count, b->limbs, b->count);
+  result->isNegative = resultIsNegative;
+  return BigInteger_trim(result);
+}
+
+ObjBigInteger* BigInteger_add(ObjBigInteger* a, ObjBigInteger* b) {
+  return BigInteger_addSigned(a, b, false);
+}
+
+ObjBigInteger* BigInteger_subtract(ObjBigInteger* a, ObjBigInteger* b) {
+  return BigInteger_addSigned(a, b, true);
+}
+
+ObjBigInteger* BigInteger_multiply(ObjBigInteger* a, ObjBigInteger* b) {
+  if(a->count == 0 || b->count == 0) return BigInteger_new(0);
+
+  ObjBigInteger* result = BigInteger_new(a->count + b->count);
+  Limbs_multiply(result->limbs, a->limbs, a->count, b->limbs, b->count);
+  result->isNegative = a->isNegative != b->isNegative;
+  return BigInteger_trim(result);
+}
+
+ObjBigInteger* BigInteger_divide(ObjBigInteger* a, ObjBigInteger* b) {
+  assert(b->count > 0);
+
+  if(Limbs_compare(a->limbs, a->count, b->limbs, b->count) < 0) {
+    return BigInteger_new(0);
+  }
+
+  ObjBigInteger* result = BigInteger_new(a->count - b->count + 1);
+
+  if(b->count == 1) {
+    memcpy(result->limbs, a->limbs, sizeof(uint32_t) * a->count);
+    result->count = a->count;
+    Limbs_divideBySingle(result->limbs, a->count, b->limbs[0]);
+  } else {
+    Limbs_divide(result->limbs, a->limbs, a->count, b->limbs, b->count);
+  }
+
+  result->isNegative = a->isNegative != b->isNegative;
+  return BigInteger_trim(result);
+}
+
+int BigInteger_compare(ObjBigInteger* a, ObjBigInteger* b) {
+  if(a->isNegative != b->isNegative) return a->isNegative ? -1 : 1;
+
+  int magnitudeOrder = Limbs_compare(a->limbs, a->count, b->limbs, b->count);
+  return a->isNegative ? -magnitudeOrder : magnitudeOrder;
+}
+
+ObjBigInteger* BigInteger_fromDecimal(const uint8_t* digits, size_t count, bool isNegative) {
+  // A limb holds more than 9 decimal digits
+  ObjBigInteger* self = BigInteger_new(count / 9 + 1);
+  size_t used = 0;
+
+  /*
+   * Multiply in 9 digits at a time, the most that fit in a limb, starting
+   * with whatever is left over so that the rest are whole chunks.
+   */
+  size_t chunkLength = count % 9 == 0 ? 9 : count % 9;
+
+  for(size_t i = 0; i < count; i += chunkLength, chunkLength = 9) {
+    uint32_t chunk = 0;
+    uint32_t multiplier = 1;
+
+    for(size_t j = 0; j < chunkLength; j++) {
+      chunk = chunk * 10 + (digits[i + j] - '0');
+      multiplier *= 10;
+    }
+
+    uint64_t carry = chunk;
+
+    for(size_t j = 0; j < used; j++) {
+      uint64_t product = (uint64_t)(self->limbs[j]) * multiplier + carry;
+      self->limbs[j] = (uint32_t)product;
+      carry = product >> 32;
+    }
+
+    if(carry != 0) self->limbs[used++] = (uint32_t)carry;
+  }
+
+  self->isNegative = isNegative;
+  return BigInteger_trim(self);
+}
+
+uint8_t* BigInteger_toDecimal(ObjBigInteger* self, size_t* count) {
+  // Each limb is less than 10 decimal digits, and there may be a sign
+  size_t capacity = self->count * 10 + 2;
+  uint8_t* digits = malloc(capacity);
+
+  // TODO Handle this
+  assert(digits != NULL);
+
+  if(self->count == 0) {
+    digits[0] = '0';
+    *count = 1;
+    return digits;
+  }
+
+  /*
+   * Peel off 9 decimal digits at a time, least significant first, by
+   * dividing a copy of the magnitude by 10^9.
+   */
+  const uint32_t chunkDivisor = 1000000000;
+
+  size_t limbCount = self->count;
+  uint32_t* magnitude = malloc(sizeof(uint32_t) * limbCount);
+
+  // TODO Handle this
+  assert(magnitude != NULL);
+
+  memcpy(magnitude, self->limbs, sizeof(uint32_t) * limbCount);
+
+  size_t start = capacity;
+
+  while(limbCount > 0) {
+    uint32_t chunk = Limbs_divideBySingle(magnitude, limbCount, chunkDivisor);
+    limbCount = Limbs_trimmedCount(magnitude, limbCount);
+
+    // Chunks are zero-padded, except the most significant
+    for(size_t i = 0; i < 9 && (limbCount > 0 || chunk > 0); i++) {
+      digits[--start] = '0' + chunk % 10;
+      chunk /= 10;
+    }
+  }
+
+  if(self->isNegative) digits[--start] = '-';
+
+  free(magnitude);
+
+  *count = capacity - start;
+  memmove(digits, digits + start, *count);
+  return digits;
+}
+
+void BigInteger_write(Output* out, ObjBigInteger* self) {
+  size_t count;
+  uint8_t* digits = BigInteger_toDecimal(self, &count);
+
+  Output_write(out, digits, count);
+  free(digits);
+}
+
+#ifdef TEST
+
+#include <unistd.h>
+
+static ObjBigInteger* BigInteger_random(size_t count, uint32_t* seed) {
+  ObjBigInteger* result = BigInteger_new(count);
+
+  for(size_t i = 0; i < count; i++) {
+    // xorshift32, which is enough to fill limbs with varied bits
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    result->limbs[i] = *seed;
+  }
+
+  return BigInteger_trim(result);
+}
+
+static void BigInteger_assertWrites(ObjBigInteger* self, const char* expected) {
+  int channel[2];
+  assert(pipe(channel) == 0);
+
+  Output* output = malloc(sizeof(Output));
+  Output_init(output, channel[1]);
+  BigInteger_write(output, self);
+  Output_flush(output);
+
+  char buffer[128];
+  ssize_t count = read(channel[0], buffer, sizeof(buffer));
+
+  assert(count == (ssize_t)strlen(expected));
+  assert(strncmp(buffer, expected, count) == 0);
+
+  free(output);
+  close(channel[0]);
+  close(channel[1]);
+}
+
+void test_BigInteger_toInteger_limits() {
+  int64_t integers[] = { 0, 1, -1, INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+
+  for(size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); i++) {
+    ObjBigInteger* big = BigInteger_fromInteger(integers[i]);
+    int64_t result;
+
+    assert(BigInteger_toInteger(big, &result));
+    assert(result == integers[i]);
+
+    BigInteger_del(big);
+  }
+
+  ObjBigInteger* one = BigInteger_fromInteger(1);
+  ObjBigInteger* max = BigInteger_fromInteger(INT64_MAX);
+  ObjBigInteger* min = BigInteger_fromInteger(INT64_MIN);
+  ObjBigInteger* aboveMax = BigInteger_add(max, one);
+  ObjBigInteger* belowMin = BigInteger_subtract(min, one);
+  int64_t result;
+
+  assert(!BigInteger_toInteger(aboveMax, &result));
+  assert(!BigInteger_toInteger(belowMin, &result));
+  assert(aboveMax->count == 2);
+  assert(belowMin->count == 2);
+
+  BigInteger_del(belowMin);
+  BigInteger_del(aboveMax);
+  BigInteger_del(min);
+  BigInteger_del(max);
+  BigInteger_del(one);
+}
+
+void test_BigInteger_add_carriesAndSigns() {
+  ObjBigInteger* a = BigInteger_fromInteger(INT64_MAX);
+  ObjBigInteger* b = BigInteger_fromInteger(INT64_MAX);
+
+  // (2^63 - 1) * 2 = 2^64 - 2
+  ObjBigInteger* sum = BigInteger_add(a, b);
+  assert(sum->count == 2);
+  assert(sum->limbs[0] == 0xFFFFFFFE);
+  assert(sum->limbs[1] == 0xFFFFFFFF);
+  assert(!(sum->isNegative));
+
+  // Carries into a new limb
+  ObjBigInteger* two = BigInteger_fromInteger(2);
+  ObjBigInteger* power = BigInteger_add(sum, two);
+  assert(power->count == 3);
+  assert(power->limbs[0] == 0 && power->limbs[1] == 0 && power->limbs[2] == 1);
+
+  // Mixed signs subtract magnitudes, and cancelling out leaves zero
+  ObjBigInteger* negative = BigInteger_negate(power);
+  ObjBigInteger* difference = BigInteger_add(two, negative);
+  assert(difference->isNegative);
+  assert(BigInteger_compare(difference, negative) > 0);
+
+  ObjBigInteger* zero = BigInteger_add(power, negative);
+  assert(zero->count == 0);
+  assert(!(zero->isNegative));
+
+  BigInteger_del(zero);
+  BigInteger_del(difference);
+  BigInteger_del(negative);
+  BigInteger_del(power);
+  BigInteger_del(two);
+  BigInteger_del(sum);
+  BigInteger_del(b);
+  BigInteger_del(a);
+}
+
+void test_BigInteger_multiply_karatsubaMatchesSchoolbook() {
+  uint32_t seed = 12345;
+
+  // Balanced and unbalanced sizes on both sides of the threshold
+  size_t sizes[][2] = { { 31, 31 }, { 32, 32 }, { 100, 100 }, { 257, 130 }, { 300, 40 }, { 500, 33 } };
+
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    ObjBigInteger* a = BigInteger_random(sizes[i][0], &seed);
+    ObjBigInteger* b = BigInteger_random(sizes[i][1], &seed);
+
+    size_t count = a->count + b->count;
+    uint32_t* expected = malloc(sizeof(uint32_t) * count);
+    uint32_t* actual = malloc(sizeof(uint32_t) * count);
+
+    Limbs_multiplySchoolbook(expected, a->limbs, a->count, b->limbs, b->count);
+    Limbs_multiply(actual, a->limbs, a->count, b->limbs, b->count);
+
+    assert(memcmp(expected, actual, sizeof(uint32_t) * count) == 0);
+
+    free(actual);
+    free(expected);
+    BigInteger_del(b);
+    BigInteger_del(a);
+  }
+}
+
+void test_BigInteger_divide_inverseOfMultiply() {
+  uint32_t seed = 54321;
+
+  size_t sizes[][2] = { { 3, 1 }, { 2, 2 }, { 10, 4 }, { 40, 39 }, { 100, 60 } };
+
+  for(size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    ObjBigInteger* a = BigInteger_random(sizes[i][0], &seed);
+    ObjBigInteger* b = BigInteger_random(sizes[i][1], &seed);
+    ObjBigInteger* one = BigInteger_fromInteger(1);
+
+    // The largest remainder, which is most likely to expose a bad estimate
+    ObjBigInteger* remainder = BigInteger_subtract(b, one);
+
+    b->isNegative = true;
+
+    ObjBigInteger* product = BigInteger_multiply(a, b);
+    ObjBigInteger* dividend = BigInteger_subtract(product, remainder);
+
+    // Truncating division: (-(a * |b|) - r) / -|b| = a
+    ObjBigInteger* quotient = BigInteger_divide(dividend, b);
+    assert(BigInteger_compare(quotient, a) == 0);
+
+    BigInteger_del(quotient);
+    BigInteger_del(dividend);
+    BigInteger_del(product);
+    BigInteger_del(remainder);
+    BigInteger_del(one);
+    BigInteger_del(b);
+    BigInteger_del(a);
+  }
+}
+
+void test_BigInteger_write_decimal() {
+  ObjBigInteger* zero = BigInteger_fromInteger(0);
+  ObjBigInteger* min = BigInteger_fromInteger(INT64_MIN);
+  ObjBigInteger* billion = BigInteger_fromInteger(1000000000);
+  ObjBigInteger* one = BigInteger_fromInteger(1);
+  ObjBigInteger* max = BigInteger_fromInteger(INT64_MAX);
+  ObjBigInteger* aboveMax = BigInteger_add(max, one);
+  ObjBigInteger* square = BigInteger_multiply(aboveMax, aboveMax);
+  ObjBigInteger* billionSquared = BigInteger_multiply(billion, billion);
+  ObjBigInteger* negativeSquare = BigInteger_negate(square);
+
+  BigInteger_assertWrites(zero, "0");
+  BigInteger_assertWrites(min, "-9223372036854775808");
+  BigInteger_assertWrites(aboveMax, "9223372036854775808");
+  BigInteger_assertWrites(billionSquared, "1000000000000000000");
+  BigInteger_assertWrites(negativeSquare, "-85070591730234615865843651857942052864");
+
+  BigInteger_del(negativeSquare);
+  BigInteger_del(billionSquared);
+  BigInteger_del(square);
+  BigInteger_del(aboveMax);
+  BigInteger_del(max);
+  BigInteger_del(one);
+  BigInteger_del(billion);
+  BigInteger_del(min);
+  BigInteger_del(zero);
+}
+
+void test_BigInteger_fromDecimal_inverseOfWrite() {
+  const char* texts[] = {
+    "0",
+    "9223372036854775808",
+    "-9223372036854775809",
+    "1000000000000000000000000000",
+    "-85070591730234615865843651857942052864",
+    "123456789123456789123456789123456789123456789",
+  };
+
+  for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    bool isNegative = texts[i][0] == '-';
+    const char* digits = texts[i] + isNegative;
+
+    ObjBigInteger* parsed = BigInteger_fromDecimal((const uint8_t*)digits, strlen(digits), isNegative);
+    BigInteger_assertWrites(parsed, texts[i]);
+
+    size_t count;
+    uint8_t* text = BigInteger_toDecimal(parsed, &count);
+    assert(count == strlen(texts[i]));
+    assert(memcmp(text, texts[i], count) == 0);
+
+    free(text);
+    BigInteger_del(parsed);
+  }
+
+  // Leading zeros and negative zero both parse as plain zero
+  ObjBigInteger* zero = BigInteger_fromDecimal((const uint8_t*)"0000000000000", 13, true);
+  assert(zero->count == 0 && !zero->isNegative);
+  BigInteger_del(zero);
+}
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef BIG_INTEGER_H
+#define BIG_INTEGER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "object.h"
+#include "output.h"
+
+/*
+ * An arbitrary-precision integer, for results which don't fit in the
+ * int64_t of a VALUE_INTEGER. The magnitude is stored as 32-bit limbs, least
+ * significant first, so that the product of two limbs fits in a uint64_t.
+ * There are never leading zero limbs, and zero has no limbs.
+ *
+ * Integer arithmetic only produces these when the result doesn't fit in an
+ * int64_t, so each integer has exactly one representation. Callers should
+ * check BigInteger_toInteger() on every result.
+ *
+ * Every function returning an ObjBigInteger* returns a new one, which the
+ * caller owns and frees with BigInteger_del().
+ */
+typedef struct {
+  Obj obj;
+  bool isNegative;
+  size_t count;
+  uint32_t limbs[];
+} ObjBigInteger;
+
+ObjBigInteger* BigInteger_fromInteger(int64_t);
+void BigInteger_del(ObjBigInteger*);
+
+// Returns false if the value doesn't fit in an int64_t
+bool BigInteger_toInteger(ObjBigInteger*, int64_t* result);
+
+ObjBigInteger* BigInteger_negate(ObjBigInteger*);
+ObjBigInteger* BigInteger_add(ObjBigInteger*, ObjBigInteger*);
+ObjBigInteger* BigInteger_subtract(ObjBigInteger*, ObjBigInteger*);
+ObjBigInteger* BigInteger_multiply(ObjBigInteger*, ObjBigInteger*);
+
+// Truncates toward zero, like C's integer division. The divisor can't be 0.
+ObjBigInteger* BigInteger_divide(ObjBigInteger*, ObjBigInteger*);
+
+// Returns a negative number, 0 or a positive number, like strcmp()
+int BigInteger_compare(ObjBigInteger*, ObjBigInteger*);
+
+/*
+ * Parses count decimal digits, which the caller has checked are all ASCII
+ * digits, with no sign.
+ */
+ObjBigInteger* BigInteger_fromDecimal(const uint8_t* digits, size_t count, bool isNegative);
+
+// Returns the decimal text in a buffer which the caller frees, setting *count
+uint8_t* BigInteger_toDecimal(ObjBigInteger*, size_t* count);
+
+void BigInteger_write(Output*, ObjBigInteger*);
+
+#ifdef TEST
+
+void test_BigInteger_toInteger_limits();
+void test_BigInteger_add_carriesAndSigns();
+void test_BigInteger_multiply_karatsubaMatchesSchoolbook();
+void test_BigInteger_divide_inverseOfMultiply();
+void test_BigInteger_write_decimal();
+void test_BigInteger_fromDecimal_inverseOfWrite();
+
+#endif
+
+#endif
@@ -2,27 +2,119 @@
 #define BLOB_H
 
 #include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+/*
+ * The bytes of a string. The hash is computed on first use by Blob_hash(),
+ * and is 0 until then. String literals are hashed and interned by the
+ * compiler, so equal literals share a Blob and already know their hash.
+ *
+ * Strings made at run time are owned by the Thread which made them, which
+ * allocates them behind an Obj header (see Thread_newBlob()) so that they
+ * can be collected. Literals and strings restored from a snapshot aren't.
+ * isOwned is a uint32_t rather than a bool to keep the bytes aligned for
+ * UTF-32 code points.
+ */
 typedef struct {
   size_t count;
+  uint32_t hash;
+  uint32_t isOwned;
   uint8_t bytes[];
 } Blob;
 
+// Allocates a Blob for count bytes, which the caller fills in
+inline static Blob* Blob_new(size_t count) {
+  Blob* self = malloc(sizeof(Blob) + count);
+
+  // TODO Handle this
+  assert(self != NULL);
+
+  self->count = count;
+  self->hash = 0;
+  self->isOwned = false;
+  return self;
+}
+
+inline static uint32_t Blob_hash(Blob* self) {
+  if(self->hash != 0) return self->hash;
+
+  /*
+   * FNV-1a, as for symbols. 0 marks the hash as not computed yet, so a
+   * string which really hashes to 0 is given 1 instead.
+   */
+  uint32_t hash = 2166136261u;
+
+  for(size_t i = 0; i < self->count; i++) {
+    hash ^= self->bytes[i];
+    hash *= 16777619;
+  }
+
+  self->hash = hash == 0 ? 1 : hash;
+  return self->hash;
+}
+
+/*
+ * Checks the cheap things first: interned strings are the same Blob, and
+ * strings of different lengths or (already computed) hashes differ. Only
+ * then are the bytes compared, with memcmp(), which libc vectorizes.
+ */
+inline static bool Blob_equals(Blob* self, Blob* other) {
+  if(self == other) return true;
+  if(self->count != other->count) return false;
+  if(self->hash != 0 && other->hash != 0 && self->hash != other->hash) return false;
+
+  return memcmp(self->bytes, other->bytes, self->count) == 0;
+}
+
+/*
+ * Orders strings by their bytes, which for UTF-8 is the order of their code
+ * points. Returns a negative number, 0 or a positive number, like strcmp().
+ */
+inline static int Bytes_compare(const uint8_t* a, size_t aCount, const uint8_t* b, size_t bCount) {
+  int result = memcmp(a, b, aCount < bCount ? aCount : bCount);
+
+  if(result != 0) return result;
+  return (aCount > bCount) - (aCount < bCount);
+}
+
+inline static int Blob_compare(Blob* self, Blob* other) {
+  if(self == other) return 0;
+  return Bytes_compare(self->bytes, self->count, other->bytes, other->count);
+}
+
+/*
+ * The string literals of a ByteCode. The compiler interns literals with
+ * BlobList_find(), which looks them up in slots, a hash table of item
+ * indices plus one (0 is an empty slot) probed linearly from the slot
+ * Fibonacci hashing picks, as in SymbolTable. Items are added to the table
+ * by the first find after they're appended, since snapshots and tests
+ * append blobs which aren't hashed yet, or are NULL.
+ */
 typedef struct {
   size_t count;
   size_t capacity;
   Blob** items;
+
+  size_t* slots;
+  size_t slotCount;
+  size_t indexedCount;
 } BlobList;
 
 inline static void BlobList_init(BlobList* self) {
   self->count = 0;
   self->capacity = 0;
   self->items = NULL;
+  self->slots = NULL;
+  self->slotCount = 0;
+  self->indexedCount = 0;
 }
 
 inline static void BlobList_free(BlobList* self) {
   free(self->items);
+  free(self->slots);
 }
 
 inline static size_t BlobList_append(BlobList* self, Blob* item) {
@@ -41,4 +133,57 @@ inline static size_t BlobList_append(BlobList* self, Blob* item) {
   return self->count++;
 }
 
+inline static size_t BlobList_firstSlot(BlobList* self, uint32_t hash) {
+  // 2^64 / phi, as in SymbolTable; slotCount is a power of 2
+  int shift = 64 - __builtin_ctzll(self->slotCount);
+  return (11400714819323198485llu * (unsigned long long)hash) >> shift;
+}
+
+// Adds the items appended since the last find to the slots
+inline static void BlobList_index(BlobList* self) {
+  if(self->slotCount == 0 || self->count * 4 > self->slotCount * 3) {
+    // Rebuilding is simpler than moving entries, and amortizes the same
+    if(self->slotCount == 0) self->slotCount = 16;
+    while(self->count * 4 > self->slotCount * 3) self->slotCount *= 2;
+
+    free(self->slots);
+    self->slots = calloc(self->slotCount, sizeof(size_t));
+    assert(self->slots != NULL);
+    self->indexedCount = 0;
+  }
+
+  for(; self->indexedCount < self->count; self->indexedCount++) {
+    Blob* item = self->items[self->indexedCount];
+    if(item == NULL) continue;
+
+    size_t slot = BlobList_firstSlot(self, Blob_hash(item));
+
+    while(self->slots[slot] != 0) {
+      slot = (slot + 1) & (self->slotCount - 1);
+    }
+
+    self->slots[slot] = self->indexedCount + 1;
+  }
+}
+
+// Returns false if no item is equal to blob, leaving index untouched
+inline static bool BlobList_find(BlobList* self, Blob* blob, size_t* index) {
+  BlobList_index(self);
+
+  size_t slot = BlobList_firstSlot(self, Blob_hash(blob));
+
+  while(self->slots[slot] != 0) {
+    size_t item = self->slots[slot] - 1;
+
+    if(Blob_equals(self->items[item], blob)) {
+      *index = item;
+      return true;
+    }
+
+    slot = (slot + 1) & (self->slotCount - 1);
+  }
+
+  return false;
+}
+
 #endif
@@ -1,22 +1,114 @@
 #ifndef BUILTINS_H
 #define BUILTINS_H
 
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 
+#include "decimal.h"
+#include "kernel.h"
+#include "map.h"
+#include "output.h"
+#include "thread.h"
+#include "utf8.h"
 #include "value.h"
 
+/*
+ * Builtins report arguments they can't handle through Thread_panic(), like
+ * Fur code calling a function with the wrong number of arguments.
+ */
+static Value Builtin_arityError(const char* name, const char* arity, uint8_t argc) {
+  return Thread_panic(
+    "Function `%s` takes %s argument(s) but was called with %d.",
+    name,
+    arity,
+    (int)argc
+  );
+}
+
+static Value Builtin_typeError(const char* name, const char* expected, Value actual) {
+  return Thread_panic(
+    "Function `%s` takes %s, not `%s`.",
+    name,
+    expected,
+    ValueType_toCString(actual.type)
+  );
+}
+
 static Value Builtin_print(uint8_t argc, Value* argv) {
   for(size_t i = 0; i < argc; i++) {
-    if(i != 0) printf(" ");
+    if(i != 0) Output_writeByte(Output_standard(), ' ');
     Value_print(argv[i]);
   }
 
-  fflush(stdout);
+  return NIL;
+}
 
+/*
+ * Strings convert to booleans and integers by parsing, and text which isn't
+ * a boolean or an integer gives nil rather than an error, so that scripts
+ * reading input can check for it.
+ */
+static Value Builtin_parseBoolean(const uint8_t* bytes, size_t count) {
+  if(count == 4 && memcmp(bytes, "true", 4) == 0) return TRUE;
+  if(count == 5 && memcmp(bytes, "false", 5) == 0) return FALSE;
   return NIL;
 }
 
+// Integers which don't fit in an int64_t are parsed as big integers
+static Value Builtin_parseInteger(const uint8_t* bytes, size_t count) {
+  int64_t result;
+
+  switch(Decimal_parse(bytes, count, &result)) {
+    case DECIMAL_OK:
+      return Value_fromInteger(result);
+
+    case DECIMAL_INVALID:
+      return NIL;
+
+    case DECIMAL_OVERFLOW:
+      {
+        bool isNegative = bytes[0] == '-';
+
+        // Builtins are only called from inside Thread_run()
+        assert(Thread_running != NULL);
+
+        return Thread_normalizeBigInteger(
+          Thread_running,
+          BigInteger_fromDecimal(bytes + isNegative, count - isNegative, isNegative)
+        );
+      }
+  }
+
+  // Should never happen
+  assert(false);
+  return NIL;
+}
+
+/*
+ * Parses a string of either encoding with parse. UTF-32 strings are
+ * transcoded to UTF-8 first, on the stack if they're short enough.
+ */
+static Value Builtin_parseString(Value text, Value (*parse)(const uint8_t*, size_t)) {
+  if(Value_isUTF8(text)) return parse(Value_utf8Bytes(&text), Value_utf8Count(&text));
+
+  const uint32_t* codePoints = Value_asCodePoints(text);
+  size_t codePointCount = Value_codePointCount(text);
+  size_t count = UTF32_countUTF8Bytes(codePoints, codePointCount);
+
+  uint8_t buffer[64];
+  uint8_t* bytes = count <= sizeof(buffer) ? buffer : malloc(count);
+
+  // TODO Handle this
+  assert(bytes != NULL);
+
+  UTF32_toUTF8(codePoints, codePointCount, bytes);
+  Value result = parse(bytes, count);
+
+  if(bytes != buffer) free(bytes);
+  return result;
+}
+
 static Value Builtin_Bool(uint8_t argc, Value* argv) {
   assert(argc == 1);
 
@@ -27,16 +119,38 @@ static Value Builtin_Bool(uint8_t argc, Value* argv) {
       return arg0;
 
     case VALUE_NATIVE_FN:
+    case VALUE_NATIVE:
+    case VALUE_FN:
+    case VALUE_CLOSURE:
       return TRUE;
 
+    case VALUE_STACK_CLOSURE:
+    case VALUE_BOX:
+      // Boxes and stack closures are never passed to functions
+      assert(false);
+      return NIL;
+
     case VALUE_NIL:
       return FALSE;
 
     case VALUE_INTEGER:
       return Value_fromBoolean(Value_asInteger(arg0) != 0);
 
+    case VALUE_BIG_INTEGER:
+      // Big integers are never 0
+      return TRUE;
+
     case VALUE_UTF8:
-      assert(false); // TODO Does this type conversion even make sense?
+    case VALUE_SMALL_UTF8:
+    case VALUE_UTF32:
+      return Builtin_parseString(arg0, Builtin_parseBoolean);
+
+    case VALUE_ARRAY:
+    case VALUE_MAP:
+    case VALUE_RANGE:
+    case VALUE_STRING_BUILDER:
+      // Like text which isn't a boolean, these have no conversion
+      return NIL;
   }
 
   // Should never happen
@@ -53,8 +167,9 @@ static Value Builtin_Int(uint8_t argc, Value* argv) {
     case VALUE_BOOLEAN:
       return Value_fromInteger(Value_asBoolean(arg0) ? 1 : 0);
 
-    case VALUE_NATIVE_FN:
-      // TODO Handle this better
+    case VALUE_STACK_CLOSURE:
+    case VALUE_BOX:
+      // Boxes and stack closures are never passed to functions
       assert(false);
       return NIL;
 
@@ -62,10 +177,105 @@ static Value Builtin_Int(uint8_t argc, Value* argv) {
       return Value_fromInteger(0);
 
     case VALUE_INTEGER:
+    case VALUE_BIG_INTEGER:
       return arg0;
 
     case VALUE_UTF8:
-      assert(false); // TODO Implement
+    case VALUE_SMALL_UTF8:
+    case VALUE_UTF32:
+      return Builtin_parseString(arg0, Builtin_parseInteger);
+
+    case VALUE_NATIVE_FN:
+    case VALUE_NATIVE:
+    case VALUE_FN:
+    case VALUE_CLOSURE:
+    case VALUE_ARRAY:
+    case VALUE_MAP:
+    case VALUE_RANGE:
+    case VALUE_STRING_BUILDER:
+      // Like text which isn't an integer, these have no conversion
+      return NIL;
+  }
+
+  // Should never happen
+  assert(false);
+  return NIL;
+}
+
+/*
+ * The text which print() writes for a boolean, nil or an integer, or a
+ * string as UTF-8. Other values give nil.
+ */
+static Value Builtin_UTF8(uint8_t argc, Value* argv) {
+  assert(argc == 1);
+
+  Value arg0 = argv[0];
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  switch(arg0.type) {
+    case VALUE_BOOLEAN:
+      return Value_asBoolean(arg0)
+        ? Value_fromSmallUTF8((const uint8_t*)"true", 4)
+        : Value_fromSmallUTF8((const uint8_t*)"false", 5);
+
+    case VALUE_NIL:
+      return Value_fromSmallUTF8((const uint8_t*)"nil", 3);
+
+    case VALUE_INTEGER:
+      {
+        uint8_t digits[DECIMAL_MAX_LENGTH];
+        size_t count = Decimal_format(Value_asInteger(arg0), digits);
+        return Thread_newUTF8(Thread_running, digits, count);
+      }
+
+    case VALUE_BIG_INTEGER:
+      {
+        size_t count;
+        uint8_t* digits = BigInteger_toDecimal(Value_asBigInteger(arg0), &count);
+        Value result = Thread_newUTF8(Thread_running, digits, count);
+
+        free(digits);
+        return result;
+      }
+
+    case VALUE_UTF8:
+    case VALUE_SMALL_UTF8:
+      return arg0;
+
+    case VALUE_UTF32:
+      {
+        const uint32_t* codePoints = Value_asCodePoints(arg0);
+        size_t codePointCount = Value_codePointCount(arg0);
+        size_t count = UTF32_countUTF8Bytes(codePoints, codePointCount);
+
+        if(count <= SMALL_UTF8_CAPACITY) {
+          uint8_t bytes[SMALL_UTF8_CAPACITY];
+          UTF32_toUTF8(codePoints, codePointCount, bytes);
+          return Value_fromSmallUTF8(bytes, count);
+        }
+
+        Blob* blob = Thread_newBlob(Thread_running, count);
+        UTF32_toUTF8(codePoints, codePointCount, blob->bytes);
+        return Value_fromBlob(VALUE_UTF8, blob);
+      }
+
+    case VALUE_STACK_CLOSURE:
+    case VALUE_BOX:
+      // Boxes and stack closures are never passed to functions
+      assert(false);
+      return NIL;
+
+    case VALUE_NATIVE_FN:
+    case VALUE_NATIVE:
+    case VALUE_FN:
+    case VALUE_CLOSURE:
+    case VALUE_ARRAY:
+    case VALUE_MAP:
+    case VALUE_RANGE:
+    case VALUE_STRING_BUILDER:
+      return NIL;
   }
 
   // Should never happen
@@ -75,22 +285,408 @@ static Value Builtin_Int(uint8_t argc, Value* argv) {
 
 static Value Builtin_println(uint8_t argc, Value* argv) {
   Builtin_print(argc, argv);
-  printf("\n");
+  Output_writeByte(Output_standard(), '\n');
+  return NIL;
+}
+
+/*
+ * Appends to an array, or a UTF-8 string or an integer to a string builder,
+ * in place
+ */
+static Value Builtin_append(uint8_t argc, Value* argv) {
+  if(argc != 2) return Builtin_arityError("append", "2", argc);
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  if(argv[0].type == VALUE_STRING_BUILDER && argv[1].type == VALUE_INTEGER) {
+    // Integers are formatted without making a string of them first
+    uint8_t digits[DECIMAL_MAX_LENGTH];
+    size_t count = Decimal_format(Value_asInteger(argv[1]), digits);
+
+    Thread_appendBytes(Thread_running, Value_asStringBuilder(argv[0]), digits, count);
+    return NIL;
+  }
+
+  if(argv[0].type == VALUE_STRING_BUILDER) {
+    if(!Value_isUTF8(argv[1])) {
+      return Thread_panic(
+        "Cannot append a value of type `%s` to a `StringBuilder`.",
+        ValueType_toCString(argv[1].type)
+      );
+    }
+
+    Thread_appendBytes(
+      Thread_running,
+      Value_asStringBuilder(argv[0]),
+      Value_utf8Bytes(&argv[1]),
+      Value_utf8Count(&argv[1])
+    );
+    return NIL;
+  }
+
+  if(argv[0].type != VALUE_ARRAY) {
+    return Builtin_typeError("append", "an `Array` or `StringBuilder`", argv[0]);
+  }
+
+  Thread_appendItem(Thread_running, Value_asArray(argv[0]), argv[1]);
+  return NIL;
+}
+
+/*
+ * reserve(array, count) or reserve(builder, count), which makes room for
+ * count items or bytes in all, so that appending up to that many doesn't
+ * have to grow it.
+ */
+static Value Builtin_reserve(uint8_t argc, Value* argv) {
+  if(argc != 2) return Builtin_arityError("reserve", "2", argc);
+
+  if(argv[0].type != VALUE_ARRAY && argv[0].type != VALUE_STRING_BUILDER) {
+    return Builtin_typeError("reserve", "an `Array` or `StringBuilder`", argv[0]);
+  }
+
+  if(argv[1].type != VALUE_INTEGER) {
+    return Builtin_typeError("reserve", "an `Integer` capacity", argv[1]);
+  }
+
+  if(Value_asInteger(argv[1]) < 0) {
+    return Thread_panic(
+      "Function `reserve` takes a capacity of at least 0, not %" PRId64 ".",
+      Value_asInteger(argv[1])
+    );
+  }
+
+  size_t capacity = (size_t)Value_asInteger(argv[1]);
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  if(argv[0].type == VALUE_STRING_BUILDER) {
+    Thread_reserveBytes(Thread_running, Value_asStringBuilder(argv[0]), capacity);
+    return NIL;
+  }
+
+  Thread_reserveItems(Thread_running, Value_asArray(argv[0]), capacity);
   return NIL;
 }
 
+static Value Builtin_has(uint8_t argc, Value* argv) {
+  if(argc != 2) return Builtin_arityError("has", "2", argc);
+  if(argv[0].type != VALUE_MAP) return Builtin_typeError("has", "a `Map`", argv[0]);
+
+  Value value;
+  return Value_fromBoolean(ObjMap_get(Value_asMap(argv[0]), argv[1], &value));
+}
+
+// Removes a key from a map in place, returning whether it was there
+static Value Builtin_remove(uint8_t argc, Value* argv) {
+  if(argc != 2) return Builtin_arityError("remove", "2", argc);
+  if(argv[0].type != VALUE_MAP) return Builtin_typeError("remove", "a `Map`", argv[0]);
+
+  return Value_fromBoolean(ObjMap_remove(Value_asMap(argv[0]), argv[1]));
+}
+
+/*
+ * range(stop) or range(start, stop). The range is lazy (see ObjRange), and
+ * for loops over a call to range() don't create it at all.
+ */
+static Value Builtin_range(uint8_t argc, Value* argv) {
+  if(argc != 1 && argc != 2) return Builtin_arityError("range", "1 or 2", argc);
+
+  if(argc == 1 && argv[0].type != VALUE_INTEGER) {
+    return Builtin_typeError("range", "an `Integer`", argv[0]);
+  }
+
+  // The same error as the loops which don't call range()
+  if(argc == 2 && (argv[0].type != VALUE_INTEGER || argv[1].type != VALUE_INTEGER)) {
+    return Thread_panic(
+      "Cannot make a range of values of type `%s` and `%s`.",
+      ValueType_toCString(argv[0].type),
+      ValueType_toCString(argv[1].type)
+    );
+  }
+
+  int64_t start = argc == 1 ? 0 : Value_asInteger(argv[0]);
+  int64_t stop = Value_asInteger(argv[argc - 1]);
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  return Value_fromRange(Thread_newRange(Thread_running, start, stop));
+}
+
+/*
+ * sum(), min() and max() reduce an array of integers, and count() counts the
+ * trues in an array of booleans, like the masks comparing an array gives.
+ * They run the kernels in kernel.h, and only the items those stop at, such
+ * as big integers, go down the general path.
+ */
+
+// Adds item to total, freeing the old total
+static ObjBigInteger* Builtin_addBigInteger(ObjBigInteger* total, Value item) {
+  ObjBigInteger* addend = item.type == VALUE_BIG_INTEGER
+    ? Value_asBigInteger(item)
+    : BigInteger_fromInteger(Value_asInteger(item));
+  ObjBigInteger* result = BigInteger_add(total, addend);
+
+  if(item.type == VALUE_INTEGER) BigInteger_del(addend);
+  BigInteger_del(total);
+
+  return result;
+}
+
+static Value Builtin_sum(uint8_t argc, Value* argv) {
+  if(argc != 1) return Builtin_arityError("sum", "1", argc);
+  if(argv[0].type != VALUE_ARRAY) return Builtin_typeError("sum", "an `Array`", argv[0]);
+
+  ObjArray* array = Value_asArray(argv[0]);
+  ObjBigInteger* total = NULL;
+  int64_t partial = 0;
+  size_t i = 0;
+
+  for(;;) {
+    i += Kernel_sum(array->items + i, array->count - i, &partial);
+    if(i == array->count) break;
+
+    // The kernel stopped at a big integer, or where partial would overflow
+    if(!Value_isInteger(array->items[i])) {
+      if(total != NULL) BigInteger_del(total);
+
+      return Thread_panic(
+        "Function `sum` takes an array of `Integer`s, but item %zu is `%s`.",
+        i,
+        ValueType_toCString(array->items[i].type)
+      );
+    }
+
+    if(total == NULL) total = BigInteger_fromInteger(0);
+    total = Builtin_addBigInteger(total, Value_fromInteger(partial));
+    total = Builtin_addBigInteger(total, array->items[i++]);
+    partial = 0;
+  }
+
+  if(total == NULL) return Value_fromInteger(partial);
+
+  total = Builtin_addBigInteger(total, Value_fromInteger(partial));
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  return Thread_normalizeBigInteger(Thread_running, total);
+}
+
+// min() or max(), which are nil for an empty array
+static Value Builtin_fold(uint8_t argc, Value* argv, bool isMin) {
+  const char* name = isMin ? "min" : "max";
+
+  if(argc != 1) return Builtin_arityError(name, "1", argc);
+  if(argv[0].type != VALUE_ARRAY) return Builtin_typeError(name, "an `Array`", argv[0]);
+
+  Value arg0 = argv[0];
+
+  ObjArray* array = Value_asArray(arg0);
+  int64_t best = isMin ? INT64_MAX : INT64_MIN;
+  bool hasInteger = false;
+  ObjBigInteger* bestBig = NULL;
+  size_t i = 0;
+
+  if(array->count == 0) return NIL;
+
+  for(;;) {
+    size_t finished = isMin
+      ? Kernel_min(array->items + i, array->count - i, &best)
+      : Kernel_max(array->items + i, array->count - i, &best);
+
+    hasInteger = hasInteger || finished > 0;
+    i += finished;
+    if(i == array->count) break;
+
+    if(array->items[i].type != VALUE_BIG_INTEGER) {
+      return Thread_panic(
+        "Function `%s` takes an array of `Integer`s, but item %zu is `%s`.",
+        name,
+        i,
+        ValueType_toCString(array->items[i].type)
+      );
+    }
+
+    ObjBigInteger* big = Value_asBigInteger(array->items[i++]);
+
+    if(bestBig == NULL) {
+      bestBig = big;
+    } else {
+      int order = BigInteger_compare(big, bestBig);
+      if(isMin ? order < 0 : order > 0) bestBig = big;
+    }
+  }
+
+  /*
+   * Big integers are all outside the int64_t range, so a negative one is
+   * less than every integer, and a positive one greater.
+   */
+  if(bestBig != NULL && (!hasInteger || bestBig->isNegative == isMin)) {
+    return Value_fromBigInteger(bestBig);
+  }
+
+  return Value_fromInteger(best);
+}
+
+static Value Builtin_min(uint8_t argc, Value* argv) {
+  return Builtin_fold(argc, argv, true);
+}
+
+static Value Builtin_max(uint8_t argc, Value* argv) {
+  return Builtin_fold(argc, argv, false);
+}
+
+static Value Builtin_count(uint8_t argc, Value* argv) {
+  if(argc != 1) return Builtin_arityError("count", "1", argc);
+  if(argv[0].type != VALUE_ARRAY) return Builtin_typeError("count", "an `Array`", argv[0]);
+
+  ObjArray* array = Value_asArray(argv[0]);
+  size_t trues = 0;
+  size_t finished = Kernel_count(array->items, array->count, &trues);
+
+  // The kernel stops at the first item which isn't a boolean
+  if(finished != array->count) {
+    return Thread_panic(
+      "Function `count` takes an array of `Boolean`s, but item %zu is `%s`.",
+      finished,
+      ValueType_toCString(array->items[finished].type)
+    );
+  }
+
+  return Value_fromInteger((int64_t)trues);
+}
+
+/*
+ * stringBuilder(), append() and finish() build a string a piece at a time,
+ * and join() concatenates an array of strings. Both work out the length of
+ * the string before making it, so the string takes one allocation, or none
+ * if it's small.
+ */
+
+// stringBuilder() or stringBuilder(capacity)
+static Value Builtin_stringBuilder(uint8_t argc, Value* argv) {
+  if(argc > 1) return Builtin_arityError("stringBuilder", "0 or 1", argc);
+
+  if(argc == 1 && argv[0].type != VALUE_INTEGER) {
+    return Builtin_typeError("stringBuilder", "an `Integer` capacity", argv[0]);
+  }
+
+  if(argc == 1 && Value_asInteger(argv[0]) < 0) {
+    return Thread_panic(
+      "Function `stringBuilder` takes a capacity of at least 0, not %" PRId64 ".",
+      Value_asInteger(argv[0])
+    );
+  }
+
+  size_t capacity = argc == 0 ? 0 : (size_t)Value_asInteger(argv[0]);
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  return Value_fromStringBuilder(Thread_newStringBuilder(Thread_running, capacity));
+}
+
+// Returns what was appended to the builder as a string, and empties it
+static Value Builtin_finish(uint8_t argc, Value* argv) {
+  if(argc != 1) return Builtin_arityError("finish", "1", argc);
+
+  if(argv[0].type != VALUE_STRING_BUILDER) {
+    return Builtin_typeError("finish", "a `StringBuilder`", argv[0]);
+  }
+
+  ObjStringBuilder* stringBuilder = Value_asStringBuilder(argv[0]);
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  // An empty builder may not have allocated any bytes yet
+  if(stringBuilder->count == 0) return EMPTY_UTF8;
+
+  Value result = Thread_newUTF8(Thread_running, stringBuilder->bytes, stringBuilder->count);
+  stringBuilder->count = 0;
+  return result;
+}
+
+// join(strings) or join(strings, separator)
+static Value Builtin_join(uint8_t argc, Value* argv) {
+  if(argc != 1 && argc != 2) return Builtin_arityError("join", "1 or 2", argc);
+  if(argv[0].type != VALUE_ARRAY) return Builtin_typeError("join", "an `Array`", argv[0]);
+
+  if(argc == 2 && !Value_isUTF8(argv[1])) {
+    return Builtin_typeError("join", "a `UTF8` separator", argv[1]);
+  }
+
+  ObjArray* array = Value_asArray(argv[0]);
+  const uint8_t* separator = argc == 1 ? NULL : Value_utf8Bytes(&argv[1]);
+  size_t separatorCount = argc == 1 ? 0 : Value_utf8Count(&argv[1]);
+
+  if(array->count == 0) return EMPTY_UTF8;
+
+  size_t count = separatorCount * (array->count - 1);
+
+  for(size_t i = 0; i < array->count; i++) {
+    if(!Value_isUTF8(array->items[i])) {
+      return Thread_panic(
+        "Function `join` takes an array of `UTF8`s, but item %zu is `%s`.",
+        i,
+        ValueType_toCString(array->items[i].type)
+      );
+    }
+
+    count += Value_utf8Count(&(array->items[i]));
+  }
+
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  // Small results are built on the stack, and only longer ones allocate
+  uint8_t small[SMALL_UTF8_CAPACITY];
+  Blob* blob = count <= SMALL_UTF8_CAPACITY ? NULL : Thread_newBlob(Thread_running, count);
+  uint8_t* bytes = blob == NULL ? small : blob->bytes;
+
+  for(size_t i = 0; i < array->count; i++) {
+    if(i != 0 && separatorCount != 0) {
+      memcpy(bytes, separator, separatorCount);
+      bytes += separatorCount;
+    }
+
+    size_t itemCount = Value_utf8Count(&(array->items[i]));
+    memcpy(bytes, Value_utf8Bytes(&(array->items[i])), itemCount);
+    bytes += itemCount;
+  }
+
+  if(blob == NULL) return Value_fromSmallUTF8(small, count);
+  return Value_fromBlob(VALUE_UTF8, blob);
+}
+
 typedef struct {
   const char* const name;
   const Value value;
 } BuiltinValue;
 
-#define BUILTINS_COUNT 4
+#define BUILTINS_COUNT 17
 
 static const BuiltinValue BUILTINS[BUILTINS_COUNT] = {
   { "Bool", { VALUE_NATIVE_FN, { .nativeFn=Builtin_Bool } } },
   { "Int", { VALUE_NATIVE_FN, { .nativeFn=Builtin_Int } } },
   { "print", { VALUE_NATIVE_FN, { .nativeFn=Builtin_print } } },
   { "println", { VALUE_NATIVE_FN, { .nativeFn=Builtin_println } } },
+  { "append", { VALUE_NATIVE_FN, { .nativeFn=Builtin_append } } },
+  { "has", { VALUE_NATIVE_FN, { .nativeFn=Builtin_has } } },
+  { "remove", { VALUE_NATIVE_FN, { .nativeFn=Builtin_remove } } },
+  { "range", { VALUE_NATIVE_FN, { .nativeFn=Builtin_range } } },
+  { "sum", { VALUE_NATIVE_FN, { .nativeFn=Builtin_sum } } },
+  { "min", { VALUE_NATIVE_FN, { .nativeFn=Builtin_min } } },
+  { "max", { VALUE_NATIVE_FN, { .nativeFn=Builtin_max } } },
+  { "count", { VALUE_NATIVE_FN, { .nativeFn=Builtin_count } } },
+  { "reserve", { VALUE_NATIVE_FN, { .nativeFn=Builtin_reserve } } },
+  { "stringBuilder", { VALUE_NATIVE_FN, { .nativeFn=Builtin_stringBuilder } } },
+  { "finish", { VALUE_NATIVE_FN, { .nativeFn=Builtin_finish } } },
+  { "join", { VALUE_NATIVE_FN, { .nativeFn=Builtin_join } } },
+  { "UTF8", { VALUE_NATIVE_FN, { .nativeFn=Builtin_UTF8 } } },
 };
 
 inline static int32_t Builtin_index(const char* name, size_t length) {
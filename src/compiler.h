@@ -13,9 +13,93 @@ typedef struct {
   size_t depth;
 } Break;
 
+/*
+ * A variable of an enclosing function (or of an inner module scope) which
+ * the function being compiled captures. If isLocal, index is the variable's
+ * slot in the immediately enclosing function. Otherwise it is the index of
+ * an upvalue of the enclosing function, which captured it in turn, so that
+ * every closure holds all of its upvalues itself (flat closures).
+ *
+ * Mutable variables captured by heap closures are always boxed. Stack
+ * closures also capture unboxed ones, as a reference to their slot.
+ */
+typedef struct {
+  Symbol* symbol;
+  uint16_t index;
+  bool isLocal;
+  bool isMutable;
+  bool isBoxed;
+  size_t definedOnLine;
+} Upvalue;
+
+typedef struct {
+  Upvalue* items;
+  size_t count;
+  size_t capacity;
+} UpvalueList;
+
+/*
+ * The state of a function whose compilation is suspended while a function
+ * nested in it is compiled, linked to the functions enclosing it in turn.
+ * Module-level code is the outermost, with a NULL enclosing.
+ */
+typedef struct CompilerFunction CompilerFunction;
+struct CompilerFunction {
+  SymbolList* symbolList;
+  UpvalueList* upvalues;
+  bool isStackClosure;
+  CompilerFunction* enclosing;
+};
+
 typedef struct {
   SymbolTable symbolTable;
+
+  /*
+   * The symbols of the function being compiled, or of the module when
+   * compiling module-level code. Symbol indices are stack indices relative
+   * to the current frame.
+   */
   SymbolList symbolList;
+
+  /*
+   * While compiling a function, this points at the module's symbols, whose
+   * outermost variables functions can reach through their absolute stack
+   * index. NULL when compiling module-level code.
+   */
+  SymbolList* moduleSymbolList;
+
+  // The variables the current function captures, empty at module level
+  UpvalueList upvalues;
+
+  // The functions enclosing the current one, NULL at module level
+  CompilerFunction* enclosing;
+
+  // Whether the current function is compiled as a stack closure
+  bool isStackClosure;
+
+  /*
+   * Every symbol referenced from inside a function nested in the code being
+   * compiled. This is a conservative escape analysis: `mut` variables whose
+   * names aren't in it can't be captured, so they stay unboxed on the stack.
+   */
+  Symbol** capturedSymbols;
+  size_t capturedSymbolCount;
+  size_t capturedSymbolCapacity;
+
+  /*
+   * Every symbol used in the code being compiled other than as the function
+   * in a call, or used at all from inside a nested function except for a
+   * function calling itself. A function whose name isn't in it can't escape
+   * the scope defining it, so it's compiled as a stack closure. This is
+   * found first, since it decides which nested functions capture anything.
+   */
+  Symbol** escapingSymbols;
+  size_t escapingSymbolCount;
+  size_t escapingSymbolCapacity;
+
+  // How many of the ByteCode's natives are registered in symbolTable
+  size_t nativeCount;
+
   bool hasErrors;
 
   Break* breaks;
@@ -77,7 +161,26 @@ void test_Compiler_emitNode_loopContinueTo();
 //void test_Compiler_emitNode_whileElseBreakToWith();
 
 void test_Compiler_compile_emitsVariableInstructions();
-
+void test_Compiler_compile_emitsFunction();
+void test_Compiler_compile_functionReadsModuleVariables();
+void test_Compiler_compile_emitsClosure();
+void test_Compiler_compile_boxesOnlyCapturedMutables();
+void test_Compiler_compile_emitsStackClosures();
+void test_Compiler_compile_emitsTailCalls();
+void test_Compiler_compile_callsNativesDirectly();
+void test_Compiler_compile_functionErrors();
+
+void test_Compiler_compile_internsStrings();
+void test_Compiler_compile_internsManyStrings();
+void test_Compiler_compile_rejectsTooManyStrings();
+void test_Compiler_compile_emitsSmallStrings();
+void test_Compiler_compile_decodesEscapes();
+void test_Compiler_compile_rejectsInvalidStrings();
+void test_Compiler_compile_emitsArrays();
+void test_Compiler_compile_emitsForRange();
+void test_Compiler_compile_emitsForNextCollected();
+void test_Compiler_compile_reservesForRangeCollected();
+void test_Compiler_compile_emitsForElementwise();
 void test_Compiler_compile_emitsNilOnEmptyInput();
 void test_Compiler_compile_emitsNilOnBlankInput();
 
@@ -0,0 +1,298 @@
+#ifdef BENCH
+
+#include <assert.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "compiler.h"
+#include "corpus.h"
+#include "file.h"
+#include "output.h"
+#include "parser.h"
+#include "thread.h"
+
+typedef struct {
+  uint64_t parse;
+  uint64_t compile;
+  uint64_t execute;
+  uint64_t instructions;
+  size_t byteCodeSize;
+} CorpusTimings;
+
+/*
+ * Parsing alone is timed by pulling statements from the parser until EOF,
+ * which is exactly what Compiler_compile() drives while emitting. The
+ * compile phase is then reported as the difference between the fastest
+ * Compiler_compile() and the fastest parse, so that it measures code
+ * generation and not the parser a second time.
+ */
+static uint64_t Corpus_parse(const char* source) {
+  Parser parser;
+  Parser_init(&parser, source, false);
+
+  uint64_t start = Bench_now();
+
+  for(;;) {
+    Node* statement = Parser_parseStatement(&parser);
+
+    if(parser.panic) {
+      Parser_clearPanic(&parser);
+      continue;
+    }
+
+    bool isEOF = statement->type == NODE_EOF;
+    Node_del(statement);
+    if(isEOF) break;
+  }
+
+  uint64_t elapsed = Bench_now() - start;
+
+  Parser_free(&parser);
+  return elapsed;
+}
+
+static bool Corpus_compile(const char* source, ByteCode* out, uint64_t* elapsed) {
+  Compiler compiler;
+  Compiler_init(&compiler);
+  Parser parser;
+  Parser_init(&parser, source, false);
+
+  uint64_t start = Bench_now();
+  bool success = Compiler_compile(&compiler, out, &parser);
+  *elapsed = Bench_now() - start;
+
+  Parser_free(&parser);
+  Compiler_free(&compiler);
+  return success;
+}
+
+static inline uint64_t Corpus_min(uint64_t a, uint64_t b) {
+  return a < b ? a : b;
+}
+
+/*
+ * Runs the compiled program once. Only the traced dispatch loop counts
+ * instructions, so the timed runs are untraced and the count comes from a
+ * separate traced run.
+ */
+static bool Corpus_execute(ByteCode* byteCode, bool isTraced, uint64_t* elapsed, uint64_t* instructions) {
+  Thread thread;
+  Thread_init(&thread, byteCode);
+  Thread_isTraced = isTraced;
+
+  uint64_t start = Bench_now();
+  Thread_run(&thread);
+  Output_flush(Output_standard());
+  *elapsed = Bench_now() - start;
+
+  Thread_isTraced = false;
+  bool panicked = thread.panic;
+  *instructions = thread.instructionCount;
+
+  Thread_free(&thread);
+  return !panicked;
+}
+
+/*
+ * Runs in the forked child. Each phase is repeated and the fastest run is
+ * kept, since the programs are deterministic and anything slower is noise.
+ */
+static bool Corpus_measure(const char* source, CorpusTimings* timings) {
+  size_t repetitions = Bench_parameter("FUR_BENCH_CORPUS_REPETITIONS", 3);
+  assert(repetitions > 0);
+
+  timings->parse = UINT64_MAX;
+  timings->compile = UINT64_MAX;
+  timings->execute = UINT64_MAX;
+
+  for(size_t i = 0; i <= repetitions; i++) {
+    uint64_t parse = Corpus_parse(source);
+
+    ByteCode byteCode;
+    ByteCode_init(&byteCode);
+
+    uint64_t compile;
+    if(!Corpus_compile(source, &byteCode, &compile)) {
+      ByteCode_free(&byteCode);
+      return false;
+    }
+
+    // The extra last repetition is the traced one
+    bool isTraced = i == repetitions;
+    uint64_t execute;
+    uint64_t instructions;
+    bool success = Corpus_execute(&byteCode, isTraced, &execute, &instructions);
+    timings->byteCodeSize = ByteCode_count(&byteCode);
+
+    ByteCode_free(&byteCode);
+
+    if(!success) return false;
+
+    timings->parse = Corpus_min(timings->parse, parse);
+    timings->compile = Corpus_min(timings->compile, compile);
+
+    if(isTraced) {
+      timings->instructions = instructions;
+    } else {
+      timings->execute = Corpus_min(timings->execute, execute);
+    }
+  }
+
+  timings->compile = timings->compile > timings->parse
+    ? timings->compile - timings->parse
+    : 0;
+
+  return true;
+}
+
+/*
+ * Each program runs in its own child process, so that the peak RSS reported
+ * by wait4() belongs to that program alone (plus the small baseline of the
+ * runner itself) rather than to everything bin/bench has run before it.
+ * The program's own output goes to /dev/null so it doesn't corrupt the
+ * JSON on stdout, and the timings come back over a pipe.
+ */
+static void Corpus_runProgram(const char* directory, const char* fileName) {
+  char path[4096];
+  snprintf(path, sizeof(path), "%s/%s", directory, fileName);
+
+  char benchmark[256];
+  snprintf(
+    benchmark,
+    sizeof(benchmark),
+    "corpus/%.*s",
+    (int)(strlen(fileName) - strlen(".fur")),
+    fileName
+  );
+
+  fprintf(stderr, "  %s\n", benchmark);
+
+  char* source = File_read(path);
+
+  if(source == NULL) {
+    fprintf(stderr, "Unable to read %s\n", path);
+    return;
+  }
+
+  int channel[2];
+  if(pipe(channel) != 0) {
+    perror("pipe");
+    free(source);
+    return;
+  }
+
+  fflush(stdout);
+  pid_t child = fork();
+
+  if(child == 0) {
+    close(channel[0]);
+
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+    close(devNull);
+
+    CorpusTimings timings;
+    bool success = Corpus_measure(source, &timings);
+    fflush(stdout);
+
+    if(success) {
+      ssize_t written = write(channel[1], &timings, sizeof(timings));
+      (void)written;
+    }
+
+    _exit(success ? 0 : 1);
+  }
+
+  close(channel[1]);
+  free(source);
+
+  if(child < 0) {
+    perror("fork");
+    close(channel[0]);
+    return;
+  }
+
+  CorpusTimings timings;
+  ssize_t received = read(channel[0], &timings, sizeof(timings));
+  close(channel[0]);
+
+  int status;
+  struct rusage usage;
+  wait4(child, &status, 0, &usage);
+
+  if(received != sizeof(timings) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+    fprintf(stderr, "%s failed to compile or run\n", path);
+    return;
+  }
+
+  Bench_report(benchmark, "parse", (double)timings.parse, "ns");
+  Bench_report(benchmark, "compile", (double)timings.compile, "ns");
+  Bench_report(benchmark, "execute", (double)timings.execute, "ns");
+  Bench_report(benchmark, "instructions", (double)timings.instructions, "instructions");
+  Bench_report(
+    benchmark,
+    "ns_per_instruction",
+    timings.instructions == 0 ? 0 : (double)timings.execute / (double)timings.instructions,
+    "ns"
+  );
+  Bench_report(benchmark, "bytecode_size", (double)timings.byteCodeSize, "bytes");
+
+  // ru_maxrss is in kilobytes on Linux
+  Bench_report(benchmark, "peak_rss", (double)usage.ru_maxrss * 1024, "bytes");
+}
+
+static int Corpus_compareNames(const void* a, const void* b) {
+  return strcmp(*(const char**)a, *(const char**)b);
+}
+
+void bench_Corpus_run() {
+  const char* directory = getenv("FUR_BENCH_CORPUS");
+  if(directory == NULL || *directory == '\0') directory = "bench";
+
+  DIR* dir = opendir(directory);
+
+  if(dir == NULL) {
+    fprintf(stderr, "Unable to open corpus directory %s\n", directory);
+    return;
+  }
+
+  size_t count = 0;
+  size_t capacity = 16;
+  char** fileNames = malloc(sizeof(char*) * capacity);
+
+  struct dirent* entry;
+  while((entry = readdir(dir)) != NULL) {
+    size_t length = strlen(entry->d_name);
+
+    if(length <= strlen(".fur")) continue;
+    if(strcmp(entry->d_name + length - strlen(".fur"), ".fur") != 0) continue;
+
+    if(count == capacity) {
+      capacity *= 2;
+      fileNames = realloc(fileNames, sizeof(char*) * capacity);
+    }
+
+    fileNames[count++] = strdup(entry->d_name);
+  }
+
+  closedir(dir);
+
+  // Sort so that reports from different runs line up
+  qsort(fileNames, count, sizeof(char*), Corpus_compareNames);
+
+  for(size_t i = 0; i < count; i++) {
+    Corpus_runProgram(directory, fileNames[i]);
+    free(fileNames[i]);
+  }
+
+  free(fileNames);
+}
+
+#endif
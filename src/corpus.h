@@ -0,0 +1,16 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+/*
+ * The corpus is a directory of whole .fur programs (bench/ by default) that
+ * are run end-to-end, with the parse, compile and execute phases timed
+ * separately so that front-end and VM regressions show up independently.
+ */
+
+#ifdef BENCH
+
+void bench_Corpus_run();
+
+#endif
+
+#endif
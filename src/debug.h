@@ -35,11 +35,15 @@ inline static void Token_println(Token token) {
 
     PRINT_CASE(TOKEN_SEMICOLON);
     PRINT_CASE(TOKEN_COMMA);
+    PRINT_CASE(TOKEN_COLON);
+    PRINT_CASE(TOKEN_BACKSLASH);
 
     PRINT_CASE(TOKEN_OPEN_PAREN);
     PRINT_CASE(TOKEN_CLOSE_PAREN);
     PRINT_CASE(TOKEN_OPEN_BRACE);
     PRINT_CASE(TOKEN_CLOSE_BRACE);
+    PRINT_CASE(TOKEN_OPEN_BRACKET);
+    PRINT_CASE(TOKEN_CLOSE_BRACKET);
 
     PRINT_CASE(TOKEN_NIL);
     PRINT_CASE(TOKEN_TRUE);
@@ -53,6 +57,8 @@ inline static void Token_println(Token token) {
     PRINT_CASE(TOKEN_ELSE);
     PRINT_CASE(TOKEN_WHILE);
     PRINT_CASE(TOKEN_UNTIL);
+    PRINT_CASE(TOKEN_FOR);
+    PRINT_CASE(TOKEN_IN);
 
     PRINT_CASE(TOKEN_CONTINUE);
     PRINT_CASE(TOKEN_BREAK);
@@ -95,11 +101,15 @@ inline static void TokenType_println(TokenType tokenType) {
 
     PRINT_CASE(TOKEN_SEMICOLON);
     PRINT_CASE(TOKEN_COMMA);
+    PRINT_CASE(TOKEN_COLON);
+    PRINT_CASE(TOKEN_BACKSLASH);
 
     PRINT_CASE(TOKEN_OPEN_PAREN);
     PRINT_CASE(TOKEN_CLOSE_PAREN);
     PRINT_CASE(TOKEN_OPEN_BRACE);
     PRINT_CASE(TOKEN_CLOSE_BRACE);
+    PRINT_CASE(TOKEN_OPEN_BRACKET);
+    PRINT_CASE(TOKEN_CLOSE_BRACKET);
 
     PRINT_CASE(TOKEN_NIL);
     PRINT_CASE(TOKEN_TRUE);
@@ -113,6 +123,8 @@ inline static void TokenType_println(TokenType tokenType) {
     PRINT_CASE(TOKEN_ELSE);
     PRINT_CASE(TOKEN_WHILE);
     PRINT_CASE(TOKEN_UNTIL);
+    PRINT_CASE(TOKEN_FOR);
+    PRINT_CASE(TOKEN_IN);
 
     PRINT_CASE(TOKEN_CONTINUE);
     PRINT_CASE(TOKEN_BREAK);
@@ -162,12 +174,17 @@ inline static void NodeType_println(NodeType nodeType) {
     PRINT_CASE(NODE_IF);
     PRINT_CASE(NODE_WHILE);
     PRINT_CASE(NODE_UNTIL);
+    PRINT_CASE(NODE_FOR);
 
     PRINT_CASE(NODE_CONTINUE);
     PRINT_CASE(NODE_BREAK);
 
     PRINT_CASE(NODE_BLOCK);
     PRINT_CASE(NODE_CALL);
+    PRINT_CASE(NODE_SUBSCRIPT);
+    PRINT_CASE(NODE_ARRAY);
+    PRINT_CASE(NODE_MAP);
+    PRINT_CASE(NODE_LAMBDA);
     PRINT_CASE(NODE_COMMA_SEPARATED);
 
     PRINT_CASE(NODE_EOF);
@@ -0,0 +1,278 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "decimal.h"
+
+#define DECIMAL_ONES 0x0101010101010101llu
+
+/*
+ * Whether all 8 bytes of chunk are ASCII digits. Digits are 0x30 to 0x39,
+ * so every byte's high nibble must be 3, and must still be 3 after adding
+ * 6, which carries into it for 0x3A and up.
+ */
+inline static bool Decimal_areEightDigits(uint64_t chunk) {
+  uint64_t highNibbles = 0xF0 * DECIMAL_ONES;
+
+  return ((chunk & highNibbles) | (((chunk + 6 * DECIMAL_ONES) & highNibbles) >> 4))
+    == 0x33 * DECIMAL_ONES;
+}
+
+/*
+ * The value of 8 digits loaded little endian, so that the first digit is in
+ * the low byte. Each step combines neighbouring groups into one twice their
+ * width: bytes into pairs of digits, then pairs into fours with one
+ * multiply, and fours into the whole with another.
+ */
+inline static uint32_t Decimal_parseEightDigits(uint64_t chunk) {
+  chunk -= 0x30 * DECIMAL_ONES;
+  chunk = (chunk * 10) + (chunk >> 8);
+
+  return (uint32_t)((
+    ((chunk & 0x000000FF000000FFllu) * (100 + (1000000llu << 32))) +
+    (((chunk >> 16) & 0x000000FF000000FFllu) * (1 + (10000llu << 32)))
+  ) >> 32);
+}
+
+DecimalStatus Decimal_parse(const uint8_t* text, size_t count, int64_t* result) {
+  const uint8_t* end = text + count;
+  bool isNegative = count > 0 && *text == '-';
+  if(isNegative) text++;
+
+  if(text == end) return DECIMAL_INVALID;
+
+  // Once this overflows, the rest of the text is only checked
+  uint64_t magnitude = 0;
+  bool overflowed = false;
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  while(end - text >= 8) {
+    uint64_t chunk;
+    memcpy(&chunk, text, sizeof(chunk));
+
+    if(!Decimal_areEightDigits(chunk)) return DECIMAL_INVALID;
+
+    overflowed = overflowed
+      || __builtin_mul_overflow(magnitude, 100000000, &magnitude)
+      || __builtin_add_overflow(magnitude, Decimal_parseEightDigits(chunk), &magnitude);
+
+    text += 8;
+  }
+#endif
+
+  for(; text < end; text++) {
+    if(*text < '0' || *text > '9') return DECIMAL_INVALID;
+
+    overflowed = overflowed
+      || __builtin_mul_overflow(magnitude, 10, &magnitude)
+      || __builtin_add_overflow(magnitude, *text - '0', &magnitude);
+  }
+
+  if(overflowed || magnitude > (uint64_t)INT64_MAX + isNegative) return DECIMAL_OVERFLOW;
+
+  // Negate as unsigned so that INT64_MIN doesn't overflow
+  *result = (int64_t)(isNegative ? -magnitude : magnitude);
+  return DECIMAL_OK;
+}
+
+static const char DECIMAL_PAIRS[200] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+size_t Decimal_format(int64_t i, uint8_t* out) {
+  uint8_t digits[DECIMAL_MAX_LENGTH];
+  size_t start = sizeof(digits);
+
+  // Work with the magnitude as unsigned so that INT64_MIN doesn't overflow
+  uint64_t magnitude = i < 0 ? -(uint64_t)i : (uint64_t)i;
+
+  while(magnitude >= 100) {
+    start -= 2;
+    memcpy(digits + start, DECIMAL_PAIRS + (magnitude % 100) * 2, 2);
+    magnitude /= 100;
+  }
+
+  if(magnitude >= 10) {
+    start -= 2;
+    memcpy(digits + start, DECIMAL_PAIRS + magnitude * 2, 2);
+  } else {
+    digits[--start] = '0' + magnitude;
+  }
+
+  if(i < 0) digits[--start] = '-';
+
+  memcpy(out, digits + start, sizeof(digits) - start);
+  return sizeof(digits) - start;
+}
+
+#ifdef TEST
+
+static DecimalStatus parseCString(const char* text, int64_t* result) {
+  return Decimal_parse((const uint8_t*)text, strlen(text), result);
+}
+
+void test_Decimal_parse_limits() {
+  int64_t result;
+
+  assert(parseCString("0", &result) == DECIMAL_OK && result == 0);
+  assert(parseCString("-0", &result) == DECIMAL_OK && result == 0);
+  assert(parseCString("42", &result) == DECIMAL_OK && result == 42);
+  assert(parseCString("12345678", &result) == DECIMAL_OK && result == 12345678);
+  assert(parseCString("-123456789", &result) == DECIMAL_OK && result == -123456789);
+
+  // Leading zeros take whole chunks without overflowing
+  assert(parseCString("0000000000000000000000000007", &result) == DECIMAL_OK && result == 7);
+
+  assert(parseCString("9223372036854775807", &result) == DECIMAL_OK && result == INT64_MAX);
+  assert(parseCString("-9223372036854775808", &result) == DECIMAL_OK && result == INT64_MIN);
+
+  result = 1;
+  assert(parseCString("9223372036854775808", &result) == DECIMAL_OVERFLOW);
+  assert(parseCString("-9223372036854775809", &result) == DECIMAL_OVERFLOW);
+  assert(parseCString("18446744073709551616", &result) == DECIMAL_OVERFLOW);
+  assert(parseCString("123456789012345678901234567890", &result) == DECIMAL_OVERFLOW);
+  assert(result == 1);
+}
+
+void test_Decimal_parse_rejectsMalformedText() {
+  const char* texts[] = {
+    "",
+    "-",
+    "--1",
+    "+1",
+    " 1",
+    "1 ",
+    "12345678\n",
+    "1234567/",
+    "1234567:",
+    "12345678901234567x",
+    "1e5",
+    "0x10",
+    // Overflow doesn't hide a bad digit later on
+    "99999999999999999999999999a",
+  };
+
+  for(size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++) {
+    int64_t result = 1;
+    assert(parseCString(texts[i], &result) == DECIMAL_INVALID);
+    assert(result == 1);
+  }
+}
+
+void test_Decimal_format_roundTrips() {
+  int64_t values[] = {
+    0, 7, -7, 10, 99, 100, -100, 12345, 1000000000, INT64_MAX, INT64_MIN,
+  };
+  uint8_t text[DECIMAL_MAX_LENGTH];
+
+  size_t count = Decimal_format(-1203, text);
+  assert(count == 5);
+  assert(memcmp(text, "-1203", 5) == 0);
+
+  assert(Decimal_format(INT64_MIN, text) == DECIMAL_MAX_LENGTH);
+
+  for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    int64_t result;
+
+    count = Decimal_format(values[i], text);
+    assert(Decimal_parse(text, count, &result) == DECIMAL_OK);
+    assert(result == values[i]);
+  }
+
+  // Every power of ten, and one less, which change the number of digits
+  int64_t power = 1;
+
+  for(int digits = 1; digits <= 18; digits++) {
+    int64_t result;
+    power *= 10;
+
+    assert(Decimal_format(power, text) == (size_t)digits + 1);
+    assert(Decimal_format(power - 1, text) == (size_t)digits);
+    assert(Decimal_parse(text, digits, &result) == DECIMAL_OK && result == power - 1);
+  }
+}
+
+#endif
+
+#ifdef BENCH
+
+#include <stdlib.h>
+
+#include "bench.h"
+
+typedef struct {
+  size_t count;
+  int64_t* values;
+  uint8_t* text;
+  size_t* lengths;
+} DecimalBench;
+
+static void DecimalBench_parse(void* context) {
+  DecimalBench* bench = context;
+  const uint8_t* text = bench->text;
+
+  // Parsing back into values keeps the results live
+  for(size_t i = 0; i < bench->count; i++) {
+    DecimalStatus status = Decimal_parse(text, bench->lengths[i], bench->values + i);
+    assert(status == DECIMAL_OK);
+    (void)status;
+
+    text += bench->lengths[i];
+  }
+}
+
+static void DecimalBench_format(void* context) {
+  DecimalBench* bench = context;
+  uint8_t* text = bench->text;
+
+  for(size_t i = 0; i < bench->count; i++) {
+    text += Decimal_format(bench->values[i], text);
+  }
+}
+
+static void DecimalBench_init(DecimalBench* bench) {
+  bench->count = Bench_parameter("FUR_BENCH_DECIMAL_COUNT", 100000);
+  bench->values = malloc(bench->count * sizeof(int64_t));
+  bench->text = malloc(bench->count * DECIMAL_MAX_LENGTH);
+  bench->lengths = malloc(bench->count * sizeof(size_t));
+
+  uint8_t* text = bench->text;
+
+  // A spread of lengths, as in a column of measurements
+  for(size_t i = 0; i < bench->count; i++) {
+    uint64_t bits = (uint64_t)i * 11400714819323198485llu;
+    bench->values[i] = (int64_t)(bits >> (i % 48 + 16)) * (i % 3 == 0 ? -1 : 1);
+    bench->lengths[i] = Decimal_format(bench->values[i], text);
+    text += bench->lengths[i];
+  }
+}
+
+static void DecimalBench_free(DecimalBench* bench) {
+  free(bench->lengths);
+  free(bench->text);
+  free(bench->values);
+}
+
+void bench_Decimal_parse() {
+  DecimalBench bench;
+  DecimalBench_init(&bench);
+  Bench_measure("Decimal_parse", DecimalBench_parse, &bench, bench.count);
+  DecimalBench_free(&bench);
+}
+
+void bench_Decimal_format() {
+  DecimalBench bench;
+  DecimalBench_init(&bench);
+  Bench_measure("Decimal_format", DecimalBench_format, &bench, bench.count);
+  DecimalBench_free(&bench);
+}
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Conversions between int64_ts and decimal text, behind Int() and UTF8()
+ * on strings and the printing of integers. Parsing checks and converts
+ * eight digits at a time with SWAR arithmetic on a uint64_t, and formatting
+ * writes two digits at a time from a table of the 100 digit pairs, so both
+ * do a fraction of the multiplications and divisions of a digit-by-digit
+ * loop.
+ */
+
+// The length of "-9223372036854775808"
+#define DECIMAL_MAX_LENGTH 20
+
+typedef enum {
+  DECIMAL_OK,
+  // Not an optional '-' followed by at least one ASCII digit
+  DECIMAL_INVALID,
+  // Well formed, but outside the range of an int64_t
+  DECIMAL_OVERFLOW
+} DecimalStatus;
+
+// Only sets *result if the text is well formed and in range
+DecimalStatus Decimal_parse(const uint8_t* text, size_t count, int64_t* result);
+
+// Writes up to DECIMAL_MAX_LENGTH bytes to out, returning how many
+size_t Decimal_format(int64_t, uint8_t* out);
+
+#ifdef TEST
+
+void test_Decimal_parse_limits();
+void test_Decimal_parse_rejectsMalformedText();
+void test_Decimal_format_roundTrips();
+
+#endif
+
+#ifdef BENCH
+
+void bench_Decimal_parse();
+void bench_Decimal_format();
+
+#endif
+
+#endif
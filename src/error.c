@@ -3,11 +3,15 @@
 #include <stdio.h>
 
 #include "error.h"
+#include "output.h"
 
 #define ANSI_COLOR_RED    "\x1b[31m"
 #define ANSI_COLOR_RESET  "\x1b[0m"
 
 void printError(size_t line, const char* fmt, ...) {
+  // Flush program output first so that the error appears after it
+  Output_flush(Output_standard());
+
   // Support the NO_COLOR flag, see https://no-color.org/ for explanation.
   const char* noColorEnv = getenv("NO_COLOR");
   bool isColorAllowed = noColorEnv == NULL || noColorEnv[0] == '\0';
@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "file.h"
+
+char* File_read(const char* path) {
+  FILE* file = fopen(path, "r");
+  if(file == NULL) return NULL;
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char* source = size < 0 ? NULL : malloc(size + 1);
+
+  if(source == NULL) {
+    fclose(file);
+    return NULL;
+  }
+
+  size_t read = fread(source, 1, size, file);
+  source[read] = '\0';
+
+  fclose(file);
+  return source;
+}
@@ -0,0 +1,14 @@
+#ifndef FILE_H
+#define FILE_H
+
+/*
+ * Reads a whole file into a null-terminated string, which the caller frees,
+ * or returns NULL with errno set if it can't be read.
+ */
+char* File_read(const char* path);
+
+#ifdef TEST
+
+#endif
+
+#endif
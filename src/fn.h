@@ -0,0 +1,86 @@
+#ifndef FN_H
+#define FN_H
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A compiled Fur function. Its body lives in the ByteCode that owns it,
+ * between start and end, and finishes with an OP_RETURN. These are
+ * stored as indices rather than pointers so that they survive the ByteCode
+ * being reallocated by later compilation (for example in the REPL).
+ *
+ * The name is copied from the source, since REPL lines don't outlive the
+ * ByteCode. Lambdas have a nameLength of 0.
+ */
+typedef struct {
+  size_t start;
+  size_t end;
+  uint8_t arity;
+  size_t nameLength;
+  char name[];
+} Fn;
+
+// Expands to the arguments for a "%.*s" format of the function's name
+#define FN_PRINTF_NAME(fn) \
+  ((fn)->nameLength == 0 ? (int)strlen("(lambda)") : (int)((fn)->nameLength)), \
+  ((fn)->nameLength == 0 ? "(lambda)" : (fn)->name)
+
+inline static Fn* Fn_new(uint8_t arity, const char* name, size_t nameLength) {
+  Fn* self = malloc(sizeof(Fn) + nameLength);
+
+  // TODO Handle this
+  assert(self != NULL);
+
+  self->start = 0;
+  self->end = 0;
+  self->arity = arity;
+  self->nameLength = nameLength;
+  memcpy(self->name, name, nameLength);
+
+  return self;
+}
+
+inline static void Fn_del(Fn* self) {
+  free(self);
+}
+
+typedef struct {
+  size_t count;
+  size_t capacity;
+  Fn** items;
+} FnList;
+
+inline static void FnList_init(FnList* self) {
+  self->count = 0;
+  self->capacity = 0;
+  self->items = NULL;
+}
+
+inline static void FnList_free(FnList* self) {
+  for(size_t i = 0; i < self->count; i++) {
+    Fn_del(self->items[i]);
+  }
+
+  free(self->items);
+}
+
+inline static size_t FnList_append(FnList* self, Fn* item) {
+  if(self->capacity == self->count) {
+    if(self->capacity == 0) {
+      self->capacity = 8;
+    } else {
+      self->capacity *= 2;
+    }
+
+    self->items = realloc(self->items, self->capacity * sizeof(Fn*));
+    assert(self->items != NULL);
+  }
+
+  self->items[self->count] = item;
+  return self->count++;
+}
+
+#endif
@@ -0,0 +1,622 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fur.h"
+#include "output.h"
+
+Fur* Fur_new() {
+  Fur* self = malloc(sizeof(Fur));
+
+  // TODO Handle this
+  assert(self != NULL);
+
+  Compiler_init(&(self->compiler));
+  ByteCode_init(&(self->byteCode));
+  Thread_init(&(self->thread), &(self->byteCode));
+  Parser_init(&(self->parser), "", true /* REPL mode */);
+
+  self->sources = NULL;
+  self->sourceCount = 0;
+  self->sourceCapacity = 0;
+  self->symbolCheckpoint = 0;
+  Snapshot_init(&(self->snapshot));
+
+  return self;
+}
+
+void Fur_del(Fur* self) {
+  Parser_free(&(self->parser));
+  Thread_free(&(self->thread));
+  ByteCode_free(&(self->byteCode));
+  Compiler_free(&(self->compiler));
+
+  // Symbols and blobs may point into the snapshot
+  Snapshot_free(&(self->snapshot));
+
+  for(size_t i = 0; i < self->sourceCount; i++) {
+    free((void*)(self->sources[i]));
+  }
+
+  free(self->sources);
+  free(self);
+}
+
+bool Fur_registerNative(Fur* self, const char* name, NativeContextFn fn, void* context) {
+  return NativeList_register(&(self->byteCode.natives), name, fn, context);
+}
+
+bool Fur_loadNatives(Fur* self, const char* path) {
+  return NativeList_load(&(self->byteCode.natives), path);
+}
+
+static const char* Fur_keepSource(Fur* self, const char* source) {
+  if(self->sourceCount == self->sourceCapacity) {
+    self->sourceCapacity = self->sourceCapacity == 0 ? 16 : self->sourceCapacity * 2;
+    self->sources = realloc(self->sources, self->sourceCapacity * sizeof(char*));
+
+    // TODO Handle this
+    assert(self->sources != NULL);
+  }
+
+  char* copy = strdup(source);
+
+  // TODO Handle this
+  assert(copy != NULL);
+
+  self->sources[self->sourceCount++] = copy;
+  return copy;
+}
+
+bool Fur_compile(Fur* self, const char* source) {
+  Parser_appendLine(&(self->parser), Fur_keepSource(self, source));
+
+  self->symbolCheckpoint = SymbolList_count(&(self->compiler.symbolList));
+  return Compiler_compile(&(self->compiler), &(self->byteCode), &(self->parser));
+}
+
+bool Fur_run(Fur* self, Value* result) {
+  Thread* thread = &(self->thread);
+
+  *result = Thread_run(thread);
+
+  Output_flush(Output_standard());
+
+  if(!(thread->panic)) return true;
+
+  Thread_clearPanic(thread);
+
+  /*
+   * Forget the variables declared by the failed code, and anything else it
+   * left on the stack, so that the remaining variables line up with their
+   * stack slots again.
+   */
+  SymbolList_rewind(&(self->compiler.symbolList), self->symbolCheckpoint);
+  Stack_truncate(&(thread->stack), self->symbolCheckpoint);
+
+  *result = NIL;
+  return false;
+}
+
+bool Fur_eval(Fur* self, const char* source, Value* result) {
+  if(!Fur_compile(self, source)) {
+    *result = NIL;
+    return false;
+  }
+
+  return Fur_run(self, result);
+}
+
+bool Fur_save(Fur* self, const char* path) {
+  return Snapshot_save(path, &(self->compiler), &(self->byteCode), &(self->thread));
+}
+
+bool Fur_restore(Fur* self, const char* path) {
+  return Snapshot_restore(
+    &(self->snapshot),
+    path,
+    &(self->compiler),
+    &(self->byteCode),
+    &(self->thread)
+  );
+}
+
+#ifdef TEST
+
+#include <unistd.h>
+
+void test_Fur_eval_keepsStateAcrossEvaluations() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "mut total = 0;", &result));
+  assert(Fur_eval(fur, "add(n) = { total = total + n; total }", &result));
+  assert(Fur_eval(fur, "add(20)", &result));
+  assert(Fur_eval(fur, "add(22)", &result));
+
+  assert(Value_asInteger(result) == 42);
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_recoversFromErrors() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "x = 1;", &result));
+
+  // A compile error, then a panic after declaring a variable
+  assert(!Fur_eval(fur, "y = ;", &result));
+  assert(!Fur_eval(fur, "y = 2; 1 // 0", &result));
+  assert(result.type == VALUE_NIL);
+
+  // y was forgotten, so it can be declared again and x is still in its slot
+  assert(Fur_eval(fur, "y = 41; x + y", &result));
+  assert(Value_asInteger(result) == 42);
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_arrays() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "a = [1, 2];", &result));
+  assert(Fur_eval(fur, "append(a, 3); a[0] = 40;", &result));
+  assert(Fur_eval(fur, "a[0] + a[1]", &result));
+  assert(Value_asInteger(result) == 42);
+
+  assert(Fur_eval(fur, "a", &result));
+  assert(result.type == VALUE_ARRAY);
+  assert(Value_asArray(result)->count == 3);
+  assert(Value_asInteger(Value_asArray(result)->items[2]) == 3);
+
+  // Indices are checked against the current length, including negatives
+  assert(!Fur_eval(fur, "a[3]", &result));
+  assert(!Fur_eval(fur, "a[-1]", &result));
+  assert(!Fur_eval(fur, "a[true]", &result));
+  assert(!Fur_eval(fur, "a[3] = 0;", &result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_maps() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "m = ['a': 1, 2: 'b', 'a': 40];", &result));
+  assert(Fur_eval(fur, "m[nil] = 2; m['c'] = 0;", &result));
+  assert(Fur_eval(fur, "m['a'] + m[nil]", &result));
+  assert(Value_asInteger(result) == 42);
+
+  assert(Fur_eval(fur, "remove(m, 'c') and not has(m, 'c') and not remove(m, 'c')", &result));
+  assert(Value_asBoolean(result));
+
+  assert(Fur_eval(fur, "m", &result));
+  assert(result.type == VALUE_MAP);
+  assert(Value_asMap(result)->count == 3);
+
+  assert(!Fur_eval(fur, "m['c']", &result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_forLoops() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "mut total = 0;", &result));
+  assert(Fur_eval(fur, "for(i in range(1, 5)) total = total + i;", &result));
+  assert(Fur_eval(fur, "for(x in [10, 20]) total = total + x;", &result));
+  assert(Fur_eval(fur, "for(k in ['a': 1, 'b': 2]) total = total + 100;", &result));
+  assert(Fur_eval(fur, "total", &result));
+  assert(Value_asInteger(result) == 240);
+
+  // A loop only returns an array when it's assigned
+  assert(Fur_eval(fur, "squares = for(i in range(4)) i * i;", &result));
+  assert(Fur_eval(fur, "squares", &result));
+  assert(result.type == VALUE_ARRAY);
+  assert(Value_asArray(result)->count == 4);
+  assert(Value_asInteger(Value_asArray(result)->items[3]) == 9);
+
+  // Each iteration binds a new variable, so closures see their own
+  assert(Fur_eval(fur, "fs = for(i in range(3)) \\() i;", &result));
+  assert(Fur_eval(fur, "fs[0]() + fs[2]()", &result));
+  assert(Value_asInteger(result) == 2);
+
+  assert(Fur_eval(fur, "found = for(i in range(10)) { if(i == 7) { break with i * 6; } i }", &result));
+  assert(Fur_eval(fur, "found", &result));
+  assert(Value_asInteger(result) == 42);
+
+  // Ranges are values too, iterated without the fast path
+  assert(Fur_eval(fur, "r = range(5, 8);", &result));
+  assert(Fur_eval(fur, "odds = for(i in r) { if(i == 6) { continue; } i }", &result));
+  assert(Fur_eval(fur, "odds", &result));
+  assert(Value_asArray(result)->count == 2);
+  assert(Value_asInteger(Value_asArray(result)->items[1]) == 7);
+
+  assert(Fur_eval(fur, "r == range(5, 8) and r != range(8)", &result));
+  assert(Value_asBoolean(result));
+
+  assert(!Fur_eval(fur, "for(i in 3) i;", &result));
+  assert(!Fur_eval(fur, "for(i in range('a')) i;", &result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_forLoopsOnlyCollectUsedValues() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "r = range(3);", &result));
+
+  // Loops whose values are dropped don't allocate
+  Obj* objects = fur->thread.objects;
+  assert(Fur_eval(fur, "for(i in range(1000)) i; for(i in r) { for(j in r) j; i } 0", &result));
+  assert(fur->thread.objects == objects);
+
+  // Loops whose values are used collect them, even when nested
+  assert(Fur_eval(fur, "for(i in r) for(j in range(i)) j", &result));
+  assert(Value_asArray(result)->count == 3);
+  assert(Value_asArray(Value_asArray(result)->items[2])->count == 2);
+
+  // A loop over range() knows how many values it collects
+  assert(Fur_eval(fur, "xs = for(i in range(5)) i;", &result));
+  assert(Fur_eval(fur, "xs", &result));
+  assert(Value_asArray(result)->count == 5);
+  assert(Value_asArray(result)->capacity == 5);
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_elementwiseArrays() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "xs = [4, -7, 12, 0, 9];", &result));
+
+  // Operators apply to each item, against scalars or arrays of the same length
+  assert(Fur_eval(fur, "ys = xs * 2 - [1, 1, 1, 1, 1]; ys[2] + (30 - xs)[1]", &result));
+  assert(Value_asInteger(result) == 23 + 37);
+
+  // Comparisons give masks, which count() counts
+  assert(Fur_eval(fur, "count(xs > 0) * 10 + count(0 >= xs)", &result));
+  assert(Value_asInteger(result) == 32);
+
+  assert(Fur_eval(fur, "sum(xs) * 10000 + max(xs) * 100 + min(xs)", &result));
+  assert(Value_asInteger(result) == 18 * 10000 + 12 * 100 - 7);
+
+  // Overflow promotes items, and reductions, to big integers
+  assert(Fur_eval(fur, "bs = [9223372036854775807, 1] + 1;", &result));
+  assert(Fur_eval(fur, "bs[0] > 9223372036854775807 and bs[1] == 2", &result));
+  assert(Value_asBoolean(result));
+  assert(Fur_eval(fur, "sum(bs) - max(bs) == 2 and min(bs * -1) < -9223372036854775807", &result));
+  assert(Value_asBoolean(result));
+
+  // Loops which are elementwise over arrays are still loops over anything else
+  assert(Fur_eval(fur, "a = for(x in xs) x + 1; r = for(x in range(3)) 10 - x;", &result));
+  assert(Fur_eval(fur, "a[1] * 100 + r[2]", &result));
+  assert(Value_asInteger(result) == -600 + 8);
+
+  assert(!Fur_eval(fur, "xs + [1]", &result));
+  assert(!Fur_eval(fur, "xs // (xs - xs)", &result));
+  assert(!Fur_eval(fur, "for(x in ['a']) x * 2", &result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_builtinsPanicOnBadArguments() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(!Fur_eval(fur, "sum(['a'])", &result));
+  assert(!Fur_eval(fur, "sum([9223372036854775807, 1, 'a'])", &result));
+  assert(!Fur_eval(fur, "sum(1)", &result));
+  assert(!Fur_eval(fur, "sum()", &result));
+  assert(!Fur_eval(fur, "min([1, nil])", &result));
+  assert(!Fur_eval(fur, "max('a')", &result));
+  assert(!Fur_eval(fur, "count([true, 1])", &result));
+
+  assert(Fur_eval(fur, "b = stringBuilder();", &result));
+  assert(!Fur_eval(fur, "append(b, nil)", &result));
+  assert(!Fur_eval(fur, "finish([])", &result));
+  assert(!Fur_eval(fur, "stringBuilder(-1)", &result));
+  assert(!Fur_eval(fur, "stringBuilder('a')", &result));
+  assert(!Fur_eval(fur, "join(1, 2)", &result));
+  assert(!Fur_eval(fur, "join(['a'], 2)", &result));
+  assert(!Fur_eval(fur, "join(['a', 1], ', ')", &result));
+  assert(!Fur_eval(fur, "append(1, 2)", &result));
+  assert(!Fur_eval(fur, "append([])", &result));
+  assert(!Fur_eval(fur, "reserve('a', 2)", &result));
+  assert(!Fur_eval(fur, "reserve([], -2)", &result));
+  assert(!Fur_eval(fur, "has([1], 1)", &result));
+  assert(!Fur_eval(fur, "remove(nil, 1)", &result));
+  assert(!Fur_eval(fur, "range('a')", &result));
+  assert(!Fur_eval(fur, "range(1, nil)", &result));
+  assert(!Fur_eval(fur, "range(1, 2, 3)", &result));
+
+  // Builtins called as values, and in tail position, panic the same way
+  assert(Fur_eval(fur, "f = sum; g(xs) = f(xs);", &result));
+  assert(!Fur_eval(fur, "f([[]])", &result));
+  assert(!Fur_eval(fur, "y = 1; g([false])", &result));
+  assert(result.type == VALUE_NIL);
+
+  // The variables from the failed code are forgotten like any other panic
+  assert(Fur_eval(fur, "y = 2; g([1, y]) + count([true])", &result));
+  assert(Value_asInteger(result) == 4);
+  assert(Fur_eval(fur, "append(b, 'ok'); finish(b) == join(['o', 'k'])", &result));
+  assert(Value_asBoolean(result));
+
+  Fur_del(fur);
+}
+
+static Value Fur_testIncrement(void* context, uint8_t argc, Value* argv) {
+  assert(argc == 1);
+  return Value_fromInteger(Value_asInteger(argv[0]) + *((int64_t*)context));
+}
+
+void test_Fur_eval_smallStrings() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  // Concatenations short enough to be small are, so they equal literals
+  assert(Fur_eval(fur, "short = 'ab' + 'cd';", &result));
+  assert(Fur_eval(fur, "short", &result));
+  assert(result.type == VALUE_SMALL_UTF8);
+  assert(Fur_eval(fur, "short == 'abcd' and short != 'abc'", &result));
+  assert(Value_asBoolean(result));
+
+  assert(Fur_eval(fur, "long = short + 'efgh';", &result));
+  assert(Fur_eval(fur, "long", &result));
+  assert(result.type == VALUE_UTF8);
+  assert(Fur_eval(fur, "long == 'abcdefgh' and long != short and short < long", &result));
+  assert(Value_asBoolean(result));
+
+  // Small and large keys find each other's equals
+  assert(Fur_eval(fur, "lookup = [short: 1, long: 2];", &result));
+  assert(Fur_eval(fur, "lookup['ab' + 'cd'] + lookup['abcdefgh']", &result));
+  assert(Value_asInteger(result) == 3);
+
+  assert(Fur_eval(fur, "joined = for(s in ['x', 'y']) s + '!';", &result));
+  assert(Fur_eval(fur, "joined[1] == 'y!'", &result));
+  assert(Value_asBoolean(result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_buildsStrings() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "b = stringBuilder(4);", &result));
+  assert(Fur_eval(fur, "for(word in ['one', 'two', 'three']) { append(b, word); append(b, ';'); }", &result));
+  assert(Fur_eval(fur, "finish(b) == 'one;two;three;'", &result));
+  assert(Value_asBoolean(result));
+
+  // Finishing empties the builder for reuse
+  assert(Fur_eval(fur, "append(b, 'x');", &result));
+  assert(Fur_eval(fur, "finish(b)", &result));
+  assert(result.type == VALUE_SMALL_UTF8);
+  assert(Value_utf8Count(&result) == 1);
+
+  assert(Fur_eval(fur, "join(['alpha', 'beta', 'gamma'], ', ')", &result));
+  assert(result.type == VALUE_UTF8);
+  assert(result.as.blob->count == 18);
+  assert(memcmp(result.as.blob->bytes, "alpha, beta, gamma", 18) == 0);
+
+  assert(Fur_eval(fur, "join(['a', 'b']) == 'ab' and join([], '-') == '' and join(['c'], '-') == 'c'", &result));
+  assert(Value_asBoolean(result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_collectsUnreachableObjects() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "kept = [[1, 2], ['key': 'a string too long to be small']];", &result));
+
+  // Each iteration's array and string are garbage by the next iteration
+  assert(Fur_eval(fur, "for(i in range(100000)) { s = [i, i]; t = join(['iteration ', 'number']); } 0", &result));
+
+  size_t count = 0;
+  for(Obj* obj = fur->thread.objects; obj != NULL; obj = obj->next) count++;
+
+  assert(count < 100000 / 2);
+  assert(fur->thread.bytesAllocated <= 2 * THREAD_MIN_COLLECTION);
+
+  assert(Fur_eval(fur, "kept[0][1] == 2 and kept[1]['key'] == 'a string too long to be small'", &result));
+  assert(Value_asBoolean(result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_stackClosuresDontAllocate() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(
+    fur,
+    "sum(n) = {\n"
+    "  mut total = 0;\n"
+    "  for(i in range(n)) {\n"
+    "    add(x) = { total = total + x + i }\n"
+    "    add(1);\n"
+    "  }\n"
+    "  total\n"
+    "}",
+    &result
+  ));
+
+  size_t bytesAllocated = fur->thread.bytesAllocated;
+
+  // add() is only ever called, so neither it nor total is on the heap
+  assert(Fur_eval(fur, "sum(1000)", &result));
+  assert(Value_asInteger(result) == 1000 + 999 * 1000 / 2);
+  assert(fur->thread.bytesAllocated == bytesAllocated);
+  assert(fur->thread.objects == NULL);
+
+  // A closure which is returned still captures a boxed variable
+  assert(Fur_eval(fur, "counter() = { mut c = 0; \\() { c = c + 1; c } }", &result));
+  assert(Fur_eval(fur, "next = counter(); next(); next()", &result));
+  assert(Value_asInteger(result) == 2);
+  assert(fur->thread.objects != NULL);
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_convertsStrings() {
+  Fur* fur = Fur_new();
+  Value result;
+
+  assert(Fur_eval(fur, "Int('-1234567890') + Int('0000000000000000042')", &result));
+  assert(Value_asInteger(result) == -1234567848);
+
+  // Integers too big for an int64_t parse as big integers
+  assert(Fur_eval(fur, "Int('-9223372036854775809') + 1", &result));
+  assert(Value_asInteger(result) == INT64_MIN);
+
+  // Text which isn't a boolean or an integer gives nil
+  assert(Fur_eval(fur, "Int('12 ') == nil and Int('') == nil and Bool('yes') == nil", &result));
+  assert(Value_asBoolean(result));
+
+  assert(Fur_eval(fur, "Bool('true') and not Bool('false')", &result));
+  assert(Value_asBoolean(result));
+
+  assert(Fur_eval(fur, "UTF8(-42) == '-42' and UTF8(false) == 'false'", &result));
+  assert(Value_asBoolean(result));
+
+  // UTF-32 strings are transcoded
+  assert(Fur_eval(fur, "Int('-12345678901'utf32) + Int('99999999999999999999'utf32)", &result));
+  assert(result.type == VALUE_BIG_INTEGER);
+  assert(Fur_eval(fur, "Bool('true'utf32) and Int('1é'utf32) == nil", &result));
+  assert(Value_asBoolean(result));
+  assert(Fur_eval(fur, "UTF8('déjà'utf32) == 'déjà' and UTF8('transcoded to UTF-8'utf32) == 'transcoded to UTF-8'", &result));
+  assert(Value_asBoolean(result));
+
+  // Values with no conversion give nil too
+  assert(Fur_eval(fur, "UTF8([1]) == nil and Int([1]) == nil and Bool([:]) == nil and UTF8(print) == nil", &result));
+  assert(Value_asBoolean(result));
+
+  assert(Fur_eval(fur, "UTF8(9223372036854775807 + 1)", &result));
+  assert(result.type == VALUE_UTF8);
+  assert(result.as.blob->count == 19);
+  assert(memcmp(result.as.blob->bytes, "9223372036854775808", 19) == 0);
+
+  assert(Fur_eval(fur, "b = stringBuilder();", &result));
+  assert(Fur_eval(fur, "for(i in range(3)) { append(b, i * 10); append(b, ' '); }", &result));
+  assert(Fur_eval(fur, "finish(b) == '0 10 20 '", &result));
+  assert(Value_asBoolean(result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_eval_callsNatives() {
+  Fur* fur = Fur_new();
+  Value result;
+  int64_t step = 2;
+
+  assert(Fur_eval(fur, "a = 40;", &result));
+  assert(Fur_registerNative(fur, "increment", Fur_testIncrement, &step));
+  assert(Fur_eval(fur, "increment(a)", &result));
+
+  assert(Value_asInteger(result) == 42);
+
+  Fur_del(fur);
+}
+
+void test_Fur_restore_resumesSavedState() {
+  char path[] = "/tmp/fur_snapshot_testXXXXXX";
+  int fd = mkstemp(path);
+  assert(fd != -1);
+  close(fd);
+
+  Fur* fur = Fur_new();
+  Value result;
+
+  // A function, a closure over a box, a big integer, strings, an array, a map,
+  // a range and a string builder
+  assert(Fur_eval(fur, "double(n) = n * 2;", &result));
+  assert(Fur_eval(fur, "makeCounter() = { mut count = 0; \\() { count = count + 1; count } }", &result));
+  assert(Fur_eval(fur, "counter = makeCounter();", &result));
+  assert(Fur_eval(fur, "counter();", &result));
+  assert(Fur_eval(fur, "big = 9223372036854775807 + 1;", &result));
+  assert(Fur_eval(fur, "name = 'fur';", &result));
+  assert(Fur_eval(fur, "greeting = name + ' restored';", &result));
+  assert(Fur_eval(fur, "items = [name, [big]];", &result));
+  assert(Fur_eval(fur, "lookup = [name: items, big: 2];", &result));
+  assert(Fur_eval(fur, "span = range(2, 5);", &result));
+  assert(Fur_eval(fur, "log = stringBuilder();", &result));
+  assert(Fur_eval(fur, "append(log, 'saved, ');", &result));
+  assert(Fur_save(fur, path));
+  Fur_del(fur);
+
+  fur = Fur_new();
+  assert(Fur_restore(fur, path));
+
+  // The restored state is independent of the file
+  unlink(path);
+
+  assert(Fur_eval(fur, "counter() + double(20)", &result));
+  assert(Value_asInteger(result) == 42);
+
+  assert(Fur_eval(fur, "big - 9223372036854775807", &result));
+  assert(Value_asInteger(result) == 1);
+
+  assert(Fur_eval(fur, "name", &result));
+  assert(result.type == VALUE_SMALL_UTF8);
+  assert(Value_utf8Count(&result) == 3);
+  assert(memcmp(Value_utf8Bytes(&result), "fur", 3) == 0);
+
+  // Strings built at runtime are restored from their own records
+  assert(Fur_eval(fur, "greeting", &result));
+  assert(result.type == VALUE_UTF8);
+  assert(result.as.blob->count == 12);
+  assert(memcmp(result.as.blob->bytes, "fur restored", 12) == 0);
+
+  // Arrays are restored with the objects they contain
+  assert(Fur_eval(fur, "items[0] == name and items[1][0] - big", &result));
+  assert(Value_asInteger(result) == 0);
+
+  // Map keys are hashed again when restored
+  assert(Fur_eval(fur, "lookup['fur'] == items and lookup[big]", &result));
+  assert(Value_asInteger(result) == 2);
+
+  assert(Fur_eval(fur, "span == range(2, 5)", &result));
+  assert(Value_asBoolean(result));
+
+  // String builders keep what was appended, and can be appended to again
+  assert(Fur_eval(fur, "append(log, 'restored');", &result));
+  assert(Fur_eval(fur, "finish(log) == 'saved, restored'", &result));
+  assert(Value_asBoolean(result));
+
+  Fur_del(fur);
+}
+
+void test_Fur_restore_requiresNatives() {
+  char path[] = "/tmp/fur_snapshot_testXXXXXX";
+  int fd = mkstemp(path);
+  assert(fd != -1);
+  close(fd);
+
+  int64_t step = 2;
+
+  Fur* fur = Fur_new();
+  Value result;
+  assert(Fur_registerNative(fur, "increment", Fur_testIncrement, &step));
+  assert(Fur_eval(fur, "a = increment(38);", &result));
+  assert(Fur_save(fur, path));
+  Fur_del(fur);
+
+  fur = Fur_new();
+  assert(!Fur_restore(fur, path));
+  assert(Fur_registerNative(fur, "increment", Fur_testIncrement, &step));
+  assert(Fur_restore(fur, path));
+  assert(Fur_eval(fur, "increment(a)", &result));
+  assert(Value_asInteger(result) == 42);
+  Fur_del(fur);
+
+  unlink(path);
+}
+
+#endif
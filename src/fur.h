@@ -0,0 +1,108 @@
+#ifndef FUR_H
+#define FUR_H
+
+#include <stdbool.h>
+
+#include "compiler.h"
+#include "instruction.h"
+#include "native.h"
+#include "parser.h"
+#include "snapshot.h"
+#include "thread.h"
+#include "value.h"
+
+/*
+ * An interpreter instance, for programs embedding Fur through libfur. Each
+ * piece of source is compiled onto the end of the same ByteCode and run on
+ * the same Thread, like lines in the REPL, so later source sees the
+ * variables and functions of earlier source, and the compiler and ByteCode
+ * stay warm across evaluations.
+ *
+ * Source is parsed in REPL mode, so the last statement doesn't need a
+ * semicolon. Errors are printed to stderr, as in bin/fur.
+ *
+ * An instance is not thread-safe, but separate instances can be used on
+ * separate threads.
+ */
+typedef struct {
+  Compiler compiler;
+  ByteCode byteCode;
+  Thread thread;
+  Parser parser;
+
+  // Symbols point into the source, so it is kept until the instance is freed
+  const char** sources;
+  size_t sourceCount;
+  size_t sourceCapacity;
+
+  // The variables declared before the last compile, for backing out a panic
+  size_t symbolCheckpoint;
+
+  // The image restored by Fur_restore(), if any
+  Snapshot snapshot;
+} Fur;
+
+Fur* Fur_new();
+void Fur_del(Fur*);
+
+/*
+ * Natives must be registered (or loaded) before compiling the code that
+ * calls them. See NativeList_register() and NativeList_load().
+ */
+bool Fur_registerNative(Fur*, const char* name, NativeContextFn, void* context);
+bool Fur_loadNatives(Fur*, const char* path);
+
+/*
+ * Compiles source, which is copied. Returns false if it has errors, in
+ * which case nothing is compiled and it can't be run.
+ */
+bool Fur_compile(Fur*, const char* source);
+
+/*
+ * Runs the code compiled since the last run, storing the value of its last
+ * statement in result. Returns false if the code panicked, in which case
+ * the variables it declared are forgotten and the instance can be used
+ * again. Program output is flushed before returning. An object the result
+ * refers to, like an array, is only valid until the next run, which may
+ * collect it.
+ */
+bool Fur_run(Fur*, Value* result);
+
+// Compiles and runs source
+bool Fur_eval(Fur*, const char* source, Value* result);
+
+/*
+ * Saves the instance's variables and compiled code to path, for restoring
+ * into a new instance later, e.g. after loading a prelude. See Snapshot.
+ */
+bool Fur_save(Fur*, const char* path);
+
+/*
+ * Restores a snapshot into an instance which hasn't compiled anything yet,
+ * after registering the natives the snapshot uses. Returns false, leaving
+ * the instance as it was, if the snapshot can't be restored.
+ */
+bool Fur_restore(Fur*, const char* path);
+
+#ifdef TEST
+
+void test_Fur_eval_keepsStateAcrossEvaluations();
+void test_Fur_eval_recoversFromErrors();
+void test_Fur_eval_arrays();
+void test_Fur_eval_maps();
+void test_Fur_eval_forLoops();
+void test_Fur_eval_forLoopsOnlyCollectUsedValues();
+void test_Fur_eval_elementwiseArrays();
+void test_Fur_eval_smallStrings();
+void test_Fur_eval_buildsStrings();
+void test_Fur_eval_collectsUnreachableObjects();
+void test_Fur_eval_stackClosuresDontAllocate();
+void test_Fur_eval_convertsStrings();
+void test_Fur_eval_builtinsPanicOnBadArguments();
+void test_Fur_eval_callsNatives();
+void test_Fur_restore_resumesSavedState();
+void test_Fur_restore_requiresNatives();
+
+#endif
+
+#endif
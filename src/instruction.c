@@ -25,12 +25,16 @@ void ByteCode_init(ByteCode* self) {
   self->lineRuns[0] = lineRun;
 
   BlobList_init(&(self->blobs));
+  FnList_init(&(self->functions));
+  NativeList_init(&(self->natives));
 }
 
 void ByteCode_free(ByteCode* self) {
   free(self->items);
   free(self->lineRuns);
   BlobList_free(&(self->blobs));
+  FnList_free(&(self->functions));
+  NativeList_free(&(self->natives));
 }
 
 inline static bool ByteCode_canInsert(ByteCode* self, size_t i) {
@@ -120,6 +124,10 @@ void ByteCode_appendInt32(ByteCode* self, int32_t i, size_t line) {
   DEFINE_TYPE_APPENDER(int32_t);
 }
 
+void ByteCode_appendInt64(ByteCode* self, int64_t i, size_t line) {
+  DEFINE_TYPE_APPENDER(int64_t);
+}
+
 #undef DEFINE_TYPE_APPENDER
 
 size_t ByteCode_getLine(ByteCode* self, uint8_t* instruction) {
@@ -151,6 +159,12 @@ size_t ByteCode_getLine(ByteCode* self, uint8_t* instruction) {
 }
 
 void ByteCode_rewind(ByteCode* self, size_t count) {
+  // Functions compiled after the checkpoint no longer have a body
+  while(self->functions.count > 0
+      && self->functions.items[self->functions.count - 1]->start >= count) {
+    Fn_del(self->functions.items[--(self->functions.count)]);
+  }
+
   size_t run = 0;
 
   for(size_t i = 0; i < self->lineRunCount; i++) {
@@ -167,6 +181,81 @@ void ByteCode_rewind(ByteCode* self, size_t count) {
   assert(count == self->count);
 }
 
+const char* Instruction_toCString(Instruction self) {
+  #define NAME_CASE(op) case op: return #op
+
+  switch(self) {
+    NAME_CASE(OP_NIL);
+    NAME_CASE(OP_TRUE);
+    NAME_CASE(OP_FALSE);
+    NAME_CASE(OP_INTEGER);
+    NAME_CASE(OP_INTEGER64);
+    NAME_CASE(OP_UTF8);
+    NAME_CASE(OP_SMALL_UTF8);
+    NAME_CASE(OP_UTF32);
+    NAME_CASE(OP_BUILTIN);
+    NAME_CASE(OP_NATIVE);
+    NAME_CASE(OP_FUNCTION);
+    NAME_CASE(OP_CLOSURE);
+    NAME_CASE(OP_STACK_CLOSURE);
+    NAME_CASE(OP_GET);
+    NAME_CASE(OP_SET);
+    NAME_CASE(OP_GET_GLOBAL);
+    NAME_CASE(OP_SET_GLOBAL);
+    NAME_CASE(OP_GET_BOXED);
+    NAME_CASE(OP_SET_BOXED);
+    NAME_CASE(OP_GET_UPVALUE);
+    NAME_CASE(OP_GET_UPVALUE_BOXED);
+    NAME_CASE(OP_SET_UPVALUE_BOXED);
+    NAME_CASE(OP_GET_STACK_UPVALUE);
+    NAME_CASE(OP_GET_STACK_UPVALUE_BOXED);
+    NAME_CASE(OP_SET_STACK_UPVALUE_BOXED);
+    NAME_CASE(OP_GET_STACK_UPVALUE_REF);
+    NAME_CASE(OP_SET_STACK_UPVALUE_REF);
+    NAME_CASE(OP_BOX);
+    NAME_CASE(OP_ARRAY);
+    NAME_CASE(OP_MAP);
+    NAME_CASE(OP_GET_INDEX);
+    NAME_CASE(OP_SET_INDEX);
+    NAME_CASE(OP_COLLECT);
+    NAME_CASE(OP_RESERVE_RANGE);
+    NAME_CASE(OP_NEGATE);
+    NAME_CASE(OP_NOT);
+    NAME_CASE(OP_ADD);
+    NAME_CASE(OP_SUBTRACT);
+    NAME_CASE(OP_MULTIPLY);
+    NAME_CASE(OP_IDIVIDE);
+    NAME_CASE(OP_LESS_THAN);
+    NAME_CASE(OP_LESS_THAN_EQUAL);
+    NAME_CASE(OP_GREATER_THAN);
+    NAME_CASE(OP_GREATER_THAN_EQUAL);
+    NAME_CASE(OP_EQUAL);
+    NAME_CASE(OP_NOT_EQUAL);
+    NAME_CASE(OP_DUP);
+    NAME_CASE(OP_DROP);
+    NAME_CASE(OP_ROT3);
+    NAME_CASE(OP_JUMP);
+    NAME_CASE(OP_JUMP_TRUE);
+    NAME_CASE(OP_JUMP_FALSE);
+    NAME_CASE(OP_FOR_RANGE);
+    NAME_CASE(OP_FOR_NEXT);
+    NAME_CASE(OP_FOR_ELEMENTWISE);
+    NAME_CASE(OP_SCOPE_OPEN);
+    NAME_CASE(OP_SCOPE_CLOSE);
+    NAME_CASE(OP_CALL);
+    NAME_CASE(OP_TAIL_CALL);
+    NAME_CASE(OP_CALL_BUILTIN);
+    NAME_CASE(OP_CALL_NATIVE);
+    NAME_CASE(OP_RETURN);
+  }
+
+  #undef NAME_CASE
+
+  // Should never get here
+  assert(false);
+  return ""; // silence warnings
+}
+
 #ifdef TEST
 
 void test_ByteCode_append_basic() {
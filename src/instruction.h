@@ -5,17 +5,44 @@
 #include <stdlib.h>
 
 #include "blob.h"
+#include "fn.h"
+#include "native.h"
 
 typedef enum {
   OP_NIL,
   OP_TRUE,
   OP_FALSE,
   OP_INTEGER,
+  OP_INTEGER64,
   OP_UTF8,
+  OP_SMALL_UTF8,
   OP_UTF32,
   OP_BUILTIN,
+  OP_NATIVE,
+  OP_FUNCTION,
+  OP_CLOSURE,
+  OP_STACK_CLOSURE,
   OP_GET,
   OP_SET,
+  OP_GET_GLOBAL,
+  OP_SET_GLOBAL,
+  OP_GET_BOXED,
+  OP_SET_BOXED,
+  OP_GET_UPVALUE,
+  OP_GET_UPVALUE_BOXED,
+  OP_SET_UPVALUE_BOXED,
+  OP_GET_STACK_UPVALUE,
+  OP_GET_STACK_UPVALUE_BOXED,
+  OP_SET_STACK_UPVALUE_BOXED,
+  OP_GET_STACK_UPVALUE_REF,
+  OP_SET_STACK_UPVALUE_REF,
+  OP_BOX,
+  OP_ARRAY,
+  OP_MAP,
+  OP_GET_INDEX,
+  OP_SET_INDEX,
+  OP_COLLECT,
+  OP_RESERVE_RANGE,
   OP_NEGATE,
   OP_NOT,
   OP_ADD,
@@ -34,12 +61,31 @@ typedef enum {
   OP_JUMP,
   OP_JUMP_TRUE,
   OP_JUMP_FALSE,
+  OP_FOR_RANGE,
+  OP_FOR_NEXT,
+  OP_FOR_ELEMENTWISE,
   OP_SCOPE_OPEN,
   OP_SCOPE_CLOSE,
   OP_CALL,
+  OP_TAIL_CALL,
+  OP_CALL_BUILTIN,
+  OP_CALL_NATIVE,
   OP_RETURN,
 } Instruction;
 
+/*
+ * Where OP_CLOSURE and OP_STACK_CLOSURE get each upvalue. Only stack
+ * closures capture a slot's index rather than its value, since they can't
+ * outlive the frame.
+ */
+typedef enum {
+  CAPTURE_UPVALUE,
+  CAPTURE_LOCAL,
+  CAPTURE_LOCAL_REF
+} Capture;
+
+const char* Instruction_toCString(Instruction);
+
 typedef struct {
   size_t line;
   size_t run;
@@ -53,6 +99,8 @@ typedef struct {
   size_t lineRunCapacity;
   LineRun* lineRuns;
   BlobList blobs;
+  FnList functions;
+  NativeList natives;
 } ByteCode;
 
 void ByteCode_init(ByteCode*);
@@ -61,6 +109,7 @@ void ByteCode_append(ByteCode*, uint8_t, size_t line);
 void ByteCode_appendInt16(ByteCode*, int16_t, size_t line);
 void ByteCode_appendUInt16(ByteCode*, uint16_t, size_t line);
 void ByteCode_appendInt32(ByteCode*, int32_t, size_t line);
+void ByteCode_appendInt64(ByteCode*, int64_t, size_t line);
 size_t ByteCode_getLine(ByteCode*, uint8_t* instruction);
 
 inline static size_t ByteCode_count(ByteCode* self) {
@@ -0,0 +1,151 @@
+#ifdef INSTRUMENT
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "instrumentation.h"
+
+// Only the most frequent bigrams are printed; the rest are rarely useful
+#define INSTRUMENTATION_PRINTED_BIGRAMS 32
+
+typedef struct {
+  uint64_t taken;
+  uint64_t notTaken;
+} BranchCount;
+
+uint64_t Instrumentation_counts[INSTRUMENTATION_OPCODES];
+uint64_t Instrumentation_bigrams[INSTRUMENTATION_OPCODES][INSTRUMENTATION_OPCODES];
+
+/*
+ * Branch counts are indexed by the position of the jump in the ByteCode,
+ * which assumes a single ByteCode per process, as in the REPL or when
+ * running a file.
+ */
+static BranchCount* branches = NULL;
+static size_t branchCapacity = 0;
+
+void Instrumentation_recordBranch(ByteCode* byteCode, uint8_t* instruction, bool taken) {
+  size_t index = ByteCode_index(byteCode, instruction);
+
+  if(index >= branchCapacity) {
+    size_t newCapacity = branchCapacity == 0 ? 256 : branchCapacity;
+    while(newCapacity <= index) newCapacity *= 2;
+
+    branches = realloc(branches, sizeof(BranchCount) * newCapacity);
+
+    // TODO Handle this
+    assert(branches != NULL);
+
+    memset(branches + branchCapacity, 0, sizeof(BranchCount) * (newCapacity - branchCapacity));
+    branchCapacity = newCapacity;
+  }
+
+  if(taken) {
+    branches[index].taken++;
+  } else {
+    branches[index].notTaken++;
+  }
+}
+
+void Instrumentation_reset() {
+  memset(Instrumentation_counts, 0, sizeof(Instrumentation_counts));
+  memset(Instrumentation_bigrams, 0, sizeof(Instrumentation_bigrams));
+  if(branches != NULL) memset(branches, 0, sizeof(BranchCount) * branchCapacity);
+}
+
+typedef struct {
+  uint8_t first;
+  uint8_t second;
+  uint64_t count;
+} Bigram;
+
+static int Bigram_compare(const void* a, const void* b) {
+  const Bigram* b0 = a;
+  const Bigram* b1 = b;
+
+  if(b0->count != b1->count) return b0->count < b1->count ? 1 : -1;
+  if(b0->first != b1->first) return (int)b0->first - (int)b1->first;
+  return (int)b0->second - (int)b1->second;
+}
+
+static double Instrumentation_percent(uint64_t count, uint64_t total) {
+  return total == 0 ? 0.0 : 100.0 * (double)count / (double)total;
+}
+
+void Instrumentation_print(FILE* out, ByteCode* byteCode) {
+  uint64_t total = 0;
+  for(size_t i = 0; i < INSTRUMENTATION_OPCODES; i++) total += Instrumentation_counts[i];
+
+  fprintf(out, "%llu instructions executed\n", (unsigned long long)total);
+  fprintf(out, "%14s %7s  %s\n", "count", "%", "instruction");
+
+  for(size_t i = 0; i < INSTRUMENTATION_OPCODES; i++) {
+    if(Instrumentation_counts[i] == 0) continue;
+
+    fprintf(
+      out,
+      "%14llu %6.2f%%  %s\n",
+      (unsigned long long)Instrumentation_counts[i],
+      Instrumentation_percent(Instrumentation_counts[i], total),
+      Instruction_toCString((Instruction)i)
+    );
+  }
+
+  size_t bigramCount = 0;
+  Bigram* bigrams = malloc(sizeof(Bigram) * INSTRUMENTATION_OPCODES * INSTRUMENTATION_OPCODES);
+  uint64_t bigramTotal = 0;
+
+  for(size_t i = 0; i < INSTRUMENTATION_OPCODES; i++) {
+    for(size_t j = 0; j < INSTRUMENTATION_OPCODES; j++) {
+      if(Instrumentation_bigrams[i][j] == 0) continue;
+
+      bigrams[bigramCount].first = (uint8_t)i;
+      bigrams[bigramCount].second = (uint8_t)j;
+      bigrams[bigramCount].count = Instrumentation_bigrams[i][j];
+      bigramTotal += bigrams[bigramCount].count;
+      bigramCount++;
+    }
+  }
+
+  qsort(bigrams, bigramCount, sizeof(Bigram), Bigram_compare);
+
+  fprintf(out, "\n%zu distinct bigrams, most frequent first\n", bigramCount);
+  fprintf(out, "%14s %7s  %s\n", "count", "%", "bigram");
+
+  for(size_t i = 0; i < bigramCount && i < INSTRUMENTATION_PRINTED_BIGRAMS; i++) {
+    fprintf(
+      out,
+      "%14llu %6.2f%%  %s -> %s\n",
+      (unsigned long long)bigrams[i].count,
+      Instrumentation_percent(bigrams[i].count, bigramTotal),
+      Instruction_toCString((Instruction)bigrams[i].first),
+      Instruction_toCString((Instruction)bigrams[i].second)
+    );
+  }
+
+  free(bigrams);
+
+  fprintf(out, "\nConditional jumps\n");
+  fprintf(out, "%8s %6s %-14s %14s %14s %7s\n", "index", "line", "instruction", "taken", "not taken", "taken");
+
+  for(size_t i = 0; i < branchCapacity && i < ByteCode_count(byteCode); i++) {
+    uint64_t executed = branches[i].taken + branches[i].notTaken;
+    if(executed == 0) continue;
+
+    uint8_t* instruction = ByteCode_pc(byteCode, i);
+
+    fprintf(
+      out,
+      "%8zu %6zu %-14s %14llu %14llu %6.2f%%\n",
+      i,
+      ByteCode_getLine(byteCode, instruction),
+      Instruction_toCString((Instruction)(*instruction)),
+      (unsigned long long)branches[i].taken,
+      (unsigned long long)branches[i].notTaken,
+      Instrumentation_percent(branches[i].taken, executed)
+    );
+  }
+}
+
+#endif
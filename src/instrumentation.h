@@ -0,0 +1,59 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+/*
+ * Dispatch counters for Thread_run(), used to choose superinstructions and
+ * to check branch layout on real programs. They only exist when compiled
+ * with -DINSTRUMENT (`make bin/fur_instrumented`); in other builds this
+ * header declares nothing and Thread_run() contains no counting code.
+ *
+ * Three things are counted:
+ *
+ * 1. How many times each instruction is executed.
+ * 2. How many times each instruction is immediately followed by each other
+ *    instruction (bigrams).
+ * 3. For each OP_JUMP_TRUE/OP_JUMP_FALSE in the ByteCode, how many times the
+ *    jump was taken and not taken.
+ *
+ * Counts accumulate across calls to Thread_run(), and across Threads, until
+ * Instrumentation_reset() is called.
+ */
+
+#ifdef INSTRUMENT
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "instruction.h"
+
+// Opcodes are a single byte, so this covers any Instruction
+#define INSTRUMENTATION_OPCODES 256
+
+// Used as the previous instruction at the start of Thread_run()
+#define INSTRUMENTATION_NO_INSTRUCTION INSTRUMENTATION_OPCODES
+
+extern uint64_t Instrumentation_counts[INSTRUMENTATION_OPCODES];
+extern uint64_t Instrumentation_bigrams[INSTRUMENTATION_OPCODES][INSTRUMENTATION_OPCODES];
+
+inline static void Instrumentation_recordInstruction(uint16_t previous, Instruction instruction) {
+  Instrumentation_counts[instruction]++;
+
+  if(previous != INSTRUMENTATION_NO_INSTRUCTION) {
+    Instrumentation_bigrams[previous][instruction]++;
+  }
+}
+
+void Instrumentation_recordBranch(ByteCode*, uint8_t* instruction, bool taken);
+
+void Instrumentation_reset();
+
+/*
+ * Prints instruction counts, the most frequent bigrams and per-site branch
+ * counts. The ByteCode is used to find the source line of each branch.
+ */
+void Instrumentation_print(FILE*, ByteCode*);
+
+#endif
+
+#endif
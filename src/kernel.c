@@ -0,0 +1,786 @@
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define KERNEL_HAS_AVX2
+#endif
+
+#include "kernel.h"
+
+// Returns false where the result isn't an int64_t, or is a division by 0
+inline static bool Kernel_apply(Instruction op, int64_t a, int64_t b, int64_t* result) {
+  switch(op) {
+    case OP_ADD:
+      return !__builtin_add_overflow(a, b, result);
+
+    case OP_SUBTRACT:
+      return !__builtin_sub_overflow(a, b, result);
+
+    case OP_MULTIPLY:
+      return !__builtin_mul_overflow(a, b, result);
+
+    case OP_IDIVIDE:
+      // INT64_MIN // -1 is the only int64_t division which overflows
+      if(b == 0 || (a == INT64_MIN && b == -1)) return false;
+      *result = a / b;
+      return true;
+
+    default:
+      assert(false);
+      return false;
+  }
+}
+
+inline static bool Kernel_holds(Instruction op, int64_t a, int64_t b) {
+  switch(op) {
+    case OP_LESS_THAN:
+      return a < b;
+
+    case OP_LESS_THAN_EQUAL:
+      return a <= b;
+
+    case OP_GREATER_THAN:
+      return a > b;
+
+    case OP_GREATER_THAN_EQUAL:
+      return a >= b;
+
+    default:
+      assert(false);
+      return false;
+  }
+}
+
+static size_t Kernel_arithmeticScalar(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+  for(size_t i = 0; i < count; i++) {
+    Value a = left[i * leftStride];
+    Value b = right[i * rightStride];
+    int64_t r;
+
+    if(a.type != VALUE_INTEGER || b.type != VALUE_INTEGER) return i;
+    if(!Kernel_apply(op, a.as.integer, b.as.integer, &r)) return i;
+
+    result[i] = Value_fromInteger(r);
+  }
+
+  return count;
+}
+
+static size_t Kernel_compareScalar(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+  for(size_t i = 0; i < count; i++) {
+    Value a = left[i * leftStride];
+    Value b = right[i * rightStride];
+
+    if(a.type != VALUE_INTEGER || b.type != VALUE_INTEGER) return i;
+
+    result[i] = Value_fromBoolean(Kernel_holds(op, a.as.integer, b.as.integer));
+  }
+
+  return count;
+}
+
+static size_t Kernel_sumScalar(const Value* items, size_t count, int64_t* sum) {
+  int64_t total = *sum;
+  size_t i = 0;
+
+  for(; i < count; i++) {
+    int64_t next;
+
+    if(items[i].type != VALUE_INTEGER) break;
+    if(__builtin_add_overflow(total, items[i].as.integer, &next)) break;
+
+    total = next;
+  }
+
+  *sum = total;
+  return i;
+}
+
+static size_t Kernel_foldScalar(const Value* items, size_t count, int64_t* best, bool isMin) {
+  int64_t result = *best;
+  size_t i = 0;
+
+  for(; i < count; i++) {
+    if(items[i].type != VALUE_INTEGER) break;
+
+    int64_t item = items[i].as.integer;
+    if(isMin ? item < result : item > result) result = item;
+  }
+
+  *best = result;
+  return i;
+}
+
+static size_t Kernel_countScalar(const Value* items, size_t count, size_t* trues) {
+  size_t total = *trues;
+  size_t i = 0;
+
+  for(; i < count; i++) {
+    if(items[i].type != VALUE_BOOLEAN) break;
+    total += items[i].as.boolean;
+  }
+
+  *trues = total;
+  return i;
+}
+
+#ifdef KERNEL_HAS_AVX2
+
+/*
+ * A 256-bit register holds two Values, each as a 64-bit lane with the type
+ * (whose upper 4 bytes are padding, and may be garbage) followed by a lane
+ * with the payload. Results are written with clean type lanes and the
+ * payload blended in, so they're the same bytes Value_fromInteger() and
+ * Value_fromBoolean() would produce.
+ *
+ * SSE registers would hold one Value each, so there's nothing between AVX2
+ * and the scalar loops.
+ */
+_Static_assert(
+  sizeof(Value) == 16 && offsetof(Value, as) == 8,
+  "The AVX2 kernels expect a Value to be a type lane and a payload lane"
+);
+
+#define AVX2 __attribute__((target("avx2")))
+
+// Inlined into a copy per operator, so the switches leave the loop
+#define KERNEL_SPECIALIZED __attribute__((always_inline))
+
+// Selects the payload lanes from the second operand of _mm256_blend_epi32()
+#define KERNEL_PAYLOAD_DWORDS 0xCC
+
+AVX2 inline static __m256i Kernel_load(const Value* values, size_t i, size_t stride) {
+  if(stride == 0) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)values));
+  }
+
+  return _mm256_loadu_si256((const __m256i*)(values + i));
+}
+
+// Two Values of the given type with zero payloads
+AVX2 inline static __m256i Kernel_types(ValueType type) {
+  return _mm256_set_epi64x(0, type, 0, type);
+}
+
+/*
+ * The bits Kernel_isClean() tests: the low 4 bytes of each type lane, and in
+ * each payload lane, the sign bit, or for OP_MULTIPLY's check, the high half.
+ */
+#define KERNEL_CHECKED_BITS _mm256_set_epi64x(INT64_MIN, UINT32_MAX, INT64_MIN, UINT32_MAX)
+#define KERNEL_CHECKED_HIGH_BITS \
+  _mm256_set_epi64x(0xFFFFFFFF00000000, UINT32_MAX, 0xFFFFFFFF00000000, UINT32_MAX)
+
+/*
+ * Sets the checked bits of the type lanes where either operand isn't of the
+ * given type, and takes the payload lanes from flags. The payload lanes of
+ * the xors are garbage, so the blend replaces them. Errors from several
+ * registers can be ORed into one test.
+ */
+AVX2 inline static __m256i Kernel_errors(__m256i a, __m256i b, __m256i types, __m256i flags) {
+  __m256i typeErrors = _mm256_or_si256(_mm256_xor_si256(a, types), _mm256_xor_si256(b, types));
+  return _mm256_blend_epi32(typeErrors, flags, KERNEL_PAYLOAD_DWORDS);
+}
+
+AVX2 inline static bool Kernel_isClean(__m256i errors, __m256i checked) {
+  return _mm256_testz_si256(errors, checked);
+}
+
+// Sets checked bits of overflows' payload lanes where r isn't exact
+AVX2 KERNEL_SPECIALIZED inline static __m256i Kernel_operate(
+    Instruction op,
+    __m256i a,
+    __m256i b,
+    __m256i* overflows) {
+  __m256i r;
+
+  switch(op) {
+    case OP_ADD:
+      // Overflow gives the result a different sign from both operands
+      r = _mm256_add_epi64(a, b);
+      *overflows = _mm256_and_si256(_mm256_xor_si256(a, r), _mm256_xor_si256(b, r));
+      return r;
+
+    case OP_SUBTRACT:
+      r = _mm256_sub_epi64(a, b);
+      *overflows = _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_xor_si256(a, r));
+      return r;
+
+    case OP_MULTIPLY:
+      {
+        /*
+         * There's no 64-bit multiply, but products of int32_ts can't
+         * overflow. Adding 2^31 leaves the high half of those 0.
+         */
+        __m256i bias = _mm256_set1_epi64x((int64_t)1 << 31);
+        *overflows = _mm256_or_si256(_mm256_add_epi64(a, bias), _mm256_add_epi64(b, bias));
+        return _mm256_mul_epi32(a, b);
+      }
+
+    default:
+      assert(false);
+      return a;
+  }
+}
+
+/*
+ * Works through four Values at a time, in two registers, which share one
+ * check. A block which fails it goes to the scalar loop, which finishes it
+ * if it can, or finds where to stop.
+ */
+AVX2 KERNEL_SPECIALIZED inline static size_t Kernel_arithmeticAVX2(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+  __m256i integers = Kernel_types(VALUE_INTEGER);
+  size_t i = 0;
+
+  while(i + 4 <= count) {
+    __m256i a0 = Kernel_load(left, i, leftStride);
+    __m256i a1 = Kernel_load(left, i + 2, leftStride);
+    __m256i b0 = Kernel_load(right, i, rightStride);
+    __m256i b1 = Kernel_load(right, i + 2, rightStride);
+    __m256i overflows0;
+    __m256i overflows1;
+    __m256i r0 = Kernel_operate(op, a0, b0, &overflows0);
+    __m256i r1 = Kernel_operate(op, a1, b1, &overflows1);
+
+    __m256i errors = _mm256_or_si256(
+      Kernel_errors(a0, b0, integers, overflows0),
+      Kernel_errors(a1, b1, integers, overflows1)
+    );
+
+    __m256i checked = op == OP_MULTIPLY ? KERNEL_CHECKED_HIGH_BITS : KERNEL_CHECKED_BITS;
+
+    if(Kernel_isClean(errors, checked)) {
+      _mm256_storeu_si256((__m256i*)(result + i), _mm256_blend_epi32(integers, r0, KERNEL_PAYLOAD_DWORDS));
+      _mm256_storeu_si256((__m256i*)(result + i + 2), _mm256_blend_epi32(integers, r1, KERNEL_PAYLOAD_DWORDS));
+      i += 4;
+    } else {
+      size_t finished = Kernel_arithmeticScalar(
+        op,
+        result + i,
+        left + i * leftStride,
+        leftStride,
+        right + i * rightStride,
+        rightStride,
+        4
+      );
+
+      i += finished;
+      if(finished < 4) return i;
+    }
+  }
+
+  return i + Kernel_arithmeticScalar(
+    op,
+    result + i,
+    left + i * leftStride,
+    leftStride,
+    right + i * rightStride,
+    rightStride,
+    count - i
+  );
+}
+
+// Sets each payload lane to 1 where the comparison holds, and 0 elsewhere
+AVX2 KERNEL_SPECIALIZED inline static __m256i Kernel_mask(Instruction op, __m256i a, __m256i b) {
+  __m256i ones = _mm256_set1_epi64x(1);
+
+  switch(op) {
+    case OP_LESS_THAN:
+      return _mm256_and_si256(_mm256_cmpgt_epi64(b, a), ones);
+
+    case OP_LESS_THAN_EQUAL:
+      return _mm256_andnot_si256(_mm256_cmpgt_epi64(a, b), ones);
+
+    case OP_GREATER_THAN:
+      return _mm256_and_si256(_mm256_cmpgt_epi64(a, b), ones);
+
+    case OP_GREATER_THAN_EQUAL:
+      return _mm256_andnot_si256(_mm256_cmpgt_epi64(b, a), ones);
+
+    default:
+      assert(false);
+      return ones;
+  }
+}
+
+// As Kernel_arithmeticAVX2(), except that comparisons can't overflow
+AVX2 KERNEL_SPECIALIZED inline static size_t Kernel_compareAVX2(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+  __m256i integers = Kernel_types(VALUE_INTEGER);
+  __m256i booleans = Kernel_types(VALUE_BOOLEAN);
+  __m256i noFlags = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m256i a0 = Kernel_load(left, i, leftStride);
+    __m256i a1 = Kernel_load(left, i + 2, leftStride);
+    __m256i b0 = Kernel_load(right, i, rightStride);
+    __m256i b1 = Kernel_load(right, i + 2, rightStride);
+
+    __m256i errors = _mm256_or_si256(
+      Kernel_errors(a0, b0, integers, noFlags),
+      Kernel_errors(a1, b1, integers, noFlags)
+    );
+
+    if(!Kernel_isClean(errors, KERNEL_CHECKED_BITS)) break;
+
+    __m256i isTrue0 = Kernel_mask(op, a0, b0);
+    __m256i isTrue1 = Kernel_mask(op, a1, b1);
+
+    _mm256_storeu_si256((__m256i*)(result + i), _mm256_blend_epi32(booleans, isTrue0, KERNEL_PAYLOAD_DWORDS));
+    _mm256_storeu_si256((__m256i*)(result + i + 2), _mm256_blend_epi32(booleans, isTrue1, KERNEL_PAYLOAD_DWORDS));
+  }
+
+  return i + Kernel_compareScalar(
+    op,
+    result + i,
+    left + i * leftStride,
+    leftStride,
+    right + i * rightStride,
+    rightStride,
+    count - i
+  );
+}
+
+// The reductions keep two accumulators, for the two registers of each block
+AVX2 static size_t Kernel_sumAVX2(const Value* items, size_t count, int64_t* sum) {
+  __m256i integers = Kernel_types(VALUE_INTEGER);
+  __m256i total0 = _mm256_setzero_si256();
+  __m256i total1 = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(items + i));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(items + i + 2));
+    __m256i r0 = _mm256_add_epi64(total0, a0);
+    __m256i r1 = _mm256_add_epi64(total1, a1);
+
+    // Overflow gives the result a different sign from both operands
+    __m256i errors = _mm256_or_si256(
+      Kernel_errors(a0, a0, integers, _mm256_and_si256(_mm256_xor_si256(total0, r0), _mm256_xor_si256(a0, r0))),
+      Kernel_errors(a1, a1, integers, _mm256_and_si256(_mm256_xor_si256(total1, r1), _mm256_xor_si256(a1, r1)))
+    );
+
+    if(!Kernel_isClean(errors, KERNEL_CHECKED_BITS)) break;
+
+    total0 = r0;
+    total1 = r1;
+  }
+
+  int64_t partial = *sum;
+  int64_t lanes[] = {
+    _mm256_extract_epi64(total0, 1),
+    _mm256_extract_epi64(total0, 3),
+    _mm256_extract_epi64(total1, 1),
+    _mm256_extract_epi64(total1, 3),
+  };
+
+  for(size_t lane = 0; lane < 4; lane++) {
+    if(__builtin_add_overflow(partial, lanes[lane], &partial)) {
+      // Each lane fit, but together they don't, so find where one at a time
+      return Kernel_sumScalar(items, count, sum);
+    }
+  }
+
+  *sum = partial;
+  return i + Kernel_sumScalar(items + i, count - i, sum);
+}
+
+AVX2 static size_t Kernel_foldAVX2(const Value* items, size_t count, int64_t* best, bool isMin) {
+  __m256i integers = Kernel_types(VALUE_INTEGER);
+  __m256i noFlags = _mm256_setzero_si256();
+  __m256i result0 = _mm256_set1_epi64x(*best);
+  __m256i result1 = result0;
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(items + i));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(items + i + 2));
+
+    __m256i errors = _mm256_or_si256(
+      Kernel_errors(a0, a0, integers, noFlags),
+      Kernel_errors(a1, a1, integers, noFlags)
+    );
+
+    if(!Kernel_isClean(errors, KERNEL_CHECKED_BITS)) break;
+
+    if(isMin) {
+      result0 = _mm256_blendv_epi8(result0, a0, _mm256_cmpgt_epi64(result0, a0));
+      result1 = _mm256_blendv_epi8(result1, a1, _mm256_cmpgt_epi64(result1, a1));
+    } else {
+      result0 = _mm256_blendv_epi8(result0, a0, _mm256_cmpgt_epi64(a0, result0));
+      result1 = _mm256_blendv_epi8(result1, a1, _mm256_cmpgt_epi64(a1, result1));
+    }
+  }
+
+  int64_t lanes[] = {
+    _mm256_extract_epi64(result0, 1),
+    _mm256_extract_epi64(result0, 3),
+    _mm256_extract_epi64(result1, 1),
+    _mm256_extract_epi64(result1, 3),
+  };
+
+  // Every lane started from *best, so folding them in is enough
+  for(size_t lane = 0; lane < 4; lane++) {
+    if(isMin ? lanes[lane] < *best : lanes[lane] > *best) *best = lanes[lane];
+  }
+
+  return i + Kernel_foldScalar(items + i, count - i, best, isMin);
+}
+
+AVX2 static size_t Kernel_countAVX2(const Value* items, size_t count, size_t* trues) {
+  __m256i booleans = Kernel_types(VALUE_BOOLEAN);
+  __m256i noFlags = _mm256_setzero_si256();
+
+  // Only the bool's own byte of the payload is guaranteed to be written
+  __m256i boolBytes = _mm256_set_epi64x(0xFF, 0, 0xFF, 0);
+  __m256i total0 = _mm256_setzero_si256();
+  __m256i total1 = _mm256_setzero_si256();
+  size_t i = 0;
+
+  for(; i + 4 <= count; i += 4) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(items + i));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(items + i + 2));
+
+    __m256i errors = _mm256_or_si256(
+      Kernel_errors(a0, a0, booleans, noFlags),
+      Kernel_errors(a1, a1, booleans, noFlags)
+    );
+
+    if(!Kernel_isClean(errors, KERNEL_CHECKED_BITS)) break;
+
+    total0 = _mm256_add_epi64(total0, _mm256_and_si256(a0, boolBytes));
+    total1 = _mm256_add_epi64(total1, _mm256_and_si256(a1, boolBytes));
+  }
+
+  __m256i total = _mm256_add_epi64(total0, total1);
+  *trues += _mm256_extract_epi64(total, 1) + _mm256_extract_epi64(total, 3);
+
+  return i + Kernel_countScalar(items + i, count - i, trues);
+}
+
+AVX2 static size_t Kernel_arithmeticEachAVX2(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+  switch(op) {
+    case OP_ADD:
+      return Kernel_arithmeticAVX2(OP_ADD, result, left, leftStride, right, rightStride, count);
+
+    case OP_SUBTRACT:
+      return Kernel_arithmeticAVX2(OP_SUBTRACT, result, left, leftStride, right, rightStride, count);
+
+    case OP_MULTIPLY:
+      return Kernel_arithmeticAVX2(OP_MULTIPLY, result, left, leftStride, right, rightStride, count);
+
+    default:
+      assert(false);
+      return 0;
+  }
+}
+
+AVX2 static size_t Kernel_compareEachAVX2(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+  switch(op) {
+    case OP_LESS_THAN:
+      return Kernel_compareAVX2(OP_LESS_THAN, result, left, leftStride, right, rightStride, count);
+
+    case OP_LESS_THAN_EQUAL:
+      return Kernel_compareAVX2(OP_LESS_THAN_EQUAL, result, left, leftStride, right, rightStride, count);
+
+    case OP_GREATER_THAN:
+      return Kernel_compareAVX2(OP_GREATER_THAN, result, left, leftStride, right, rightStride, count);
+
+    case OP_GREATER_THAN_EQUAL:
+      return Kernel_compareAVX2(OP_GREATER_THAN_EQUAL, result, left, leftStride, right, rightStride, count);
+
+    default:
+      assert(false);
+      return 0;
+  }
+}
+
+#undef KERNEL_SPECIALIZED
+#undef AVX2
+
+#endif
+
+size_t Kernel_arithmetic(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+#ifdef KERNEL_HAS_AVX2
+  // There's no vector integer division, so that stays scalar
+  if(op != OP_IDIVIDE && __builtin_cpu_supports("avx2")) {
+    return Kernel_arithmeticEachAVX2(op, result, left, leftStride, right, rightStride, count);
+  }
+#endif
+
+  return Kernel_arithmeticScalar(op, result, left, leftStride, right, rightStride, count);
+}
+
+size_t Kernel_compare(
+    Instruction op,
+    Value* result,
+    const Value* left,
+    size_t leftStride,
+    const Value* right,
+    size_t rightStride,
+    size_t count) {
+#ifdef KERNEL_HAS_AVX2
+  if(__builtin_cpu_supports("avx2")) {
+    return Kernel_compareEachAVX2(op, result, left, leftStride, right, rightStride, count);
+  }
+#endif
+
+  return Kernel_compareScalar(op, result, left, leftStride, right, rightStride, count);
+}
+
+size_t Kernel_sum(const Value* items, size_t count, int64_t* sum) {
+#ifdef KERNEL_HAS_AVX2
+  if(__builtin_cpu_supports("avx2")) return Kernel_sumAVX2(items, count, sum);
+#endif
+
+  return Kernel_sumScalar(items, count, sum);
+}
+
+size_t Kernel_min(const Value* items, size_t count, int64_t* min) {
+#ifdef KERNEL_HAS_AVX2
+  if(__builtin_cpu_supports("avx2")) return Kernel_foldAVX2(items, count, min, true);
+#endif
+
+  return Kernel_foldScalar(items, count, min, true);
+}
+
+size_t Kernel_max(const Value* items, size_t count, int64_t* max) {
+#ifdef KERNEL_HAS_AVX2
+  if(__builtin_cpu_supports("avx2")) return Kernel_foldAVX2(items, count, max, false);
+#endif
+
+  return Kernel_foldScalar(items, count, max, false);
+}
+
+size_t Kernel_count(const Value* items, size_t count, size_t* trues) {
+#ifdef KERNEL_HAS_AVX2
+  if(__builtin_cpu_supports("avx2")) return Kernel_countAVX2(items, count, trues);
+#endif
+
+  return Kernel_countScalar(items, count, trues);
+}
+
+#ifdef TEST
+
+static Value* integers(size_t count, const int64_t* values) {
+  Value* result = malloc(count * sizeof(Value));
+
+  for(size_t i = 0; i < count; i++) {
+    result[i] = Value_fromInteger(values[i]);
+  }
+
+  return result;
+}
+
+void test_Kernel_arithmetic_stopsWhereScalarPathIsNeeded() {
+  int64_t values[] = { 1, -2, 3, (int64_t)1 << 40, 5, 6, INT64_MAX, 8, 9 };
+  Value* items = integers(9, values);
+  Value result[9];
+  Value three = Value_fromInteger(3);
+
+  // Products too big for the vector path still finish exactly
+  assert(Kernel_arithmetic(OP_MULTIPLY, result, items, 1, &three, 0, 6) == 6);
+  assert(Value_asInteger(result[1]) == -6);
+  assert(Value_asInteger(result[3]) == (int64_t)3 << 40);
+
+  // Odd counts leave a tail for the scalar loop
+  assert(Kernel_arithmetic(OP_MULTIPLY, result, items, 1, items, 1, 3) == 3);
+  assert(Value_asInteger(result[2]) == 9);
+
+  assert(Kernel_arithmetic(OP_SUBTRACT, result, &three, 0, items, 1, 5) == 5);
+  assert(Value_asInteger(result[1]) == 5);
+  assert(Value_asInteger(result[4]) == -2);
+
+  // Stops at the overflow, having finished everything before it
+  assert(Kernel_arithmetic(OP_ADD, result, items, 1, &three, 0, 9) == 6);
+  assert(Value_asInteger(result[5]) == 9);
+
+  // Division truncates toward zero, as OP_IDIVIDE does
+  Value minusTwo = Value_fromInteger(-2);
+  assert(Kernel_arithmetic(OP_IDIVIDE, result, items, 1, &minusTwo, 0, 9) == 9);
+  assert(Value_asInteger(result[2]) == -1);
+  assert(Value_asInteger(result[6]) == INT64_MAX / -2);
+
+  items[4] = NIL;
+  assert(Kernel_arithmetic(OP_ADD, result, items, 1, items, 1, 9) == 4);
+
+  Value zero = Value_fromInteger(0);
+  assert(Kernel_arithmetic(OP_IDIVIDE, result, items, 1, &zero, 0, 3) == 0);
+
+  free(items);
+}
+
+void test_Kernel_compare_broadcastsScalars() {
+  int64_t values[] = { -3, 0, 2, 5, INT64_MIN, INT64_MAX, 2 };
+  Value* items = integers(7, values);
+  Value result[7];
+  Value two = Value_fromInteger(2);
+
+  assert(Kernel_compare(OP_LESS_THAN, result, items, 1, &two, 0, 7) == 7);
+  assert(Value_asBoolean(result[0]));
+  assert(!Value_asBoolean(result[2]));
+  assert(Value_asBoolean(result[4]));
+  assert(!Value_asBoolean(result[5]));
+
+  // Masks are the same bytes as TRUE and FALSE, so they compare as such
+  assert(memcmp(&result[0], &TRUE, sizeof(Value)) == 0);
+  assert(memcmp(&result[2], &FALSE, sizeof(Value)) == 0);
+
+  assert(Kernel_compare(OP_GREATER_THAN_EQUAL, result, &two, 0, items, 1, 7) == 7);
+  assert(Value_asBoolean(result[2]));
+  assert(!Value_asBoolean(result[3]));
+  assert(Value_asBoolean(result[6]));
+
+  assert(Kernel_compare(OP_LESS_THAN_EQUAL, result, items, 1, items + 1, 1, 6) == 6);
+  assert(!Value_asBoolean(result[3]));
+  assert(Value_asBoolean(result[4]));
+
+  items[3] = TRUE;
+  assert(Kernel_compare(OP_GREATER_THAN, result, items, 1, &two, 0, 7) == 3);
+
+  free(items);
+}
+
+void test_Kernel_sum_stopsBeforeOverflow() {
+  int64_t values[] = { 1, 2, 3, 4, 5, INT64_MAX - 20, 10, 20, -1 };
+  Value* items = integers(9, values);
+
+  int64_t sum = 0;
+  assert(Kernel_sum(items, 5, &sum) == 5);
+  assert(sum == 15);
+
+  sum = 0;
+  assert(Kernel_sum(items, 9, &sum) == 6);
+  assert(sum == INT64_MAX - 5);
+
+  // Lanes which fit alone but not together
+  int64_t halves[] = { INT64_MAX / 2 + 1, INT64_MAX / 2 + 1, 0, 0 };
+  Value* big = integers(4, halves);
+  sum = 0;
+  assert(Kernel_sum(big, 4, &sum) == 1);
+  assert(sum == INT64_MAX / 2 + 1);
+
+  free(big);
+  free(items);
+}
+
+void test_Kernel_minMaxCount() {
+  int64_t values[] = { 4, -7, 12, 0, 9 };
+  Value* items = integers(5, values);
+
+  int64_t min = INT64_MAX;
+  int64_t max = INT64_MIN;
+  assert(Kernel_min(items, 5, &min) == 5);
+  assert(Kernel_max(items, 5, &max) == 5);
+  assert(min == -7);
+  assert(max == 12);
+
+  Value mask[] = { TRUE, FALSE, TRUE, TRUE, FALSE, NIL, TRUE };
+  size_t trues = 0;
+  assert(Kernel_count(mask, 7, &trues) == 5);
+  assert(trues == 3);
+
+  free(items);
+}
+
+#endif
+
+#ifdef BENCH
+
+#include "bench.h"
+
+typedef struct {
+  size_t count;
+  Value* items;
+  Value* result;
+} KernelBench;
+
+static void KernelBench_scalar(void* context) {
+  KernelBench* bench = context;
+  Value three = Value_fromInteger(3);
+
+  size_t finished = Kernel_arithmeticScalar(
+    OP_MULTIPLY, bench->result, bench->items, 1, &three, 0, bench->count
+  );
+  assert(finished == bench->count);
+}
+
+static void KernelBench_dispatched(void* context) {
+  KernelBench* bench = context;
+  Value three = Value_fromInteger(3);
+
+  size_t finished = Kernel_arithmetic(
+    OP_MULTIPLY, bench->result, bench->items, 1, &three, 0, bench->count
+  );
+  assert(finished == bench->count);
+}
+
+void bench_Kernel_arithmetic() {
+  KernelBench bench;
+  bench.count = Bench_parameter("FUR_BENCH_KERNEL_COUNT", 10000);
+  bench.items = malloc(bench.count * sizeof(Value));
+  bench.result = malloc(bench.count * sizeof(Value));
+
+  for(size_t i = 0; i < bench.count; i++) {
+    bench.items[i] = Value_fromInteger((int64_t)(i * 2654435761u % 1000003));
+  }
+
+  Bench_measure("Kernel_arithmetic_scalar", KernelBench_scalar, &bench, bench.count);
+  Bench_measure("Kernel_arithmetic", KernelBench_dispatched, &bench, bench.count);
+
+  free(bench.result);
+  free(bench.items);
+}
+
+#endif
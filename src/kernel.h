@@ -0,0 +1,73 @@
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "instruction.h"
+#include "value.h"
+
+/*
+ * Bulk operations over arrays of integers, behind the elementwise operators
+ * on arrays and the reduction builtins. Items are Values rather than bare
+ * int64_ts, so each kernel checks types as it goes and stops at the first
+ * item it can't finish: one which isn't an integer, or whose result would
+ * be a big integer or a division by 0. Every kernel returns how many items
+ * it finished, and the caller takes the item it stopped at down its general
+ * path before calling the kernel again on the rest.
+ *
+ * Where the CPU has AVX2, the kernels work on two Values per register, and
+ * otherwise they fall back to scalar loops.
+ */
+
+/*
+ * Applies OP_ADD, OP_SUBTRACT, OP_MULTIPLY or OP_IDIVIDE to count pairs of
+ * operands, writing integers to result. A stride of 1 walks an array, and a
+ * stride of 0 repeats a scalar for every item.
+ */
+size_t Kernel_arithmetic(
+  Instruction,
+  Value* result,
+  const Value* left,
+  size_t leftStride,
+  const Value* right,
+  size_t rightStride,
+  size_t count
+);
+
+// As Kernel_arithmetic(), for OP_LESS_THAN and friends, writing booleans
+size_t Kernel_compare(
+  Instruction,
+  Value* result,
+  const Value* left,
+  size_t leftStride,
+  const Value* right,
+  size_t rightStride,
+  size_t count
+);
+
+// Add the items to *sum, or fold them into *min or *max, which must be set
+size_t Kernel_sum(const Value* items, size_t count, int64_t* sum);
+size_t Kernel_min(const Value* items, size_t count, int64_t* min);
+size_t Kernel_max(const Value* items, size_t count, int64_t* max);
+
+// Adds how many of the items are true to *trues, stopping at non-booleans
+size_t Kernel_count(const Value* items, size_t count, size_t* trues);
+
+#ifdef TEST
+
+void test_Kernel_arithmetic_stopsWhereScalarPathIsNeeded();
+void test_Kernel_compare_broadcastsScalars();
+void test_Kernel_sum_stopsBeforeOverflow();
+void test_Kernel_minMaxCount();
+
+#endif
+
+#ifdef BENCH
+
+void bench_Kernel_arithmetic();
+
+#endif
+
+#endif
@@ -3,97 +3,219 @@
 #include <stdlib.h>
 #include <string.h>
 #include <readline/readline.h>
+#include <readline/history.h>
 
 #include "compiler.h"
+#include "file.h"
+#include "fur.h"
+#include "instrumentation.h"
+#include "output.h"
 #include "parser.h"
+#include "profiler.h"
 #include "thread.h"
 #include "value.h"
 
-#include <stdio.h>
+static bool startProfiler(Profiler* profiler, const char* profilePath, ByteCode* byteCode) {
+  if(profilePath == NULL) return true;
 
-typedef struct {
-  const char** items;
-  size_t count;
-  size_t capacity;
-} BufferList;
+  Profiler_init(profiler, byteCode);
 
-void BufferList_init(BufferList* self) {
-  self->count = 0;
-  self->capacity = 16;
-  self->items = malloc(sizeof(char*) * self->capacity);
+  if(!Profiler_start(profiler)) {
+    perror("Unable to start profiler");
+    Profiler_free(profiler);
+    return false;
+  }
+
+  return true;
 }
 
-void BufferList_free(BufferList* self) {
-  for(size_t i = 0; i < self->count; i++) {
-    free((void*)(self->items[i]));
+/*
+ * Prints the flat profile to stderr and writes folded stacks to
+ * profilePath, for use with flamegraph tools.
+ */
+static void stopProfiler(Profiler* profiler, const char* profilePath, const char* name, const char* source) {
+  if(profilePath == NULL) return;
+
+  Profiler_stop(profiler);
+  Profiler_printFlat(profiler, stderr, source);
+
+  FILE* folded = fopen(profilePath, "w");
+
+  if(folded == NULL) {
+    perror(profilePath);
+  } else {
+    Profiler_printFolded(profiler, folded, name);
+    fclose(folded);
   }
-  free(self->items);
+
+  Profiler_free(profiler);
 }
 
-void BufferList_append(BufferList* self, const char* buffer) {
-  if(self->count == self->capacity) {
-    self->capacity *= 2;
-    self->items = realloc(self->items, self->capacity * sizeof(char*));
+// Paths of shared objects to load natives from, given with --native=PATH
+typedef struct {
+  const char** items;
+  size_t count;
+} NativePaths;
+
+static bool loadNatives(ByteCode* byteCode, NativePaths* nativePaths) {
+  for(size_t i = 0; i < nativePaths->count; i++) {
+    if(!NativeList_load(&(byteCode->natives), nativePaths->items[i])) return false;
   }
 
-  self->items[self->count++] = buffer;
+  return true;
 }
 
-int main() {
+static int runFile(const char* path, const char* profilePath, NativePaths* nativePaths) {
+  char* source = File_read(path);
+
+  if(source == NULL) {
+    perror(path);
+    return 1;
+  }
+
   Compiler compiler;
   Compiler_init(&compiler);
   ByteCode byteCode;
   ByteCode_init(&byteCode);
-  Thread thread;
-  Thread_init(&thread, &byteCode);
-  BufferList bufferList;
-  BufferList_init(&bufferList);
-
   Parser parser;
-  Parser_init(&parser, "", true /* REPL mode */);
+  Parser_init(&parser, source, false /* module mode */);
+
+  // Failing to start still falls through, to free everything above
+  Profiler profiler;
+  bool hasStarted = loadNatives(&byteCode, nativePaths)
+    && startProfiler(&profiler, profilePath, &byteCode);
+
+  bool success = hasStarted && Compiler_compile(&compiler, &byteCode, &parser);
+
+  if(success) {
+    Thread thread;
+    Thread_init(&thread, &byteCode);
+
+    // A script's output is only what it prints, unlike the REPL's
+    Thread_run(&thread);
+    success = !thread.panic;
+
+    Thread_free(&thread);
+  }
+
+  if(hasStarted) stopProfiler(&profiler, profilePath, path, source);
+
+#ifdef INSTRUMENT
+  Instrumentation_print(stderr, &byteCode);
+#endif
+
+  Parser_free(&parser);
+  ByteCode_free(&byteCode);
+  Compiler_free(&compiler);
+  free(source);
+
+  return success ? 0 : 1;
+}
+
+static int runRepl(const char* profilePath, NativePaths* nativePaths, const char* snapshotPath) {
+  Fur* fur = Fur_new();
+
+  Profiler profiler;
+  bool hasStarted = loadNatives(&(fur->byteCode), nativePaths)
+    && (snapshotPath == NULL || Fur_restore(fur, snapshotPath))
+    && startProfiler(&profiler, profilePath, &(fur->byteCode));
+
+  if(!hasStarted) {
+    Fur_del(fur);
+    return 1;
+  }
 
   for(;;) {
-    const char* buffer = readline("> ");
+    // Make sure any output without a trailing newline appears before the prompt
+    Output_flush(Output_standard());
+
+    char* buffer = readline("> ");
+
+    // End of input, i.e. Ctrl-D
+    if(buffer == NULL) break;
 
-    if (buffer && *buffer) {
+    if (*buffer) {
       add_history(buffer);
 
-      if(*buffer == '\\') {
+      // Lines starting with a backslash are commands, except for lambdas
+      if(*buffer == '\\' && buffer[1] != '(') {
         if(strcmp("\\stack", buffer) == 0) {
-          Thread_printStack(&thread);
+          Thread_printStack(&(fur->thread));
         }
 
+        if(strncmp("\\save ", buffer, strlen("\\save ")) == 0) {
+          Fur_save(fur, buffer + strlen("\\save "));
+        }
+
+#ifdef INSTRUMENT
+        if(strcmp("\\opcodes", buffer) == 0) {
+          Instrumentation_print(stdout, &(fur->byteCode));
+        }
+#endif
+
+        free(buffer);
         continue;
       }
 
-      Parser_appendLine(&parser, buffer);
+      Value result;
+      if(Fur_eval(fur, buffer, &result)) Value_println(result);
+    }
 
-      bool success = Compiler_compile(&compiler, &byteCode, &parser);
+    // Fur keeps its own copy of the source
+    free(buffer);
+  }
 
-      if(success) {
-        Value result = Thread_run(&thread);
+  stopProfiler(&profiler, profilePath, "repl", NULL);
 
-        if(thread.panic) {
-          Thread_clearPanic(&thread);
-        } else {
-          Value_println(result);
-        }
-      }
-    }
+#ifdef INSTRUMENT
+  Instrumentation_print(stderr, &(fur->byteCode));
+#endif
+
+  Fur_del(fur);
+
+  return 0;
+}
+
+static void printUsage() {
+  fprintf(stderr, "Usage: fur [--profile[=FOLDED_PATH]] [--native=SHARED_OBJECT]... [--restore=SNAPSHOT | FILE]\n");
+}
 
-    /*
-     * Save off buffers because they contain the memory locations to which
-     * all of our symbols point.
-     */
-    if(buffer != NULL) BufferList_append(&bufferList, buffer);
+int main(int argc, char** argv) {
+  const char* path = NULL;
+  const char* profilePath = NULL;
+  const char* snapshotPath = NULL;
+
+  NativePaths nativePaths;
+  nativePaths.items = malloc(sizeof(const char*) * argc);
+  nativePaths.count = 0;
+
+  for(int i = 1; i < argc; i++) {
+    if(strcmp(argv[i], "--profile") == 0) {
+      profilePath = "fur.folded";
+    } else if(strncmp(argv[i], "--profile=", strlen("--profile=")) == 0) {
+      profilePath = argv[i] + strlen("--profile=");
+    } else if(strncmp(argv[i], "--native=", strlen("--native=")) == 0) {
+      nativePaths.items[nativePaths.count++] = argv[i] + strlen("--native=");
+    } else if(strncmp(argv[i], "--restore=", strlen("--restore=")) == 0) {
+      snapshotPath = argv[i] + strlen("--restore=");
+    } else if(argv[i][0] == '-' || path != NULL) {
+      printUsage();
+      return 2;
+    } else {
+      path = argv[i];
+    }
   }
 
-  Parser_free(&parser);
+  // Snapshots restore REPL sessions
+  if(path != NULL && snapshotPath != NULL) {
+    printUsage();
+    return 2;
+  }
 
-  BufferList_free(&bufferList);
-  Thread_free(&thread);
-  ByteCode_free(&byteCode);
-  Compiler_free(&compiler);
+  int result = path == NULL
+    ? runRepl(profilePath, &nativePaths, snapshotPath)
+    : runFile(path, profilePath, &nativePaths);
 
-  return 0;
+  free(nativePaths.items);
+  return result;
 }
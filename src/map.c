@@ -0,0 +1,528 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "map.h"
+
+#define MAP_MIN_CAPACITY 16
+
+// 2^64 / phi, as in SymbolTable
+#define MAP_FIBONACCI 11400714819323198485llu
+
+static uint32_t hashBytes(uint32_t hash, const uint8_t* bytes, size_t count) {
+  // FNV-1a, continuing from hash
+  for(size_t i = 0; i < count; i++) {
+    hash ^= bytes[i];
+    hash *= 16777619;
+  }
+
+  return hash;
+}
+
+inline static uint32_t hashPointer(const void* pointer) {
+  // Objects are at least 16-byte aligned, so the low bits carry nothing
+  uint64_t bits = (uintptr_t)pointer >> 4;
+  return (uint32_t)(bits ^ (bits >> 32));
+}
+
+static uint32_t Value_hash(Value key) {
+  switch(key.type) {
+    case VALUE_NIL:
+      return 0;
+
+    case VALUE_BOOLEAN:
+      return Value_asBoolean(key) ? 1 : 2;
+
+    case VALUE_INTEGER:
+      {
+        uint64_t bits = (uint64_t)Value_asInteger(key);
+        return (uint32_t)(bits ^ (bits >> 32));
+      }
+
+    case VALUE_BIG_INTEGER:
+      {
+        ObjBigInteger* bigInteger = Value_asBigInteger(key);
+        uint8_t sign = bigInteger->isNegative;
+
+        return hashBytes(
+          hashBytes(2166136261u, &sign, 1),
+          (const uint8_t*)(bigInteger->limbs),
+          bigInteger->count * sizeof(uint32_t)
+        );
+      }
+
+    case VALUE_UTF8:
+    case VALUE_UTF32:
+      return Blob_hash(Value_asBlob(key));
+
+    case VALUE_SMALL_UTF8:
+      {
+        // Hashed as an integer with the same bits, which is all a small string is
+        uint64_t bits = key.as.smallUTF8;
+        return (uint32_t)(bits ^ (bits >> 32));
+      }
+
+    case VALUE_NATIVE_FN:
+      return hashPointer((const void*)(uintptr_t)Value_asNativeFn(key));
+
+    case VALUE_NATIVE:
+      return hashPointer(Value_asNative(key));
+
+    case VALUE_FN:
+      return hashPointer(Value_asFn(key));
+
+    case VALUE_CLOSURE:
+      return hashPointer(Value_asClosure(key));
+
+    case VALUE_ARRAY:
+      return hashPointer(Value_asArray(key));
+
+    case VALUE_MAP:
+      return hashPointer(Value_asMap(key));
+
+    case VALUE_STRING_BUILDER:
+      return hashPointer(Value_asStringBuilder(key));
+
+    case VALUE_RANGE:
+      {
+        ObjRange* range = Value_asRange(key);
+        return hashBytes(
+          hashBytes(2166136261u, (const uint8_t*)&(range->start), sizeof(int64_t)),
+          (const uint8_t*)&(range->stop),
+          sizeof(int64_t)
+        );
+      }
+
+    case VALUE_STACK_CLOSURE:
+    case VALUE_BOX:
+      // The compiler never leaves these where operators can see them
+      break;
+  }
+
+  assert(false);
+  return 0;
+}
+
+static bool Value_keyEquals(Value a, Value b) {
+  if(a.type != b.type) return false;
+
+  switch(a.type) {
+    case VALUE_NIL:
+      return true;
+
+    case VALUE_BOOLEAN:
+      return Value_asBoolean(a) == Value_asBoolean(b);
+
+    case VALUE_INTEGER:
+      return Value_asInteger(a) == Value_asInteger(b);
+
+    case VALUE_BIG_INTEGER:
+      return BigInteger_compare(Value_asBigInteger(a), Value_asBigInteger(b)) == 0;
+
+    case VALUE_UTF8:
+    case VALUE_UTF32:
+      return Blob_equals(Value_asBlob(a), Value_asBlob(b));
+
+    case VALUE_SMALL_UTF8:
+      return a.as.smallUTF8 == b.as.smallUTF8;
+
+    case VALUE_NATIVE_FN:
+      return Value_asNativeFn(a) == Value_asNativeFn(b);
+
+    case VALUE_NATIVE:
+      return Value_asNative(a) == Value_asNative(b);
+
+    case VALUE_FN:
+      return Value_asFn(a) == Value_asFn(b);
+
+    case VALUE_CLOSURE:
+      return Value_asClosure(a) == Value_asClosure(b);
+
+    case VALUE_ARRAY:
+      return Value_asArray(a) == Value_asArray(b);
+
+    case VALUE_MAP:
+      return Value_asMap(a) == Value_asMap(b);
+
+    case VALUE_STRING_BUILDER:
+      return Value_asStringBuilder(a) == Value_asStringBuilder(b);
+
+    case VALUE_RANGE:
+      return ObjRange_equals(Value_asRange(a), Value_asRange(b));
+
+    case VALUE_STACK_CLOSURE:
+    case VALUE_BOX:
+      break;
+  }
+
+  assert(false);
+  return false;
+}
+
+/*
+ * Bit i of the results is set if control byte i of the group matches. SSE2
+ * is part of x86-64, so it needs no runtime check.
+ */
+#ifdef __SSE2__
+
+inline static uint32_t Group_match(const uint8_t* group, uint8_t h2) {
+  __m128i bytes = _mm_loadu_si128((const __m128i*)group);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8((char)h2)));
+}
+
+inline static uint32_t Group_matchEmpty(const uint8_t* group) {
+  // Only MAP_EMPTY has its high bit set
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+}
+
+#else
+
+inline static uint32_t Group_match(const uint8_t* group, uint8_t h2) {
+  uint32_t result = 0;
+
+  for(size_t i = 0; i < MAP_GROUP_SIZE; i++) {
+    result |= (uint32_t)(group[i] == h2) << i;
+  }
+
+  return result;
+}
+
+inline static uint32_t Group_matchEmpty(const uint8_t* group) {
+  return Group_match(group, MAP_EMPTY);
+}
+
+#endif
+
+/*
+ * The top bits of the Fibonacci product pick the home slot, and 7 bits
+ * below the 32nd, which don't depend on the capacity, are kept in the
+ * control byte.
+ */
+inline static size_t ObjMap_home(ObjMap* self, uint32_t hash) {
+  return (MAP_FIBONACCI * (uint64_t)hash) >> self->shift;
+}
+
+inline static uint8_t ObjMap_h2(uint32_t hash) {
+  return ((MAP_FIBONACCI * (uint64_t)hash) >> 25) & 0x7F;
+}
+
+inline static void ObjMap_setControl(ObjMap* self, size_t slot, uint8_t control) {
+  self->control[slot] = control;
+  if(slot < MAP_GROUP_SIZE) self->control[self->capacity + slot] = control;
+}
+
+/*
+ * Returns the slot holding the key, or the empty slot it would go in. The
+ * entries with a given home slot all lie between it and the next empty
+ * slot, so the probe stops at the first group containing an empty slot.
+ */
+static size_t ObjMap_find(ObjMap* self, Value key, uint32_t hash, bool* found) {
+  size_t mask = self->capacity - 1;
+  size_t position = ObjMap_home(self, hash);
+  uint8_t h2 = ObjMap_h2(hash);
+
+  for(;;) {
+    const uint8_t* group = self->control + position;
+
+    for(uint32_t matches = Group_match(group, h2); matches != 0; matches &= matches - 1) {
+      size_t slot = (position + __builtin_ctz(matches)) & mask;
+      MapEntry* entry = self->entries + slot;
+
+      if(entry->hash == hash && Value_keyEquals(entry->key, key)) {
+        *found = true;
+        return slot;
+      }
+    }
+
+    uint32_t empties = Group_matchEmpty(group);
+
+    if(empties != 0) {
+      *found = false;
+      return (position + __builtin_ctz(empties)) & mask;
+    }
+
+    position = (position + MAP_GROUP_SIZE) & mask;
+  }
+}
+
+void ObjMap_init(ObjMap* self) {
+  self->count = 0;
+  self->capacity = 0;
+  self->shift = 64;
+  self->control = NULL;
+  self->entries = NULL;
+}
+
+void ObjMap_free(ObjMap* self) {
+  free(self->control);
+  free(self->entries);
+}
+
+static void ObjMap_resize(ObjMap* self, size_t capacity) {
+  size_t oldCapacity = self->capacity;
+  uint8_t* oldControl = self->control;
+  MapEntry* oldEntries = self->entries;
+
+  self->capacity = capacity;
+  self->shift = 64 - __builtin_ctzll(capacity);
+  self->control = malloc(capacity + MAP_GROUP_SIZE);
+  self->entries = malloc(capacity * sizeof(MapEntry));
+
+  // TODO Handle this
+  assert(self->control != NULL);
+  assert(self->entries != NULL);
+
+  memset(self->control, MAP_EMPTY, capacity + MAP_GROUP_SIZE);
+
+  // Keys are known to be distinct, so only empty slots need finding
+  size_t mask = capacity - 1;
+
+  for(size_t i = 0; i < oldCapacity; i++) {
+    if(oldControl[i] == MAP_EMPTY) continue;
+
+    uint32_t hash = oldEntries[i].hash;
+    size_t position = ObjMap_home(self, hash);
+    uint32_t empties;
+
+    while((empties = Group_matchEmpty(self->control + position)) == 0) {
+      position = (position + MAP_GROUP_SIZE) & mask;
+    }
+
+    size_t slot = (position + __builtin_ctz(empties)) & mask;
+    self->entries[slot] = oldEntries[i];
+    ObjMap_setControl(self, slot, oldControl[i]);
+  }
+
+  free(oldControl);
+  free(oldEntries);
+}
+
+void ObjMap_reserve(ObjMap* self, size_t count) {
+  if(count == 0) return;
+
+  size_t capacity = self->capacity == 0 ? MAP_MIN_CAPACITY : self->capacity;
+
+  // Linear probing stays short up to three quarters full, as for symbols
+  while(count > capacity / 4 * 3) capacity *= 2;
+
+  if(capacity != self->capacity) ObjMap_resize(self, capacity);
+}
+
+bool ObjMap_get(ObjMap* self, Value key, Value* value) {
+  if(self->count == 0) return false;
+
+  bool found;
+  size_t slot = ObjMap_find(self, key, Value_hash(key), &found);
+
+  if(found) *value = self->entries[slot].value;
+  return found;
+}
+
+void ObjMap_set(ObjMap* self, Value key, Value value) {
+  ObjMap_reserve(self, self->count + 1);
+
+  uint32_t hash = Value_hash(key);
+  bool found;
+  size_t slot = ObjMap_find(self, key, hash, &found);
+  MapEntry* entry = self->entries + slot;
+
+  if(!found) {
+    entry->hash = hash;
+    entry->key = key;
+    ObjMap_setControl(self, slot, ObjMap_h2(hash));
+    self->count++;
+  }
+
+  entry->value = value;
+}
+
+/*
+ * Backward-shift deletion: moves each later entry in the run into the hole
+ * unless its home slot lies after the hole, then empties the last hole. This
+ * leaves the table exactly as if the key had never been inserted.
+ */
+bool ObjMap_remove(ObjMap* self, Value key) {
+  if(self->count == 0) return false;
+
+  bool found;
+  size_t hole = ObjMap_find(self, key, Value_hash(key), &found);
+
+  if(!found) return false;
+
+  size_t mask = self->capacity - 1;
+
+  for(size_t slot = (hole + 1) & mask; self->control[slot] != MAP_EMPTY; slot = (slot + 1) & mask) {
+    size_t home = ObjMap_home(self, self->entries[slot].hash);
+
+    if(((slot - home) & mask) >= ((slot - hole) & mask)) {
+      self->entries[hole] = self->entries[slot];
+      ObjMap_setControl(self, hole, self->control[slot]);
+      hole = slot;
+    }
+  }
+
+  ObjMap_setControl(self, hole, MAP_EMPTY);
+  self->count--;
+  return true;
+}
+
+#ifdef TEST
+
+void test_ObjMap_set_overwritesEqualKeys() {
+  ObjMap map;
+  ObjMap_init(&map);
+
+  // Equal strings in separate blobs are the same key
+  Blob* a = Blob_new(3);
+  Blob* b = Blob_new(3);
+  memcpy(a->bytes, "key", 3);
+  memcpy(b->bytes, "key", 3);
+
+  ObjMap_set(&map, Value_fromBlob(VALUE_UTF8, a), Value_fromInteger(1));
+  ObjMap_set(&map, Value_fromBlob(VALUE_UTF8, b), Value_fromInteger(2));
+  ObjMap_set(&map, Value_fromInteger(3), TRUE);
+  ObjMap_set(&map, NIL, FALSE);
+
+  assert(map.count == 3);
+
+  Value value;
+  assert(ObjMap_get(&map, Value_fromBlob(VALUE_UTF8, a), &value));
+  assert(Value_asInteger(value) == 2);
+  assert(ObjMap_get(&map, Value_fromInteger(3), &value));
+  assert(Value_asBoolean(value));
+  assert(ObjMap_get(&map, NIL, &value));
+  assert(!Value_asBoolean(value));
+
+  // The same bytes in a different encoding are a different key
+  assert(!ObjMap_get(&map, Value_fromBlob(VALUE_UTF32, a), &value));
+  assert(!ObjMap_get(&map, Value_fromInteger(4), &value));
+
+  ObjMap_free(&map);
+  free(a);
+  free(b);
+}
+
+void test_ObjMap_set_growsAndKeepsEntries() {
+  ObjMap map;
+  ObjMap_init(&map);
+
+  for(int64_t i = 0; i < 10000; i++) {
+    ObjMap_set(&map, Value_fromInteger(i * 7919), Value_fromInteger(i));
+  }
+
+  assert(map.count == 10000);
+  assert(map.capacity == 16384);
+
+  for(int64_t i = 0; i < 10000; i++) {
+    Value value;
+    assert(ObjMap_get(&map, Value_fromInteger(i * 7919), &value));
+    assert(Value_asInteger(value) == i);
+  }
+
+  ObjMap_free(&map);
+}
+
+void test_ObjMap_remove_shiftsCollidingEntriesBack() {
+  /*
+   * Small keys in a small table collide a lot, so random inserts and
+   * removals checked against a plain array exercise every way a shift can
+   * wrap around or stop.
+   */
+  #define KEY_COUNT 64
+
+  bool present[KEY_COUNT] = { false };
+  size_t count = 0;
+
+  ObjMap map;
+  ObjMap_init(&map);
+  srand(42);
+
+  for(size_t i = 0; i < 100000; i++) {
+    int64_t key = rand() % KEY_COUNT;
+
+    if(rand() % 2 == 0) {
+      ObjMap_set(&map, Value_fromInteger(key), Value_fromInteger(key));
+      if(!present[key]) count++;
+      present[key] = true;
+    } else {
+      assert(ObjMap_remove(&map, Value_fromInteger(key)) == present[key]);
+      if(present[key]) count--;
+      present[key] = false;
+    }
+
+    assert(map.count == count);
+
+    for(int64_t j = 0; j < KEY_COUNT; j++) {
+      Value value;
+      assert(ObjMap_get(&map, Value_fromInteger(j), &value) == present[j]);
+    }
+  }
+
+  // The mirrored control bytes were kept in step
+  assert(memcmp(map.control, map.control + map.capacity, MAP_GROUP_SIZE) == 0);
+
+  ObjMap_free(&map);
+
+  #undef KEY_COUNT
+}
+
+#endif
+
+#ifdef BENCH
+
+#include <stdio.h>
+
+#include "bench.h"
+
+typedef struct {
+  size_t count;
+  size_t distinct;
+  Blob** keys;
+} MapBench;
+
+/*
+ * Counts occurrences of string keys, the shape of keyed aggregation in Fur
+ * programs: mostly lookups of keys that are already present.
+ */
+static void MapBench_aggregate(void* context) {
+  MapBench* bench = context;
+  ObjMap map;
+  ObjMap_init(&map);
+
+  for(size_t i = 0; i < bench->count; i++) {
+    Value key = Value_fromBlob(VALUE_UTF8, bench->keys[i % bench->distinct]);
+    Value total = Value_fromInteger(0);
+
+    ObjMap_get(&map, key, &total);
+    ObjMap_set(&map, key, Value_fromInteger(Value_asInteger(total) + 1));
+  }
+
+  assert(map.count == bench->distinct);
+  ObjMap_free(&map);
+}
+
+void bench_ObjMap_aggregate() {
+  MapBench bench;
+  bench.count = Bench_parameter("FUR_BENCH_MAP_COUNT", 1000000);
+  bench.distinct = Bench_parameter("FUR_BENCH_MAP_DISTINCT", 10000);
+  bench.keys = malloc(bench.distinct * sizeof(Blob*));
+
+  for(size_t i = 0; i < bench.distinct; i++) {
+    char text[32];
+    int length = snprintf(text, sizeof(text), "key_%zu", i * 2654435761u);
+
+    bench.keys[i] = Blob_new(length);
+    memcpy(bench.keys[i]->bytes, text, length);
+  }
+
+  Bench_measure("ObjMap_aggregate", MapBench_aggregate, &bench, bench.count);
+
+  for(size_t i = 0; i < bench.distinct; i++) free(bench.keys[i]);
+  free(bench.keys);
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "value.h"
+
+/*
+ * The hash table behind Fur's maps (see ObjMap in value.h). Keys are hashed
+ * as symbols are: FNV-1a for strings and big integers, the bits themselves
+ * for other values, then Fibonacci hashing picks the first slot to probe.
+ * Collisions are resolved by linear probing a group of slots at a time, and
+ * deletion shifts later entries back rather than leaving tombstones, so
+ * lookups never slow down as a map churns.
+ *
+ * Keys are equal when == would say so. Strings, integers, big integers and
+ * ranges compare by value, and arrays, maps, string builders and functions
+ * by identity.
+ */
+
+void ObjMap_init(ObjMap*);
+
+// Frees the table but not the map itself, which the thread owns
+void ObjMap_free(ObjMap*);
+
+// Makes room for count entries, so that inserting them doesn't rehash
+void ObjMap_reserve(ObjMap*, size_t count);
+
+// Returns false if the key isn't in the map, leaving value untouched
+bool ObjMap_get(ObjMap*, Value key, Value* value);
+
+void ObjMap_set(ObjMap*, Value key, Value value);
+
+// Returns false if the key wasn't in the map
+bool ObjMap_remove(ObjMap*, Value key);
+
+#ifdef TEST
+
+void test_ObjMap_set_overwritesEqualKeys();
+void test_ObjMap_set_growsAndKeepsEntries();
+void test_ObjMap_remove_shiftsCollidingEntriesBack();
+
+#endif
+
+#ifdef BENCH
+
+void bench_ObjMap_aggregate();
+
+#endif
+
+#endif
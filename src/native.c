@@ -0,0 +1,102 @@
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include "native.h"
+
+void NativeList_init(NativeList* self) {
+  self->count = 0;
+  self->capacity = 0;
+  self->items = NULL;
+  self->handleCount = 0;
+  self->handleCapacity = 0;
+  self->handles = NULL;
+}
+
+void NativeList_free(NativeList* self) {
+  for(size_t i = 0; i < self->count; i++) {
+    free(self->items[i]);
+  }
+
+  free(self->items);
+
+  for(size_t i = 0; i < self->handleCount; i++) {
+    dlclose(self->handles[i]);
+  }
+
+  free(self->handles);
+}
+
+bool NativeList_load(NativeList* self, const char* path) {
+  void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+  if(handle == NULL) {
+    fprintf(stderr, "Unable to load natives: %s\n", dlerror());
+    return false;
+  }
+
+  /*
+   * ISO C doesn't allow converting a void* to a function pointer, but POSIX
+   * requires that it works for dlsym(), so copy the bits across.
+   */
+  void* symbol = dlsym(handle, NATIVE_ENTRY_POINT);
+  NativeEntryPoint entryPoint;
+
+  if(symbol == NULL) {
+    fprintf(stderr, "Unable to load natives: %s has no %s().\n", path, NATIVE_ENTRY_POINT);
+    dlclose(handle);
+    return false;
+  }
+
+  memcpy(&entryPoint, &symbol, sizeof(entryPoint));
+
+  if(self->handleCapacity == self->handleCount) {
+    self->handleCapacity = self->handleCapacity == 0 ? 4 : self->handleCapacity * 2;
+    self->handles = realloc(self->handles, self->handleCapacity * sizeof(void*));
+    assert(self->handles != NULL);
+  }
+
+  self->handles[self->handleCount++] = handle;
+
+  entryPoint(self);
+  return true;
+}
+
+#ifdef TEST
+
+static Value Native_testConstant(void* context, uint8_t argc, Value* argv) {
+  (void)argc;
+  (void)argv;
+  return Value_fromInteger(*((int64_t*)context));
+}
+
+void test_NativeList_register_rejectsDuplicates() {
+  NativeList natives;
+  NativeList_init(&natives);
+
+  int64_t one = 1;
+
+  assert(NativeList_register(&natives, "one", Native_testConstant, &one));
+  assert(NativeList_register(&natives, "two", Native_testConstant, &one));
+  assert(!NativeList_register(&natives, "one", Native_testConstant, &one));
+
+  assert(natives.count == 2);
+  assert(NativeList_find(&natives, "two", 3) == 1);
+  assert(NativeList_find(&natives, "on", 2) == -1);
+
+  Native* native = natives.items[0];
+  assert(Value_asInteger(native->fn(native->context, 0, NULL)) == 1);
+
+  NativeList_free(&natives);
+}
+
+void test_NativeList_load_reportsMissingLibrary() {
+  NativeList natives;
+  NativeList_init(&natives);
+
+  assert(!NativeList_load(&natives, "/nonexistent/libfur_natives.so"));
+  assert(natives.handleCount == 0);
+
+  NativeList_free(&natives);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "value.h"
+
+/*
+ * The natives registered on a ByteCode (see Native in value.h). Natives are
+ * registered before compiling the code that calls them, and can't be
+ * unregistered. They're held by pointer, so that Values referring to them
+ * survive the list growing. handles are the shared objects loaded by
+ * NativeList_load(), which are closed when the list is freed.
+ */
+typedef struct {
+  size_t count;
+  size_t capacity;
+  Native** items;
+  size_t handleCount;
+  size_t handleCapacity;
+  void** handles;
+} NativeList;
+
+/*
+ * Shared objects loaded with NativeList_load() export a function with this
+ * name and type, which registers their natives with NativeList_register().
+ */
+#define NATIVE_ENTRY_POINT "Fur_registerNatives"
+typedef void (*NativeEntryPoint)(NativeList*);
+
+void NativeList_init(NativeList*);
+void NativeList_free(NativeList*);
+
+// Returns the index of the native with the given name, or -1
+inline static int32_t NativeList_find(NativeList* self, const char* name, size_t nameLength) {
+  for(size_t i = 0; i < self->count; i++) {
+    Native* native = self->items[i];
+
+    if(native->nameLength == nameLength && memcmp(native->name, name, nameLength) == 0) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Returns false if a native with the same name is already registered. A
+ * native with the same name as a builtin hides the builtin.
+ *
+ * This is defined in the header so that shared objects registering natives
+ * don't need to link against the interpreter.
+ */
+inline static bool NativeList_register(NativeList* self, const char* name, NativeContextFn fn, void* context) {
+  size_t nameLength = strlen(name);
+
+  if(NativeList_find(self, name, nameLength) != -1) return false;
+
+  // Natives are indexed by a uint8_t operand, like builtins
+  if(self->count == UINT8_MAX + 1) return false;
+
+  if(self->capacity == self->count) {
+    self->capacity = self->capacity == 0 ? 8 : self->capacity * 2;
+    self->items = realloc(self->items, self->capacity * sizeof(Native*));
+    assert(self->items != NULL);
+  }
+
+  Native* native = malloc(sizeof(Native) + nameLength);
+
+  // TODO Handle this
+  assert(native != NULL);
+
+  native->fn = fn;
+  native->context = context;
+  native->nameLength = nameLength;
+  memcpy(native->name, name, nameLength);
+
+  self->items[self->count++] = native;
+  return true;
+}
+
+/*
+ * Loads the shared object at path with dlopen() and calls its entry point.
+ * Returns false, after printing why to stderr, if the shared object can't be
+ * loaded or has no entry point.
+ */
+bool NativeList_load(NativeList*, const char* path);
+
+#ifdef TEST
+
+void test_NativeList_register_rejectsDuplicates();
+void test_NativeList_load_reportsMissingLibrary();
+
+#endif
+
+#endif
@@ -52,7 +52,9 @@ inline static void UnaryNode_init(UnaryNode* self, NodeType type, size_t line, N
       || type == NODE_PARENS
       || type == NODE_MUT
       || type == NODE_LOOP
-      || type == NODE_CONTINUE);
+      || type == NODE_CONTINUE
+      || type == NODE_ARRAY
+      || type == NODE_MAP);
   Node_init(&(self->node), type, line);
   self->arg0 = arg0;
 }
@@ -83,7 +85,9 @@ inline static void BinaryNode_init(BinaryNode* self, NodeType type, size_t line,
       || type == NODE_AND
       || type == NODE_OR
       || type == NODE_BREAK
-      || type == NODE_CALL);
+      || type == NODE_CALL
+      || type == NODE_SUBSCRIPT
+      || type == NODE_LAMBDA);
   Node_init(&(self->node), type, line);
   self->arg0 = arg0;
   self->arg1 = arg1;
@@ -104,7 +108,8 @@ inline static void BinaryNode_del(BinaryNode* self) {
 inline static void TernaryNode_init(TernaryNode* self, NodeType type, size_t line, Node* arg0, Node* arg1, Node* arg2) {
   assert(type == NODE_IF
       || type == NODE_WHILE
-      || type == NODE_UNTIL);
+      || type == NODE_UNTIL
+      || type == NODE_FOR);
   Node_init(&(self->node), type, line);
   self->arg0 = arg0;
   self->arg1 = arg1;
@@ -193,6 +198,8 @@ void Node_del(Node* self) {
     case NODE_LOGICAL_NOT:
     case NODE_LOOP:
     case NODE_MUT:
+    case NODE_ARRAY:
+    case NODE_MAP:
       UnaryNode_del((UnaryNode*)self);
       return;
 
@@ -211,12 +218,15 @@ void Node_del(Node* self) {
     case NODE_OR:
     case NODE_BREAK:
     case NODE_CALL:
+    case NODE_SUBSCRIPT:
+    case NODE_LAMBDA:
       BinaryNode_del((BinaryNode*)self);
       return;
 
     case NODE_IF:
     case NODE_WHILE:
     case NODE_UNTIL:
+    case NODE_FOR:
       TernaryNode_del((TernaryNode*)self);
       return;
 
@@ -21,6 +21,8 @@ typedef enum {
   NODE_MUT,
   NODE_LOOP,
   NODE_CONTINUE,
+  NODE_ARRAY,
+  NODE_MAP,
 
   // Binary Nodes
   NODE_ASSIGN,
@@ -38,11 +40,14 @@ typedef enum {
   NODE_OR,
   NODE_BREAK,
   NODE_CALL,
+  NODE_SUBSCRIPT,
+  NODE_LAMBDA,
 
   // Ternary Nodes
   NODE_IF,
   NODE_WHILE,
   NODE_UNTIL,
+  NODE_FOR,
 
   // List Nodes
   NODE_BLOCK,
@@ -1,19 +1,33 @@
 #ifndef OBJECT_H
 #define OBJECT_H
 
-#include "string.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
 
 typedef enum {
   OBJ_UTF8_STRING,
   OBJ_UTF8_CONCAT,
   OBJ_UTF32_STRING,
   OBJ_UTF32_CONCAT,
+  OBJ_BLOB,
+  OBJ_BOX,
+  OBJ_CLOSURE,
+  OBJ_BIG_INTEGER,
+  OBJ_ARRAY,
+  OBJ_MAP,
+  OBJ_RANGE,
+  OBJ_STRING_BUILDER,
 } ObjType;
 
 struct Obj;
 typedef struct Obj Obj;
 struct Obj{
   ObjType type;
+
+  // Set on the objects still in use while Thread_collect() runs
+  bool isMarked;
+
   Obj* next;
 };
 
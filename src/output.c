@@ -0,0 +1,274 @@
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "decimal.h"
+#include "output.h"
+
+void Output_init(Output* self, int fd) {
+  self->fd = fd;
+  self->isTerminal = isatty(fd);
+  self->count = 0;
+}
+
+/*
+ * Each thread's writer is cached in a thread local, and also held by a
+ * pthread key, whose destructor flushes and frees it when the thread exits.
+ */
+static _Thread_local Output* standardOutput = NULL;
+static pthread_key_t standardOutputKey;
+static pthread_once_t standardOutputOnce = PTHREAD_ONCE_INIT;
+
+static void Output_releaseStandard(void* output) {
+  Output_flush(output);
+  free(output);
+
+  // Another key's destructor may still print, which makes a new writer
+  standardOutput = NULL;
+}
+
+/*
+ * Threads which are still running at exit() never reach their destructor,
+ * and atexit() handlers run on the thread that calls exit(), which is the
+ * main thread for the REPL and for running files.
+ */
+static void Output_flushStandard() {
+  if(standardOutput != NULL) Output_flush(standardOutput);
+}
+
+static void Output_initStandard() {
+  int error = pthread_key_create(&standardOutputKey, Output_releaseStandard);
+
+  // TODO Handle this
+  assert(error == 0);
+  (void)error;
+
+  atexit(Output_flushStandard);
+}
+
+Output* Output_standard() {
+  if(standardOutput == NULL) {
+    pthread_once(&standardOutputOnce, Output_initStandard);
+
+    standardOutput = malloc(sizeof(Output));
+
+    // TODO Handle this
+    assert(standardOutput != NULL);
+
+    Output_init(standardOutput, STDOUT_FILENO);
+    pthread_setspecific(standardOutputKey, standardOutput);
+  }
+
+  return standardOutput;
+}
+
+/*
+ * Writes all of the given buffers, retrying on partial writes and
+ * interrupts. Errors (such as a closed pipe) drop the output, as there is
+ * nowhere to report them.
+ */
+static void Output_writeAll(int fd, struct iovec* buffers, int bufferCount) {
+  while(bufferCount > 0) {
+    ssize_t written = writev(fd, buffers, bufferCount);
+
+    if(written < 0) {
+      if(errno == EINTR) continue;
+      return;
+    }
+
+    while(bufferCount > 0 && (size_t)written >= buffers->iov_len) {
+      written -= buffers->iov_len;
+      buffers++;
+      bufferCount--;
+    }
+
+    if(bufferCount > 0) {
+      buffers->iov_base = (uint8_t*)(buffers->iov_base) + written;
+      buffers->iov_len -= written;
+    }
+  }
+}
+
+void Output_flush(Output* self) {
+  /*
+   * Anything else writing to stdout, such as readline, goes through stdio,
+   * so flush that first to keep output in the order it was written.
+   */
+  if(self->fd == STDOUT_FILENO) fflush(stdout);
+
+  if(self->count == 0) return;
+
+  struct iovec buffer = { self->items, self->count };
+  Output_writeAll(self->fd, &buffer, 1);
+  self->count = 0;
+}
+
+void Output_write(Output* self, const uint8_t* bytes, size_t count) {
+  if(count <= OUTPUT_BUFFER_SIZE - self->count) {
+    memcpy(self->items + self->count, bytes, count);
+    self->count += count;
+  } else if(count < OUTPUT_BUFFER_SIZE) {
+    Output_flush(self);
+    memcpy(self->items, bytes, count);
+    self->count = count;
+  } else {
+    if(self->fd == STDOUT_FILENO) fflush(stdout);
+
+    // Too big to be worth copying, so write it out with what's buffered
+    struct iovec buffers[2] = {
+      { self->items, self->count },
+      { (void*)bytes, count },
+    };
+    Output_writeAll(self->fd, buffers, 2);
+    self->count = 0;
+    return;
+  }
+
+  if(self->isTerminal && memchr(bytes, '\n', count) != NULL) Output_flush(self);
+}
+
+void Output_writeCString(Output* self, const char* text) {
+  Output_write(self, (const uint8_t*)text, strlen(text));
+}
+
+void Output_writeInteger(Output* self, int64_t i) {
+  uint8_t digits[DECIMAL_MAX_LENGTH];
+  Output_write(self, digits, Decimal_format(i, digits));
+}
+
+#ifdef TEST
+
+#include <fcntl.h>
+
+static size_t readAvailable(int fd, char* buffer, size_t capacity) {
+  ssize_t count = read(fd, buffer, capacity);
+  return count < 0 ? 0 : (size_t)count;
+}
+
+void test_Output_write_buffersUntilFlush() {
+  int channel[2];
+  assert(pipe(channel) == 0);
+  fcntl(channel[0], F_SETFL, O_NONBLOCK);
+
+  Output* output = malloc(sizeof(Output));
+  Output_init(output, channel[1]);
+
+  Output_writeCString(output, "Hello,\n");
+  Output_writeByte(output, ' ');
+  Output_writeCString(output, "world");
+
+  char buffer[64];
+  assert(readAvailable(channel[0], buffer, sizeof(buffer)) == 0);
+
+  Output_flush(output);
+
+  assert(readAvailable(channel[0], buffer, sizeof(buffer)) == 13);
+  assert(strncmp(buffer, "Hello,\n world", 13) == 0);
+
+  free(output);
+  close(channel[0]);
+  close(channel[1]);
+}
+
+void test_Output_write_largeWriteBypassesBuffer() {
+  // A file rather than a pipe, so that the write can't block
+  FILE* file = tmpfile();
+  assert(file != NULL);
+
+  Output* output = malloc(sizeof(Output));
+  Output_init(output, fileno(file));
+
+  size_t largeCount = OUTPUT_BUFFER_SIZE + 1;
+  uint8_t* large = malloc(largeCount);
+  memset(large, 'x', largeCount);
+
+  Output_writeByte(output, 'a');
+  Output_write(output, large, largeCount);
+
+  assert(output->count == 0);
+
+  uint8_t* buffer = malloc(largeCount + 1);
+  lseek(fileno(file), 0, SEEK_SET);
+
+  size_t received = 0;
+  while(received < largeCount + 1) {
+    size_t count = readAvailable(fileno(file), (char*)buffer + received, largeCount + 1 - received);
+    assert(count > 0);
+    received += count;
+  }
+
+  assert(buffer[0] == 'a');
+  assert(buffer[1] == 'x');
+  assert(buffer[largeCount] == 'x');
+
+  free(buffer);
+  free(large);
+  free(output);
+  fclose(file);
+}
+
+static void* writeFromThread(void* text) {
+  Output_writeCString(Output_standard(), text);
+  return NULL;
+}
+
+void test_Output_standard_flushesWhenThreadExits() {
+  int channel[2];
+  assert(pipe(channel) == 0);
+  fcntl(channel[0], F_SETFL, O_NONBLOCK);
+
+  // The thread's writer is made while stdout is the pipe
+  Output_flush(Output_standard());
+  int savedStdout = dup(STDOUT_FILENO);
+  dup2(channel[1], STDOUT_FILENO);
+
+  pthread_t thread;
+  assert(pthread_create(&thread, NULL, writeFromThread, "from a thread") == 0);
+  assert(pthread_join(thread, NULL) == 0);
+
+  dup2(savedStdout, STDOUT_FILENO);
+  close(savedStdout);
+
+  char buffer[64];
+  size_t count = readAvailable(channel[0], buffer, sizeof(buffer));
+
+  assert(count == strlen("from a thread"));
+  assert(strncmp(buffer, "from a thread", count) == 0);
+
+  close(channel[0]);
+  close(channel[1]);
+}
+
+void test_Output_writeInteger_formatsIntegers() {
+  int channel[2];
+  assert(pipe(channel) == 0);
+
+  Output* output = malloc(sizeof(Output));
+  Output_init(output, channel[1]);
+
+  int64_t integers[] = { 0, 7, -7, 42, 1000000, INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+
+  for(size_t i = 0; i < sizeof(integers) / sizeof(integers[0]); i++) {
+    Output_writeInteger(output, integers[i]);
+    Output_writeByte(output, ' ');
+  }
+
+  Output_flush(output);
+
+  const char* expected = "0 7 -7 42 1000000 2147483647 -2147483648 9223372036854775807 -9223372036854775808 ";
+  char buffer[128];
+  size_t count = readAvailable(channel[0], buffer, sizeof(buffer));
+
+  assert(count == strlen(expected));
+  assert(strncmp(buffer, expected, count) == 0);
+
+  free(output);
+  close(channel[0]);
+  close(channel[1]);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * A buffered writer for program output, used instead of stdio so that
+ * output-heavy programs don't pay for a printf() and an fflush() (and thus
+ * a write syscall) per print call.
+ *
+ * Output is flushed when the buffer fills, when a newline is written to a
+ * terminal (so interactive output still appears line by line), and at exit.
+ * Writes larger than the buffer skip it and go to the file descriptor with
+ * a single writev() alongside whatever was already buffered.
+ *
+ * Output_standard() returns the writer for stdout. There is one per OS
+ * thread, so native functions can use it without locking, and it's flushed
+ * and freed when its thread exits.
+ */
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+  int fd;
+  bool isTerminal;
+  size_t count;
+  uint8_t items[OUTPUT_BUFFER_SIZE];
+} Output;
+
+void Output_init(Output*, int fd);
+
+Output* Output_standard();
+
+void Output_flush(Output*);
+void Output_write(Output*, const uint8_t* bytes, size_t count);
+void Output_writeCString(Output*, const char*);
+void Output_writeInteger(Output*, int64_t);
+
+inline static void Output_writeByte(Output* self, uint8_t byte) {
+  if(self->count == OUTPUT_BUFFER_SIZE) Output_flush(self);
+
+  self->items[self->count++] = byte;
+
+  if(byte == '\n' && self->isTerminal) Output_flush(self);
+}
+
+#ifdef TEST
+
+void test_Output_write_buffersUntilFlush();
+void test_Output_write_largeWriteBypassesBuffer();
+void test_Output_standard_flushesWhenThreadExits();
+void test_Output_writeInteger_formatsIntegers();
+
+#endif
+
+#endif
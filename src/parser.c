@@ -82,6 +82,7 @@ const PrecedenceRule PRECEDENCE[] = {
   [TOKEN_MUT] =                 { PREC_MUTABILITY,  PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_EQUALS] =              { PREC_NONE,        PREC_NONE,  PREC_ASSIGNMENT_LEFT,   PREC_ASSIGNMENT_RIGHT,  false,  NO_TOKEN },
   [TOKEN_SEMICOLON] =           { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
+  [TOKEN_COLON] =               { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
 
   [TOKEN_PLUS] =                { PREC_NONE,        PREC_NONE,  PREC_TERM_LEFT,         PREC_TERM_RIGHT,        false,  NO_TOKEN },
   [TOKEN_MINUS] =               { PREC_NEGATE,      PREC_NONE,  PREC_TERM_LEFT,         PREC_TERM_RIGHT,        false,  NO_TOKEN },
@@ -100,12 +101,16 @@ const PrecedenceRule PRECEDENCE[] = {
 
   [TOKEN_OPEN_PAREN] =          { PREC_NONE,        PREC_CALL,  PREC_NONE,              PREC_NONE,              true,   NO_TOKEN },
   [TOKEN_CLOSE_PAREN] =         { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  TOKEN_OPEN_PAREN },
+  [TOKEN_OPEN_BRACKET] =        { PREC_NONE,        PREC_CALL,  PREC_NONE,              PREC_NONE,              true,   NO_TOKEN },
+  [TOKEN_CLOSE_BRACKET] =       { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  TOKEN_OPEN_BRACKET },
 
   [TOKEN_NIL] =                 { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_TRUE] =                { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_FALSE] =               { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_NOT] =                 { PREC_LOGICAL_NOT, PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
 
+  [TOKEN_BACKSLASH] =           { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
+
   [TOKEN_SYMBOL] =              { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
 
   [TOKEN_LOOP] =                { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
@@ -113,6 +118,8 @@ const PrecedenceRule PRECEDENCE[] = {
   [TOKEN_ELSE] =                { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_WHILE] =               { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_UNTIL] =               { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
+  [TOKEN_FOR] =                 { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
+  [TOKEN_IN] =                  { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
 
   [TOKEN_EOF] =                 { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
   [TOKEN_ERROR] =               { PREC_NONE,        PREC_NONE,  PREC_NONE,              PREC_NONE,              false,  NO_TOKEN },
@@ -192,6 +199,8 @@ inline static NodeType mapOutfix(Token token) {
   switch(token.type) {
     case TOKEN_OPEN_PAREN:
       return NODE_PARENS;
+    case TOKEN_OPEN_BRACKET:
+      return NODE_ARRAY;
 
     default:
       break;
@@ -224,6 +233,8 @@ inline static NodeType mapPostfix(Token token) {
   switch(token.type) {
     case TOKEN_OPEN_PAREN:
       return NODE_CALL;
+    case TOKEN_OPEN_BRACKET:
+      return NODE_SUBSCRIPT;
 
     default:
       break;
@@ -319,6 +330,161 @@ Node* Parser_parseCondJumpExpr(Parser* self, NodeType nodeType) {
   );
 }
 
+/*
+ * Parses `for(x in iterable) body` into a NODE_FOR whose arguments are the
+ * loop variable, the iterable and the body, in that order. Unlike the
+ * conditional loops a for loop has no else branch: it ends when the
+ * iterable runs out.
+ */
+Node* Parser_parseFor(Parser* self) {
+  Tokenizer* tokenizer = &(self->tokenizer);
+  Token token = Tokenizer_scan(tokenizer);
+
+  Token openParen = Tokenizer_peek(tokenizer);
+
+  if(openParen.type == TOKEN_OPEN_PAREN) {
+    Tokenizer_scan(tokenizer);
+  } else {
+    self->panic = true;
+    printError(
+      openParen.line,
+      FMT_EXPECTED_OPEN_PAREN,
+      openParen.length,
+      openParen.lexeme
+    );
+    return NULL;
+  }
+
+  Token variableToken = Tokenizer_scan(tokenizer);
+
+  if(variableToken.type != TOKEN_SYMBOL) {
+    self->panic = true;
+    printError(variableToken.line, MSG_LOOP_VARIABLE_NOT_SYMBOL);
+    return NULL;
+  }
+
+  Token inToken = Tokenizer_peek(tokenizer);
+
+  if(inToken.type == TOKEN_IN) {
+    Tokenizer_scan(tokenizer);
+  } else {
+    self->panic = true;
+    printError(
+      inToken.line,
+      FMT_EXPECTED_IN,
+      inToken.length,
+      inToken.lexeme
+    );
+    return NULL;
+  }
+
+  Node* iterable = Parser_parseExpression(self);
+
+  if(self->panic) {
+    assert(iterable == NULL);
+    return NULL;
+  }
+
+  Token closeParen = Tokenizer_peek(tokenizer);
+
+  if(closeParen.type == TOKEN_CLOSE_PAREN) {
+    Tokenizer_scan(tokenizer);
+  } else {
+    Node_del(iterable);
+    self->panic = true;
+    printError(
+      closeParen.line,
+      FMT_EXPECTED_CLOSE_OUTFIX,
+      1,
+      "(",
+      openParen.line,
+      closeParen.length,
+      closeParen.lexeme
+    );
+    return NULL;
+  }
+
+  Node* body = Parser_parseStatement(self);
+
+  if(self->panic) {
+    assert(body == NULL);
+    Node_del(iterable);
+    return NULL;
+  }
+
+  Node* variable = AtomNode_new(
+    NODE_SYMBOL,
+    variableToken.line,
+    variableToken.lexeme,
+    variableToken.length
+  );
+
+  return TernaryNode_new(NODE_FOR, token.line, variable, iterable, body);
+}
+
+Node* Parser_parseList(Parser*, TokenType close);
+
+/*
+ * Parses a lambda such as `\(a, b) a * b`. The body is an expression, which
+ * extends as far to the right as it can.
+ */
+Node* Parser_parseLambda(Parser* self) {
+  Tokenizer* tokenizer = &(self->tokenizer);
+  Token token = Tokenizer_scan(tokenizer);
+
+  Token openParen = Tokenizer_peek(tokenizer);
+
+  if(openParen.type == TOKEN_OPEN_PAREN) {
+    Tokenizer_scan(tokenizer);
+  } else {
+    self->panic = true;
+    printError(
+      openParen.line,
+      FMT_EXPECTED_OPEN_PAREN,
+      openParen.length,
+      openParen.lexeme
+    );
+    return NULL;
+  }
+
+  Node* parameters = Parser_parseList(self, TOKEN_CLOSE_PAREN);
+
+  if(self->panic) {
+    assert(parameters == NULL);
+    return NULL;
+  }
+
+  Token closeParen = Tokenizer_peek(tokenizer);
+
+  if(closeParen.type == TOKEN_CLOSE_PAREN) {
+    Tokenizer_scan(tokenizer);
+  } else {
+    Node_del(parameters);
+    self->panic = true;
+    printError(
+      closeParen.line,
+      FMT_EXPECTED_CLOSE_OUTFIX,
+      ")",
+      openParen.length,
+      openParen.lexeme,
+      openParen.line,
+      closeParen.length,
+      closeParen.lexeme
+    );
+    return NULL;
+  }
+
+  Node* body = Parser_parseExpression(self);
+
+  if(self->panic) {
+    assert(body == NULL);
+    Node_del(parameters);
+    return NULL;
+  }
+
+  return BinaryNode_new(NODE_LAMBDA, token.line, parameters, body);
+}
+
 /*
  * TODO
  * This is clearly not parsing atoms any more. Come up with a better name.
@@ -430,12 +596,17 @@ Node* Parser_parseAtom(Parser* self) {
         return UnaryNode_new(NODE_LOOP, token.line, body);
       }
 
+    case TOKEN_BACKSLASH:
+      return Parser_parseLambda(self);
+
     case TOKEN_IF:
       return Parser_parseCondJumpExpr(self, NODE_IF);
     case TOKEN_WHILE:
       return Parser_parseCondJumpExpr(self, NODE_WHILE);
     case TOKEN_UNTIL:
       return Parser_parseCondJumpExpr(self, NODE_UNTIL);
+    case TOKEN_FOR:
+      return Parser_parseFor(self);
 
     default:
       // TODO More specific error
@@ -463,6 +634,9 @@ static inline const char* getExpectedCloseFromOpen(Token token) {
     case TOKEN_OPEN_BRACE:
       return "}";
 
+    case TOKEN_OPEN_BRACKET:
+      return "]";
+
     default:
       break;
   }
@@ -472,16 +646,14 @@ static inline const char* getExpectedCloseFromOpen(Token token) {
   return ""; // Silence warnings
 }
 
-Node* Parser_parseOutfix(Parser* self) {
+/*
+ * Consumes the token which closes openToken and returns inner, or reports
+ * an error and deletes inner if the next token doesn't close it.
+ */
+static Node* Parser_closeOutfix(Parser* self, Token openToken, Node* inner) {
   Tokenizer* tokenizer = &(self->tokenizer);
-  Token openToken = Tokenizer_peek(tokenizer);
-
-  if(!Token_opensOutfix(openToken)) return Parser_parseAtom(self);
-
-  Tokenizer_scan(tokenizer);
 
-  // TODO Should we set a minPrecedence for opened "environments"?
-  Node* result = Parser_parseExpression(self);
+  if(self->panic) return NULL;
 
   Token closeToken = Tokenizer_peek(tokenizer);
 
@@ -499,17 +671,100 @@ Node* Parser_parseOutfix(Parser* self) {
       closeToken.lexeme
     );
 
-    Node_del(result);
+    Node_del(inner);
     return NULL;
   }
 
   Tokenizer_scan(tokenizer);
+  return inner;
+}
 
-  return UnaryNode_new(
-    mapOutfix(openToken),
-    openToken.line,
-    result
-  );
+/*
+ * Parses the inside of brackets up to, but not including, the "]". That is
+ * either an array literal such as `[1, 2]` or a map literal such as
+ * `['a': 1, 'b': 2]`, which the colon after the first item tells apart.
+ * `[:]` is the empty map. A map's list holds its keys and values
+ * alternately.
+ */
+static Node* Parser_parseBrackets(Parser* self, NodeType* type) {
+  Tokenizer* tokenizer = &(self->tokenizer);
+
+  // TODO Getting the line from the tokenizer is a hack
+  ListNode* listNode = ListNode_new(NODE_COMMA_SEPARATED, tokenizer->line);
+  *type = NODE_ARRAY;
+
+  if(Tokenizer_peek(tokenizer).type == TOKEN_COLON) {
+    Tokenizer_scan(tokenizer);
+    *type = NODE_MAP;
+    return ListNode_finish(listNode);
+  }
+
+  for(;;) {
+    Token token = Tokenizer_peek(tokenizer);
+
+    if(listNode->count > 0 && token.type == TOKEN_COMMA) {
+      Tokenizer_scan(tokenizer);
+      token = Tokenizer_peek(tokenizer);
+    }
+
+    if(token.type == TOKEN_CLOSE_BRACKET) return ListNode_finish(listNode);
+
+    Node* key = Parser_parseExpression(self);
+
+    if(self->panic) {
+      assert(key == NULL);
+      Node_del((Node*)listNode);
+      return NULL;
+    }
+
+    ListNode_append(listNode, key);
+
+    token = Tokenizer_peek(tokenizer);
+
+    if(listNode->count == 1 && token.type == TOKEN_COLON) *type = NODE_MAP;
+    if(*type == NODE_ARRAY) continue;
+
+    if(token.type != TOKEN_COLON) {
+      self->panic = true;
+      printError(token.line, FMT_EXPECTED_COLON, token.length, token.lexeme);
+      Node_del((Node*)listNode);
+      return NULL;
+    }
+
+    Tokenizer_scan(tokenizer);
+
+    Node* value = Parser_parseExpression(self);
+
+    if(self->panic) {
+      assert(value == NULL);
+      Node_del((Node*)listNode);
+      return NULL;
+    }
+
+    ListNode_append(listNode, value);
+  }
+}
+
+Node* Parser_parseOutfix(Parser* self) {
+  Tokenizer* tokenizer = &(self->tokenizer);
+  Token openToken = Tokenizer_peek(tokenizer);
+
+  if(!Token_opensOutfix(openToken)) return Parser_parseAtom(self);
+
+  Tokenizer_scan(tokenizer);
+
+  NodeType type = mapOutfix(openToken);
+
+  // TODO Should we set a minPrecedence for opened "environments"?
+  Node* result = openToken.type == TOKEN_OPEN_BRACKET
+    ? Parser_parseBrackets(self, &type)
+    : Parser_parseExpression(self);
+
+  result = Parser_closeOutfix(self, openToken, result);
+
+  if(result == NULL) return NULL;
+
+  return UnaryNode_new(type, openToken.line, result);
 }
 
 Precedence Precedence_max(Precedence arg0, Precedence arg1) {
@@ -537,7 +792,8 @@ Node* Parser_parsePrefix(Parser* self, Precedence minPrecedence) {
   return UnaryNode_new(mapPrefix(token), token.line, inner);
 }
 
-Node* Parser_parseList(Parser* self) {
+// Parses comma separated expressions up to, but not including, close
+Node* Parser_parseList(Parser* self, TokenType close) {
   Tokenizer* tokenizer = &(self->tokenizer);
 
   // TODO Getting the line from the tokenizer is a hack
@@ -550,38 +806,22 @@ Node* Parser_parseList(Parser* self) {
 
     if(first) {
       first = false;
-    } else {
-      switch(token.type) {
-        case TOKEN_COMMA:
-          Tokenizer_scan(tokenizer);
-          token = Tokenizer_peek(tokenizer);
-          break;
-
-        case TOKEN_CLOSE_PAREN:
-          return ListNode_finish(listNode);
-
-        default:
-
-      }
+    } else if(token.type == TOKEN_COMMA) {
+      Tokenizer_scan(tokenizer);
+      token = Tokenizer_peek(tokenizer);
     }
 
-    switch(token.type) {
-      case TOKEN_CLOSE_PAREN:
-        return ListNode_finish(listNode);
+    if(token.type == close) return ListNode_finish(listNode);
 
-      default:
-        {
-          Node* next = Parser_parseExpression(self);
+    Node* next = Parser_parseExpression(self);
 
-          if(self->panic) {
-            assert(next == NULL);
-            Node_del((Node*)listNode);
-            return NULL;
-          }
-
-          ListNode_append(listNode, next);
-        }
+    if(self->panic) {
+      assert(next == NULL);
+      Node_del((Node*)listNode);
+      return NULL;
     }
+
+    ListNode_append(listNode, next);
   }
 }
 
@@ -616,31 +856,19 @@ Node* Parser_parseExprWithPrec(Parser* self, Precedence minPrecedence) {
       if(Token_opensOutfix(operator)) {
         Tokenizer_scan(tokenizer);
 
-        Node* argExpr = Parser_parseList(self);
+        // A subscript holds an index, and a call its list of arguments
+        Node* inner = operator.type == TOKEN_OPEN_BRACKET
+          ? Parser_parseExpression(self)
+          : Parser_parseList(self, TOKEN_CLOSE_PAREN);
 
-        Token closeToken = Tokenizer_peek(tokenizer);
-
-        if(!Token_closesOutfix(closeToken, operator)) {
-          self->panic = true;
-
-          printError(
-            closeToken.line,
-            FMT_EXPECTED_CLOSE_OUTFIX,
-            getExpectedCloseFromOpen(operator),
-            operator.length,
-            operator.lexeme,
-            operator.line,
-            closeToken.length,
-            closeToken.lexeme
-          );
+        inner = Parser_closeOutfix(self, operator, inner);
 
+        if(inner == NULL) {
           Node_del(result);
           return NULL;
         }
 
-        Tokenizer_scan(tokenizer);
-
-        result = BinaryNode_new(mapPostfix(operator), result->line, result, argExpr);
+        result = BinaryNode_new(mapPostfix(operator), result->line, result, inner);
       } else {
         // Currently all postfix operators are outfix as well
         assert(false);
@@ -670,6 +898,7 @@ static inline bool Node_requiresSemicolon(Node* self) {
     case NODE_IF:
     case NODE_UNTIL:
     case NODE_WHILE:
+    case NODE_FOR:
       return false;
 
     case NODE_INTEGER_LITERAL:
@@ -680,6 +909,9 @@ static inline bool Node_requiresSemicolon(Node* self) {
     case NODE_UTF8_LITERAL:
     case NODE_UTF32_LITERAL:
     case NODE_CALL:
+    case NODE_SUBSCRIPT:
+    case NODE_ARRAY:
+    case NODE_MAP:
       return true;
 
     case NODE_NEGATE:
@@ -700,6 +932,7 @@ static inline bool Node_requiresSemicolon(Node* self) {
     case NODE_NOT_EQUAL:
     case NODE_AND:
     case NODE_OR:
+    case NODE_LAMBDA:
       return Node_requiresSemicolon(((BinaryNode*)self)->arg1);
 
     /*
@@ -1503,6 +1736,107 @@ void test_Parser_parseExpression_mutableAssignment() {
   Parser_free(&parser);
 }
 
+void test_Parser_parseExpression_functionAssignment() {
+  const char* source = "multiply(a, b) = a * b";
+
+  Parser parser;
+  Parser_init(&parser, source, false);
+
+  Node* node = Parser_parseExpression(&parser);
+
+  assert(node->type == NODE_ASSIGN);
+
+  BinaryNode* callNode = (BinaryNode*)(((BinaryNode*)node)->arg0);
+  assert(callNode->node.type == NODE_CALL);
+  assert(callNode->arg0->type == NODE_SYMBOL);
+  assert(((ListNode*)(callNode->arg1))->count == 2);
+
+  assert(((BinaryNode*)node)->arg1->type == NODE_MULTIPLY);
+
+  Node_del(node);
+  Parser_free(&parser);
+}
+
+void test_Parser_parseExpression_lambda() {
+  const char* source = "\\(a, b) a * b";
+
+  Parser parser;
+  Parser_init(&parser, source, false);
+
+  Node* node = Parser_parseExpression(&parser);
+
+  assert(node->type == NODE_LAMBDA);
+  assert(node->line == 1);
+
+  ListNode* parameters = (ListNode*)(((BinaryNode*)node)->arg0);
+  assert(parameters->node.type == NODE_COMMA_SEPARATED);
+  assert(parameters->count == 2);
+  assert(parameters->items[0]->type == NODE_SYMBOL);
+  assert(parameters->items[1]->type == NODE_SYMBOL);
+
+  // The body extends as far right as it can
+  assert(((BinaryNode*)node)->arg1->type == NODE_MULTIPLY);
+
+  Node_del(node);
+  Parser_free(&parser);
+}
+
+void test_Parser_parseExpression_lambdaWithoutParameters() {
+  const char* source = "\\() 42";
+
+  Parser parser;
+  Parser_init(&parser, source, false);
+
+  Node* node = Parser_parseExpression(&parser);
+
+  assert(node->type == NODE_LAMBDA);
+  assert(((ListNode*)(((BinaryNode*)node)->arg0))->count == 0);
+  assert(((BinaryNode*)node)->arg1->type == NODE_INTEGER_LITERAL);
+
+  Node_del(node);
+  Parser_free(&parser);
+}
+
+void test_Parser_parseExpression_mapLiteral() {
+  const char* source = "['a': 1, 'b': 2]";
+
+  Parser parser;
+  Parser_init(&parser, source, false);
+
+  Node* node = Parser_parseExpression(&parser);
+
+  assert(node->type == NODE_MAP);
+
+  // Keys and values alternate
+  ListNode* entries = (ListNode*)(((UnaryNode*)node)->arg0);
+  assert(entries->count == 4);
+  assert(entries->items[0]->type == NODE_UTF8_LITERAL);
+  assert(entries->items[1]->type == NODE_INTEGER_LITERAL);
+  assert(entries->items[2]->type == NODE_UTF8_LITERAL);
+  assert(entries->items[3]->type == NODE_INTEGER_LITERAL);
+
+  Node_del(node);
+  Parser_free(&parser);
+
+  Parser_init(&parser, "[:]", false);
+  node = Parser_parseExpression(&parser);
+
+  assert(node->type == NODE_MAP);
+  assert(((ListNode*)(((UnaryNode*)node)->arg0))->count == 0);
+
+  Node_del(node);
+  Parser_free(&parser);
+
+  // Once the first key has a value, every key needs one
+  Parser_init(&parser, "['a': 1, 'b']", false);
+  node = Parser_parseExpression(&parser);
+
+  assert(node == NULL);
+  assert(parser.panic);
+
+  Parser_free(&parser);
+}
+
 void test_Parser_parseStatement_parsesJumpStatementsWithoutElse() {
   const char* sources[3] = {
     "if(true) 42;",
@@ -1771,6 +2105,33 @@ void test_Parser_parseStatement_parsesJumpElseInParens() {
   }
 }
 
+void test_Parser_parseStatement_forIn() {
+  Parser parser;
+  Parser_init(&parser, "for(i in range(10)) i;", false);
+
+  Node* node = Parser_parseStatement(&parser);
+
+  assert(node->type == NODE_FOR);
+
+  TernaryNode* forNode = (TernaryNode*)node;
+  assert(forNode->arg0->type == NODE_SYMBOL);
+  assert(((AtomNode*)(forNode->arg0))->length == 1);
+  assert(forNode->arg1->type == NODE_CALL);
+  assert(forNode->arg2->type == NODE_SYMBOL);
+
+  Node_del(node);
+  Parser_free(&parser);
+
+  // The loop variable can only be a symbol
+  Parser_init(&parser, "for(1 in range(10)) 1;", false);
+  node = Parser_parseStatement(&parser);
+
+  assert(node == NULL);
+  assert(parser.panic);
+
+  Parser_free(&parser);
+}
+
 void test_Parser_parseStatement_continue() {
   const char* source = "continue;";
 
@@ -63,6 +63,10 @@ void test_Parser_parseExpression_parens();
 
 void test_Parser_parseExpression_assignment();
 void test_Parser_parseExpression_mutableAssignment();
+void test_Parser_parseExpression_functionAssignment();
+void test_Parser_parseExpression_lambda();
+void test_Parser_parseExpression_lambdaWithoutParameters();
+void test_Parser_parseExpression_mapLiteral();
 
 void test_Parser_parseStatement_parsesJumpStatementsWithoutElse();
 
@@ -78,6 +82,7 @@ void test_Parser_parseStatement_parsesJumpInAssignment();
 void test_Parser_parseStatement_parsesJumpElseInAssignment();
 void test_Parser_parseStatement_parsesJumpInParens();
 void test_Parser_parseStatement_parsesJumpElseInParens();
+void test_Parser_parseStatement_forIn();
 
 void test_Parser_parseStatement_continue();
 void test_Parser_parseStatement_continueTo();
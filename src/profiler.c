@@ -0,0 +1,607 @@
+#include <assert.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "profiler.h"
+
+/*
+ * Signal handlers can't take arguments, so the handler finds the profiler
+ * through this. Only one profiler can be started at a time.
+ */
+static Profiler* volatile activeProfiler = NULL;
+
+void Profiler_init(Profiler* self, ByteCode* byteCode) {
+  self->byteCode = byteCode;
+
+  /*
+   * The samples are allocated up front because the signal handler can't
+   * call malloc(). Untouched pages aren't resident, so this costs little
+   * for short runs.
+   */
+  self->samples = malloc(sizeof(uint32_t) * PROFILER_MAX_SAMPLES);
+  self->sampleCount = 0;
+  self->depths = malloc(sizeof(uint16_t) * PROFILER_MAX_SAMPLES);
+  self->callers = malloc(sizeof(uint32_t) * PROFILER_MAX_CALLERS);
+  self->callerCount = 0;
+  self->outsideSamples = 0;
+  self->droppedSamples = 0;
+
+  // TODO Handle this
+  assert(self->samples != NULL);
+  assert(self->depths != NULL);
+  assert(self->callers != NULL);
+}
+
+void Profiler_free(Profiler* self) {
+  assert(activeProfiler != self);
+  free(self->callers);
+  free(self->depths);
+  free(self->samples);
+}
+
+void Profiler_recordSample(Profiler* self, Thread* thread) {
+  if(thread == NULL || thread->byteCode != self->byteCode) {
+    self->outsideSamples++;
+    return;
+  }
+
+  uint8_t* pc = thread->publishedPc;
+
+  if(pc == NULL) {
+    self->outsideSamples++;
+    return;
+  }
+
+  /*
+   * Thread_pushFrame() only counts a frame once it's written, and only
+   * frees replaced frames once the thread points past them.
+   */
+  size_t frameCount = thread->frameCount;
+  Frame* frames = thread->frames;
+  size_t depth = frameCount < PROFILER_MAX_DEPTH ? frameCount : PROFILER_MAX_DEPTH;
+
+  if(self->sampleCount == PROFILER_MAX_SAMPLES
+      || self->callerCount + depth > PROFILER_MAX_CALLERS) {
+    self->droppedSamples++;
+    return;
+  }
+
+  for(size_t i = 0; i < depth; i++) {
+    self->callers[self->callerCount++] = (uint32_t)frames[frameCount - depth + i].returnIndex;
+  }
+
+  self->depths[self->sampleCount] = (uint16_t)depth;
+  self->samples[self->sampleCount++] = (uint32_t)ByteCode_index(self->byteCode, pc);
+}
+
+static void Profiler_handleSignal(int signal) {
+  (void)signal;
+
+  Profiler* profiler = activeProfiler;
+  if(profiler != NULL) Profiler_recordSample(profiler, Thread_running);
+}
+
+bool Profiler_start(Profiler* self) {
+  assert(activeProfiler == NULL);
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = Profiler_handleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+
+  if(sigaction(SIGPROF, &action, NULL) != 0) return false;
+
+  activeProfiler = self;
+  Thread_isTraced = true;
+
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = PROFILER_INTERVAL_MICROSECONDS;
+  timer.it_value = timer.it_interval;
+
+  if(setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+    activeProfiler = NULL;
+    Thread_isTraced = false;
+    signal(SIGPROF, SIG_DFL);
+    return false;
+  }
+
+  return true;
+}
+
+void Profiler_stop(Profiler* self) {
+  assert(activeProfiler == self);
+
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+
+  /*
+   * Ignore rather than restore the default action, since a signal that was
+   * already pending when the timer was disarmed would otherwise terminate
+   * the process.
+   */
+  signal(SIGPROF, SIG_IGN);
+  activeProfiler = NULL;
+  Thread_isTraced = false;
+}
+
+/*
+ * Counts samples per bytecode index. The returned array has one entry per
+ * byte of the ByteCode, and must be freed by the caller.
+ */
+static size_t* Profiler_histogram(Profiler* self) {
+  size_t* counts = calloc(ByteCode_count(self->byteCode) + 1, sizeof(size_t));
+
+  for(size_t i = 0; i < self->sampleCount; i++) {
+    if(self->samples[i] < ByteCode_count(self->byteCode)) {
+      counts[self->samples[i]]++;
+    }
+  }
+
+  return counts;
+}
+
+static void Profiler_printSourceLine(FILE* out, const char* source, size_t line) {
+  size_t currentLine = 1;
+
+  while(*source != '\0' && currentLine < line) {
+    if(*source == '\n') currentLine++;
+    source++;
+  }
+
+  while(*source == ' ' || *source == '\t') source++;
+
+  size_t length = strcspn(source, "\n");
+  fprintf(out, "  %.*s", (int)length, source);
+}
+
+typedef struct {
+  size_t line;
+  size_t count;
+} ProfilerLineCount;
+
+static int ProfilerLineCount_compare(const void* a, const void* b) {
+  const ProfilerLineCount* l0 = a;
+  const ProfilerLineCount* l1 = b;
+
+  if(l0->count != l1->count) return l0->count < l1->count ? 1 : -1;
+  return l0->line < l1->line ? -1 : l0->line > l1->line;
+}
+
+void Profiler_printFlat(Profiler* self, FILE* out, const char* source) {
+  size_t* counts = Profiler_histogram(self);
+  ByteCode* byteCode = self->byteCode;
+
+  /*
+   * A line can be split across several line runs (for example, the
+   * condition and the jump back of a while loop), so we total by line
+   * number rather than by run.
+   */
+  size_t maxLine = 0;
+  for(size_t i = 0; i < byteCode->lineRunCount; i++) {
+    if(byteCode->lineRuns[i].line > maxLine) maxLine = byteCode->lineRuns[i].line;
+  }
+
+  ProfilerLineCount* lines = calloc(maxLine + 1, sizeof(ProfilerLineCount));
+  for(size_t line = 0; line <= maxLine; line++) lines[line].line = line;
+
+  size_t index = 0;
+  for(size_t i = 0; i < byteCode->lineRunCount; i++) {
+    LineRun run = byteCode->lineRuns[i];
+
+    for(size_t j = 0; j < run.run; j++) {
+      lines[run.line].count += counts[index++];
+    }
+  }
+
+  qsort(lines, maxLine + 1, sizeof(ProfilerLineCount), ProfilerLineCount_compare);
+
+  size_t total = self->sampleCount + self->outsideSamples;
+
+  fprintf(
+    out,
+    "%zu samples every %dus, %zu outside Fur code, %zu dropped\n",
+    total,
+    PROFILER_INTERVAL_MICROSECONDS,
+    self->outsideSamples,
+    self->droppedSamples
+  );
+  fprintf(out, "%9s %7s %6s\n", "samples", "%", "line");
+
+  for(size_t i = 0; i <= maxLine && lines[i].count > 0; i++) {
+    fprintf(
+      out,
+      "%9zu %6.2f%% %6zu",
+      lines[i].count,
+      100.0 * (double)lines[i].count / (double)total,
+      lines[i].line
+    );
+
+    if(source != NULL) Profiler_printSourceLine(out, source, lines[i].line);
+
+    fprintf(out, "\n");
+  }
+
+  free(lines);
+  free(counts);
+}
+
+/*
+ * Where an index in the ByteCode is in the source: its line in the high
+ * half, and in the low half the function whose body it's in, as 1 plus the
+ * function's index, or 0 for module-level code. Samples on different
+ * instructions of the same line and function fold into the same frame.
+ */
+typedef uint64_t ProfilerLocation;
+
+typedef struct {
+  size_t size;
+  size_t index;
+} ProfilerFunction;
+
+static int ProfilerFunction_compare(const void* a, const void* b) {
+  const ProfilerFunction* f0 = a;
+  const ProfilerFunction* f1 = b;
+
+  if(f0->size != f1->size) return f0->size > f1->size ? -1 : 1;
+  return f0->index < f1->index ? -1 : f0->index > f1->index;
+}
+
+static ProfilerLocation* Profiler_locations(Profiler* self) {
+  ByteCode* byteCode = self->byteCode;
+  size_t count = ByteCode_count(byteCode);
+  ProfilerLocation* locations = calloc(count + 1, sizeof(ProfilerLocation));
+
+  /*
+   * Nested functions are compiled inside the body of the function around
+   * them, so larger functions are marked first and the functions inside
+   * them overwrite their part.
+   */
+  size_t functionCount = byteCode->functions.count;
+  ProfilerFunction* functions = malloc(sizeof(ProfilerFunction) * (functionCount + 1));
+
+  for(size_t i = 0; i < functionCount; i++) {
+    Fn* fn = byteCode->functions.items[i];
+    functions[i].size = fn->end - fn->start;
+    functions[i].index = i;
+  }
+
+  qsort(functions, functionCount, sizeof(ProfilerFunction), ProfilerFunction_compare);
+
+  for(size_t i = 0; i < functionCount; i++) {
+    Fn* fn = byteCode->functions.items[functions[i].index];
+
+    for(size_t index = fn->start; index < fn->end && index < count; index++) {
+      locations[index] = functions[i].index + 1;
+    }
+  }
+
+  free(functions);
+
+  size_t index = 0;
+  for(size_t i = 0; i < byteCode->lineRunCount; i++) {
+    LineRun run = byteCode->lineRuns[i];
+
+    for(size_t j = 0; j < run.run; j++, index++) {
+      locations[index] |= (ProfilerLocation)run.line << 32;
+    }
+  }
+
+  return locations;
+}
+
+/*
+ * One sample's stack, as the location of each frame, outermost first and
+ * ending with the location of the sampled instruction.
+ */
+typedef struct {
+  const ProfilerLocation* locations;
+  size_t depth;
+  Instruction instruction;
+  size_t count;
+} ProfilerStack;
+
+static int ProfilerStack_compare(const void* a, const void* b) {
+  const ProfilerStack* s0 = a;
+  const ProfilerStack* s1 = b;
+
+  for(size_t i = 0; i < s0->depth && i < s1->depth; i++) {
+    if(s0->locations[i] != s1->locations[i]) {
+      return s0->locations[i] < s1->locations[i] ? -1 : 1;
+    }
+  }
+
+  if(s0->depth != s1->depth) return s0->depth < s1->depth ? -1 : 1;
+  return (int)s0->instruction - (int)s1->instruction;
+}
+
+static void Profiler_printLocation(Profiler* self, FILE* out, ProfilerLocation location) {
+  size_t line = (size_t)(location >> 32);
+  size_t function = (size_t)(location & UINT32_MAX);
+
+  if(function == 0) {
+    fprintf(out, ";line %zu", line);
+  } else {
+    Fn* fn = self->byteCode->functions.items[function - 1];
+    fprintf(out, ";%.*s line %zu", FN_PRINTF_NAME(fn), line);
+  }
+}
+
+void Profiler_printFolded(Profiler* self, FILE* out, const char* name) {
+  ByteCode* byteCode = self->byteCode;
+  ProfilerLocation* locations = Profiler_locations(self);
+
+  ProfilerLocation* stackLocations = malloc(
+    sizeof(ProfilerLocation) * (self->callerCount + self->sampleCount + 1)
+  );
+  ProfilerStack* stacks = malloc(sizeof(ProfilerStack) * (self->sampleCount + 1));
+
+  /*
+   * A return index is just past the call, so the call itself is the byte
+   * before it. Samples always land on the first byte of an instruction, so
+   * they can be decoded as an opcode.
+   */
+  const uint32_t* callers = self->callers;
+  ProfilerLocation* next = stackLocations;
+
+  for(size_t i = 0; i < self->sampleCount; i++) {
+    stacks[i].locations = next;
+    stacks[i].depth = self->depths[i] + 1;
+    stacks[i].count = 1;
+
+    for(size_t j = 0; j < self->depths[i]; j++) {
+      uint32_t returnIndex = *(callers++);
+      bool isValid = returnIndex > 0 && returnIndex <= ByteCode_count(byteCode);
+      *(next++) = isValid ? locations[returnIndex - 1] : 0;
+    }
+
+    uint32_t sample = self->samples[i];
+    bool isValid = sample < ByteCode_count(byteCode);
+    *(next++) = isValid ? locations[sample] : 0;
+    stacks[i].instruction = isValid ? (Instruction)(byteCode->items[sample]) : OP_NIL;
+  }
+
+  qsort(stacks, self->sampleCount, sizeof(ProfilerStack), ProfilerStack_compare);
+
+  for(size_t i = 0; i < self->sampleCount;) {
+    ProfilerStack stack = stacks[i++];
+
+    while(i < self->sampleCount && ProfilerStack_compare(&stack, stacks + i) == 0) {
+      stack.count += stacks[i++].count;
+    }
+
+    fprintf(out, "%s", name);
+
+    for(size_t j = 0; j < stack.depth; j++) {
+      Profiler_printLocation(self, out, stack.locations[j]);
+    }
+
+    fprintf(out, ";%s %zu\n", Instruction_toCString(stack.instruction), stack.count);
+  }
+
+  if(self->outsideSamples > 0) {
+    fprintf(out, "%s;(outside Fur code) %zu\n", name, self->outsideSamples);
+  }
+
+  free(stacks);
+  free(stackLocations);
+  free(locations);
+}
+
+#ifdef TEST
+
+static void Profiler_addSample(Profiler* self, uint32_t sample, size_t depth, const uint32_t* callers) {
+  for(size_t i = 0; i < depth; i++) {
+    self->callers[self->callerCount++] = callers[i];
+  }
+
+  self->depths[self->sampleCount] = (uint16_t)depth;
+  self->samples[self->sampleCount++] = sample;
+}
+
+void test_Profiler_recordSample_outsideThread() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_NIL, 1);
+
+  Profiler profiler;
+  Profiler_init(&profiler, &byteCode);
+
+  Profiler_recordSample(&profiler, NULL);
+
+  ByteCode otherByteCode;
+  ByteCode_init(&otherByteCode);
+  Thread otherThread;
+  Thread_init(&otherThread, &otherByteCode);
+  otherThread.publishedPc = otherByteCode.items;
+
+  Profiler_recordSample(&profiler, &otherThread);
+
+  assert(profiler.sampleCount == 0);
+  assert(profiler.outsideSamples == 2);
+
+  Thread_free(&otherThread);
+  ByteCode_free(&otherByteCode);
+  Profiler_free(&profiler);
+  ByteCode_free(&byteCode);
+}
+
+void test_Profiler_recordSample_runningThread() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  Profiler profiler;
+  Profiler_init(&profiler, &byteCode);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.publishedPc = ByteCode_pc(&byteCode, 1);
+
+  Profiler_recordSample(&profiler, &thread);
+
+  assert(profiler.sampleCount == 1);
+  assert(profiler.samples[0] == 1);
+  assert(profiler.depths[0] == 0);
+  assert(profiler.outsideSamples == 0);
+
+  // Frames are recorded outermost first
+  thread.frames = malloc(sizeof(Frame) * 2);
+  thread.frames[0].returnIndex = 7;
+  thread.frames[0].base = 0;
+  thread.frames[1].returnIndex = 9;
+  thread.frames[1].base = 3;
+  thread.frameCount = 2;
+  thread.frameCapacity = 2;
+
+  Profiler_recordSample(&profiler, &thread);
+
+  assert(profiler.sampleCount == 2);
+  assert(profiler.depths[1] == 2);
+  assert(profiler.callerCount == 2);
+  assert(profiler.callers[0] == 7);
+  assert(profiler.callers[1] == 9);
+
+  Thread_free(&thread);
+  Profiler_free(&profiler);
+  ByteCode_free(&byteCode);
+}
+
+void test_Profiler_printFlat_sortsByLine() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_TRUE, 2);
+  ByteCode_append(&byteCode, OP_DROP, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 3);
+
+  Profiler profiler;
+  Profiler_init(&profiler, &byteCode);
+
+  uint32_t samples[] = { 0, 1, 2, 2, 3 };
+  for(size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+    Profiler_addSample(&profiler, samples[i], 0, NULL);
+  }
+
+  char* text;
+  size_t length;
+  FILE* out = open_memstream(&text, &length);
+  Profiler_printFlat(&profiler, out, "nil;\ntrue;\nnil;\n");
+  fclose(out);
+
+  const char* expected =
+    "5 samples every 1000us, 0 outside Fur code, 0 dropped\n"
+    "  samples       %   line\n"
+    "        3  60.00%      1  nil;\n"
+    "        1  20.00%      2  true;\n"
+    "        1  20.00%      3  nil;\n";
+  assert(strcmp(text, expected) == 0);
+
+  free(text);
+  Profiler_free(&profiler);
+  ByteCode_free(&byteCode);
+}
+
+void test_Profiler_printFolded_groupsByInstruction() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_DROP, 1);
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Profiler profiler;
+  Profiler_init(&profiler, &byteCode);
+
+  uint32_t samples[] = { 2, 0, 1, 3, 0 };
+  for(size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+    Profiler_addSample(&profiler, samples[i], 0, NULL);
+  }
+  profiler.outsideSamples = 4;
+
+  char* text;
+  size_t length;
+  FILE* out = open_memstream(&text, &length);
+  Profiler_printFolded(&profiler, out, "test");
+  fclose(out);
+
+  const char* expected =
+    "test;line 1;OP_NIL 3\n"
+    "test;line 1;OP_DROP 1\n"
+    "test;line 2;OP_RETURN 1\n"
+    "test;(outside Fur code) 4\n";
+  assert(strcmp(text, expected) == 0);
+
+  free(text);
+  Profiler_free(&profiler);
+  ByteCode_free(&byteCode);
+}
+
+void test_Profiler_printFolded_walksFrames() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  // Module-level code on lines 1 and 2, calling f, which calls a lambda
+  ByteCode_append(&byteCode, OP_CALL, 1);
+  ByteCode_append(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_CALL, 2);
+  ByteCode_append(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Fn* f = Fn_new(0, "f", 1);
+  f->start = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_NIL, 4);
+  ByteCode_append(&byteCode, OP_CALL, 5);
+  ByteCode_append(&byteCode, 0, 5);
+
+  Fn* lambda = Fn_new(0, "", 0);
+  lambda->start = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_TRUE, 6);
+  ByteCode_append(&byteCode, OP_RETURN, 6);
+  lambda->end = ByteCode_count(&byteCode);
+
+  ByteCode_append(&byteCode, OP_RETURN, 7);
+  f->end = ByteCode_count(&byteCode);
+
+  FnList_append(&(byteCode.functions), lambda);
+  FnList_append(&(byteCode.functions), f);
+
+  Profiler profiler;
+  Profiler_init(&profiler, &byteCode);
+
+  uint32_t fromLine1[] = { 2 };
+  uint32_t fromLine2[] = { 4 };
+  uint32_t throughF[] = { 2, 8 };
+
+  Profiler_addSample(&profiler, 0, 0, NULL);
+  Profiler_addSample(&profiler, 5, 1, fromLine1);
+  Profiler_addSample(&profiler, 8, 2, throughF);
+  Profiler_addSample(&profiler, 5, 1, fromLine2);
+  Profiler_addSample(&profiler, 8, 2, throughF);
+  Profiler_addSample(&profiler, 9, 2, throughF);
+
+  char* text;
+  size_t length;
+  FILE* out = open_memstream(&text, &length);
+  Profiler_printFolded(&profiler, out, "test");
+  fclose(out);
+
+  const char* expected =
+    "test;line 1;OP_CALL 1\n"
+    "test;line 1;f line 4;OP_NIL 1\n"
+    "test;line 1;f line 5;(lambda) line 6;OP_TRUE 2\n"
+    "test;line 1;f line 5;(lambda) line 6;OP_RETURN 1\n"
+    "test;line 2;f line 4;OP_NIL 1\n";
+  assert(strcmp(text, expected) == 0);
+
+  free(text);
+  Profiler_free(&profiler);
+  ByteCode_free(&byteCode);
+}
+
+#endif
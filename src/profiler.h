@@ -0,0 +1,85 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "instruction.h"
+#include "thread.h"
+
+/*
+ * A sampling profiler. While started, a SIGPROF timer fires every
+ * PROFILER_INTERVAL_MICROSECONDS of CPU time, and the handler records the
+ * published pc of the running Thread as an index into the profiled
+ * ByteCode, along with the return index of each of its frames. Samples are
+ * only mapped to lines, functions and instructions when the profile is
+ * printed, so the handler does no allocation or lookups.
+ *
+ * Threads only publish their pc while Thread_isTraced is set, which
+ * Profiler_start() and Profiler_stop() take care of.
+ */
+
+#define PROFILER_INTERVAL_MICROSECONDS 1000
+#define PROFILER_MAX_SAMPLES (1 << 20)
+#define PROFILER_MAX_CALLERS (1 << 22)
+
+// Deeper stacks keep only their innermost frames
+#define PROFILER_MAX_DEPTH 256
+
+typedef struct {
+  ByteCode* byteCode;
+
+  // The index of the instruction each sample landed on
+  uint32_t* samples;
+  size_t sampleCount;
+
+  /*
+   * The return indices of the frames each sample was taken in, outermost
+   * first. Sample i has depths[i] of them, directly after those of the
+   * samples before it.
+   */
+  uint16_t* depths;
+  uint32_t* callers;
+  size_t callerCount;
+
+  // Samples taken while no Thread was running this ByteCode, e.g. compiling
+  size_t outsideSamples;
+
+  // Samples that didn't fit in PROFILER_MAX_SAMPLES
+  size_t droppedSamples;
+} Profiler;
+
+void Profiler_init(Profiler*, ByteCode*);
+void Profiler_free(Profiler*);
+
+bool Profiler_start(Profiler*);
+void Profiler_stop(Profiler*);
+
+void Profiler_recordSample(Profiler*, Thread*);
+
+/*
+ * Prints samples per source line, hottest first. If source is not NULL,
+ * each line is followed by its text.
+ */
+void Profiler_printFlat(Profiler*, FILE*, const char* source);
+
+/*
+ * Prints one line per distinct stack in the folded stack format read by
+ * flamegraph.pl and similar tools. name is the root frame, standing for
+ * module-level code, and each call adds a frame for the function and line
+ * it's executing, ending with the sampled instruction.
+ */
+void Profiler_printFolded(Profiler*, FILE*, const char* name);
+
+#ifdef TEST
+
+void test_Profiler_recordSample_outsideThread();
+void test_Profiler_recordSample_runningThread();
+void test_Profiler_printFlat_sortsByLine();
+void test_Profiler_printFolded_groupsByInstruction();
+void test_Profiler_printFolded_walksFrames();
+
+#endif
+
+#endif
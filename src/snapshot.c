@@ -0,0 +1,1073 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "map.h"
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "FURSNAP"
+#define SNAPSHOT_VERSION 9
+
+typedef struct {
+  uint64_t offset;
+  uint64_t count;
+} SnapshotSection;
+
+/*
+ * The start of the image. Sections which hold records of varying size are
+ * tables of the records' offsets, in which an offset of 0 stands for NULL.
+ */
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  // Catches images from builds with a different Value layout
+  uint32_t valueSize;
+  uint64_t pcIndex;
+  SnapshotSection code;
+  SnapshotSection lineRuns;
+  SnapshotSection blobs;            // Offsets of Blobs
+  SnapshotSection functions;        // Offsets of Fns
+  SnapshotSection natives;          // Offsets of SnapshotNames
+  SnapshotSection symbols;          // SnapshotSymbols
+  SnapshotSection capturedSymbols;  // Offsets of SnapshotNames
+  SnapshotSection objects;          // Offsets of SnapshotObjects
+  SnapshotSection stack;            // Values
+} SnapshotHeader;
+
+typedef struct {
+  uint64_t length;
+  char text[];
+} SnapshotName;
+
+typedef struct {
+  uint64_t name;
+  uint64_t definedOnLine;
+  uint8_t isMutable;
+  uint8_t isBoxed;
+} SnapshotSymbol;
+
+/*
+ * An object reached from the stack, followed by its contents: the Value in
+ * a box, the count upvalues of a closure of the function at index, the
+ * count limbs of a big integer which is negative if index is 1, the Blob
+ * of a string, the count items of an array, the count keys and values of
+ * a map, alternately, or the count bytes of a string builder.
+ */
+typedef struct {
+  uint64_t type;
+  uint64_t count;
+  uint64_t index;
+  uint8_t contents[];
+} SnapshotObject;
+
+/*
+ * Maps pointers to the indices they are written under, so that functions
+ * are written as their index in the ByteCode and objects reached more than
+ * once are written once.
+ */
+typedef struct {
+  const void** keys;
+  uint64_t* indices;
+  size_t count;
+  size_t capacity;
+} SnapshotMap;
+
+static void SnapshotMap_init(SnapshotMap* self) {
+  self->keys = NULL;
+  self->indices = NULL;
+  self->count = 0;
+  self->capacity = 0;
+}
+
+static void SnapshotMap_free(SnapshotMap* self) {
+  free(self->keys);
+  free(self->indices);
+}
+
+inline static size_t SnapshotMap_slot(SnapshotMap* self, const void* key) {
+  // Allocations are at least 16-byte aligned, so the low bits carry nothing
+  size_t slot = (((uintptr_t)key >> 4) * 11400714819323198485llu) & (self->capacity - 1);
+
+  while(self->keys[slot] != NULL && self->keys[slot] != key) {
+    slot = (slot + 1) & (self->capacity - 1);
+  }
+
+  return slot;
+}
+
+// Returns the index of key, or -1
+static int64_t SnapshotMap_find(SnapshotMap* self, const void* key) {
+  if(self->count == 0) return -1;
+
+  size_t slot = SnapshotMap_slot(self, key);
+  return self->keys[slot] == NULL ? -1 : (int64_t)(self->indices[slot]);
+}
+
+static void SnapshotMap_insert(SnapshotMap* self, const void* key, uint64_t index) {
+  if(self->count * 2 >= self->capacity) {
+    const void** keys = self->keys;
+    uint64_t* indices = self->indices;
+    size_t capacity = self->capacity;
+
+    self->capacity = capacity == 0 ? 64 : capacity * 2;
+    self->keys = calloc(self->capacity, sizeof(void*));
+    self->indices = malloc(self->capacity * sizeof(uint64_t));
+
+    // TODO Handle this
+    assert(self->keys != NULL && self->indices != NULL);
+
+    for(size_t i = 0; i < capacity; i++) {
+      if(keys[i] == NULL) continue;
+
+      size_t slot = SnapshotMap_slot(self, keys[i]);
+      self->keys[slot] = keys[i];
+      self->indices[slot] = indices[i];
+    }
+
+    free(keys);
+    free(indices);
+  }
+
+  size_t slot = SnapshotMap_slot(self, key);
+  assert(self->keys[slot] == NULL);
+
+  self->keys[slot] = key;
+  self->indices[slot] = index;
+  self->count++;
+}
+
+/*
+ * Builds the image in memory, so that it can be written with a single
+ * fwrite(). Writes return offsets rather than pointers, since any write may
+ * move the image.
+ */
+typedef struct {
+  uint8_t* items;
+  size_t count;
+  size_t capacity;
+
+  ByteCode* byteCode;
+  SnapshotMap functions;
+
+  // The objects reached so far, in the order of their indices
+  SnapshotMap objectIndices;
+  Value* objects;
+  size_t objectCount;
+  size_t objectCapacity;
+} SnapshotWriter;
+
+static void SnapshotWriter_init(SnapshotWriter* self, ByteCode* byteCode) {
+  self->items = NULL;
+  self->count = 0;
+  self->capacity = 0;
+  self->byteCode = byteCode;
+
+  SnapshotMap_init(&(self->functions));
+
+  for(size_t i = 0; i < byteCode->functions.count; i++) {
+    SnapshotMap_insert(&(self->functions), byteCode->functions.items[i], i);
+  }
+
+  SnapshotMap_init(&(self->objectIndices));
+  self->objects = NULL;
+  self->objectCount = 0;
+  self->objectCapacity = 0;
+}
+
+static void SnapshotWriter_free(SnapshotWriter* self) {
+  free(self->items);
+  SnapshotMap_free(&(self->functions));
+  SnapshotMap_free(&(self->objectIndices));
+  free(self->objects);
+}
+
+/*
+ * Every write starts 8-byte aligned, so that the image can be used in
+ * place once it is mapped. The padding and the reserved bytes are zeroed,
+ * so that saving the same state always writes the same file.
+ */
+static uint64_t SnapshotWriter_reserve(SnapshotWriter* self, size_t size) {
+  size_t offset = (self->count + 7) & ~(size_t)7;
+
+  if(offset + size > self->capacity) {
+    while(offset + size > self->capacity) {
+      self->capacity = self->capacity == 0 ? 4096 : self->capacity * 2;
+    }
+
+    self->items = realloc(self->items, self->capacity);
+
+    // TODO Handle this
+    assert(self->items != NULL);
+  }
+
+  memset(self->items + self->count, 0, offset + size - self->count);
+  self->count = offset + size;
+
+  return offset;
+}
+
+static uint64_t SnapshotWriter_write(SnapshotWriter* self, const void* data, size_t size) {
+  uint64_t offset = SnapshotWriter_reserve(self, size);
+
+  // Empty sections may have no data at all
+  if(size > 0) memcpy(self->items + offset, data, size);
+
+  return offset;
+}
+
+inline static void* SnapshotWriter_at(SnapshotWriter* self, uint64_t offset) {
+  return self->items + offset;
+}
+
+inline static void SnapshotWriter_setOffset(SnapshotWriter* self, uint64_t table, size_t i, uint64_t offset) {
+  ((uint64_t*)SnapshotWriter_at(self, table))[i] = offset;
+}
+
+static uint64_t SnapshotWriter_writeName(SnapshotWriter* self, const char* text, size_t length) {
+  uint64_t offset = SnapshotWriter_reserve(self, sizeof(SnapshotName) + length);
+  SnapshotName* name = SnapshotWriter_at(self, offset);
+
+  name->length = length;
+  memcpy(name->text, text, length);
+
+  return offset;
+}
+
+static uint64_t SnapshotWriter_objectIndex(SnapshotWriter* self, Value value, const void* object) {
+  int64_t index = SnapshotMap_find(&(self->objectIndices), object);
+  if(index != -1) return index;
+
+  if(self->objectCount == self->objectCapacity) {
+    self->objectCapacity = self->objectCapacity == 0 ? 16 : self->objectCapacity * 2;
+    self->objects = realloc(self->objects, self->objectCapacity * sizeof(Value));
+
+    // TODO Handle this
+    assert(self->objects != NULL);
+  }
+
+  SnapshotMap_insert(&(self->objectIndices), object, self->objectCount);
+  self->objects[self->objectCount] = value;
+  return self->objectCount++;
+}
+
+/*
+ * Returns value with its pointer replaced by the index of what it points
+ * to. Objects are queued to be written after the stack.
+ */
+static Value SnapshotWriter_encode(SnapshotWriter* self, Value value) {
+  Value result;
+  memset(&result, 0, sizeof(Value));
+  result.type = value.type;
+
+  switch(value.type) {
+    case VALUE_BOOLEAN:
+    case VALUE_NIL:
+    case VALUE_INTEGER:
+    case VALUE_SMALL_UTF8:
+      result.as = value.as;
+      break;
+
+    case VALUE_NATIVE_FN:
+      result.as.integer = Thread_findBuiltin(Value_asNativeFn(value));
+      assert(result.as.integer != -1);
+      break;
+
+    case VALUE_NATIVE:
+      result.as.integer = -1;
+
+      for(size_t i = 0; i < self->byteCode->natives.count; i++) {
+        if(self->byteCode->natives.items[i] == Value_asNative(value)) result.as.integer = i;
+      }
+
+      assert(result.as.integer != -1);
+      break;
+
+    case VALUE_FN:
+      result.as.integer = SnapshotMap_find(&(self->functions), Value_asFn(value));
+      assert(result.as.integer != -1);
+      break;
+
+    case VALUE_CLOSURE:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asClosure(value));
+      break;
+
+    case VALUE_BOX:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asBox(value));
+      break;
+
+    case VALUE_STACK_CLOSURE:
+      // These only live in scopes and frames, which are closed by now
+      assert(false);
+      break;
+
+    case VALUE_BIG_INTEGER:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asBigInteger(value));
+      break;
+
+    case VALUE_UTF8:
+    case VALUE_UTF32:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, value.as.blob);
+      break;
+
+    case VALUE_ARRAY:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asArray(value));
+      break;
+
+    case VALUE_MAP:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asMap(value));
+      break;
+
+    case VALUE_RANGE:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asRange(value));
+      break;
+
+    case VALUE_STRING_BUILDER:
+      result.as.integer = SnapshotWriter_objectIndex(self, value, Value_asStringBuilder(value));
+      break;
+  }
+
+  return result;
+}
+
+/*
+ * Arrays and maps can be any size, so their contents are encoded straight
+ * into the record rather than into a buffer. Encoding never writes to the
+ * image, so the record doesn't move while it is filled in.
+ */
+static uint64_t SnapshotWriter_writeArray(SnapshotWriter* self, ObjArray* array) {
+  uint64_t offset = SnapshotWriter_reserve(self, sizeof(SnapshotObject) + array->count * sizeof(Value));
+  SnapshotObject* record = SnapshotWriter_at(self, offset);
+
+  record->type = VALUE_ARRAY;
+  record->count = array->count;
+  record->index = 0;
+
+  for(size_t i = 0; i < array->count; i++) {
+    ((Value*)(record->contents))[i] = SnapshotWriter_encode(self, array->items[i]);
+  }
+
+  return offset;
+}
+
+static uint64_t SnapshotWriter_writeMap(SnapshotWriter* self, ObjMap* map) {
+  uint64_t offset = SnapshotWriter_reserve(self, sizeof(SnapshotObject) + 2 * map->count * sizeof(Value));
+  SnapshotObject* record = SnapshotWriter_at(self, offset);
+  Value* contents = (Value*)(record->contents);
+
+  record->type = VALUE_MAP;
+  record->count = map->count;
+  record->index = 0;
+
+  for(size_t i = 0; i < map->capacity; i++) {
+    if(map->control[i] == MAP_EMPTY) continue;
+
+    *(contents++) = SnapshotWriter_encode(self, map->entries[i].key);
+    *(contents++) = SnapshotWriter_encode(self, map->entries[i].value);
+  }
+
+  return offset;
+}
+
+static uint64_t SnapshotWriter_writeObject(SnapshotWriter* self, Value object) {
+  if(object.type == VALUE_ARRAY) return SnapshotWriter_writeArray(self, Value_asArray(object));
+  if(object.type == VALUE_MAP) return SnapshotWriter_writeMap(self, Value_asMap(object));
+
+  SnapshotObject header;
+  header.type = object.type;
+  header.count = 0;
+  header.index = 0;
+
+  // Encode first, since writing the header would move the image
+  Value contents[UINT8_MAX + 1];
+  size_t contentSize = 0;
+  const void* data = contents;
+
+  switch(object.type) {
+    case VALUE_BOX:
+      contents[0] = SnapshotWriter_encode(self, Value_asBox(object)->value);
+      contentSize = sizeof(Value);
+      break;
+
+    case VALUE_CLOSURE:
+      {
+        ObjClosure* closure = Value_asClosure(object);
+        header.count = closure->upvalueCount;
+        header.index = SnapshotMap_find(&(self->functions), closure->fn);
+
+        for(size_t i = 0; i < closure->upvalueCount; i++) {
+          contents[i] = SnapshotWriter_encode(self, closure->upvalues[i]);
+        }
+
+        contentSize = closure->upvalueCount * sizeof(Value);
+      }
+      break;
+
+    case VALUE_BIG_INTEGER:
+      {
+        ObjBigInteger* bigInteger = Value_asBigInteger(object);
+        header.count = bigInteger->count;
+        header.index = bigInteger->isNegative;
+        data = bigInteger->limbs;
+        contentSize = bigInteger->count * sizeof(uint32_t);
+      }
+      break;
+
+    case VALUE_UTF8:
+    case VALUE_UTF32:
+      Blob_hash(object.as.blob);
+      data = object.as.blob;
+      contentSize = sizeof(Blob) + object.as.blob->count;
+      break;
+
+    case VALUE_RANGE:
+      data = &(Value_asRange(object)->start);
+      contentSize = 2 * sizeof(int64_t);
+      break;
+
+    case VALUE_STRING_BUILDER:
+      header.count = Value_asStringBuilder(object)->count;
+      data = Value_asStringBuilder(object)->bytes;
+      contentSize = header.count;
+      break;
+
+    default:
+      // Only the types queued by SnapshotWriter_encode() are objects
+      assert(false);
+  }
+
+  uint64_t offset = SnapshotWriter_reserve(self, sizeof(SnapshotObject) + contentSize);
+  SnapshotObject* record = SnapshotWriter_at(self, offset);
+
+  *record = header;
+  // An empty string builder may not have any bytes to point to
+  if(contentSize > 0) memcpy(record->contents, data, contentSize);
+
+  // Restored strings point into the image, which no Thread can free
+  if(object.type == VALUE_UTF8 || object.type == VALUE_UTF32) {
+    ((Blob*)(record->contents))->isOwned = false;
+  }
+
+  return offset;
+}
+
+void Snapshot_init(Snapshot* self) {
+  self->address = NULL;
+  self->size = 0;
+}
+
+void Snapshot_free(Snapshot* self) {
+  if(self->address != NULL) munmap(self->address, self->size);
+}
+
+inline static SnapshotSection SnapshotSection_new(uint64_t offset, uint64_t count) {
+  SnapshotSection result;
+  result.offset = offset;
+  result.count = count;
+  return result;
+}
+
+bool Snapshot_save(const char* path, Compiler* compiler, ByteCode* byteCode, Thread* thread) {
+  // Frames and scopes only exist while code is running
+  assert(thread->frameCount == 0);
+  assert(thread->stack.scopeCount == 0);
+  assert(compiler->symbolList.scopeDepth == 0);
+
+  SnapshotWriter writer;
+  SnapshotWriter_init(&writer, byteCode);
+
+  SnapshotHeader header;
+  memset(&header, 0, sizeof(SnapshotHeader));
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+  header.version = SNAPSHOT_VERSION;
+  header.valueSize = sizeof(Value);
+  header.pcIndex = thread->pcIndex;
+
+  SnapshotWriter_reserve(&writer, sizeof(SnapshotHeader));
+
+  header.code = SnapshotSection_new(
+    SnapshotWriter_write(&writer, byteCode->items, byteCode->count),
+    byteCode->count
+  );
+
+  header.lineRuns = SnapshotSection_new(
+    SnapshotWriter_write(&writer, byteCode->lineRuns, byteCode->lineRunCount * sizeof(LineRun)),
+    byteCode->lineRunCount
+  );
+
+  BlobList* blobs = &(byteCode->blobs);
+  header.blobs = SnapshotSection_new(
+    SnapshotWriter_reserve(&writer, blobs->count * sizeof(uint64_t)),
+    blobs->count
+  );
+
+  for(size_t i = 0; i < blobs->count; i++) {
+    Blob* blob = blobs->items[i];
+    if(blob == NULL) continue;
+
+    // Restored blobs are read-only, so they can't hash themselves later
+    Blob_hash(blob);
+
+    uint64_t offset = SnapshotWriter_write(&writer, blob, sizeof(Blob) + blob->count);
+    SnapshotWriter_setOffset(&writer, header.blobs.offset, i, offset);
+  }
+
+  FnList* functions = &(byteCode->functions);
+  header.functions = SnapshotSection_new(
+    SnapshotWriter_reserve(&writer, functions->count * sizeof(uint64_t)),
+    functions->count
+  );
+
+  for(size_t i = 0; i < functions->count; i++) {
+    Fn* fn = functions->items[i];
+    uint64_t offset = SnapshotWriter_write(&writer, fn, sizeof(Fn) + fn->nameLength);
+    SnapshotWriter_setOffset(&writer, header.functions.offset, i, offset);
+  }
+
+  NativeList* natives = &(byteCode->natives);
+  header.natives = SnapshotSection_new(
+    SnapshotWriter_reserve(&writer, natives->count * sizeof(uint64_t)),
+    natives->count
+  );
+
+  for(size_t i = 0; i < natives->count; i++) {
+    Native* native = natives->items[i];
+    uint64_t offset = SnapshotWriter_writeName(&writer, native->name, native->nameLength);
+    SnapshotWriter_setOffset(&writer, header.natives.offset, i, offset);
+  }
+
+  SymbolList* symbolList = &(compiler->symbolList);
+  header.symbols = SnapshotSection_new(
+    SnapshotWriter_reserve(&writer, symbolList->count * sizeof(SnapshotSymbol)),
+    symbolList->count
+  );
+
+  for(size_t i = 0; i < symbolList->count; i++) {
+    SymbolMetadata* metadata = &(symbolList->items[i]);
+    uint64_t name = SnapshotWriter_writeName(&writer, metadata->symbol->text, metadata->symbol->length);
+
+    SnapshotSymbol* symbol = (SnapshotSymbol*)SnapshotWriter_at(&writer, header.symbols.offset) + i;
+    symbol->name = name;
+    symbol->definedOnLine = metadata->definedOnLine;
+    symbol->isMutable = metadata->isMutable;
+    symbol->isBoxed = metadata->isBoxed;
+  }
+
+  header.capturedSymbols = SnapshotSection_new(
+    SnapshotWriter_reserve(&writer, compiler->capturedSymbolCount * sizeof(uint64_t)),
+    compiler->capturedSymbolCount
+  );
+
+  for(size_t i = 0; i < compiler->capturedSymbolCount; i++) {
+    Symbol* symbol = compiler->capturedSymbols[i];
+    uint64_t offset = SnapshotWriter_writeName(&writer, symbol->text, symbol->length);
+    SnapshotWriter_setOffset(&writer, header.capturedSymbols.offset, i, offset);
+  }
+
+  Stack* stack = &(thread->stack);
+  size_t stackCount = stack->top + 1 - stack->items;
+  header.stack = SnapshotSection_new(
+    SnapshotWriter_reserve(&writer, stackCount * sizeof(Value)),
+    stackCount
+  );
+
+  for(size_t i = 0; i < stackCount; i++) {
+    Value value = SnapshotWriter_encode(&writer, stack->items[i]);
+    ((Value*)SnapshotWriter_at(&writer, header.stack.offset))[i] = value;
+  }
+
+  // Writing objects can reach more objects, so the count grows as this runs
+  uint64_t* objectOffsets = NULL;
+  size_t objectOffsetCapacity = 0;
+
+  for(size_t i = 0; i < writer.objectCount; i++) {
+    if(i == objectOffsetCapacity) {
+      objectOffsetCapacity = writer.objectCapacity;
+      objectOffsets = realloc(objectOffsets, objectOffsetCapacity * sizeof(uint64_t));
+
+      // TODO Handle this
+      assert(objectOffsets != NULL);
+    }
+
+    objectOffsets[i] = SnapshotWriter_writeObject(&writer, writer.objects[i]);
+  }
+
+  header.objects = SnapshotSection_new(
+    SnapshotWriter_write(&writer, objectOffsets, writer.objectCount * sizeof(uint64_t)),
+    writer.objectCount
+  );
+
+  free(objectOffsets);
+
+  memcpy(SnapshotWriter_at(&writer, 0), &header, sizeof(SnapshotHeader));
+
+  FILE* file = fopen(path, "wb");
+  bool success = file != NULL
+    && fwrite(writer.items, 1, writer.count, file) == writer.count;
+
+  if(file != NULL && fclose(file) != 0) success = false;
+  if(!success) fprintf(stderr, "Unable to save snapshot: %s: %s\n", path, strerror(errno));
+
+  SnapshotWriter_free(&writer);
+  return success;
+}
+
+inline static uint64_t* Snapshot_table(uint8_t* image, SnapshotSection section) {
+  return (uint64_t*)(image + section.offset);
+}
+
+inline static SnapshotName* Snapshot_name(uint8_t* image, uint64_t offset) {
+  return (SnapshotName*)(image + offset);
+}
+
+/*
+ * Checks that the header came from this build and that its sections lie in
+ * the file. Records are trusted beyond that, since the only way to get a
+ * bad one is to edit the file.
+ */
+static bool Snapshot_isValid(uint8_t* image, size_t size) {
+  if(size < sizeof(SnapshotHeader)) return false;
+
+  SnapshotHeader* header = (SnapshotHeader*)image;
+
+  if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return false;
+  if(header->version != SNAPSHOT_VERSION) return false;
+  if(header->valueSize != sizeof(Value)) return false;
+
+  struct {
+    SnapshotSection section;
+    size_t size;
+  } sections[] = {
+    { header->code, sizeof(uint8_t) },
+    { header->lineRuns, sizeof(LineRun) },
+    { header->blobs, sizeof(uint64_t) },
+    { header->functions, sizeof(uint64_t) },
+    { header->natives, sizeof(uint64_t) },
+    { header->symbols, sizeof(SnapshotSymbol) },
+    { header->capturedSymbols, sizeof(uint64_t) },
+    { header->objects, sizeof(uint64_t) },
+    { header->stack, sizeof(Value) },
+  };
+
+  for(size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+    SnapshotSection section = sections[i].section;
+
+    if(section.offset > size) return false;
+    if(section.count > (size - section.offset) / sections[i].size) return false;
+  }
+
+  // ByteCode relies on there always being a line run
+  return header->lineRuns.count > 0 && header->pcIndex <= header->code.count;
+}
+
+inline static Value Snapshot_decode(Value value, ByteCode* byteCode, void** objects) {
+  switch(value.type) {
+    case VALUE_BOOLEAN:
+    case VALUE_NIL:
+    case VALUE_INTEGER:
+    case VALUE_SMALL_UTF8:
+      return value;
+
+    case VALUE_NATIVE_FN:
+      return Thread_builtin(value.as.integer);
+
+    case VALUE_NATIVE:
+      return Value_fromNative(byteCode->natives.items[value.as.integer]);
+
+    case VALUE_FN:
+      return Value_fromFn(byteCode->functions.items[value.as.integer]);
+
+    case VALUE_CLOSURE:
+      return Value_fromClosure(objects[value.as.integer]);
+
+    case VALUE_BOX:
+      return Value_fromBox(objects[value.as.integer]);
+
+    case VALUE_BIG_INTEGER:
+      return Value_fromBigInteger(objects[value.as.integer]);
+
+    case VALUE_UTF8:
+    case VALUE_UTF32:
+      return Value_fromBlob(value.type, objects[value.as.integer]);
+
+    case VALUE_ARRAY:
+      return Value_fromArray(objects[value.as.integer]);
+
+    case VALUE_MAP:
+      return Value_fromMap(objects[value.as.integer]);
+
+    case VALUE_RANGE:
+      return Value_fromRange(objects[value.as.integer]);
+
+    case VALUE_STRING_BUILDER:
+      return Value_fromStringBuilder(objects[value.as.integer]);
+
+    case VALUE_STACK_CLOSURE:
+      break;
+  }
+
+  // Should never happen
+  assert(false);
+  return NIL;
+}
+
+bool Snapshot_restore(Snapshot* self, const char* path, Compiler* compiler, ByteCode* byteCode, Thread* thread) {
+  assert(self->address == NULL);
+
+  // The snapshot replaces the instructions and stack wholesale
+  assert(ByteCode_count(byteCode) == 0);
+  assert(SymbolList_count(&(compiler->symbolList)) == 0);
+  assert(Stack_isEmpty(&(thread->stack)));
+
+  int fd = open(path, O_RDONLY);
+
+  if(fd == -1) {
+    fprintf(stderr, "Unable to restore snapshot: %s: %s\n", path, strerror(errno));
+    return false;
+  }
+
+  struct stat status;
+  uint8_t* image = MAP_FAILED;
+  size_t size = 0;
+
+  if(fstat(fd, &status) == 0 && status.st_size > 0) {
+    size = status.st_size;
+    image = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+
+  close(fd);
+
+  if(image == MAP_FAILED || !Snapshot_isValid(image, size)) {
+    fprintf(stderr, "Unable to restore snapshot: %s wasn't saved by this version of Fur.\n", path);
+    if(image != MAP_FAILED) munmap(image, size);
+    return false;
+  }
+
+  SnapshotHeader* header = (SnapshotHeader*)image;
+
+  // Compiled code calls natives by index, so they must line up
+  uint64_t* natives = Snapshot_table(image, header->natives);
+
+  for(size_t i = 0; i < header->natives.count; i++) {
+    SnapshotName* name = Snapshot_name(image, natives[i]);
+
+    if(i >= byteCode->natives.count
+        || NativeList_find(&(byteCode->natives), name->text, name->length) != (int32_t)i) {
+      fprintf(
+        stderr,
+        "Unable to restore snapshot: the native %.*s must be registered first.\n",
+        (int)(name->length),
+        name->text
+      );
+
+      munmap(image, size);
+      return false;
+    }
+  }
+
+  byteCode->count = header->code.count;
+  if(byteCode->capacity < byteCode->count) {
+    byteCode->capacity = byteCode->count;
+    byteCode->items = realloc(byteCode->items, byteCode->capacity);
+
+    // TODO Handle this
+    assert(byteCode->items != NULL);
+  }
+
+  memcpy(byteCode->items, image + header->code.offset, byteCode->count);
+
+  byteCode->lineRunCount = header->lineRuns.count;
+  if(byteCode->lineRunCapacity < byteCode->lineRunCount) {
+    byteCode->lineRunCapacity = byteCode->lineRunCount;
+    byteCode->lineRuns = realloc(byteCode->lineRuns, byteCode->lineRunCapacity * sizeof(LineRun));
+
+    // TODO Handle this
+    assert(byteCode->lineRuns != NULL);
+  }
+
+  memcpy(byteCode->lineRuns, image + header->lineRuns.offset, byteCode->lineRunCount * sizeof(LineRun));
+
+  uint64_t* blobs = Snapshot_table(image, header->blobs);
+
+  for(size_t i = 0; i < header->blobs.count; i++) {
+    BlobList_append(&(byteCode->blobs), blobs[i] == 0 ? NULL : (Blob*)(image + blobs[i]));
+  }
+
+  uint64_t* functions = Snapshot_table(image, header->functions);
+
+  for(size_t i = 0; i < header->functions.count; i++) {
+    Fn* saved = (Fn*)(image + functions[i]);
+    Fn* fn = Fn_new(saved->arity, saved->name, saved->nameLength);
+
+    fn->start = saved->start;
+    fn->end = saved->end;
+
+    FnList_append(&(byteCode->functions), fn);
+  }
+
+  SnapshotSymbol* symbols = (SnapshotSymbol*)(image + header->symbols.offset);
+
+  for(size_t i = 0; i < header->symbols.count; i++) {
+    SnapshotName* name = Snapshot_name(image, symbols[i].name);
+    Symbol* symbol = SymbolTable_getOrCreate(&(compiler->symbolTable), name->text, name->length);
+
+    SymbolList_append(&(compiler->symbolList), symbol, symbols[i].definedOnLine, symbols[i].isMutable);
+    if(symbols[i].isBoxed) SymbolList_box(&(compiler->symbolList), i);
+  }
+
+  uint64_t* capturedSymbols = Snapshot_table(image, header->capturedSymbols);
+
+  if(header->capturedSymbols.count > 0) {
+    compiler->capturedSymbolCapacity = header->capturedSymbols.count;
+    compiler->capturedSymbols = malloc(compiler->capturedSymbolCapacity * sizeof(Symbol*));
+
+    // TODO Handle this
+    assert(compiler->capturedSymbols != NULL);
+  }
+
+  for(size_t i = 0; i < header->capturedSymbols.count; i++) {
+    SnapshotName* name = Snapshot_name(image, capturedSymbols[i]);
+    compiler->capturedSymbols[compiler->capturedSymbolCount++] =
+      SymbolTable_getOrCreate(&(compiler->symbolTable), name->text, name->length);
+  }
+
+  /*
+   * Objects can refer to each other in cycles (a closure stored in a box
+   * which it captured), so they are all allocated before any are filled in.
+   */
+  uint64_t* objectOffsets = Snapshot_table(image, header->objects);
+  void** objects = malloc(header->objects.count * sizeof(void*));
+
+  // TODO Handle this
+  assert(objects != NULL || header->objects.count == 0);
+
+  for(size_t i = 0; i < header->objects.count; i++) {
+    SnapshotObject* record = (SnapshotObject*)(image + objectOffsets[i]);
+
+    switch(record->type) {
+      case VALUE_BOX:
+        objects[i] = Thread_allocate(thread, OBJ_BOX, sizeof(ObjBox));
+        break;
+
+      case VALUE_CLOSURE:
+        {
+          ObjClosure* closure = (ObjClosure*)Thread_allocate(
+            thread,
+            OBJ_CLOSURE,
+            sizeof(ObjClosure) + record->count * sizeof(Value)
+          );
+
+          closure->fn = byteCode->functions.items[record->index];
+          closure->upvalueCount = record->count;
+          objects[i] = closure;
+        }
+        break;
+
+      case VALUE_BIG_INTEGER:
+        {
+          ObjBigInteger* bigInteger = (ObjBigInteger*)Thread_allocate(
+            thread,
+            OBJ_BIG_INTEGER,
+            sizeof(ObjBigInteger) + record->count * sizeof(uint32_t)
+          );
+
+          bigInteger->isNegative = record->index;
+          bigInteger->count = record->count;
+          memcpy(bigInteger->limbs, record->contents, record->count * sizeof(uint32_t));
+          objects[i] = bigInteger;
+        }
+        break;
+
+      case VALUE_UTF8:
+      case VALUE_UTF32:
+        objects[i] = record->contents;
+        break;
+
+      case VALUE_ARRAY:
+        objects[i] = Thread_newArray(thread, record->count);
+        break;
+
+      case VALUE_MAP:
+        objects[i] = Thread_newMap(thread, record->count);
+        break;
+
+      case VALUE_RANGE:
+        {
+          const int64_t* bounds = (const int64_t*)(record->contents);
+          objects[i] = Thread_newRange(thread, bounds[0], bounds[1]);
+        }
+        break;
+
+      case VALUE_STRING_BUILDER:
+        {
+          ObjStringBuilder* stringBuilder = Thread_newStringBuilder(thread, record->count);
+          ObjStringBuilder_append(stringBuilder, record->contents, record->count);
+          objects[i] = stringBuilder;
+        }
+        break;
+
+      default:
+        assert(false);
+    }
+  }
+
+  for(size_t i = 0; i < header->objects.count; i++) {
+    SnapshotObject* record = (SnapshotObject*)(image + objectOffsets[i]);
+    Value* contents = (Value*)(record->contents);
+
+    if(record->type == VALUE_BOX) {
+      ((ObjBox*)objects[i])->value = Snapshot_decode(contents[0], byteCode, objects);
+    } else if(record->type == VALUE_CLOSURE) {
+      ObjClosure* closure = objects[i];
+
+      for(size_t j = 0; j < closure->upvalueCount; j++) {
+        closure->upvalues[j] = Snapshot_decode(contents[j], byteCode, objects);
+      }
+    } else if(record->type == VALUE_ARRAY) {
+      ObjArray* array = objects[i];
+
+      for(size_t j = 0; j < record->count; j++) {
+        ObjArray_append(array, Snapshot_decode(contents[j], byteCode, objects));
+      }
+    } else if(record->type == VALUE_MAP) {
+      // Keys are hashed again, since identities and the table size may differ
+      for(size_t j = 0; j < record->count; j++) {
+        ObjMap_set(
+          objects[i],
+          Snapshot_decode(contents[2 * j], byteCode, objects),
+          Snapshot_decode(contents[2 * j + 1], byteCode, objects)
+        );
+      }
+    }
+  }
+
+  Value* stack = (Value*)(image + header->stack.offset);
+
+  for(size_t i = 0; i < header->stack.count; i++) {
+    Stack_push(&(thread->stack), Snapshot_decode(stack[i], byteCode, objects));
+  }
+
+  free(objects);
+
+  thread->pcIndex = header->pcIndex;
+
+  self->address = image;
+  self->size = size;
+  return true;
+}
+
+#ifdef TEST
+
+void test_Snapshot_restore_rejectsOtherFiles() {
+  char path[] = "/tmp/fur_snapshot_testXXXXXX";
+  int fd = mkstemp(path);
+  assert(fd != -1);
+
+  const char* contents = "x = 1;\n";
+  assert(write(fd, contents, strlen(contents)) == (ssize_t)strlen(contents));
+  close(fd);
+
+  Compiler compiler;
+  Compiler_init(&compiler);
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  Snapshot snapshot;
+  Snapshot_init(&snapshot);
+
+  assert(!Snapshot_restore(&snapshot, path, &compiler, &byteCode, &thread));
+  assert(!Snapshot_restore(&snapshot, "/nonexistent/fur.snapshot", &compiler, &byteCode, &thread));
+
+  assert(snapshot.address == NULL);
+  assert(ByteCode_count(&byteCode) == 0);
+  assert(Stack_isEmpty(&(thread.stack)));
+
+  Snapshot_free(&snapshot);
+  Thread_free(&thread);
+  ByteCode_free(&byteCode);
+  Compiler_free(&compiler);
+  unlink(path);
+}
+
+#endif
+
+#ifdef BENCH
+
+#include "bench.h"
+#include "fur.h"
+
+typedef struct {
+  const char* source;
+  const char* path;
+} SnapshotBench;
+
+static void SnapshotBench_compile(void* context) {
+  Fur* fur = Fur_new();
+  Value result;
+
+  bool success = Fur_eval(fur, ((SnapshotBench*)context)->source, &result);
+  assert(success);
+  (void)success;
+
+  Fur_del(fur);
+}
+
+static void SnapshotBench_restore(void* context) {
+  Fur* fur = Fur_new();
+
+  bool success = Fur_restore(fur, ((SnapshotBench*)context)->path);
+  assert(success);
+  (void)success;
+
+  Fur_del(fur);
+}
+
+/*
+ * Compares starting an instance by compiling and running a prelude of
+ * FUR_BENCH_SNAPSHOT_FUNCTIONS functions against restoring a snapshot of
+ * the same instance.
+ */
+void bench_Snapshot_restore() {
+  size_t functionCount = Bench_parameter("FUR_BENCH_SNAPSHOT_FUNCTIONS", 1000);
+
+  // Each definition is well under 128 bytes
+  size_t capacity = (functionCount + 1) * 128;
+  char* source = malloc(capacity);
+  size_t length = 0;
+
+  assert(source != NULL);
+
+  for(size_t i = 0; i < functionCount; i++) {
+    length += snprintf(
+      source + length,
+      capacity - length,
+      "f%zu(x) = if(x < %zu) { x * 2 } else { f%zu(x - 1) + 1 }\n",
+      i, i, i
+    );
+  }
+
+  snprintf(source + length, capacity - length, "total = f%zu(3);\n", functionCount - 1);
+
+  SnapshotBench bench;
+  bench.source = source;
+  bench.path = "/tmp/fur_bench.snapshot";
+
+  Fur* fur = Fur_new();
+  Value result;
+  bool success = Fur_eval(fur, bench.source, &result) && Fur_save(fur, bench.path);
+  assert(success);
+  (void)success;
+  Fur_del(fur);
+
+  Bench_measure("Snapshot_compilePrelude", SnapshotBench_compile, &bench, 1);
+  Bench_measure("Snapshot_restore", SnapshotBench_restore, &bench, 1);
+
+  unlink(bench.path);
+  free(source);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "compiler.h"
+#include "instruction.h"
+#include "thread.h"
+
+/*
+ * A snapshot is an image of a warm interpreter between evaluations: the
+ * compiler's module symbols, the ByteCode, and the thread's stack of module
+ * variables along with every object they reach. Restoring one maps the file
+ * and relocates it instead of parsing and compiling the source again.
+ *
+ * The image is written in the native layout, with every pointer replaced by
+ * an index or a file offset, so it can only be restored by the same version
+ * of Fur on the same platform:
+ *
+ * - Instructions and line runs are copied out of the mapping with one
+ *   memcpy() each, since they must stay growable.
+ * - Blobs and symbol names are used in place, so the mapping lives until
+ *   the snapshot is freed, which must be after the ByteCode and Compiler.
+ * - Values hold the index of their function, builtin, native or object, and
+ *   are relocated as they are copied onto the stack and into objects.
+ *
+ * Natives can't be stored, since they are C function pointers. They must be
+ * registered again, under the same names and in the same order, before
+ * restoring.
+ */
+typedef struct {
+  void* address;
+  size_t size;
+} Snapshot;
+
+void Snapshot_init(Snapshot*);
+void Snapshot_free(Snapshot*);
+
+/*
+ * Writes the state to path. Only module-level state can be saved, so the
+ * thread must be between runs. Returns false, after printing why to stderr,
+ * if the file can't be written.
+ */
+bool Snapshot_save(const char* path, Compiler*, ByteCode*, Thread*);
+
+/*
+ * Restores the state saved at path into a Compiler, ByteCode and Thread
+ * which have not compiled or run anything yet, keeping the file mapped in
+ * self. Returns false, after printing why to stderr, if the file can't be
+ * read, wasn't written by this build, or needs natives which aren't
+ * registered. Nothing is restored in that case.
+ */
+bool Snapshot_restore(Snapshot* self, const char* path, Compiler*, ByteCode*, Thread*);
+
+#ifdef TEST
+
+void test_Snapshot_restore_rejectsOtherFiles();
+
+#endif
+
+#ifdef BENCH
+
+void bench_Snapshot_restore();
+
+#endif
+
+#endif
@@ -30,25 +30,19 @@ void Stack_free(Stack* self) {
 
 void Stack_openScope(Stack* self) {
   if(self->scopeCount == self->scopeCapacity) {
-    // TODO Handle this
-    assert(self->scopeCapacity < UINT8_MAX);
-
-    uint16_t newCapacity = (uint16_t)(self->scopeCapacity) * 1.25;
-
     if(self->scopeCapacity == 0) {
       self->scopeCapacity = 8;
     } else {
-      if(newCapacity > UINT8_MAX) newCapacity = UINT8_MAX;
+      self->scopeCapacity *= 2;
     }
 
-    self->scopeCapacity = newCapacity;
-    self->scopes = realloc(self->scopes, sizeof(Value*) * self->scopeCapacity);
+    self->scopes = realloc(self->scopes, sizeof(size_t) * self->scopeCapacity);
 
     // TODO Handle this
     assert(self->scopes != NULL);
   }
 
-  self->scopes[self->scopeCount] = self->currentScope;
+  self->scopes[self->scopeCount] = self->currentScope - self->items;
   self->scopeCount++;
   self->currentScope = self->top + 1;
 }
@@ -63,7 +57,20 @@ void Stack_closeScope(Stack* self) {
   *(self->currentScope) = *(self->top);
   self->top = self->currentScope;
   self->scopeCount--;
-  self->currentScope = self->scopes[self->scopeCount];
+  self->currentScope = self->items + self->scopes[self->scopeCount];
+}
+
+void Stack_abandonScopes(Stack* self, size_t count) {
+  if(count == 0) return;
+
+  assert(count <= self->scopeCount);
+
+  self->scopeCount -= count;
+  self->currentScope = self->items + self->scopes[self->scopeCount];
+}
+
+void Stack_closeAllScopes(Stack* self) {
+  Stack_abandonScopes(self, self->scopeCount);
 }
 
 #ifdef TEST
@@ -112,6 +119,64 @@ void test_Stack_pushIndex() {
   Stack_free(&stack);
 }
 
+void test_Stack_window_inPushOrder() {
+  Stack stack;
+  Stack_init(&stack);
+
+  for(int i = 0; i < 10; i++) {
+    Stack_push(&stack, Value_fromInteger(i));
+  }
+
+  Value* window = Stack_window(&stack, 3);
+
+  assert(Value_asInteger(window[0]) == 7);
+  assert(Value_asInteger(window[1]) == 8);
+  assert(Value_asInteger(window[2]) == 9);
+  assert(window + 2 == stack.top);
+
+  Stack_free(&stack);
+}
+
+void test_Stack_drop() {
+  Stack stack;
+  Stack_init(&stack);
+
+  for(int i = 0; i < 10; i++) {
+    Stack_push(&stack, Value_fromInteger(i));
+  }
+
+  Stack_drop(&stack, 4);
+  assert(Value_asInteger(Stack_peek(&stack)) == 5);
+
+  Stack_drop(&stack, 6);
+  assert(Stack_isEmpty(&stack));
+
+  Stack_free(&stack);
+}
+
+void test_Stack_collapse() {
+  Stack stack;
+  Stack_init(&stack);
+
+  for(int i = 0; i < 10; i++) {
+    Stack_push(&stack, Value_fromInteger(i));
+  }
+
+  Stack_collapse(&stack, 6, 1);
+
+  assert(Value_asInteger(Stack_pop(&stack)) == 9);
+  assert(Value_asInteger(Stack_pop(&stack)) == 5);
+
+  Stack_collapse(&stack, 1, 2);
+
+  assert(Value_asInteger(Stack_pop(&stack)) == 4);
+  assert(Value_asInteger(Stack_pop(&stack)) == 3);
+  assert(Value_asInteger(Stack_pop(&stack)) == 0);
+  assert(Stack_isEmpty(&stack));
+
+  Stack_free(&stack);
+}
+
 void test_Stack_scopes() {
   Stack stack;
   Stack_init(&stack);
@@ -132,4 +197,26 @@ void test_Stack_scopes() {
   Stack_free(&stack);
 }
 
+void test_Stack_scopes_nested() {
+  Stack stack;
+  Stack_init(&stack);
+
+  for(int i = 0; i < 1000; i++) {
+    Stack_openScope(&stack);
+    Stack_push(&stack, Value_fromInteger(i));
+  }
+
+  assert(stack.scopeCount == 1000);
+
+  for(int i = 0; i < 1000; i++) {
+    Stack_closeScope(&stack);
+  }
+
+  assert(stack.scopeCount == 0);
+  assert(Value_asInteger(Stack_pop(&stack)) == 999);
+  assert(Stack_isEmpty(&stack));
+
+  Stack_free(&stack);
+}
+
 #endif
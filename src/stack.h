@@ -3,7 +3,9 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <string.h>
 
+#include "output.h"
 #include "value.h"
 
 typedef struct {
@@ -11,10 +13,17 @@ typedef struct {
   Value* items;
   Value* top;
 
+  /*
+   * Function calls nest inside whatever scopes the caller has open, so the
+   * number of open scopes grows with recursion depth rather than being
+   * bounded by how deeply blocks are nested in the source. The enclosing
+   * scopes are saved as indices into items, so growing items doesn't have
+   * to rebase them.
+   */
   Value* currentScope;
-  Value** scopes;
-  uint8_t scopeCount;
-  uint8_t scopeCapacity;
+  size_t* scopes;
+  size_t scopeCount;
+  size_t scopeCapacity;
 } Stack;
 
 void Stack_init(Stack*);
@@ -23,26 +32,38 @@ void Stack_free(Stack*);
 void Stack_openScope(Stack*);
 void Stack_closeScope(Stack*);
 
+/*
+ * Forgets the innermost count scopes without touching the values in them,
+ * for leaving scopes without passing their OP_SCOPE_CLOSEs.
+ */
+void Stack_abandonScopes(Stack*, size_t count);
+
+/*
+ * Forgets all open scopes without touching the values in them, for
+ * abandoning execution part way through.
+ */
+void Stack_closeAllScopes(Stack*);
+
 inline static bool Stack_isEmpty(Stack* self) {
   return self->top < self->items;
 }
 
+// The number of values on the stack, which is the index of the next push
+inline static size_t Stack_count(Stack* self) {
+  return self->top + 1 - self->items;
+}
+
 inline static void Stack_push(Stack* self, Value item) {
   if(self->top == self->maxTop) {
     size_t topIndex = self->top - self->items;
+    size_t currentScopeIndex = self->currentScope - self->items;
     size_t capacity = (topIndex + 1) * 2;
-    Value* oldItems = self->items;
 
     self->items = realloc(self->items, sizeof(Value) * capacity);
     assert(self->items != NULL);
     self->top = self->items + topIndex;
     self->maxTop = self->items + capacity - 1;
-
-    self->currentScope = self->items + (self->currentScope - oldItems);
-
-    for(size_t i = 0; i < self->scopeCount; i++) {
-      self->scopes[i] = self->items + (self->scopes[i] - oldItems);
-    }
+    self->currentScope = self->items + currentScopeIndex;
   }
 
   *(++(self->top)) = item;
@@ -60,6 +81,54 @@ inline static Value Stack_peek(Stack* self) {
   return *(self->top);
 }
 
+/*
+ * Returns a pointer to the top count values, in the order they were pushed,
+ * without copying them. The pointer is only valid until the next push, which
+ * may reallocate the stack.
+ */
+inline static Value* Stack_window(Stack* self, size_t count) {
+  assert(self->top + 1 - count >= self->items);
+
+  return self->top + 1 - count;
+}
+
+/*
+ * Returns a pointer to the count values starting at index, like
+ * Stack_window() but from the bottom of the stack, so instructions can
+ * update several of a frame's slots in place.
+ */
+inline static Value* Stack_slots(Stack* self, size_t index, size_t count) {
+  assert(self->items + index + count <= self->top + 1);
+
+  return self->items + index;
+}
+
+inline static void Stack_drop(Stack* self, size_t count) {
+  assert(self->top + 1 - count >= self->items);
+
+  self->top -= count;
+}
+
+// Removes everything above the first count values
+inline static void Stack_truncate(Stack* self, size_t count) {
+  assert(self->items + count <= self->top + 1);
+
+  self->top = self->items + count - 1;
+}
+
+/*
+ * Removes everything from index up, except the top count values, which are
+ * moved down to start at index. This is how a returning function replaces
+ * itself, its arguments and its locals with its result, and how a tail call
+ * replaces them with the callee and its arguments.
+ */
+inline static void Stack_collapse(Stack* self, size_t index, size_t count) {
+  assert(self->items + index + count <= self->top + 1);
+
+  memmove(self->items + index, self->top + 1 - count, sizeof(Value) * count);
+  self->top = self->items + index + count - 1;
+}
+
 inline static void Stack_pushIndex(Stack* self, size_t index) {
   assert(self->items + index <= self->top);
   Stack_push(self, self->items[index]);
@@ -72,19 +141,21 @@ inline static void Stack_popToIndex(Stack* self, size_t index) {
 }
 
 inline static void Stack_println(Stack* self) {
-  printf("[");
+  Output* out = Output_standard();
+
+  Output_writeByte(out, '[');
   bool first = true;
   for(Value* v = self->items; v <= self->top; v++) {
     if(first) {
       first = false;
     } else {
-      printf(", ");
+      Output_writeCString(out, ", ");
     }
 
     Value_print(*v);
   }
 
-  printf("] top\n");
+  Output_writeCString(out, "] top\n");
 }
 
 #ifdef TEST
@@ -92,7 +163,11 @@ inline static void Stack_println(Stack* self) {
 void test_Stack_init_empty();
 void test_Stack_lifo();
 void test_Stack_pushIndex();
+void test_Stack_window_inPushOrder();
+void test_Stack_drop();
+void test_Stack_collapse();
 void test_Stack_scopes();
+void test_Stack_scopes_nested();
 
 #endif
 
@@ -8,6 +8,8 @@ Symbol* Symbol_new(const char* text, size_t length, uint32_t hash) {
   result->text = text;
   result->length = length;
   result->hash = hash;
+  result->builtinIndex = -1;
+  result->nativeIndex = -1;
   return result;
 }
 
@@ -8,6 +8,12 @@ typedef struct {
   const char* text;
   size_t length;
   uint32_t hash;
+
+  // The symbol's index in BUILTINS, or -1; see Compiler_init()
+  int16_t builtinIndex;
+
+  // The symbol's index in the ByteCode's natives, or -1; see Compiler_compile()
+  int16_t nativeIndex;
 } Symbol;
 
 Symbol* Symbol_new(const char* text, size_t length, uint32_t hash);
@@ -7,6 +7,8 @@ inline static void SymbolMetadata_init(SymbolMetadata* self, Symbol* symbol, siz
   self->symbol = symbol;
   self->definedOnLine = definedOnLine;
   self->isMutable = isMutable;
+  self->isBoxed = false;
+  self->isStackClosure = false;
 }
 
 int32_t SymbolList_find(SymbolList* self, Symbol* symbol) {
@@ -19,10 +21,7 @@ int32_t SymbolList_find(SymbolList* self, Symbol* symbol) {
   return -1;
 }
 
-void SymbolList_append(SymbolList* self, Symbol* symbol, size_t definedOnLine, bool isMutable) {
-  // TODO Handle this better
-  assert(SymbolList_find(self, symbol) == -1);
-
+static void SymbolList_grow(SymbolList* self) {
   if(self->count == self->capacity) {
     uint32_t capacity = self->capacity;
 
@@ -40,6 +39,13 @@ void SymbolList_append(SymbolList* self, Symbol* symbol, size_t definedOnLine, b
     // TODO Handle this better
     assert(self->items != NULL);
   }
+}
+
+void SymbolList_append(SymbolList* self, Symbol* symbol, size_t definedOnLine, bool isMutable) {
+  // TODO Handle this better
+  assert(SymbolList_find(self, symbol) == -1);
+
+  SymbolList_grow(self);
 
   SymbolMetadata_init(
     &(self->items[self->count++]),
@@ -49,6 +55,17 @@ void SymbolList_append(SymbolList* self, Symbol* symbol, size_t definedOnLine, b
   );
 }
 
+void SymbolList_appendHidden(SymbolList* self, size_t definedOnLine) {
+  SymbolList_grow(self);
+
+  SymbolMetadata_init(
+    &(self->items[self->count++]),
+    NULL,
+    definedOnLine,
+    false
+  );
+}
+
 #ifdef TEST
 
 #include<string.h>
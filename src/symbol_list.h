@@ -7,6 +7,12 @@ typedef struct {
   Symbol* symbol;
   size_t definedOnLine;
   bool isMutable;
+
+  // Captured mutable variables are boxed; see ObjBox
+  bool isBoxed;
+
+  // The variable holds a stack closure whose Fn and upvalues precede it
+  bool isStackClosure;
 } SymbolMetadata;
 
 typedef enum {
@@ -77,13 +83,46 @@ inline static void SymbolList_closeScope(SymbolList* self) {
   self->count = scope.checkpoint;
 }
 
+/*
+ * The number of symbols declared outside of any scope. These are the first
+ * symbols in the list, since scopes are closed in the reverse order to which
+ * they are opened.
+ */
+inline static uint16_t SymbolList_outermostCount(SymbolList* self) {
+  return self->scopeDepth == 0 ? self->count : self->scopes[0].checkpoint;
+}
+
 void SymbolList_append(SymbolList* self, Symbol* symbol, size_t definedOnLine, bool isMutable);
+
+/*
+ * Reserves a slot which no symbol refers to, for state the compiler keeps on
+ * the stack, like a for loop's iterator.
+ */
+void SymbolList_appendHidden(SymbolList* self, size_t definedOnLine);
 int32_t SymbolList_find(SymbolList* self, Symbol* symbol);
 
 inline static bool SymbolList_isMutable(SymbolList* self, int32_t index) {
   return self->items[index].isMutable;
 }
 
+inline static bool SymbolList_isBoxed(SymbolList* self, int32_t index) {
+  return self->items[index].isBoxed;
+}
+
+inline static void SymbolList_box(SymbolList* self, int32_t index) {
+  assert(self->items[index].isMutable);
+  self->items[index].isBoxed = true;
+}
+
+inline static bool SymbolList_isStackClosure(SymbolList* self, int32_t index) {
+  return self->items[index].isStackClosure;
+}
+
+inline static void SymbolList_markStackClosure(SymbolList* self, int32_t index) {
+  assert(!self->items[index].isMutable);
+  self->items[index].isStackClosure = true;
+}
+
 inline static size_t SymbolList_definedOnLine(SymbolList* self, int32_t index) {
   return self->items[index].definedOnLine;
 }
@@ -3,19 +3,42 @@
 
 #define FMT_EXPECTED_CLOSE_OUTFIX \
   "Expected \"%s\" to close \"%.*s\" from line %zu, but received \"%.*s\"."
+#define FMT_DUPLICATE_PARAMETER \
+  "Parameter `%.*s` is declared more than once."
 #define FMT_EXPECTED_OPEN_PAREN \
   "Unexpected token \"%.*s\". Expected \"(\"."
+#define FMT_EXPECTED_IN \
+  "Unexpected token \"%.*s\". Expected \"in\" after the loop variable."
+#define FMT_EXPECTED_COLON \
+  "Unexpected token \"%.*s\". Expected \":\" after a map key."
 #define FMT_REASSIGNING_IMMUTABLE_VARIABLE \
   "Reassigning immutable variable `%.*s` after definition on line %zu."
 #define FMT_REDECLARATION \
   "Re-declaring symbol `%.*s` already declared on line %zu."
+#define FMT_INTEGER_LITERAL_TOO_LARGE \
+  "Integer literal %.*s is too large; literals must fit in 64 bits."
 #define FMT_UNDEFINED_SYMBOL \
   "Symbol \"%.*s\" is not (yet) defined."
 #define FMT_UNEXPECTED_TOKEN "Unexpected token \"%.*s\"."
+#define FMT_UNKNOWN_ESCAPE "Unknown escape sequence \"\\%.*s\"."
+#define FMT_INVALID_UNICODE_ESCAPE \
+  "Invalid escape sequence \"%.*s\". Expected \"\\u{...}\" with 1 to 6 hex digits."
+#define FMT_INVALID_CODE_POINT \
+  "Escape sequence \"%.*s\" is not a Unicode scalar value."
 
+#define MSG_BREAK_OUT_OF_FUNCTION "Cannot break out of a function."
+#define MSG_INVALID_ASSIGNMENT_TARGET "Cannot assign to this expression."
+#define MSG_PARAMETER_NOT_SYMBOL "Function parameters must be symbols."
+#define MSG_LOOP_VARIABLE_NOT_SYMBOL "Loop variables must be symbols."
+#define MSG_TOO_MANY_PARAMETERS "Functions cannot take more than 254 parameters."
+#define MSG_TOO_MANY_ARRAY_ITEMS "Array literals cannot have more than 65535 items."
+#define MSG_TOO_MANY_MAP_ENTRIES "Map literals cannot have more than 65535 entries."
+#define MSG_TOO_MANY_STRING_LITERALS \
+  "Programs cannot have more than 65536 distinct long string literals."
 #define MSG_TOO_MANY_CHAINED_COMPARISONS \
   "Cannot chain more than 256 comparison operators."
 #define MSG_MISSING_SEMICOLON "Missing \";\"."
 #define MSG_UNEXPECTED_EOF "Unexpected end of file."
+#define MSG_INVALID_UTF8 "String literal is not valid UTF-8."
 
 #endif
@@ -1,20 +1,445 @@
+#include <inttypes.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "builtins.h"
+#include "instrumentation.h"
+#include "kernel.h"
+#include "map.h"
 #include "thread.h"
 
 #include "error.h"
 
+Thread* volatile Thread_running = NULL;
+bool Thread_isTraced = false;
+
 void Thread_init(Thread* self, ByteCode* byteCode) {
   self->byteCode = byteCode;
   self->pcIndex = 0;
+  self->publishedPc = NULL;
   Stack_init(&(self->stack));
   self->panic = false;
+  self->frames = NULL;
+  self->frameCount = 0;
+  self->frameCapacity = 0;
+  self->objects = NULL;
+  self->bytesAllocated = 0;
+  self->nextCollection = THREAD_MIN_COLLECTION;
+  self->instructionCount = 0;
+}
+
+static void Thread_freeObject(Obj* obj) {
+  if(obj->type == OBJ_ARRAY) free(((ObjArray*)obj)->items);
+  if(obj->type == OBJ_MAP) ObjMap_free((ObjMap*)obj);
+  if(obj->type == OBJ_STRING_BUILDER) free(((ObjStringBuilder*)obj)->bytes);
+
+  free(obj);
 }
 
 void Thread_free(Thread* self) {
   Stack_free(&(self->stack));
+  free(self->frames);
+
+  while(self->objects != NULL) {
+    Obj* next = self->objects->next;
+    Thread_freeObject(self->objects);
+    self->objects = next;
+  }
+}
+
+Obj* Thread_allocate(Thread* self, ObjType type, size_t size) {
+  Obj* result = malloc(size);
+
+  // TODO Handle this
+  assert(result != NULL);
+
+  result->type = type;
+  result->isMarked = false;
+  result->next = self->objects;
+  self->objects = result;
+  self->bytesAllocated += size;
+
+  return result;
+}
+
+// The bytes of a map's slots, which live outside the ObjMap
+inline static size_t ObjMap_slotSize(ObjMap* self) {
+  if(self->capacity == 0) return 0;
+  return self->capacity * sizeof(MapEntry) + self->capacity + MAP_GROUP_SIZE;
+}
+
+ObjArray* Thread_newArray(Thread* self, size_t capacity) {
+  ObjArray* array = (ObjArray*)Thread_allocate(self, OBJ_ARRAY, sizeof(ObjArray));
+
+  array->count = 0;
+  array->capacity = 0;
+  array->items = NULL;
+  Thread_reserveItems(self, array, capacity);
+
+  return array;
+}
+
+ObjMap* Thread_newMap(Thread* self, size_t count) {
+  ObjMap* map = (ObjMap*)Thread_allocate(self, OBJ_MAP, sizeof(ObjMap));
+
+  ObjMap_init(map);
+  ObjMap_reserve(map, count);
+  self->bytesAllocated += ObjMap_slotSize(map);
+
+  return map;
+}
+
+ObjRange* Thread_newRange(Thread* self, int64_t start, int64_t stop) {
+  ObjRange* range = (ObjRange*)Thread_allocate(self, OBJ_RANGE, sizeof(ObjRange));
+
+  range->start = start;
+  range->stop = stop;
+
+  return range;
+}
+
+ObjStringBuilder* Thread_newStringBuilder(Thread* self, size_t capacity) {
+  ObjStringBuilder* stringBuilder = (ObjStringBuilder*)Thread_allocate(
+    self,
+    OBJ_STRING_BUILDER,
+    sizeof(ObjStringBuilder)
+  );
+
+  stringBuilder->count = 0;
+  stringBuilder->capacity = 0;
+  stringBuilder->bytes = NULL;
+  Thread_reserveBytes(self, stringBuilder, capacity);
+
+  return stringBuilder;
+}
+
+Blob* Thread_newBlob(Thread* self, size_t count) {
+  // The Blob follows its object's header, so freeing the object frees both
+  Obj* obj = Thread_allocate(self, OBJ_BLOB, sizeof(Obj) + sizeof(Blob) + count);
+  Blob* blob = (Blob*)(obj + 1);
+
+  blob->count = count;
+  blob->hash = 0;
+  blob->isOwned = true;
+
+  return blob;
+}
+
+Value Thread_newUTF8(Thread* self, const uint8_t* bytes, size_t count) {
+  if(count <= SMALL_UTF8_CAPACITY) return Value_fromSmallUTF8(bytes, count);
+
+  Blob* blob = Thread_newBlob(self, count);
+  memcpy(blob->bytes, bytes, count);
+  return Value_fromBlob(VALUE_UTF8, blob);
+}
+
+/*
+ * Returns the object a value refers to if the thread owns it, which only
+ * Blobs made at run time do among strings, or NULL.
+ */
+static Obj* Value_ownedObject(Value value) {
+  switch(value.type) {
+    case VALUE_BOOLEAN:
+    case VALUE_NATIVE_FN:
+    case VALUE_NATIVE:
+    case VALUE_FN:
+    case VALUE_NIL:
+    case VALUE_INTEGER:
+    case VALUE_SMALL_UTF8:
+      return NULL;
+
+    case VALUE_STACK_CLOSURE:
+      // Its Fn and upvalues are on the stack, which is marked anyway
+      return NULL;
+
+    case VALUE_CLOSURE:
+      return &(value.as.closure->obj);
+
+    case VALUE_BOX:
+      return &(value.as.box->obj);
+
+    case VALUE_BIG_INTEGER:
+      return &(value.as.bigInteger->obj);
+
+    case VALUE_UTF8:
+    case VALUE_UTF32:
+      // See Thread_newBlob()
+      return value.as.blob->isOwned ? ((Obj*)(value.as.blob)) - 1 : NULL;
+
+    case VALUE_ARRAY:
+      return &(value.as.array->obj);
+
+    case VALUE_MAP:
+      return &(value.as.map->obj);
+
+    case VALUE_RANGE:
+      return &(value.as.range->obj);
+
+    case VALUE_STRING_BUILDER:
+      return &(value.as.stringBuilder->obj);
+  }
+
+  // Should never get here
+  assert(false);
+  return NULL;
+}
+
+// The bytes an object holds, including storage outside of it
+static size_t Thread_objectSize(Obj* obj) {
+  switch(obj->type) {
+    case OBJ_BLOB:
+      return sizeof(Obj) + sizeof(Blob) + ((Blob*)(obj + 1))->count;
+
+    case OBJ_BOX:
+      return sizeof(ObjBox);
+
+    case OBJ_CLOSURE:
+      return sizeof(ObjClosure) + ((ObjClosure*)obj)->upvalueCount * sizeof(Value);
+
+    case OBJ_BIG_INTEGER:
+      return sizeof(ObjBigInteger) + ((ObjBigInteger*)obj)->count * sizeof(uint32_t);
+
+    case OBJ_ARRAY:
+      return sizeof(ObjArray) + ((ObjArray*)obj)->capacity * sizeof(Value);
+
+    case OBJ_MAP:
+      return sizeof(ObjMap) + ObjMap_slotSize((ObjMap*)obj);
+
+    case OBJ_RANGE:
+      return sizeof(ObjRange);
+
+    case OBJ_STRING_BUILDER:
+      return sizeof(ObjStringBuilder) + ((ObjStringBuilder*)obj)->capacity;
+
+    default:
+      // Threads don't allocate the other types
+      assert(false);
+      return 0;
+  }
+}
+
+/*
+ * The objects which Thread_collect() has marked but whose contents it
+ * hasn't marked yet. Working through a list rather than recursing keeps
+ * deeply nested arrays from overflowing the C stack.
+ */
+typedef struct {
+  Obj** items;
+  size_t count;
+  size_t capacity;
+} GrayList;
+
+static void GrayList_mark(GrayList* self, Value value) {
+  Obj* obj = Value_ownedObject(value);
+
+  if(obj == NULL || obj->isMarked) return;
+
+  obj->isMarked = true;
+
+  // Nothing else is reached through these
+  if(obj->type != OBJ_BOX && obj->type != OBJ_CLOSURE && obj->type != OBJ_ARRAY && obj->type != OBJ_MAP) {
+    return;
+  }
+
+  if(self->count == self->capacity) {
+    self->capacity = self->capacity == 0 ? 64 : self->capacity * 2;
+    self->items = realloc(self->items, self->capacity * sizeof(Obj*));
+
+    // TODO Handle this
+    assert(self->items != NULL);
+  }
+
+  self->items[self->count++] = obj;
+}
+
+static void GrayList_markContents(GrayList* self, Obj* obj) {
+  switch(obj->type) {
+    case OBJ_BOX:
+      GrayList_mark(self, ((ObjBox*)obj)->value);
+      break;
+
+    case OBJ_CLOSURE:
+      {
+        ObjClosure* closure = (ObjClosure*)obj;
+
+        for(uint8_t i = 0; i < closure->upvalueCount; i++) {
+          GrayList_mark(self, closure->upvalues[i]);
+        }
+      }
+      break;
+
+    case OBJ_ARRAY:
+      {
+        ObjArray* array = (ObjArray*)obj;
+
+        for(size_t i = 0; i < array->count; i++) {
+          GrayList_mark(self, array->items[i]);
+        }
+      }
+      break;
+
+    case OBJ_MAP:
+      {
+        ObjMap* map = (ObjMap*)obj;
+
+        for(size_t i = 0; i < map->capacity; i++) {
+          if(map->control[i] == MAP_EMPTY) continue;
+
+          GrayList_mark(self, map->entries[i].key);
+          GrayList_mark(self, map->entries[i].value);
+        }
+      }
+      break;
+
+    default:
+      // GrayList_mark() only adds objects which reach others
+      assert(false);
+  }
+}
+
+void Thread_collect(Thread* self) {
+  GrayList gray;
+  gray.items = NULL;
+  gray.count = 0;
+  gray.capacity = 0;
+
+  // Globals and the locals of every frame are all on the stack
+  Stack* stack = &(self->stack);
+
+  for(Value* item = stack->items; item <= stack->top; item++) {
+    GrayList_mark(&gray, *item);
+  }
+
+  while(gray.count > 0) {
+    GrayList_markContents(&gray, gray.items[--gray.count]);
+  }
+
+  free(gray.items);
+
+  // Unmarked objects are freed, and marked ones are unmarked for next time
+  Obj** link = &(self->objects);
+  size_t liveBytes = 0;
+
+  while(*link != NULL) {
+    Obj* obj = *link;
+
+    if(obj->isMarked) {
+      obj->isMarked = false;
+      liveBytes += Thread_objectSize(obj);
+      link = &(obj->next);
+    } else {
+      *link = obj->next;
+      Thread_freeObject(obj);
+    }
+  }
+
+  /*
+   * Collecting again once the heap has doubled keeps the time spent
+   * collecting proportional to the time spent allocating.
+   */
+  self->bytesAllocated = liveBytes;
+  self->nextCollection = liveBytes * 2;
+  if(self->nextCollection < THREAD_MIN_COLLECTION) self->nextCollection = THREAD_MIN_COLLECTION;
+}
+
+int16_t Thread_findBuiltin(NativeFn fn) {
+  for(int16_t i = 0; i < BUILTINS_COUNT; i++) {
+    if(Value_asNativeFn(BUILTINS[i].value) == fn) return i;
+  }
+
+  return -1;
+}
+
+Value Thread_builtin(int16_t index) {
+  assert(index >= 0 && index < BUILTINS_COUNT);
+  return BUILTINS[index].value;
+}
+
+Value Thread_panic(const char* fmt, ...) {
+  // Builtins are only called from inside Thread_run()
+  assert(Thread_running != NULL);
+
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(Thread_running->panicMessage, THREAD_MAX_PANIC_MESSAGE, fmt, args);
+  va_end(args);
+
+  Thread_running->panic = true;
+  return NIL;
+}
+
+/*
+ * Returns false if the frame would exceed THREAD_MAX_FRAME_COUNT.
+ */
+static bool Thread_pushFrame(Thread* self, size_t returnIndex, size_t base) {
+  if(self->frameCount == self->frameCapacity) {
+    if(self->frameCapacity == THREAD_MAX_FRAME_COUNT) return false;
+
+    if(self->frameCapacity == 0) {
+      self->frameCapacity = 8;
+    } else {
+      self->frameCapacity *= 2;
+    }
+
+    /*
+     * The profiler's signal handler walks the frames, so rather than
+     * realloc(), the copy is finished before it replaces the old frames,
+     * and those are only freed after.
+     */
+    Frame* frames = malloc(sizeof(Frame) * self->frameCapacity);
+
+    // TODO Handle this
+    assert(frames != NULL);
+
+    Frame* oldFrames = self->frames;
+    if(self->frameCount > 0) memcpy(frames, oldFrames, sizeof(Frame) * self->frameCount);
+    self->frames = frames;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    free(oldFrames);
+  }
+
+  Frame frame;
+  frame.returnIndex = returnIndex;
+  frame.base = base;
+
+  // Likewise, the frame is written before the handler can see it
+  self->frames[self->frameCount] = frame;
+  __atomic_signal_fence(__ATOMIC_SEQ_CST);
+  self->frameCount++;
+  return true;
+}
+
+inline static size_t Thread_base(Thread* self) {
+  return self->frameCount == 0 ? 0 : self->frames[self->frameCount - 1].base;
+}
+
+/*
+ * Returns an upvalue of the function running in the frame at base, which is
+ * in slot 0 and is either a heap or a stack closure.
+ */
+inline static Value Thread_upvalue(Stack* stack, size_t base, uint16_t index) {
+  Value function = stack->items[base];
+
+  if(function.type == VALUE_STACK_CLOSURE) {
+    return stack->items[Value_asStackClosure(function) + 1 + index];
+  }
+
+  return Value_asClosure(function)->upvalues[index];
+}
+
+// Returns the Fn to run for a VALUE_FN, VALUE_CLOSURE or VALUE_STACK_CLOSURE
+inline static Fn* Thread_callee(Stack* stack, Value function) {
+  switch(function.type) {
+    case VALUE_FN:
+      return Value_asFn(function);
+
+    case VALUE_CLOSURE:
+      return Value_asClosure(function)->fn;
+
+    default:
+      return Value_asFn(stack->items[Value_asStackClosure(function)]);
+  }
 }
 
 static const char* Instruction_toOperatorCString(uint8_t* pc) {
@@ -25,19 +450,45 @@ static const char* Instruction_toOperatorCString(uint8_t* pc) {
     case OP_TRUE:
     case OP_FALSE:
     case OP_BUILTIN:
+    case OP_NATIVE:
+    case OP_FUNCTION:
+    case OP_CLOSURE:
+    case OP_STACK_CLOSURE:
     case OP_INTEGER:
+    case OP_INTEGER64:
     case OP_UTF8:
+    case OP_SMALL_UTF8:
     case OP_UTF32:
     case OP_GET:
+    case OP_GET_GLOBAL:
+    case OP_GET_BOXED:
+    case OP_GET_UPVALUE:
+    case OP_GET_UPVALUE_BOXED:
+    case OP_GET_STACK_UPVALUE:
+    case OP_GET_STACK_UPVALUE_BOXED:
+    case OP_GET_STACK_UPVALUE_REF:
+    case OP_BOX:
+    case OP_ARRAY:
+    case OP_MAP:
+    case OP_GET_INDEX:
+    case OP_SET_INDEX:
+    case OP_COLLECT:
+    case OP_RESERVE_RANGE:
     case OP_DUP:
     case OP_DROP:
     case OP_ROT3:
     case OP_JUMP:
     case OP_JUMP_TRUE:
     case OP_JUMP_FALSE:
+    case OP_FOR_RANGE:
+    case OP_FOR_NEXT:
+    case OP_FOR_ELEMENTWISE:
     case OP_SCOPE_OPEN:
     case OP_SCOPE_CLOSE:
     case OP_CALL:
+    case OP_TAIL_CALL:
+    case OP_CALL_BUILTIN:
+    case OP_CALL_NATIVE:
     case OP_RETURN:
       assert(false);
 
@@ -78,6 +529,11 @@ static const char* Instruction_toOperatorCString(uint8_t* pc) {
       return "!=";
 
     case OP_SET:
+    case OP_SET_GLOBAL:
+    case OP_SET_BOXED:
+    case OP_SET_UPVALUE_BOXED:
+    case OP_SET_STACK_UPVALUE_BOXED:
+    case OP_SET_STACK_UPVALUE_REF:
       return "=";
   }
 
@@ -92,16 +548,42 @@ const char* ValueType_toCString(ValueType type) {
       return "Boolean";
 
     case VALUE_NATIVE_FN:
+    case VALUE_NATIVE:
       return "NativeFn";
 
+    case VALUE_FN:
+    case VALUE_CLOSURE:
+    case VALUE_STACK_CLOSURE:
+      return "Function";
+
+    case VALUE_BOX:
+      return "Box";
+
     case VALUE_NIL:
       return "Void";
 
     case VALUE_INTEGER:
+    case VALUE_BIG_INTEGER:
       return "Integer";
 
     case VALUE_UTF8:
+    case VALUE_SMALL_UTF8:
       return "UTF8";
+
+    case VALUE_UTF32:
+      return "UTF32";
+
+    case VALUE_ARRAY:
+      return "Array";
+
+    case VALUE_MAP:
+      return "Map";
+
+    case VALUE_RANGE:
+      return "Range";
+
+    case VALUE_STRING_BUILDER:
+      return "StringBuilder";
   }
 
   // Should never get here
@@ -109,7 +591,326 @@ const char* ValueType_toCString(ValueType type) {
   return ""; // silence warnings
 }
 
-Value Thread_run(Thread* self) {
+Value Thread_normalizeBigInteger(Thread* self, ObjBigInteger* result) {
+  int64_t i;
+
+  if(BigInteger_toInteger(result, &i)) {
+    BigInteger_del(result);
+    return Value_fromInteger(i);
+  }
+
+  result->obj.isMarked = false;
+  result->obj.next = self->objects;
+  self->objects = (Obj*)result;
+  self->bytesAllocated += sizeof(ObjBigInteger) + result->count * sizeof(uint32_t);
+
+  return Value_fromBigInteger(result);
+}
+
+inline static ObjBigInteger* Value_toBigInteger(Value v) {
+  if(v.type == VALUE_BIG_INTEGER) return Value_asBigInteger(v);
+  return BigInteger_fromInteger(Value_asInteger(v));
+}
+
+inline static void Value_freeBigInteger(Value v, ObjBigInteger* converted) {
+  // Only integers converted by Value_toBigInteger() are temporary
+  if(v.type == VALUE_INTEGER) BigInteger_del(converted);
+}
+
+/*
+ * The slow path for integer arithmetic, taken when an operand is already a
+ * big integer or the int64_t fast path overflowed. Kept out of line so that
+ * it doesn't bloat Thread_run(). Division by zero must already be checked.
+ */
+__attribute__((noinline))
+static Value Thread_bigIntegerArithmetic(Thread* self, Instruction instruction, Value operand0, Value operand1) {
+  ObjBigInteger* a = Value_toBigInteger(operand0);
+  ObjBigInteger* b = Value_toBigInteger(operand1);
+  ObjBigInteger* result;
+
+  switch(instruction) {
+    case OP_ADD:
+      result = BigInteger_add(a, b);
+      break;
+
+    case OP_SUBTRACT:
+      result = BigInteger_subtract(a, b);
+      break;
+
+    case OP_MULTIPLY:
+      result = BigInteger_multiply(a, b);
+      break;
+
+    case OP_IDIVIDE:
+      result = BigInteger_divide(a, b);
+      break;
+
+    default:
+      assert(false);
+      result = NULL; // Silence warnings
+  }
+
+  Value_freeBigInteger(operand1, b);
+  Value_freeBigInteger(operand0, a);
+
+  return Thread_normalizeBigInteger(self, result);
+}
+
+// Returns a negative number, 0 or a positive number, like strcmp()
+__attribute__((noinline))
+static int Thread_compareBigIntegers(Value operand0, Value operand1) {
+  ObjBigInteger* a = Value_toBigInteger(operand0);
+  ObjBigInteger* b = Value_toBigInteger(operand1);
+
+  int result = BigInteger_compare(a, b);
+
+  Value_freeBigInteger(operand1, b);
+  Value_freeBigInteger(operand0, a);
+
+  return result;
+}
+
+// Whether both operands are strings of the same encoding, small or not
+inline static bool Thread_areStrings(Value operand0, Value operand1) {
+  if(Value_isUTF8(operand0)) return Value_isUTF8(operand1);
+  return operand0.type == VALUE_UTF32 && operand1.type == VALUE_UTF32;
+}
+
+/*
+ * Orders two strings of the same encoding by code point. Comparing bytes
+ * does that for UTF-8, but not for little endian code points.
+ */
+static int Thread_compareStrings(Value operand0, Value operand1) {
+  if(Value_isUTF8(operand0)) {
+    return Bytes_compare(
+      Value_utf8Bytes(&operand0),
+      Value_utf8Count(&operand0),
+      Value_utf8Bytes(&operand1),
+      Value_utf8Count(&operand1)
+    );
+  }
+
+  return UTF32_compare(
+    Value_asCodePoints(operand0),
+    Value_codePointCount(operand0),
+    Value_asCodePoints(operand1),
+    Value_codePointCount(operand1)
+  );
+}
+
+/*
+ * Joins two strings of the same encoding into a new one. UTF-8 results
+ * short enough to be small are built in place, without allocating.
+ */
+__attribute__((noinline))
+static Value Thread_concatenate(Thread* self, Value operand0, Value operand1) {
+  if(Value_isUTF8(operand0)) {
+    size_t count0 = Value_utf8Count(&operand0);
+    size_t count1 = Value_utf8Count(&operand1);
+
+    if(count0 + count1 <= SMALL_UTF8_CAPACITY) {
+      uint8_t bytes[SMALL_UTF8_CAPACITY];
+      memcpy(bytes, Value_utf8Bytes(&operand0), count0);
+      memcpy(bytes + count0, Value_utf8Bytes(&operand1), count1);
+      return Value_fromSmallUTF8(bytes, count0 + count1);
+    }
+
+    Blob* blob = Thread_newBlob(self, count0 + count1);
+    memcpy(blob->bytes, Value_utf8Bytes(&operand0), count0);
+    memcpy(blob->bytes + count0, Value_utf8Bytes(&operand1), count1);
+    return Value_fromBlob(VALUE_UTF8, blob);
+  }
+
+  Blob* a = Value_asBlob(operand0);
+  Blob* b = Value_asBlob(operand1);
+  Blob* blob = Thread_newBlob(self, a->count + b->count);
+
+  memcpy(blob->bytes, a->bytes, a->count);
+  memcpy(blob->bytes + a->count, b->bytes, b->count);
+  return Value_fromBlob(VALUE_UTF32, blob);
+}
+
+inline static bool Instruction_isComparison(Instruction op) {
+  return op == OP_LESS_THAN || op == OP_LESS_THAN_EQUAL
+    || op == OP_GREATER_THAN || op == OP_GREATER_THAN_EQUAL;
+}
+
+// Applies a comparison to an order like Thread_compareStrings() returns
+inline static bool Instruction_holds(Instruction op, int order) {
+  switch(op) {
+    case OP_LESS_THAN:
+      return order < 0;
+
+    case OP_LESS_THAN_EQUAL:
+      return order <= 0;
+
+    case OP_GREATER_THAN:
+      return order > 0;
+
+    case OP_GREATER_THAN_EQUAL:
+      return order >= 0;
+
+    default:
+      assert(false);
+      return false;
+  }
+}
+
+/*
+ * An item of an elementwise operation which the kernels didn't finish,
+ * done as the operator does it on scalars. Returns false after printing
+ * an error.
+ */
+static bool Thread_elementwiseItem(
+    Thread* self,
+    uint8_t* op,
+    size_t line,
+    Value operand0,
+    Value operand1,
+    Value* result) {
+  Instruction instruction = (Instruction)(*op);
+
+  if(Thread_areStrings(operand0, operand1)) {
+    if(instruction == OP_ADD) {
+      *result = Thread_concatenate(self, operand0, operand1);
+      return true;
+    }
+
+    if(Instruction_isComparison(instruction)) {
+      *result = Value_fromBoolean(
+        Instruction_holds(instruction, Thread_compareStrings(operand0, operand1))
+      );
+      return true;
+    }
+  }
+
+  if(!Value_isInteger(operand0) || !Value_isInteger(operand1)) {
+    printError(
+      line,
+      "Cannot apply infix operator `%s` to values of type `%s` and `%s`.",
+      Instruction_toOperatorCString(op),
+      ValueType_toCString(operand0.type),
+      ValueType_toCString(operand1.type)
+    );
+    return false;
+  }
+
+  if(Instruction_isComparison(instruction)) {
+    *result = Value_fromBoolean(
+      Instruction_holds(instruction, Thread_compareBigIntegers(operand0, operand1))
+    );
+    return true;
+  }
+
+  // Big integers are never 0
+  if(instruction == OP_IDIVIDE && operand1.type == VALUE_INTEGER && Value_asInteger(operand1) == 0) {
+    printError(line, "Division by 0.");
+    return false;
+  }
+
+  *result = Thread_bigIntegerArithmetic(self, instruction, operand0, operand1);
+  return true;
+}
+
+/*
+ * The slow path of an arithmetic or comparison operator with an array
+ * operand, which applies the operator to each item and a scalar, or to the
+ * items of two arrays of the same length, giving a new array. The kernels
+ * do every item they can. op points at the operator's instruction, or at
+ * the operand of OP_FOR_ELEMENTWISE naming it. Returns false after printing
+ * an error.
+ */
+__attribute__((noinline))
+static bool Thread_elementwise(
+    Thread* self,
+    uint8_t* op,
+    size_t line,
+    Value operand0,
+    Value operand1,
+    Value* result) {
+  Instruction instruction = (Instruction)(*op);
+  const Value* left = &operand0;
+  const Value* right = &operand1;
+  size_t leftStride = 0;
+  size_t rightStride = 0;
+  size_t count = 0;
+
+  if(operand0.type == VALUE_ARRAY) {
+    left = Value_asArray(operand0)->items;
+    leftStride = 1;
+    count = Value_asArray(operand0)->count;
+  }
+
+  if(operand1.type == VALUE_ARRAY) {
+    if(operand0.type == VALUE_ARRAY && Value_asArray(operand1)->count != count) {
+      printError(
+        line,
+        "Cannot apply infix operator `%s` to arrays of lengths %zu and %zu.",
+        Instruction_toOperatorCString(op),
+        count,
+        Value_asArray(operand1)->count
+      );
+      return false;
+    }
+
+    right = Value_asArray(operand1)->items;
+    rightStride = 1;
+    count = Value_asArray(operand1)->count;
+  }
+
+  ObjArray* array = Thread_newArray(self, count);
+  size_t i = 0;
+
+  for(;;) {
+    if(Instruction_isComparison(instruction)) {
+      i += Kernel_compare(
+        instruction,
+        array->items + i,
+        left + i * leftStride,
+        leftStride,
+        right + i * rightStride,
+        rightStride,
+        count - i
+      );
+    } else {
+      i += Kernel_arithmetic(
+        instruction,
+        array->items + i,
+        left + i * leftStride,
+        leftStride,
+        right + i * rightStride,
+        rightStride,
+        count - i
+      );
+    }
+
+    if(i == count) break;
+
+    bool isDone = Thread_elementwiseItem(
+      self,
+      op,
+      line,
+      left[i * leftStride],
+      right[i * rightStride],
+      array->items + i
+    );
+
+    if(!isDone) return false;
+    i++;
+  }
+
+  array->count = count;
+  *result = Value_fromArray(array);
+  return true;
+}
+
+/*
+ * The body of Thread_run(). It's always inlined into the two functions
+ * below, and isTraced is a constant in each, so the untraced copy of the
+ * dispatch loop compiles without any of the tracing.
+ */
+__attribute__((always_inline))
+inline static Value Thread_dispatch(Thread* self, const bool isTraced) {
   Stack* stack = &(self->stack);
 
   /*
@@ -123,11 +924,37 @@ Value Thread_run(Thread* self) {
    */
   register uint8_t* pc = ByteCode_pc(self->byteCode, self->pcIndex);
 
+  /*
+   * The stack index of the current frame, which OP_GET and OP_SET are
+   * relative to. Kept in a local for the same reason as pc.
+   */
+  size_t base = Thread_base(self);
+
+  if(isTraced) self->publishedPc = pc;
+  Thread_running = self;
+
+#ifdef INSTRUMENT
+  uint16_t previousInstruction = INSTRUMENTATION_NO_INSTRUCTION;
+#endif
+
   #define THREAD_ERROR(...) \
     printError(__VA_ARGS__); \
     self->panic = true; \
+    Thread_running = NULL; \
     return NIL
 
+  /*
+   * A builtin can't report an error itself, since it doesn't know the line
+   * it was called from, so it leaves its message with Thread_panic().
+   */
+  #define CHECK_BUILTIN_PANIC(instructionPc) \
+    if(self->panic) { \
+      THREAD_ERROR( \
+        ByteCode_getLine(self->byteCode, instructionPc), \
+        "%s", \
+        self->panicMessage \
+      ); \
+    }
   #define CHECK_UNARY_TYPE(tt) \
     if(operand.type != tt) { \
       THREAD_ERROR( \
@@ -147,6 +974,16 @@ Value Thread_run(Thread* self) {
         ValueType_toCString(operand1.type) \
       ); \
     }
+  #define CHECK_INTEGER_TYPES() \
+    if(!Value_isInteger(operand0) || !Value_isInteger(operand1)) { \
+      THREAD_ERROR( \
+        ByteCode_getLine(self->byteCode, pc - 1), \
+        "Cannot apply infix operator `%s` to values of type `%s` and `%s`.", \
+        Instruction_toOperatorCString(pc - 1), \
+        ValueType_toCString(operand0.type), \
+        ValueType_toCString(operand1.type) \
+      ); \
+    }
   #define CHECK_SAME_TYPE() \
     if(operand0.type != operand1.type) { \
       THREAD_ERROR( \
@@ -157,11 +994,68 @@ Value Thread_run(Thread* self) {
         ValueType_toCString(operand1.type) \
       ); \
     }
-
-  for(;;) {
-    Instruction instruction = *pc;
+  /*
+   * Checks an array subscript, once maps have been handled. A negative
+   * index converts to a uint64_t larger than any count, so one comparison
+   * covers both bounds.
+   */
+  #define CHECK_INDEX(array, index) \
+    if(array.type != VALUE_ARRAY) { \
+      THREAD_ERROR( \
+        ByteCode_getLine(self->byteCode, pc - 1), \
+        "Cannot subscript a value of type `%s`.", \
+        ValueType_toCString(array.type) \
+      ); \
+    } \
+    if(index.type != VALUE_INTEGER) { \
+      THREAD_ERROR( \
+        ByteCode_getLine(self->byteCode, pc - 1), \
+        "Array index must be an `Integer`, not `%s`.", \
+        ValueType_toCString(index.type) \
+      ); \
+    } \
+    if((uint64_t)Value_asInteger(index) >= Value_asArray(array)->count) { \
+      THREAD_ERROR( \
+        ByteCode_getLine(self->byteCode, pc - 1), \
+        "Index %" PRId64 " is out of bounds for an array of length %zu.", \
+        Value_asInteger(index), \
+        Value_asArray(array)->count \
+      ); \
+    }
+
+  // Must come before any type checks, since it handles operands they reject
+  #define ELEMENTWISE() \
+    if(operand0.type == VALUE_ARRAY || operand1.type == VALUE_ARRAY) { \
+      Value elements; \
+      if(!Thread_elementwise( \
+          self, \
+          pc - 1, \
+          ByteCode_getLine(self->byteCode, pc - 1), \
+          operand0, \
+          operand1, \
+          &elements)) { \
+        self->panic = true; \
+        Thread_running = NULL; \
+        return NIL; \
+      } \
+      Stack_push(stack, elements); \
+      break; \
+    }
+
+  for(;;) {
+    if(isTraced) {
+      self->publishedPc = pc;
+      self->instructionCount++;
+    }
+
+    Instruction instruction = *pc;
     pc++;
 
+#ifdef INSTRUMENT
+    Instrumentation_recordInstruction(previousInstruction, instruction);
+    previousInstruction = instruction;
+#endif
+
     switch(instruction) {
       case OP_NIL:
         Stack_push(stack, NIL);
@@ -180,37 +1074,167 @@ Value Thread_run(Thread* self) {
         pc++;
         break;
 
+      case OP_NATIVE:
+        Stack_push(stack, Value_fromNative(self->byteCode->natives.items[*(pc)]));
+        pc++;
+        break;
+
+      case OP_FUNCTION:
+        {
+          uint16_t functionIndex = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          assert(functionIndex < self->byteCode->functions.count);
+
+          Stack_push(
+            stack,
+            Value_fromFn(self->byteCode->functions.items[functionIndex])
+          );
+        }
+        break;
+
       case OP_INTEGER:
         Stack_push(stack, Value_fromInteger(*((int32_t*)pc)));
         pc += sizeof(int32_t);
         break;
 
+      case OP_INTEGER64:
+        Stack_push(stack, Value_fromInteger(*((int64_t*)pc)));
+        pc += sizeof(int64_t);
+        break;
+
       case OP_UTF8:
+      case OP_UTF32:
         {
-          uint8_t blobIndex = *((uint8_t*)pc);
-          pc += sizeof(uint8_t);
+          uint16_t blobIndex = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
           assert(blobIndex < self->byteCode->blobs.count);
           assert(blobIndex < self->byteCode->blobs.capacity);
 
           Stack_push(
             stack,
-            Value_fromBlob(VALUE_UTF8, self->byteCode->blobs.items[blobIndex])
+            Value_fromBlob(
+              instruction == OP_UTF8 ? VALUE_UTF8 : VALUE_UTF32,
+              self->byteCode->blobs.items[blobIndex]
+            )
           );
         }
         break;
 
-      case OP_UTF32:
-        assert(false);
+      case OP_SMALL_UTF8:
+        {
+          // The operand is the string's smallUTF8, unused bytes and all
+          Value value;
+          value.type = VALUE_SMALL_UTF8;
+          memcpy(&(value.as.smallUTF8), pc, sizeof(uint64_t));
+          pc += sizeof(uint64_t);
+
+          Stack_push(stack, value);
+        }
+        break;
+
+      case OP_CLOSURE:
+        {
+          uint16_t functionIndex = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          uint8_t upvalueCount = *(pc++);
+          assert(functionIndex < self->byteCode->functions.count);
+
+          ObjClosure* closure = (ObjClosure*)Thread_allocate(
+            self,
+            OBJ_CLOSURE,
+            sizeof(ObjClosure) + sizeof(Value) * upvalueCount
+          );
+          closure->fn = self->byteCode->functions.items[functionIndex];
+          closure->upvalueCount = upvalueCount;
+
+          /*
+           * Each upvalue is copied either from a slot of the current frame
+           * or from the upvalues of the current function, which is in slot 0.
+           * The compiler boxes every mutable variable a heap closure
+           * captures, so there are no slot references to copy here.
+           */
+          for(uint8_t i = 0; i < upvalueCount; i++) {
+            Capture capture = *(pc++);
+            uint16_t index = *((uint16_t*)pc);
+            pc += sizeof(uint16_t);
+
+            assert(capture != CAPTURE_LOCAL_REF);
+
+            if(capture == CAPTURE_LOCAL) {
+              closure->upvalues[i] = stack->items[base + index];
+            } else {
+              closure->upvalues[i] = Thread_upvalue(stack, base, index);
+            }
+          }
+
+          Stack_push(stack, Value_fromClosure(closure));
+        }
+        break;
+
+      case OP_STACK_CLOSURE:
+        {
+          uint16_t functionIndex = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          uint8_t upvalueCount = *(pc++);
+          assert(functionIndex < self->byteCode->functions.count);
+
+          /*
+           * The Fn and upvalues go in the hidden slots the compiler reserved
+           * below the variable being declared, and the value pushed last
+           * points back at them.
+           */
+          size_t slot = Stack_count(stack);
+          Stack_push(stack, Value_fromFn(self->byteCode->functions.items[functionIndex]));
+
+          for(uint8_t i = 0; i < upvalueCount; i++) {
+            Capture capture = *(pc++);
+            uint16_t index = *((uint16_t*)pc);
+            pc += sizeof(uint16_t);
+
+            switch(capture) {
+              case CAPTURE_UPVALUE:
+                Stack_push(stack, Thread_upvalue(stack, base, index));
+                break;
+
+              case CAPTURE_LOCAL:
+                Stack_pushIndex(stack, base + index);
+                break;
+
+              case CAPTURE_LOCAL_REF:
+                Stack_push(stack, Value_fromInteger(base + index));
+                break;
+            }
+          }
+
+          Stack_push(stack, Value_fromStackClosure(slot));
+        }
+        break;
 
       case OP_GET:
         {
           uint16_t index = *((uint16_t*)pc);
           pc += sizeof(uint16_t);
-          Stack_pushIndex(stack, index);
+          Stack_pushIndex(stack, base + index);
           break;
         }
 
       case OP_SET:
+        {
+          uint16_t index = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          Stack_popToIndex(stack, base + index);
+          break;
+        }
+
+      case OP_GET_GLOBAL:
+        {
+          uint16_t index = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          Stack_pushIndex(stack, index);
+          break;
+        }
+
+      case OP_SET_GLOBAL:
         {
           uint16_t index = *((uint16_t*)pc);
           pc += sizeof(uint16_t);
@@ -218,11 +1242,225 @@ Value Thread_run(Thread* self) {
           break;
         }
 
+      case OP_GET_BOXED:
+        {
+          uint16_t index = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          Stack_push(stack, Value_asBox(stack->items[base + index])->value);
+          break;
+        }
+
+      case OP_SET_BOXED:
+        {
+          uint16_t index = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+          Value_asBox(stack->items[base + index])->value = Stack_pop(stack);
+          break;
+        }
+
+      case OP_GET_UPVALUE:
+        {
+          uint8_t index = *(pc++);
+          Stack_push(stack, Value_asClosure(stack->items[base])->upvalues[index]);
+          break;
+        }
+
+      case OP_GET_UPVALUE_BOXED:
+        {
+          uint8_t index = *(pc++);
+          Value box = Value_asClosure(stack->items[base])->upvalues[index];
+          Stack_push(stack, Value_asBox(box)->value);
+          break;
+        }
+
+      case OP_SET_UPVALUE_BOXED:
+        {
+          uint8_t index = *(pc++);
+          Value box = Value_asClosure(stack->items[base])->upvalues[index];
+          Value_asBox(box)->value = Stack_pop(stack);
+          break;
+        }
+
+      case OP_GET_STACK_UPVALUE:
+        {
+          uint8_t index = *(pc++);
+          size_t slot = Value_asStackClosure(stack->items[base]);
+          Stack_pushIndex(stack, slot + 1 + index);
+          break;
+        }
+
+      case OP_GET_STACK_UPVALUE_BOXED:
+        {
+          uint8_t index = *(pc++);
+          size_t slot = Value_asStackClosure(stack->items[base]);
+          Stack_push(stack, Value_asBox(stack->items[slot + 1 + index])->value);
+          break;
+        }
+
+      case OP_SET_STACK_UPVALUE_BOXED:
+        {
+          uint8_t index = *(pc++);
+          size_t slot = Value_asStackClosure(stack->items[base]);
+          Value_asBox(stack->items[slot + 1 + index])->value = Stack_pop(stack);
+          break;
+        }
+
+      case OP_GET_STACK_UPVALUE_REF:
+        {
+          uint8_t index = *(pc++);
+          size_t slot = Value_asStackClosure(stack->items[base]);
+          Stack_pushIndex(stack, Value_asInteger(stack->items[slot + 1 + index]));
+          break;
+        }
+
+      case OP_SET_STACK_UPVALUE_REF:
+        {
+          uint8_t index = *(pc++);
+          size_t slot = Value_asStackClosure(stack->items[base]);
+          Stack_popToIndex(stack, Value_asInteger(stack->items[slot + 1 + index]));
+          break;
+        }
+
+      case OP_BOX:
+        {
+          ObjBox* box = (ObjBox*)Thread_allocate(self, OBJ_BOX, sizeof(ObjBox));
+          box->value = Stack_pop(stack);
+          Stack_push(stack, Value_fromBox(box));
+          break;
+        }
+
+      case OP_ARRAY:
+        {
+          uint16_t count = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+
+          // The items are already on the stack in order, so copy them at once
+          ObjArray* array = Thread_newArray(self, count);
+
+          if(count > 0) {
+            memcpy(array->items, Stack_window(stack, count), count * sizeof(Value));
+            array->count = count;
+          }
+
+          Stack_drop(stack, count);
+          Stack_push(stack, Value_fromArray(array));
+          break;
+        }
+
+      case OP_MAP:
+        {
+          uint16_t count = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+
+          // Keys and values alternate on the stack, and later keys win
+          ObjMap* map = Thread_newMap(self, count);
+          Value* entries = Stack_window(stack, 2 * count);
+
+          for(size_t i = 0; i < count; i++) {
+            ObjMap_set(map, entries[2 * i], entries[2 * i + 1]);
+          }
+
+          Stack_drop(stack, 2 * count);
+          Stack_push(stack, Value_fromMap(map));
+          break;
+        }
+
+      case OP_GET_INDEX:
+        {
+          Value index = Stack_pop(stack);
+          Value array = Stack_pop(stack);
+
+          if(array.type == VALUE_MAP) {
+            Value item;
+
+            if(!ObjMap_get(Value_asMap(array), index, &item)) {
+              THREAD_ERROR(
+                ByteCode_getLine(self->byteCode, pc - 1),
+                "Key is not in the map."
+              );
+            }
+
+            Stack_push(stack, item);
+            break;
+          }
+
+          CHECK_INDEX(array, index);
+
+          Stack_push(stack, Value_asArray(array)->items[Value_asInteger(index)]);
+          break;
+        }
+
+      case OP_SET_INDEX:
+        {
+          Value item = Stack_pop(stack);
+          Value index = Stack_pop(stack);
+          Value array = Stack_pop(stack);
+
+          if(array.type == VALUE_MAP) {
+            ObjMap* map = Value_asMap(array);
+            size_t slotSize = ObjMap_slotSize(map);
+
+            ObjMap_set(map, index, item);
+            self->bytesAllocated += ObjMap_slotSize(map) - slotSize;
+            break;
+          }
+
+          CHECK_INDEX(array, index);
+
+          Value_asArray(array)->items[Value_asInteger(index)] = item;
+          break;
+        }
+
+      case OP_COLLECT:
+        {
+          // Appends a for loop body's value to the array the loop returns
+          uint16_t index = *((uint16_t*)pc);
+          pc += sizeof(uint16_t);
+
+          Value item = Stack_pop(stack);
+          Thread_appendItem(self, Value_asArray(*Stack_slots(stack, base + index, 1)), item);
+          break;
+        }
+
+      case OP_RESERVE_RANGE:
+        {
+          /*
+           * Sizes the array a for loop over range() collects into, which is
+           * in the slot below the range's bounds, so that OP_COLLECT doesn't
+           * have to grow it.
+           */
+          Value* slots = Stack_slots(stack, base + *((uint16_t*)pc), 3);
+          pc += sizeof(uint16_t);
+
+          // OP_FOR_RANGE reports bounds which aren't integers
+          if(
+            slots[1].type == VALUE_INTEGER && slots[2].type == VALUE_INTEGER &&
+            slots[1].as.integer < slots[2].as.integer
+          ) {
+            uint64_t count = (uint64_t)(slots[2].as.integer) - (uint64_t)(slots[1].as.integer);
+            if(count > THREAD_MAX_RESERVED_ITEMS) count = THREAD_MAX_RESERVED_ITEMS;
+
+            Thread_reserveItems(self, Value_asArray(slots[0]), count);
+          }
+          break;
+        }
+
       case OP_NEGATE:
         {
           Value operand = Stack_pop(stack);
-          CHECK_UNARY_TYPE(VALUE_INTEGER);
-          Stack_push(stack, Value_fromInteger(-Value_asInteger(operand)));
+
+          if(operand.type == VALUE_INTEGER && Value_asInteger(operand) != INT64_MIN) {
+            Stack_push(stack, Value_fromInteger(-Value_asInteger(operand)));
+          } else {
+            if(operand.type != VALUE_BIG_INTEGER) {
+              CHECK_UNARY_TYPE(VALUE_INTEGER);
+            }
+
+            Stack_push(
+              stack,
+              Thread_bigIntegerArithmetic(self, OP_SUBTRACT, Value_fromInteger(0), operand)
+            );
+          }
         }
         break;
 
@@ -238,13 +1476,20 @@ Value Thread_run(Thread* self) {
         {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
-
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromInteger(Value_asInteger(operand0) + Value_asInteger(operand1))
-          );
+          int64_t result;
+
+          if(
+            operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER &&
+            !__builtin_add_overflow(Value_asInteger(operand0), Value_asInteger(operand1), &result)
+          ) {
+            Stack_push(stack, Value_fromInteger(result));
+          } else if(Thread_areStrings(operand0, operand1)) {
+            Stack_push(stack, Thread_concatenate(self, operand0, operand1));
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(stack, Thread_bigIntegerArithmetic(self, OP_ADD, operand0, operand1));
+          }
         }
         break;
 
@@ -252,13 +1497,18 @@ Value Thread_run(Thread* self) {
         {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
+          int64_t result;
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromInteger(Value_asInteger(operand0) - Value_asInteger(operand1))
-          );
+          if(
+            operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER &&
+            !__builtin_sub_overflow(Value_asInteger(operand0), Value_asInteger(operand1), &result)
+          ) {
+            Stack_push(stack, Value_fromInteger(result));
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(stack, Thread_bigIntegerArithmetic(self, OP_SUBTRACT, operand0, operand1));
+          }
         }
         break;
 
@@ -266,13 +1516,18 @@ Value Thread_run(Thread* self) {
         {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
+          int64_t result;
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromInteger(Value_asInteger(operand0) * Value_asInteger(operand1))
-          );
+          if(
+            operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER &&
+            !__builtin_mul_overflow(Value_asInteger(operand0), Value_asInteger(operand1), &result)
+          ) {
+            Stack_push(stack, Value_fromInteger(result));
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(stack, Thread_bigIntegerArithmetic(self, OP_MULTIPLY, operand0, operand1));
+          }
         }
         break;
 
@@ -281,19 +1536,29 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
+          ELEMENTWISE();
+          CHECK_INTEGER_TYPES();
 
-          if(Value_asInteger(operand1) == 0) {
+          // Big integers are never 0
+          if(operand1.type == VALUE_INTEGER && Value_asInteger(operand1) == 0) {
             THREAD_ERROR(
               ByteCode_getLine(self->byteCode, pc - 1),
               "Division by 0."
             );
           }
 
-          Stack_push(
-            stack,
-            Value_fromInteger(Value_asInteger(operand0) / Value_asInteger(operand1))
-          );
+          // INT64_MIN // -1 is the only int64_t division which overflows
+          if(
+            operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER &&
+            !(Value_asInteger(operand0) == INT64_MIN && Value_asInteger(operand1) == -1)
+          ) {
+            Stack_push(
+              stack,
+              Value_fromInteger(Value_asInteger(operand0) / Value_asInteger(operand1))
+            );
+          } else {
+            Stack_push(stack, Thread_bigIntegerArithmetic(self, OP_IDIVIDE, operand0, operand1));
+          }
         }
         break;
 
@@ -302,12 +1567,24 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromBoolean(Value_asInteger(operand0) < Value_asInteger(operand1))
-          );
+          if(operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Value_asInteger(operand0) < Value_asInteger(operand1))
+            );
+          } else if(Thread_areStrings(operand0, operand1)) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareStrings(operand0, operand1) < 0)
+            );
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareBigIntegers(operand0, operand1) < 0)
+            );
+          }
         }
         break;
 
@@ -316,12 +1593,24 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromBoolean(Value_asInteger(operand0) <= Value_asInteger(operand1))
-          );
+          if(operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Value_asInteger(operand0) <= Value_asInteger(operand1))
+            );
+          } else if(Thread_areStrings(operand0, operand1)) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareStrings(operand0, operand1) <= 0)
+            );
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareBigIntegers(operand0, operand1) <= 0)
+            );
+          }
         }
         break;
 
@@ -330,12 +1619,24 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromBoolean(Value_asInteger(operand0) > Value_asInteger(operand1))
-          );
+          if(operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Value_asInteger(operand0) > Value_asInteger(operand1))
+            );
+          } else if(Thread_areStrings(operand0, operand1)) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareStrings(operand0, operand1) > 0)
+            );
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareBigIntegers(operand0, operand1) > 0)
+            );
+          }
         }
         break;
 
@@ -344,12 +1645,24 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
-          CHECK_BINARY_TYPE(VALUE_INTEGER, VALUE_INTEGER);
-
-          Stack_push(
-            stack,
-            Value_fromBoolean(Value_asInteger(operand0) >= Value_asInteger(operand1))
-          );
+          if(operand0.type == VALUE_INTEGER && operand1.type == VALUE_INTEGER) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Value_asInteger(operand0) >= Value_asInteger(operand1))
+            );
+          } else if(Thread_areStrings(operand0, operand1)) {
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareStrings(operand0, operand1) >= 0)
+            );
+          } else {
+            ELEMENTWISE();
+            CHECK_INTEGER_TYPES();
+            Stack_push(
+              stack,
+              Value_fromBoolean(Thread_compareBigIntegers(operand0, operand1) >= 0)
+            );
+          }
         }
         break;
 
@@ -358,6 +1671,21 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
+          /*
+           * Integers only become big integers when they don't fit in an
+           * int64_t, so an integer never equals a big integer. Likewise,
+           * strings short enough to be small always are.
+           */
+          if(
+            operand0.type != operand1.type && (
+              (Value_isInteger(operand0) && Value_isInteger(operand1)) ||
+              (Value_isUTF8(operand0) && Value_isUTF8(operand1))
+            )
+          ) {
+            Stack_push(stack, Value_fromBoolean(false));
+            break;
+          }
+
           CHECK_SAME_TYPE();
 
           switch(operand0.type) {
@@ -379,20 +1707,106 @@ Value Thread_run(Thread* self) {
               );
               break;
 
-            case VALUE_NIL:
-              // If both types are nil, that implies both values are nil
-              Stack_push(stack, Value_fromBoolean(true));
+            case VALUE_NATIVE:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asNative(operand0) == Value_asNative(operand1)
+                )
+              );
               break;
 
-            case VALUE_INTEGER:
+            case VALUE_FN:
               Stack_push(
                 stack,
-                Value_fromBoolean(Value_asInteger(operand0) == Value_asInteger(operand1))
+                Value_fromBoolean(
+                  Value_asFn(operand0) == Value_asFn(operand1)
+                )
+              );
+              break;
+
+            case VALUE_CLOSURE:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asClosure(operand0) == Value_asClosure(operand1)
+                )
+              );
+              break;
+
+            case VALUE_ARRAY:
+              // Arrays are mutable, so only the same array is equal
+              Stack_push(
+                stack,
+                Value_fromBoolean(Value_asArray(operand0) == Value_asArray(operand1))
+              );
+              break;
+
+            case VALUE_MAP:
+              Stack_push(
+                stack,
+                Value_fromBoolean(Value_asMap(operand0) == Value_asMap(operand1))
+              );
+              break;
+
+            case VALUE_STRING_BUILDER:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asStringBuilder(operand0) == Value_asStringBuilder(operand1)
+                )
+              );
+              break;
+
+            case VALUE_RANGE:
+              Stack_push(
+                stack,
+                Value_fromBoolean(ObjRange_equals(Value_asRange(operand0), Value_asRange(operand1)))
+              );
+              break;
+
+            case VALUE_STACK_CLOSURE:
+            case VALUE_BOX:
+              // The compiler never leaves these where operators can see them
+              assert(false);
+              break;
+
+            case VALUE_NIL:
+              // If both types are nil, that implies both values are nil
+              Stack_push(stack, Value_fromBoolean(true));
+              break;
+
+            case VALUE_INTEGER:
+              Stack_push(
+                stack,
+                Value_fromBoolean(Value_asInteger(operand0) == Value_asInteger(operand1))
+              );
+              break;
+
+            case VALUE_BIG_INTEGER:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  BigInteger_compare(Value_asBigInteger(operand0), Value_asBigInteger(operand1)) == 0
+                )
               );
               break;
 
             case VALUE_UTF8:
-              assert(false); // TODO Add support
+            case VALUE_UTF32:
+              Stack_push(
+                stack,
+                Value_fromBoolean(Blob_equals(Value_asBlob(operand0), Value_asBlob(operand1)))
+              );
+              break;
+
+            case VALUE_SMALL_UTF8:
+              // The unused bytes are zeroed, so all 8 bytes can be compared at once
+              Stack_push(
+                stack,
+                Value_fromBoolean(operand0.as.smallUTF8 == operand1.as.smallUTF8)
+              );
+              break;
           }
         }
         break;
@@ -402,6 +1816,21 @@ Value Thread_run(Thread* self) {
           Value operand1 = Stack_pop(stack);
           Value operand0 = Stack_pop(stack);
 
+          /*
+           * Integers only become big integers when they don't fit in an
+           * int64_t, so an integer never equals a big integer. Likewise,
+           * strings short enough to be small always are.
+           */
+          if(
+            operand0.type != operand1.type && (
+              (Value_isInteger(operand0) && Value_isInteger(operand1)) ||
+              (Value_isUTF8(operand0) && Value_isUTF8(operand1))
+            )
+          ) {
+            Stack_push(stack, Value_fromBoolean(true));
+            break;
+          }
+
           CHECK_SAME_TYPE();
 
           switch(operand0.type) {
@@ -423,6 +1852,69 @@ Value Thread_run(Thread* self) {
               );
               break;
 
+            case VALUE_NATIVE:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asNative(operand0) != Value_asNative(operand1)
+                )
+              );
+              break;
+
+            case VALUE_FN:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asFn(operand0) != Value_asFn(operand1)
+                )
+              );
+              break;
+
+            case VALUE_CLOSURE:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asClosure(operand0) != Value_asClosure(operand1)
+                )
+              );
+              break;
+
+            case VALUE_ARRAY:
+              Stack_push(
+                stack,
+                Value_fromBoolean(Value_asArray(operand0) != Value_asArray(operand1))
+              );
+              break;
+
+            case VALUE_MAP:
+              Stack_push(
+                stack,
+                Value_fromBoolean(Value_asMap(operand0) != Value_asMap(operand1))
+              );
+              break;
+
+            case VALUE_STRING_BUILDER:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  Value_asStringBuilder(operand0) != Value_asStringBuilder(operand1)
+                )
+              );
+              break;
+
+            case VALUE_RANGE:
+              Stack_push(
+                stack,
+                Value_fromBoolean(!ObjRange_equals(Value_asRange(operand0), Value_asRange(operand1)))
+              );
+              break;
+
+            case VALUE_STACK_CLOSURE:
+            case VALUE_BOX:
+              // The compiler never leaves these where operators can see them
+              assert(false);
+              break;
+
             case VALUE_NIL:
               // If both types are nil, that implies both values are nil
               Stack_push(stack, Value_fromBoolean(false));
@@ -435,8 +1927,29 @@ Value Thread_run(Thread* self) {
               );
               break;
 
+            case VALUE_BIG_INTEGER:
+              Stack_push(
+                stack,
+                Value_fromBoolean(
+                  BigInteger_compare(Value_asBigInteger(operand0), Value_asBigInteger(operand1)) != 0
+                )
+              );
+              break;
+
             case VALUE_UTF8:
-              assert(false); // TODO support this
+            case VALUE_UTF32:
+              Stack_push(
+                stack,
+                Value_fromBoolean(!Blob_equals(Value_asBlob(operand0), Value_asBlob(operand1)))
+              );
+              break;
+
+            case VALUE_SMALL_UTF8:
+              Stack_push(
+                stack,
+                Value_fromBoolean(operand0.as.smallUTF8 != operand1.as.smallUTF8)
+              );
+              break;
           }
         }
         break;
@@ -468,7 +1981,19 @@ Value Thread_run(Thread* self) {
         break;
 
       case OP_JUMP:
-        pc += *((int16_t*)pc);
+        {
+          int16_t offset = *((int16_t*)pc);
+
+          /*
+           * Jumping back closes a loop, which can allocate without end, so
+           * this is one of the points where the thread collects.
+           */
+          if(offset < 0 && self->bytesAllocated >= self->nextCollection) {
+            Thread_collect(self);
+          }
+
+          pc += offset;
+        }
         break;
 
       case OP_JUMP_TRUE:
@@ -478,6 +2003,10 @@ Value Thread_run(Thread* self) {
           // TODO Handle this
           assert(operand.type == VALUE_BOOLEAN);
 
+#ifdef INSTRUMENT
+          Instrumentation_recordBranch(self->byteCode, pc - 1, Value_asBoolean(operand));
+#endif
+
           if(Value_asBoolean(operand)) {
             pc += *((int16_t*)pc);
           } else {
@@ -493,6 +2022,10 @@ Value Thread_run(Thread* self) {
           // TODO Handle this
           assert(operand.type == VALUE_BOOLEAN);
 
+#ifdef INSTRUMENT
+          Instrumentation_recordBranch(self->byteCode, pc - 1, !Value_asBoolean(operand));
+#endif
+
           if(Value_asBoolean(operand)) {
             pc += sizeof(int16_t) / sizeof(uint8_t);
           } else {
@@ -501,6 +2034,138 @@ Value Thread_run(Thread* self) {
         }
         break;
 
+      case OP_FOR_RANGE:
+        {
+          /*
+           * The fast path for `for(x in range(...))`, which never allocates
+           * the range. The three slots hold the next integer, the stop and
+           * the loop variable, so an iteration is a compare, an increment
+           * and a branch.
+           */
+          Value* slots = Stack_slots(stack, base + *((uint16_t*)pc), 3);
+          pc += sizeof(uint16_t);
+
+          if(slots[0].type != VALUE_INTEGER || slots[1].type != VALUE_INTEGER) {
+            THREAD_ERROR(
+              ByteCode_getLine(self->byteCode, pc - 3),
+              "Cannot make a range of values of type `%s` and `%s`.",
+              ValueType_toCString(slots[0].type),
+              ValueType_toCString(slots[1].type)
+            );
+          }
+
+          if(slots[0].as.integer < slots[1].as.integer) {
+            slots[2] = slots[0];
+            slots[0].as.integer++;
+            pc += sizeof(int16_t) / sizeof(uint8_t);
+          } else {
+            pc += *((int16_t*)pc);
+          }
+        }
+        break;
+
+      case OP_FOR_NEXT:
+        {
+          /*
+           * Steps any other iterable. The three slots hold the iterable, a
+           * cursor into it and the loop variable. Arrays and maps are read
+           * as they are when each iteration starts, so items appended
+           * during the loop are visited too.
+           */
+          Value* slots = Stack_slots(stack, base + *((uint16_t*)pc), 3);
+          pc += sizeof(uint16_t);
+
+          uint64_t cursor = (uint64_t)(slots[1].as.integer);
+          bool hasNext;
+
+          switch(slots[0].type) {
+            case VALUE_ARRAY:
+              {
+                ObjArray* array = Value_asArray(slots[0]);
+                hasNext = cursor < array->count;
+                if(hasNext) slots[2] = array->items[cursor++];
+              }
+              break;
+
+            case VALUE_MAP:
+              {
+                ObjMap* map = Value_asMap(slots[0]);
+                while(cursor < map->capacity && map->control[cursor] == MAP_EMPTY) cursor++;
+                hasNext = cursor < map->capacity;
+                if(hasNext) slots[2] = map->entries[cursor++].key;
+              }
+              break;
+
+            case VALUE_RANGE:
+              {
+                ObjRange* range = Value_asRange(slots[0]);
+                hasNext = cursor < ObjRange_length(range);
+                if(hasNext) {
+                  slots[2] = Value_fromInteger((int64_t)((uint64_t)(range->start) + cursor));
+                  cursor++;
+                }
+              }
+              break;
+
+            default:
+              THREAD_ERROR(
+                ByteCode_getLine(self->byteCode, pc - 3),
+                "Cannot iterate over a value of type `%s`.",
+                ValueType_toCString(slots[0].type)
+              );
+          }
+
+          slots[1].as.integer = (int64_t)cursor;
+
+          if(hasNext) {
+            pc += sizeof(int16_t) / sizeof(uint8_t);
+          } else {
+            pc += *((int16_t*)pc);
+          }
+        }
+        break;
+
+      case OP_FOR_ELEMENTWISE:
+        {
+          /*
+           * Precedes a collected for loop whose body is `x OP literal` or
+           * `literal OP x`, with the literal on the stack and the operator
+           * as an operand. The two slots hold the array the loop collects
+           * into and the iterable. Over an array, the loop is one
+           * elementwise operation, whose result replaces the collected
+           * array before jumping past the loop. Anything else is left to the
+           * loop.
+           */
+          Value literal = Stack_pop(stack);
+          Value* slots = Stack_slots(stack, base + *((uint16_t*)pc), 2);
+          pc += sizeof(uint16_t);
+
+          uint8_t* op = pc++;
+          bool isReversed = *(pc++);
+
+          if(slots[1].type == VALUE_ARRAY) {
+            bool isDone = Thread_elementwise(
+              self,
+              op,
+              ByteCode_getLine(self->byteCode, op),
+              isReversed ? literal : slots[1],
+              isReversed ? slots[1] : literal,
+              &(slots[0])
+            );
+
+            if(!isDone) {
+              self->panic = true;
+              Thread_running = NULL;
+              return NIL;
+            }
+
+            pc += *((int16_t*)pc);
+          } else {
+            pc += sizeof(int16_t) / sizeof(uint8_t);
+          }
+        }
+        break;
+
       case OP_SCOPE_OPEN:
         Stack_openScope(&(self->stack));
         break;
@@ -512,39 +2177,251 @@ Value Thread_run(Thread* self) {
       case OP_CALL:
         {
           uint8_t argumentCount = *(pc++);
-          Value arguments[argumentCount];
 
-          for(uint8_t i = 0; i < argumentCount; i++) {
-            arguments[i] = Stack_pop(stack);
+          // Recursion can allocate without end too, so calls collect
+          if(self->bytesAllocated >= self->nextCollection) Thread_collect(self);
+
+          /*
+           * The function is below its arguments on the stack, so native
+           * functions get a pointer straight into the stack rather than a
+           * copy. This is safe because native functions can't push onto
+           * the thread's stack.
+           */
+          Value* arguments = Stack_window(stack, argumentCount);
+          Value function = arguments[-1];
+
+          switch(function.type) {
+            case VALUE_NATIVE_FN:
+              {
+                Value result = Value_asNativeFn(function)(argumentCount, arguments);
+                CHECK_BUILTIN_PANIC(pc - 2);
+
+                Stack_drop(stack, argumentCount + 1);
+                Stack_push(stack, result);
+              }
+              break;
+
+            case VALUE_NATIVE:
+              {
+                Native* native = Value_asNative(function);
+                Value result = native->fn(native->context, argumentCount, arguments);
+
+                Stack_drop(stack, argumentCount + 1);
+                Stack_push(stack, result);
+              }
+              break;
+
+            case VALUE_FN:
+            case VALUE_CLOSURE:
+            case VALUE_STACK_CLOSURE:
+              {
+                /*
+                 * A closure's upvalues are reached through slot 0 of its
+                 * frame, so calling it is the same as calling its Fn.
+                 */
+                Fn* callee = Thread_callee(stack, function);
+
+                if(callee->arity != argumentCount) {
+                  THREAD_ERROR(
+                    ByteCode_getLine(self->byteCode, pc - 2),
+                    "Function `%.*s` takes %d argument(s) but was called with %d.",
+                    FN_PRINTF_NAME(callee),
+                    (int)(callee->arity),
+                    (int)argumentCount
+                  );
+                }
+
+                /*
+                 * The function and its arguments stay where they are on the
+                 * stack and become the bottom of the new frame.
+                 */
+                size_t calleeBase = (arguments - 1) - stack->items;
+
+                if(!Thread_pushFrame(self, ByteCode_index(self->byteCode, pc), calleeBase)) {
+                  THREAD_ERROR(
+                    ByteCode_getLine(self->byteCode, pc - 2),
+                    "Stack overflow calling `%.*s`.",
+                    FN_PRINTF_NAME(callee)
+                  );
+                }
+
+                base = calleeBase;
+                pc = ByteCode_pc(self->byteCode, callee->start);
+              }
+              break;
+
+            default:
+              THREAD_ERROR(
+                ByteCode_getLine(self->byteCode, pc - 2),
+                "Cannot call value of type `%s`.",
+                ValueType_toCString(function.type)
+              );
+          }
+        }
+        break;
+
+      case OP_TAIL_CALL:
+        {
+          uint8_t argumentCount = *(pc++);
+          uint8_t scopeCount = *(pc++);
+
+          if(self->bytesAllocated >= self->nextCollection) Thread_collect(self);
+
+          // The compiler only emits tail calls inside function bodies
+          assert(self->frameCount > 0);
+
+          Value* arguments = Stack_window(stack, argumentCount);
+          Value function = arguments[-1];
+
+          /*
+           * The call site may be inside scopes opened by the caller, and
+           * control never comes back to close them.
+           */
+          Stack_abandonScopes(stack, scopeCount);
+
+          switch(function.type) {
+            case VALUE_NATIVE_FN:
+            case VALUE_NATIVE:
+              {
+                /*
+                 * There's no frame to reuse for a native function, so this
+                 * is a call followed by a return.
+                 */
+                Value result;
+
+                if(function.type == VALUE_NATIVE_FN) {
+                  result = Value_asNativeFn(function)(argumentCount, arguments);
+                  CHECK_BUILTIN_PANIC(pc - 3);
+                } else {
+                  Native* native = Value_asNative(function);
+                  result = native->fn(native->context, argumentCount, arguments);
+                }
+
+                Frame frame = self->frames[--(self->frameCount)];
+
+                Stack_drop(stack, argumentCount + 1);
+                Stack_push(stack, result);
+                Stack_collapse(stack, frame.base, 1);
+                pc = ByteCode_pc(self->byteCode, frame.returnIndex);
+                base = Thread_base(self);
+              }
+              break;
+
+            case VALUE_FN:
+            case VALUE_CLOSURE:
+            case VALUE_STACK_CLOSURE:
+              {
+                Fn* callee = Thread_callee(stack, function);
+
+                /*
+                 * The compiler doesn't emit tail calls to stack closures
+                 * created in the frame being replaced, except for their own
+                 * recursive calls, whose Fn and upvalues are further down.
+                 */
+                assert(
+                  function.type != VALUE_STACK_CLOSURE
+                  || Value_asStackClosure(function) < base
+                );
+
+                if(callee->arity != argumentCount) {
+                  THREAD_ERROR(
+                    ByteCode_getLine(self->byteCode, pc - 3),
+                    "Function `%.*s` takes %d argument(s) but was called with %d.",
+                    FN_PRINTF_NAME(callee),
+                    (int)(callee->arity),
+                    (int)argumentCount
+                  );
+                }
+
+                /*
+                 * The callee and its arguments replace the caller's function,
+                 * arguments and locals, and the callee returns straight to
+                 * the caller's caller, so the frame is reused as it is.
+                 */
+                Stack_collapse(stack, base, argumentCount + 1);
+                pc = ByteCode_pc(self->byteCode, callee->start);
+              }
+              break;
+
+            default:
+              THREAD_ERROR(
+                ByteCode_getLine(self->byteCode, pc - 3),
+                "Cannot call value of type `%s`.",
+                ValueType_toCString(function.type)
+              );
           }
+        }
+        break;
 
-          Value function = Stack_pop(stack);
+      case OP_CALL_BUILTIN:
+        {
+          uint8_t builtinIndex = *(pc++);
+          uint8_t argumentCount = *(pc++);
 
-          // TODO Handle this better
-          assert(function.type == VALUE_NATIVE_FN);
+          // Like OP_CALL on a native function, but nothing is pushed for it
+          Value* arguments = Stack_window(stack, argumentCount);
+          Value result = Value_asNativeFn(BUILTINS[builtinIndex].value)(argumentCount, arguments);
+          CHECK_BUILTIN_PANIC(pc - 3);
 
-          Stack_push(
-            stack,
-            Value_asNativeFn(function)(
-              argumentCount,
-              arguments
-            )
-          );
+          Stack_drop(stack, argumentCount);
+          Stack_push(stack, result);
+        }
+        break;
+
+      case OP_CALL_NATIVE:
+        {
+          uint8_t nativeIndex = *(pc++);
+          uint8_t argumentCount = *(pc++);
+
+          Native* native = self->byteCode->natives.items[nativeIndex];
+          Value* arguments = Stack_window(stack, argumentCount);
+          Value result = native->fn(native->context, argumentCount, arguments);
+
+          Stack_drop(stack, argumentCount);
+          Stack_push(stack, result);
         }
         break;
 
       case OP_RETURN:
-        self->pcIndex = ByteCode_index(self->byteCode, pc);
-        return Stack_pop(stack);
+        if(self->frameCount == 0) {
+          self->pcIndex = ByteCode_index(self->byteCode, pc);
+          Thread_running = NULL;
+          return Stack_pop(stack);
+        }
+
+        {
+          Frame frame = self->frames[--(self->frameCount)];
+
+          Stack_collapse(stack, frame.base, 1);
+          pc = ByteCode_pc(self->byteCode, frame.returnIndex);
+          base = Thread_base(self);
+        }
+        break;
     }
   }
 
+  #undef CHECK_BUILTIN_PANIC
   #undef CHECK_UNARY_TYPE
   #undef CHECK_BINARY_TYPE
+  #undef CHECK_INTEGER_TYPES
   #undef CHECK_SAME_TYPE
+  #undef CHECK_INDEX
+  #undef ELEMENTWISE
   #undef THREAD_ERROR
 }
 
+static Value Thread_runUntraced(Thread* self) {
+  return Thread_dispatch(self, false);
+}
+
+static Value Thread_runTraced(Thread* self) {
+  return Thread_dispatch(self, true);
+}
+
+Value Thread_run(Thread* self) {
+  return Thread_isTraced ? Thread_runTraced(self) : Thread_runUntraced(self);
+}
+
 void Thread_printStack(Thread* self) {
   Stack_println(&(self->stack));
 }
@@ -654,38 +2531,1104 @@ void test_Thread_run_integerComparison() {
   #undef TEST_COUNT
 }
 
-void test_Thread_clearPanic_setsPanicFalse() {
+void test_Thread_run_integerOverflowPromotes() {
   ByteCode byteCode;
   ByteCode_init(&byteCode);
 
-  ByteCode_append(&byteCode, OP_NIL, 1);
-  ByteCode_append(&byteCode, OP_RETURN, 2);
+  // (INT64_MAX + 1) * (INT64_MAX + 1), then back down to INT64_MAX
+  ByteCode_append(&byteCode, OP_INTEGER64, 1);
+  ByteCode_appendInt64(&byteCode, INT64_MAX, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_ADD, 1);
+  ByteCode_append(&byteCode, OP_DUP, 1);
+  ByteCode_append(&byteCode, OP_DUP, 1);
+  ByteCode_append(&byteCode, OP_MULTIPLY, 1);
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_SUBTRACT, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
 
   Thread thread;
   Thread_init(&thread, &byteCode);
-  thread.panic = true;
 
-  Thread_clearPanic(&thread);
+  Value result = Thread_run(&thread);
 
-  assert(!(thread.panic));
-}
+  // Results which fit are normalized back to plain integers
+  assert(result.type == VALUE_INTEGER);
+  assert(Value_asInteger(result) == INT64_MAX);
 
-void test_Thread_clearPanic_setsPCIndexToEnd() {
-  ByteCode byteCode;
-  ByteCode_init(&byteCode);
+  Value square = Stack_pop(&(thread.stack));
+  Value sum = Stack_pop(&(thread.stack));
+  int64_t unused;
 
-  ByteCode_append(&byteCode, OP_NIL, 1);
-  ByteCode_append(&byteCode, OP_RETURN, 2);
+  assert(sum.type == VALUE_BIG_INTEGER);
+  assert(square.type == VALUE_BIG_INTEGER);
+  assert(!BigInteger_toInteger(Value_asBigInteger(sum), &unused));
 
-  Thread thread;
-  Thread_init(&thread, &byteCode);
-  thread.panic = true;
+  // 2^63 * 2^63 = 2^126
+  ObjBigInteger* big = Value_asBigInteger(square);
+  assert(big->count == 4);
+  assert(big->limbs[3] == 0x40000000);
 
-  Thread_clearPanic(&thread);
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
 
-  assert(thread.pcIndex == 2);
+static Value multiplyByContext(void* context, uint8_t argc, Value* argv) {
+  assert(argc == 1);
+  return Value_fromInteger(Value_asInteger(argv[0]) * *((int64_t*)context));
 }
 
-// TODO Need a lot more tests here
+void test_Thread_run_stringComparison() {
+  #define TEST_COUNT 14
+
+  typedef struct {
+    Instruction instruction;
+    uint8_t operand0;
+    uint8_t operand1;
+    bool result;
+  } TestCase;
+
+  // "abc" twice, so that equality can't rely on the pointer, "abd" and "ab"
+  const char* strings[] = { "abc", "abc", "abd", "ab" };
+
+  TestCase tests[TEST_COUNT] = {
+    { OP_EQUAL, 0, 0, true },
+    { OP_EQUAL, 0, 1, true },
+    { OP_EQUAL, 0, 2, false },
+    { OP_EQUAL, 0, 3, false },
+    { OP_NOT_EQUAL, 0, 1, false },
+    { OP_NOT_EQUAL, 1, 2, true },
+    { OP_LESS_THAN, 0, 2, true },
+    { OP_LESS_THAN, 3, 0, true },
+    { OP_LESS_THAN, 0, 1, false },
+    { OP_LESS_THAN_EQUAL, 0, 1, true },
+    { OP_LESS_THAN_EQUAL, 2, 0, false },
+    { OP_GREATER_THAN, 0, 3, true },
+    { OP_GREATER_THAN, 0, 1, false },
+    { OP_GREATER_THAN_EQUAL, 2, 1, true },
+  };
+
+  for(int i = 0; i < TEST_COUNT; i++) {
+    ByteCode byteCode;
+    ByteCode_init(&byteCode);
+
+    for(size_t j = 0; j < sizeof(strings) / sizeof(strings[0]); j++) {
+      Blob* blob = Blob_new(strlen(strings[j]));
+      memcpy(blob->bytes, strings[j], blob->count);
+      BlobList_append(&(byteCode.blobs), blob);
+    }
+
+    // One copy of "abc" knows its hash, the other doesn't yet
+    Blob_hash(byteCode.blobs.items[0]);
+
+    ByteCode_append(&byteCode, OP_UTF8, 1);
+    ByteCode_appendUInt16(&byteCode, tests[i].operand0, 1);
+    ByteCode_append(&byteCode, OP_UTF8, 1);
+    ByteCode_appendUInt16(&byteCode, tests[i].operand1, 1);
+    ByteCode_append(&byteCode, tests[i].instruction, 1);
+    ByteCode_append(&byteCode, OP_RETURN, 1);
+    Thread thread;
+    Thread_init(&thread, &byteCode);
+
+    Value result = Thread_run(&thread);
+
+    assert(result.type == VALUE_BOOLEAN);
+    assert(Value_asBoolean(result) == tests[i].result);
+
+    for(size_t j = 0; j < byteCode.blobs.count; j++) {
+      free(byteCode.blobs.items[j]);
+    }
+
+    ByteCode_free(&byteCode);
+    Thread_free(&thread);
+  }
+
+  #undef TEST_COUNT
+}
+
+void test_Thread_run_utf32Comparison() {
+  #define TEST_COUNT 5
+
+  typedef struct {
+    Instruction instruction;
+    uint8_t operand0;
+    uint8_t operand1;
+    bool result;
+  } TestCase;
+
+  /*
+   * U+00FF sorts before U+0100, although its little endian bytes FF 00 00 00
+   * sort after 00 01 00 00.
+   */
+  const uint32_t codePoints[][2] = { { 'a', 0xFF }, { 'a', 0x100 }, { 'a', 0xFF } };
+
+  TestCase tests[TEST_COUNT] = {
+    { OP_LESS_THAN, 0, 1, true },
+    { OP_GREATER_THAN, 0, 1, false },
+    { OP_GREATER_THAN_EQUAL, 1, 0, true },
+    { OP_EQUAL, 0, 2, true },
+    { OP_NOT_EQUAL, 0, 1, true },
+  };
+
+  for(int i = 0; i < TEST_COUNT; i++) {
+    ByteCode byteCode;
+    ByteCode_init(&byteCode);
+
+    for(size_t j = 0; j < sizeof(codePoints) / sizeof(codePoints[0]); j++) {
+      Blob* blob = Blob_new(sizeof(codePoints[j]));
+      memcpy(blob->bytes, codePoints[j], blob->count);
+      BlobList_append(&(byteCode.blobs), blob);
+    }
+
+    ByteCode_append(&byteCode, OP_UTF32, 1);
+    ByteCode_appendUInt16(&byteCode, tests[i].operand0, 1);
+    ByteCode_append(&byteCode, OP_UTF32, 1);
+    ByteCode_appendUInt16(&byteCode, tests[i].operand1, 1);
+    ByteCode_append(&byteCode, tests[i].instruction, 1);
+    ByteCode_append(&byteCode, OP_RETURN, 1);
+    Thread thread;
+    Thread_init(&thread, &byteCode);
+
+    Value result = Thread_run(&thread);
+
+    assert(result.type == VALUE_BOOLEAN);
+    assert(Value_asBoolean(result) == tests[i].result);
+
+    for(size_t j = 0; j < byteCode.blobs.count; j++) {
+      free(byteCode.blobs.items[j]);
+    }
+
+    ByteCode_free(&byteCode);
+    Thread_free(&thread);
+  }
+
+  #undef TEST_COUNT
+}
+
+void test_Thread_run_callsNatives() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  int64_t factor = 3;
+  assert(NativeList_register(&(byteCode.natives), "triple", multiplyByContext, &factor));
+
+  // triple(10) + (triple)(4), calling it directly and as a value
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 10, 1);
+  ByteCode_append(&byteCode, OP_CALL_NATIVE, 1);
+  ByteCode_append(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_NATIVE, 1);
+  ByteCode_append(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 4, 1);
+  ByteCode_append(&byteCode, OP_CALL, 1);
+  ByteCode_append(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_ADD, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+
+  Value result = Thread_run(&thread);
+
+  assert(Value_asInteger(result) == 42);
+  assert(Stack_isEmpty(&(thread.stack)));
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+static Value subtract(uint8_t argc, Value* argv) {
+  assert(argc == 2);
+  return Value_fromInteger(Value_asInteger(argv[0]) - Value_asInteger(argv[1]));
+}
+
+void test_Thread_run_callPassesArgumentsInOrder() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 5, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 3, 1);
+  ByteCode_append(&byteCode, OP_CALL, 1);
+  ByteCode_append(&byteCode, 2, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  Stack_push(&(thread.stack), Value_fromNativeFn(subtract));
+
+  Value result = Thread_run(&thread);
+
+  assert(Value_asInteger(result) == 2);
+  assert(Stack_isEmpty(&(thread.stack)));
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+/*
+ * Appends `\(a, b) a - b` at the start of the ByteCode, as the compiler
+ * would lay it out if it weren't jumped over.
+ */
+static void appendSubtractFunction(ByteCode* byteCode) {
+  Fn* function = Fn_new(2, "subtract", strlen("subtract"));
+  function->start = ByteCode_count(byteCode);
+
+  ByteCode_append(byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(byteCode, 1, 1);
+  ByteCode_append(byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(byteCode, 2, 1);
+  ByteCode_append(byteCode, OP_SUBTRACT, 1);
+  ByteCode_append(byteCode, OP_RETURN, 1);
+
+  function->end = ByteCode_count(byteCode);
+  FnList_append(&(byteCode->functions), function);
+}
+
+void test_Thread_run_callsFunction() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  appendSubtractFunction(&byteCode);
+
+  size_t programStart = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 100, 2);
+  ByteCode_append(&byteCode, OP_FUNCTION, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 5, 2);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 3, 2);
+  ByteCode_append(&byteCode, OP_CALL, 2);
+  ByteCode_append(&byteCode, 2, 2);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.pcIndex = programStart;
+
+  Value result = Thread_run(&thread);
+
+  // The parameters are read relative to the frame, not the module
+  assert(Value_asInteger(result) == 2);
+  assert(thread.frameCount == 0);
+
+  // The function and its arguments were removed by the return
+  assert(Value_asInteger(Stack_pop(&(thread.stack))) == 100);
+  assert(Stack_isEmpty(&(thread.stack)));
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+void test_Thread_run_callChecksArity() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  appendSubtractFunction(&byteCode);
+
+  size_t programStart = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_FUNCTION, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 5, 2);
+  ByteCode_append(&byteCode, OP_CALL, 2);
+  ByteCode_append(&byteCode, 1, 2);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.pcIndex = programStart;
+
+  Thread_run(&thread);
+
+  assert(thread.panic);
+  assert(thread.frameCount == 0);
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+void test_Thread_clearPanic_setsPanicFalse() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.panic = true;
+
+  Thread_clearPanic(&thread);
+
+  assert(!(thread.panic));
+}
+
+void test_Thread_clearPanic_setsPCIndexToEnd() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.panic = true;
+
+  Thread_clearPanic(&thread);
+
+  assert(thread.pcIndex == 2);
+}
+
+void test_Thread_run_tailCallReusesFrame() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  // countdown(n) = if(n > 0) { countdown(n - 1) } else n
+  Fn* function = Fn_new(1, "countdown", strlen("countdown"));
+  function->start = ByteCode_count(&byteCode);
+
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_GREATER_THAN, 1);
+  ByteCode_append(&byteCode, OP_JUMP_FALSE, 1);
+  ByteCode_appendInt16(&byteCode, 18, 1);
+  ByteCode_append(&byteCode, OP_SCOPE_OPEN, 1);
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_SUBTRACT, 1);
+  ByteCode_append(&byteCode, OP_TAIL_CALL, 1);
+  ByteCode_append(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  function->end = ByteCode_count(&byteCode);
+  FnList_append(&(byteCode.functions), function);
+
+  size_t programStart = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_FUNCTION, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 100000, 2);
+  ByteCode_append(&byteCode, OP_CALL, 2);
+  ByteCode_append(&byteCode, 1, 2);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.pcIndex = programStart;
+
+  Value result = Thread_run(&thread);
+
+  assert(!thread.panic);
+  assert(Value_asInteger(result) == 0);
+
+  // Every call after the first reused the first call's frame and scopes
+  assert(thread.frameCapacity == 8);
+  assert(thread.stack.scopeCount == 0);
+  assert(Stack_isEmpty(&(thread.stack)));
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+void test_Thread_run_closureSharesBox() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  Fn* function = Fn_new(0, "get", strlen("get"));
+  function->start = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_GET_UPVALUE_BOXED, 1);
+  ByteCode_append(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+  function->end = ByteCode_count(&byteCode);
+  FnList_append(&(byteCode.functions), function);
+
+  size_t programStart = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 5, 2);
+  ByteCode_append(&byteCode, OP_BOX, 2);
+  ByteCode_append(&byteCode, OP_CLOSURE, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, 1, 2);
+  ByteCode_append(&byteCode, CAPTURE_LOCAL, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_INTEGER, 2);
+  ByteCode_appendInt32(&byteCode, 7, 2);
+  ByteCode_append(&byteCode, OP_SET_BOXED, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_GET, 2);
+  ByteCode_appendUInt16(&byteCode, 1, 2);
+  ByteCode_append(&byteCode, OP_CALL, 2);
+  ByteCode_append(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.pcIndex = programStart;
+
+  Value result = Thread_run(&thread);
+
+  // The closure sees the assignment made through the variable's slot
+  assert(!thread.panic);
+  assert(Value_asInteger(result) == 7);
+
+  assert(thread.objects->type == OBJ_CLOSURE);
+  assert(thread.objects->next->type == OBJ_BOX);
+  assert(thread.objects->next->next == NULL);
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+void test_Thread_collect_freesUnreachableObjects() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+
+  // A literal, which the thread doesn't own, alongside objects it does
+  Blob* literal = Blob_new(16);
+  memset(literal->bytes, 'a', 16);
+
+  ObjBox* box = (ObjBox*)Thread_allocate(&thread, OBJ_BOX, sizeof(ObjBox));
+  box->value = Thread_newUTF8(&thread, literal->bytes, 16);
+
+  ObjArray* array = Thread_newArray(&thread, 2);
+  Thread_appendItem(&thread, array, Value_fromBox(box));
+  Thread_appendItem(&thread, array, Value_fromBlob(VALUE_UTF8, literal));
+
+  Thread_newArray(&thread, 8);
+  Thread_newUTF8(&thread, literal->bytes, 16);
+
+  Stack_push(&(thread.stack), Value_fromArray(array));
+
+  Thread_collect(&thread);
+
+  // Only what the stack reaches, through the array and the box, is left
+  size_t count = 0;
+
+  for(Obj* obj = thread.objects; obj != NULL; obj = obj->next) {
+    assert(!(obj->isMarked));
+    assert(obj->type == OBJ_ARRAY || obj->type == OBJ_BOX || obj->type == OBJ_BLOB);
+    count++;
+  }
+
+  assert(count == 3);
+  assert(thread.bytesAllocated == sizeof(ObjArray) + 2 * sizeof(Value)
+    + sizeof(ObjBox) + sizeof(Obj) + sizeof(Blob) + 16);
+  assert(memcmp(Value_asBlob(box->value)->bytes, literal->bytes, 16) == 0);
+
+  Thread_free(&thread);
+  ByteCode_free(&byteCode);
+  free(literal);
+}
+
+void test_Thread_clearPanic_dropsFrames() {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  appendSubtractFunction(&byteCode);
+
+  // Passing nil makes the subtraction inside the function fail
+  size_t programStart = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_FUNCTION, 2);
+  ByteCode_appendUInt16(&byteCode, 0, 2);
+  ByteCode_append(&byteCode, OP_NIL, 2);
+  ByteCode_append(&byteCode, OP_NIL, 2);
+  ByteCode_append(&byteCode, OP_CALL, 2);
+  ByteCode_append(&byteCode, 2, 2);
+  ByteCode_append(&byteCode, OP_RETURN, 2);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+  thread.pcIndex = programStart;
+
+  Thread_run(&thread);
+
+  assert(thread.panic);
+  assert(thread.frameCount == 1);
+
+  Thread_clearPanic(&thread);
+
+  assert(thread.frameCount == 0);
+
+  ByteCode_free(&byteCode);
+  Thread_free(&thread);
+}
+
+// TODO Need a lot more tests here
+
+#endif
+
+#ifdef BENCH
+
+#include "bench.h"
+
+/*
+ * These benchmarks track the threading goals in the README: a Fur thread
+ * should be cheap enough that a million of them fit in about 50MB.
+ *
+ * There is no scheduler or message queue yet, so the benchmarks drive
+ * Threads directly. "Spawning" is Thread_init() against a shared ByteCode,
+ * a "context switch" is resuming a different Thread with Thread_run(), and
+ * a message is a Value pushed onto the receiving Thread's stack.
+ */
+
+void bench_Thread_spawnIdle() {
+  size_t threadCount = Bench_parameter("FUR_BENCH_THREADS", 1000000);
+
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  size_t rssBefore = Bench_currentRSS();
+  uint64_t start = Bench_now();
+
+  Thread* threads = malloc(sizeof(Thread) * threadCount);
+  assert(threads != NULL);
+
+  for(size_t i = 0; i < threadCount; i++) {
+    Thread_init(&(threads[i]), &byteCode);
+  }
+
+  uint64_t spawned = Bench_now();
+  size_t rssAfter = Bench_currentRSS();
+
+  for(size_t i = 0; i < threadCount; i++) {
+    Thread_free(&(threads[i]));
+  }
+
+  free(threads);
+  ByteCode_free(&byteCode);
+
+  Bench_report("Thread_spawnIdle", "threads", threadCount, "count");
+  Bench_report(
+    "Thread_spawnIdle",
+    "spawn_latency",
+    (double)(spawned - start) / threadCount,
+    "ns"
+  );
+  Bench_report(
+    "Thread_spawnIdle",
+    "memory_per_thread",
+    (double)(rssAfter - rssBefore) / threadCount,
+    "bytes"
+  );
+  Bench_report("Thread_spawnIdle", "peak_rss", Bench_peakRSS(), "bytes");
+}
+
+void bench_Thread_pingPong() {
+  size_t roundTrips = Bench_parameter("FUR_BENCH_ROUND_TRIPS", 1000000);
+
+  /*
+   * Each thread receives an integer, increments it, and returns it as the
+   * reply to the other thread.
+   */
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_ADD, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  Thread ping;
+  Thread pong;
+  Thread_init(&ping, &byteCode);
+  Thread_init(&pong, &byteCode);
+
+  Value message = Value_fromInteger(0);
+  uint64_t start = Bench_now();
+
+  for(size_t i = 0; i < roundTrips; i++) {
+    ping.pcIndex = 0;
+    Stack_push(&(ping.stack), message);
+    message = Thread_run(&ping);
+
+    pong.pcIndex = 0;
+    Stack_push(&(pong.stack), message);
+    message = Thread_run(&pong);
+  }
+
+  uint64_t elapsed = Bench_now() - start;
+
+  // Check the work was done so the loop can't be optimized away
+  assert(Value_asInteger(message) == (int32_t)(2 * roundTrips));
+
+  Thread_free(&ping);
+  Thread_free(&pong);
+  ByteCode_free(&byteCode);
+
+  Bench_report("Thread_pingPong", "round_trips", roundTrips, "count");
+  Bench_report(
+    "Thread_pingPong",
+    "context_switch",
+    (double)elapsed / (2 * roundTrips),
+    "ns"
+  );
+  Bench_report(
+    "Thread_pingPong",
+    "throughput",
+    (double)roundTrips * 1e9 / elapsed,
+    "round_trips/s"
+  );
+}
+
+void bench_Thread_fanOutFanIn() {
+  size_t workerCount = Bench_parameter("FUR_BENCH_WORKERS", 10000);
+  int32_t iterations = Bench_parameter("FUR_BENCH_WORK", 1000);
+
+  /*
+   * Each worker sums the integers from 1 to its argument:
+   *
+   *   slot 0: the argument (counts down to 0)
+   *   slot 1: the accumulator
+   */
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 0, 1);
+
+  size_t loopStart = ByteCode_count(&byteCode);
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_GREATER_THAN, 1);
+  ByteCode_append(&byteCode, OP_JUMP_FALSE, 1);
+  size_t exitJump = ByteCode_count(&byteCode);
+  ByteCode_appendInt16(&byteCode, 0, 1);
+
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_ADD, 1);
+  ByteCode_append(&byteCode, OP_SET, 1);
+  ByteCode_appendUInt16(&byteCode, 1, 1);
+
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 0, 1);
+  ByteCode_append(&byteCode, OP_INTEGER, 1);
+  ByteCode_appendInt32(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_SUBTRACT, 1);
+  ByteCode_append(&byteCode, OP_SET, 1);
+  ByteCode_appendUInt16(&byteCode, 0, 1);
+
+  ByteCode_append(&byteCode, OP_JUMP, 1);
+  ByteCode_appendInt16(&byteCode, loopStart - ByteCode_count(&byteCode), 1);
+
+  *((int16_t*)ByteCode_pc(&byteCode, exitJump)) = ByteCode_count(&byteCode) - exitJump;
+  ByteCode_append(&byteCode, OP_GET, 1);
+  ByteCode_appendUInt16(&byteCode, 1, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  Thread* workers = malloc(sizeof(Thread) * workerCount);
+  assert(workers != NULL);
+
+  uint64_t start = Bench_now();
+
+  // Fan out: spawn every worker and hand it its argument
+  for(size_t i = 0; i < workerCount; i++) {
+    Thread_init(&(workers[i]), &byteCode);
+    Stack_push(&(workers[i].stack), Value_fromInteger(iterations));
+  }
+
+  // Fan in: run each worker to completion and combine the results
+  int64_t total = 0;
+  for(size_t i = 0; i < workerCount; i++) {
+    total += Value_asInteger(Thread_run(&(workers[i])));
+  }
+
+  uint64_t elapsed = Bench_now() - start;
+
+  assert(total == (int64_t)workerCount * iterations * (iterations + 1) / 2);
+
+  for(size_t i = 0; i < workerCount; i++) {
+    Thread_free(&(workers[i]));
+  }
+
+  free(workers);
+  ByteCode_free(&byteCode);
+
+  Bench_report("Thread_fanOutFanIn", "workers", workerCount, "count");
+  Bench_report("Thread_fanOutFanIn", "elapsed", elapsed, "ns");
+  Bench_report(
+    "Thread_fanOutFanIn",
+    "throughput",
+    (double)workerCount * 1e9 / elapsed,
+    "workers/s"
+  );
+  Bench_report(
+    "Thread_fanOutFanIn",
+    "loop_iteration",
+    (double)elapsed / ((double)workerCount * iterations),
+    "ns"
+  );
+}
+
+/*
+ * The opcode and pattern benchmarks run hand-assembled ByteCode: a
+ * prologue which sets up any values the body needs, followed by the body
+ * repeated BENCH_UNROLL times so that dispatch of the measured instructions
+ * dominates the cost of entering and leaving Thread_run(). Each body must
+ * leave the stack as it found it.
+ */
+#define BENCH_UNROLL 100
+
+typedef struct {
+  const char* name;
+  void (*emitPrologue)(ByteCode*);
+  void (*emitBody)(ByteCode*);
+  size_t instructionsPerBody;
+} ThreadBenchmark;
+
+static void Thread_benchRun(void* context) {
+  Thread* thread = (Thread*)context;
+
+  thread->pcIndex = 0;
+  Thread_run(thread);
+
+  // Discard anything the prologue left on the stack
+  thread->stack.top = thread->stack.items - 1;
+}
+
+static void Thread_bench(const char* group, ThreadBenchmark* benchmark) {
+  ByteCode byteCode;
+  ByteCode_init(&byteCode);
+
+  if(benchmark->emitPrologue != NULL) benchmark->emitPrologue(&byteCode);
+
+  for(int i = 0; i < BENCH_UNROLL; i++) {
+    benchmark->emitBody(&byteCode);
+  }
+
+  ByteCode_append(&byteCode, OP_NIL, 1);
+  ByteCode_append(&byteCode, OP_RETURN, 1);
+
+  Thread thread;
+  Thread_init(&thread, &byteCode);
+
+  char name[64];
+  snprintf(name, sizeof(name), "%s/%s", group, benchmark->name);
+
+  Bench_measure(
+    name,
+    Thread_benchRun,
+    &thread,
+    BENCH_UNROLL * benchmark->instructionsPerBody
+  );
+
+  assert(!thread.panic);
+
+  Thread_free(&thread);
+  ByteCode_free(&byteCode);
+}
+
+static void emitInteger(ByteCode* out, int32_t i) {
+  ByteCode_append(out, OP_INTEGER, 1);
+  ByteCode_appendInt32(out, i, 1);
+}
+
+static void emitIndexed(ByteCode* out, Instruction op, uint16_t index) {
+  ByteCode_append(out, op, 1);
+  ByteCode_appendUInt16(out, index, 1);
+}
+
+static void emitJump(ByteCode* out, Instruction op) {
+  // An offset of 2 skips only the offset itself, so the jump is a no-op
+  ByteCode_append(out, op, 1);
+  ByteCode_appendInt16(out, 2, 1);
+}
+
+static void prologueZero(ByteCode* out) { emitInteger(out, 0); }
+static void prologueOne(ByteCode* out) { emitInteger(out, 1); }
+static void prologueTrue(ByteCode* out) { ByteCode_append(out, OP_TRUE, 1); }
+static void prologueTwoSlots(ByteCode* out) { emitInteger(out, 0); emitInteger(out, 1); }
+static void prologueThreeSlots(ByteCode* out) {
+  emitInteger(out, 1);
+  emitInteger(out, 2);
+  emitInteger(out, 3);
+}
+static void prologueBlob(ByteCode* out) {
+  Blob* blob = Blob_new(5);
+  memcpy(blob->bytes, "Hello", 5);
+  BlobList_append(&(out->blobs), blob);
+}
+
+/*
+ * Two equal strings in separate blobs, and one of the same length which
+ * differs only at the end, all hashed as the compiler would hash literals.
+ */
+static void prologueStringKeys(ByteCode* out) {
+  const char* keys[] = { "dispatch_key_alpha", "dispatch_key_alpha", "dispatch_key_omega" };
+
+  for(size_t i = 0; i < 3; i++) {
+    Blob* blob = Blob_new(strlen(keys[i]));
+    memcpy(blob->bytes, keys[i], blob->count);
+    Blob_hash(blob);
+    BlobList_append(&(out->blobs), blob);
+  }
+}
+
+static void bodyNil(ByteCode* out) {
+  ByteCode_append(out, OP_NIL, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyTrue(ByteCode* out) {
+  ByteCode_append(out, OP_TRUE, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyFalse(ByteCode* out) {
+  ByteCode_append(out, OP_FALSE, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyInteger(ByteCode* out) {
+  emitInteger(out, 42);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyUTF8(ByteCode* out) {
+  emitIndexed(out, OP_UTF8, 0);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyUTF32(ByteCode* out) {
+  emitIndexed(out, OP_UTF32, 0);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyBuiltin(ByteCode* out) {
+  ByteCode_append(out, OP_BUILTIN, 1);
+  ByteCode_append(out, 0, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyGet(ByteCode* out) {
+  emitIndexed(out, OP_GET, 0);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodySet(ByteCode* out) {
+  emitInteger(out, 2);
+  emitIndexed(out, OP_SET, 0);
+}
+static void bodyNegate(ByteCode* out) { ByteCode_append(out, OP_NEGATE, 1); }
+static void bodyNot(ByteCode* out) { ByteCode_append(out, OP_NOT, 1); }
+static void bodyAdd(ByteCode* out) { emitInteger(out, 1); ByteCode_append(out, OP_ADD, 1); }
+static void bodySubtract(ByteCode* out) { emitInteger(out, 1); ByteCode_append(out, OP_SUBTRACT, 1); }
+static void bodyMultiply(ByteCode* out) { emitInteger(out, 1); ByteCode_append(out, OP_MULTIPLY, 1); }
+static void bodyIDivide(ByteCode* out) { emitInteger(out, 1); ByteCode_append(out, OP_IDIVIDE, 1); }
+
+static void emitComparisonBody(ByteCode* out, Instruction op) {
+  emitInteger(out, 1);
+  emitInteger(out, 2);
+  ByteCode_append(out, op, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyLessThan(ByteCode* out) { emitComparisonBody(out, OP_LESS_THAN); }
+static void bodyLessThanEqual(ByteCode* out) { emitComparisonBody(out, OP_LESS_THAN_EQUAL); }
+static void bodyGreaterThan(ByteCode* out) { emitComparisonBody(out, OP_GREATER_THAN); }
+static void bodyGreaterThanEqual(ByteCode* out) { emitComparisonBody(out, OP_GREATER_THAN_EQUAL); }
+static void bodyEqual(ByteCode* out) { emitComparisonBody(out, OP_EQUAL); }
+static void bodyNotEqual(ByteCode* out) { emitComparisonBody(out, OP_NOT_EQUAL); }
+
+static void bodyStringEqual(ByteCode* out) {
+  for(uint8_t other = 1; other <= 2; other++) {
+    emitIndexed(out, OP_UTF8, 0);
+    emitIndexed(out, OP_UTF8, other);
+    ByteCode_append(out, OP_EQUAL, 1);
+    ByteCode_append(out, OP_DROP, 1);
+  }
+}
+
+static void bodyDup(ByteCode* out) {
+  ByteCode_append(out, OP_DUP, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyRot3(ByteCode* out) { ByteCode_append(out, OP_ROT3, 1); }
+static void bodyJump(ByteCode* out) { emitJump(out, OP_JUMP); }
+static void bodyJumpTrueTaken(ByteCode* out) {
+  ByteCode_append(out, OP_TRUE, 1);
+  emitJump(out, OP_JUMP_TRUE);
+}
+static void bodyJumpTrueNotTaken(ByteCode* out) {
+  ByteCode_append(out, OP_FALSE, 1);
+  emitJump(out, OP_JUMP_TRUE);
+}
+static void bodyJumpFalseTaken(ByteCode* out) {
+  ByteCode_append(out, OP_FALSE, 1);
+  emitJump(out, OP_JUMP_FALSE);
+}
+static void bodyJumpFalseNotTaken(ByteCode* out) {
+  ByteCode_append(out, OP_TRUE, 1);
+  emitJump(out, OP_JUMP_FALSE);
+}
+static void bodyScope(ByteCode* out) {
+  ByteCode_append(out, OP_SCOPE_OPEN, 1);
+  ByteCode_append(out, OP_NIL, 1);
+  ByteCode_append(out, OP_SCOPE_CLOSE, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyCall(ByteCode* out) {
+  ByteCode_append(out, OP_BUILTIN, 1);
+  ByteCode_append(out, Builtin_index("Bool", 4), 1);
+  ByteCode_append(out, OP_TRUE, 1);
+  ByteCode_append(out, OP_CALL, 1);
+  ByteCode_append(out, 1, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+static void bodyCallBuiltin(ByteCode* out) {
+  ByteCode_append(out, OP_TRUE, 1);
+  ByteCode_append(out, OP_CALL_BUILTIN, 1);
+  ByteCode_append(out, Builtin_index("Bool", 4), 1);
+  ByteCode_append(out, 1, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+
+void bench_Thread_run_opcodes() {
+  /*
+   * Most instructions can't be run in isolation without growing or
+   * shrinking the stack, so each is paired with the cheapest instruction
+   * that restores the stack. OP_RETURN is included in the cost of every
+   * run.
+   */
+  ThreadBenchmark benchmarks[] = {
+    { "OP_NIL+OP_DROP", NULL, bodyNil, 2 },
+    { "OP_TRUE+OP_DROP", NULL, bodyTrue, 2 },
+    { "OP_FALSE+OP_DROP", NULL, bodyFalse, 2 },
+    { "OP_INTEGER+OP_DROP", NULL, bodyInteger, 2 },
+    { "OP_UTF8+OP_DROP", prologueBlob, bodyUTF8, 2 },
+    { "OP_UTF32+OP_DROP", prologueBlob, bodyUTF32, 2 },
+    { "OP_BUILTIN+OP_DROP", NULL, bodyBuiltin, 2 },
+    { "OP_GET+OP_DROP", prologueOne, bodyGet, 2 },
+    { "OP_INTEGER+OP_SET", prologueOne, bodySet, 2 },
+    { "OP_NEGATE", prologueOne, bodyNegate, 1 },
+    { "OP_NOT", prologueTrue, bodyNot, 1 },
+    { "OP_INTEGER+OP_ADD", prologueZero, bodyAdd, 2 },
+    { "OP_INTEGER+OP_SUBTRACT", prologueZero, bodySubtract, 2 },
+    { "OP_INTEGER+OP_MULTIPLY", prologueOne, bodyMultiply, 2 },
+    { "OP_INTEGER+OP_IDIVIDE", prologueOne, bodyIDivide, 2 },
+    { "OP_LESS_THAN", NULL, bodyLessThan, 4 },
+    { "OP_LESS_THAN_EQUAL", NULL, bodyLessThanEqual, 4 },
+    { "OP_GREATER_THAN", NULL, bodyGreaterThan, 4 },
+    { "OP_GREATER_THAN_EQUAL", NULL, bodyGreaterThanEqual, 4 },
+    { "OP_EQUAL", NULL, bodyEqual, 4 },
+    { "OP_NOT_EQUAL", NULL, bodyNotEqual, 4 },
+    { "OP_EQUAL(utf8)", prologueStringKeys, bodyStringEqual, 8 },
+    { "OP_DUP+OP_DROP", prologueOne, bodyDup, 2 },
+    { "OP_ROT3", prologueThreeSlots, bodyRot3, 1 },
+    { "OP_JUMP", NULL, bodyJump, 1 },
+    { "OP_JUMP_TRUE(taken)", NULL, bodyJumpTrueTaken, 2 },
+    { "OP_JUMP_TRUE(not_taken)", NULL, bodyJumpTrueNotTaken, 2 },
+    { "OP_JUMP_FALSE(taken)", NULL, bodyJumpFalseTaken, 2 },
+    { "OP_JUMP_FALSE(not_taken)", NULL, bodyJumpFalseNotTaken, 2 },
+    { "OP_SCOPE_OPEN+OP_SCOPE_CLOSE", NULL, bodyScope, 4 },
+    { "OP_CALL(native)", NULL, bodyCall, 4 },
+    { "OP_CALL_BUILTIN", NULL, bodyCallBuiltin, 3 },
+  };
+
+  for(size_t i = 0; i < sizeof(benchmarks) / sizeof(ThreadBenchmark); i++) {
+    Thread_bench("Thread_run", &(benchmarks[i]));
+  }
+}
+
+static void bodyArithmeticChain(ByteCode* out) {
+  // 1 + 2 * 3 - 4 // 2
+  emitInteger(out, 1);
+  emitInteger(out, 2);
+  emitInteger(out, 3);
+  ByteCode_append(out, OP_MULTIPLY, 1);
+  ByteCode_append(out, OP_ADD, 1);
+  emitInteger(out, 4);
+  emitInteger(out, 2);
+  ByteCode_append(out, OP_IDIVIDE, 1);
+  ByteCode_append(out, OP_SUBTRACT, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+
+static void bodyChainedComparison(ByteCode* out) {
+  // 1 < 2 < 3, laid out the way Compiler_emitComparison() emits it
+  emitInteger(out, 1);
+  emitInteger(out, 2);
+  ByteCode_append(out, OP_DUP, 1);
+  ByteCode_append(out, OP_ROT3, 1);
+  ByteCode_append(out, OP_LESS_THAN, 1);
+  ByteCode_append(out, OP_JUMP_FALSE, 1);
+  size_t shortCircuitStart = ByteCode_count(out);
+  ByteCode_appendInt16(out, 0, 1);
+  emitInteger(out, 3);
+  ByteCode_append(out, OP_LESS_THAN, 1);
+  ByteCode_append(out, OP_JUMP, 1);
+  ByteCode_appendInt16(out, 4, 1);
+  *((int16_t*)ByteCode_pc(out, shortCircuitStart)) = ByteCode_count(out) - shortCircuitStart;
+  ByteCode_append(out, OP_DROP, 1);
+  ByteCode_append(out, OP_FALSE, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+
+static void bodyVariables(ByteCode* out) {
+  // b = a + b, with a and b in slots 0 and 1
+  emitIndexed(out, OP_GET, 0);
+  emitIndexed(out, OP_GET, 1);
+  ByteCode_append(out, OP_ADD, 1);
+  emitIndexed(out, OP_SET, 1);
+}
+
+static void bodyNestedScopes(ByteCode* out) {
+  ByteCode_append(out, OP_SCOPE_OPEN, 1);
+  ByteCode_append(out, OP_SCOPE_OPEN, 1);
+  emitInteger(out, 1);
+  ByteCode_append(out, OP_SCOPE_CLOSE, 1);
+  ByteCode_append(out, OP_SCOPE_CLOSE, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+
+static void bodyNativeCallChain(ByteCode* out) {
+  // Int(Bool(Int(true)))
+  uint8_t boolIndex = Builtin_index("Bool", 4);
+  uint8_t intIndex = Builtin_index("Int", 3);
+
+  ByteCode_append(out, OP_BUILTIN, 1);
+  ByteCode_append(out, intIndex, 1);
+  ByteCode_append(out, OP_BUILTIN, 1);
+  ByteCode_append(out, boolIndex, 1);
+  ByteCode_append(out, OP_BUILTIN, 1);
+  ByteCode_append(out, intIndex, 1);
+  ByteCode_append(out, OP_TRUE, 1);
+  ByteCode_append(out, OP_CALL, 1);
+  ByteCode_append(out, 1, 1);
+  ByteCode_append(out, OP_CALL, 1);
+  ByteCode_append(out, 1, 1);
+  ByteCode_append(out, OP_CALL, 1);
+  ByteCode_append(out, 1, 1);
+  ByteCode_append(out, OP_DROP, 1);
+}
+
+void bench_Thread_run_patterns() {
+  ThreadBenchmark benchmarks[] = {
+    { "arithmeticChain", NULL, bodyArithmeticChain, 10 },
+    { "chainedComparison", NULL, bodyChainedComparison, 10 },
+    { "variables", prologueTwoSlots, bodyVariables, 4 },
+    { "nestedScopes", NULL, bodyNestedScopes, 6 },
+    { "nativeCallChain", NULL, bodyNativeCallChain, 8 },
+  };
+
+  for(size_t i = 0; i < sizeof(benchmarks) / sizeof(ThreadBenchmark); i++) {
+    Thread_bench("Thread_run", &(benchmarks[i]));
+  }
+}
+
+#undef BENCH_UNROLL
 
 #endif
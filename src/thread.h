@@ -6,17 +6,187 @@
 #include "instruction.h"
 #include "stack.h"
 
+/*
+ * The call frame of a Fur function. The base is the stack index of the
+ * function being called, with the arguments directly above it, so the
+ * compiler addresses the function as slot 0 and its parameters from slot 1.
+ * Both fields are indices so that they survive reallocation of the ByteCode
+ * and the Stack.
+ */
+typedef struct {
+  size_t returnIndex;
+  size_t base;
+} Frame;
+
+// Deep enough for any sane recursion, but stops runaway recursion cleanly
+#define THREAD_MAX_FRAME_COUNT (1 << 20)
+
+/*
+ * The least a thread allocates before its first collection, and between
+ * collections after that, so that short programs never collect.
+ */
+#define THREAD_MIN_COLLECTION (1 << 20)
+
+/*
+ * The most items OP_RESERVE_RANGE reserves up front. A break can end a loop
+ * early, so a huge range only gets this much, and grows from there.
+ */
+#define THREAD_MAX_RESERVED_ITEMS (1 << 20)
+
+// Longer panic messages from builtins are truncated
+#define THREAD_MAX_PANIC_MESSAGE 256
+
 typedef struct {
   ByteCode* byteCode;
   size_t pcIndex;
+
+  /*
+   * While Thread_run() is executing traced, this points at the instruction
+   * being executed, so that the sampling profiler can read it from a signal
+   * handler. It is volatile so that the store isn't deferred past the
+   * point where a signal could arrive.
+   */
+  uint8_t* volatile publishedPc;
+
+  // Instructions executed while traced, for the benchmark corpus
+  uint64_t instructionCount;
+
   Stack stack;
   bool panic;
+
+  /*
+   * Set by Thread_panic() for the error a builtin hit, which the thread
+   * reports with the line of the call once the builtin returns.
+   */
+  char panicMessage[THREAD_MAX_PANIC_MESSAGE];
+
+  /*
+   * Module-level code runs with no frame and a base of 0. The frames are
+   * allocated on the first call, to keep Threads which never call a Fur
+   * function small.
+   */
+  Frame* frames;
+  size_t frameCount;
+  size_t frameCapacity;
+
+  /*
+   * Every object the thread has allocated, linked through their next
+   * pointers. Thread_collect() frees the ones the stack no longer reaches.
+   */
+  Obj* objects;
+
+  /*
+   * The bytes the objects held after the last collection, plus everything
+   * allocated since, and the total at which to collect next.
+   */
+  size_t bytesAllocated;
+  size_t nextCollection;
 } Thread;
 
+/*
+ * The Thread currently inside Thread_run(), or NULL if Fur code isn't
+ * running (for example while compiling).
+ */
+extern Thread* volatile Thread_running;
+
+/*
+ * While set, Thread_run() uses a copy of its dispatch loop which publishes
+ * the pc for the sampling profiler and counts instructions. It's checked
+ * once per call to Thread_run(), so the ordinary loop pays nothing for it.
+ */
+extern bool Thread_isTraced;
+
 void Thread_init(Thread*, ByteCode*);
 void Thread_free(Thread*);
 void Thread_printStack(Thread*);
 
+/*
+ * Allocates an object linked into the thread's objects, so that it lives
+ * until a collection finds nothing on the stack refers to it. size includes
+ * any trailing array.
+ */
+Obj* Thread_allocate(Thread*, ObjType, size_t size);
+
+/*
+ * Frees every object which the stack doesn't reach, directly or through
+ * other objects. Thread_run() collects at loop back edges and calls, once
+ * the thread has allocated nextCollection bytes, since everything in use
+ * is on the stack between instructions. So a Value held anywhere else, like
+ * the result of Thread_run(), is only valid until the thread runs again.
+ */
+void Thread_collect(Thread*);
+
+/*
+ * These grow an array or string builder like ObjArray_append(),
+ * ObjArray_reserve() and so on, counting the growth toward the next
+ * collection.
+ */
+inline static void Thread_appendItem(Thread* self, ObjArray* array, Value item) {
+  size_t capacity = array->capacity;
+  ObjArray_append(array, item);
+  self->bytesAllocated += (array->capacity - capacity) * sizeof(Value);
+}
+
+inline static void Thread_reserveItems(Thread* self, ObjArray* array, size_t capacity) {
+  size_t oldCapacity = array->capacity;
+  ObjArray_reserve(array, capacity);
+  self->bytesAllocated += (array->capacity - oldCapacity) * sizeof(Value);
+}
+
+inline static void Thread_reserveBytes(Thread* self, ObjStringBuilder* stringBuilder, size_t capacity) {
+  size_t oldCapacity = stringBuilder->capacity;
+  ObjStringBuilder_reserve(stringBuilder, capacity);
+  self->bytesAllocated += stringBuilder->capacity - oldCapacity;
+}
+
+inline static void Thread_appendBytes(Thread* self, ObjStringBuilder* stringBuilder, const uint8_t* bytes, size_t count) {
+  size_t capacity = stringBuilder->capacity;
+  ObjStringBuilder_append(stringBuilder, bytes, count);
+  self->bytesAllocated += stringBuilder->capacity - capacity;
+}
+
+// Allocates an empty array with room for capacity items
+ObjArray* Thread_newArray(Thread*, size_t capacity);
+ObjMap* Thread_newMap(Thread*, size_t count);
+ObjRange* Thread_newRange(Thread*, int64_t start, int64_t stop);
+
+// Allocates an empty string builder with room for capacity bytes
+ObjStringBuilder* Thread_newStringBuilder(Thread*, size_t capacity);
+
+// Allocates a Blob for count bytes, which the caller fills in
+Blob* Thread_newBlob(Thread*, size_t count);
+
+// Copies bytes into a small string if they fit, and a new Blob otherwise
+Value Thread_newUTF8(Thread*, const uint8_t* bytes, size_t count);
+
+/*
+ * Returns the result as a VALUE_INTEGER if it fits, freeing it, and
+ * otherwise links it into the thread's objects like Thread_allocate().
+ */
+Value Thread_normalizeBigInteger(Thread*, ObjBigInteger* result);
+
+/*
+ * builtins.h gives every file that includes it its own copies of the
+ * builtins, so a VALUE_NATIVE_FN can only be compared against the copies
+ * that Fur code sees, which are this file's. These map those values to
+ * their index in BUILTINS and back, for code which stores values outside of
+ * the process, like snapshots. Thread_findBuiltin() returns -1 if fn isn't a
+ * builtin.
+ */
+int16_t Thread_findBuiltin(NativeFn fn);
+Value Thread_builtin(int16_t index);
+
+/*
+ * Builtins call this on arguments they can't handle, instead of asserting,
+ * and return what it returns. It puts the running thread in panic, like a
+ * type error in Fur code, so that Fur_run() returns false and the instance
+ * can run again.
+ */
+Value Thread_panic(const char* fmt, ...);
+
+// The name of a type as Fur errors give it, such as `Integer` or `Array`
+const char* ValueType_toCString(ValueType);
+
 Value Thread_run(Thread*);
 
 inline static void Thread_clearPanic(Thread* self) {
@@ -24,15 +194,41 @@ inline static void Thread_clearPanic(Thread* self) {
 
   self->panic = false;
   self->pcIndex = ByteCode_count(self->byteCode);
+
+  // Execution resumes at module level, outside of any function or scope
+  self->frameCount = 0;
+  Stack_closeAllScopes(&(self->stack));
 }
 
 #ifdef TEST
 
 void test_Thread_run_executesIntegerMathOps();
 void test_Thread_run_integerComparison();
+void test_Thread_run_integerOverflowPromotes();
+void test_Thread_run_stringComparison();
+void test_Thread_run_utf32Comparison();
+void test_Thread_run_callsNatives();
+void test_Thread_run_callPassesArgumentsInOrder();
+void test_Thread_run_callsFunction();
+void test_Thread_run_callChecksArity();
 
 void test_Thread_clearPanic_setsPanicFalse();
 void test_Thread_clearPanic_setsPCIndexToEnd();
+void test_Thread_run_tailCallReusesFrame();
+void test_Thread_run_closureSharesBox();
+void test_Thread_collect_freesUnreachableObjects();
+void test_Thread_clearPanic_dropsFrames();
+
+#endif
+
+#ifdef BENCH
+
+void bench_Thread_spawnIdle();
+void bench_Thread_pingPong();
+void bench_Thread_fanOutFanIn();
+
+void bench_Thread_run_opcodes();
+void bench_Thread_run_patterns();
 
 #endif
 
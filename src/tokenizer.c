@@ -126,13 +126,9 @@ Token Tokenizer_string(Tokenizer* self) {
 
       case '\\':
         self->current++;
-        switch(*(self->current)) {
-          case '0':
-          case 'n':
-          case 't':
-            self->current++;
-            break;
-        }
+
+        // The compiler decodes and checks escapes, so skip whatever follows
+        if(*(self->current) != '\0') self->current++;
         break;
 
       case '\0':
@@ -166,6 +162,8 @@ Token Tokenizer_scanInternal(Tokenizer* self) {
       return Tokenizer_consume(self, TOKEN_SEMICOLON, 1);
     case ',':
       return Tokenizer_consume(self, TOKEN_COMMA, 1);
+    case '\\':
+      return Tokenizer_consume(self, TOKEN_BACKSLASH, 1);
 
     case '+':
       return Tokenizer_consume(self, TOKEN_PLUS, 1);
@@ -227,6 +225,12 @@ Token Tokenizer_scanInternal(Tokenizer* self) {
       return Tokenizer_consume(self, TOKEN_OPEN_BRACE, 1);
     case '}':
       return Tokenizer_consume(self, TOKEN_CLOSE_BRACE, 1);
+    case '[':
+      return Tokenizer_consume(self, TOKEN_OPEN_BRACKET, 1);
+    case ']':
+      return Tokenizer_consume(self, TOKEN_CLOSE_BRACKET, 1);
+    case ':':
+      return Tokenizer_consume(self, TOKEN_COLON, 1);
 
     case '0':
     case '1':
@@ -342,14 +346,38 @@ Token Tokenizer_scanInternal(Tokenizer* self) {
       {
         const char* lexeme = self->current;
         self->current++;
-        return Tokenizer_keywordOrSymbol(self, lexeme, "alse", TOKEN_FALSE);
+
+        switch(*(self->current)) {
+          case 'a':
+            self->current++;
+            return Tokenizer_keywordOrSymbol(self, lexeme, "lse", TOKEN_FALSE);
+
+          case 'o':
+            self->current++;
+            return Tokenizer_keywordOrSymbol(self, lexeme, "r", TOKEN_FOR);
+
+          default:
+            return Tokenizer_completeSymbol(self, lexeme);
+        }
       }
 
     case 'i':
       {
         const char* lexeme = self->current;
         self->current++;
-        return Tokenizer_keywordOrSymbol(self, lexeme, "f", TOKEN_IF);
+
+        switch(*(self->current)) {
+          case 'f':
+            self->current++;
+            return Tokenizer_keywordOrSymbol(self, lexeme, "", TOKEN_IF);
+
+          case 'n':
+            self->current++;
+            return Tokenizer_keywordOrSymbol(self, lexeme, "", TOKEN_IN);
+
+          default:
+            return Tokenizer_completeSymbol(self, lexeme);
+        }
       }
 
     case 'l':
@@ -605,6 +633,22 @@ void test_Tokenizer_scan_comma() {
   assert(token.line == 1);
 }
 
+void test_Tokenizer_scan_backslash() {
+  const char* source = "\\(";
+
+  Tokenizer tokenizer;
+  Tokenizer_init(&tokenizer, source, 1);
+
+  Token token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_BACKSLASH);
+  assert(token.lexeme == source);
+  assert(token.length == 1);
+  assert(token.line == 1);
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_OPEN_PAREN);
+}
+
 void test_Tokenizer_scan_equals() {
   const char* source = "=";
 
@@ -693,6 +737,43 @@ void test_Tokenizer_scan_braces() {
   assert(token.line == 1);
 }
 
+void test_Tokenizer_scan_brackets() {
+  const char* source = "[]";
+
+  Tokenizer tokenizer;
+  Tokenizer_init(&tokenizer, source, 1);
+
+  Token token;
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_OPEN_BRACKET);
+  assert(token.lexeme == source);
+  assert(token.length == 1);
+  assert(token.line == 1);
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_CLOSE_BRACKET);
+  assert(token.lexeme == source + 1);
+  assert(token.length == 1);
+  assert(token.line == 1);
+}
+
+void test_Tokenizer_scan_colon() {
+  const char* source = "[:]";
+
+  Tokenizer tokenizer;
+  Tokenizer_init(&tokenizer, source, 1);
+
+  assert(Tokenizer_scan(&tokenizer).type == TOKEN_OPEN_BRACKET);
+
+  Token token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_COLON);
+  assert(token.lexeme == source + 1);
+  assert(token.length == 1);
+
+  assert(Tokenizer_scan(&tokenizer).type == TOKEN_CLOSE_BRACKET);
+}
+
 void test_Tokenizer_scan_symbol() {
   const char* source = "foo";
 
@@ -891,6 +972,39 @@ void test_Tokenizer_scan_jumpKeywords() {
   assert(token.line == 1);
 }
 
+void test_Tokenizer_scan_forIn() {
+  const char* source = "for in fore inside";
+
+  Tokenizer tokenizer;
+  Tokenizer_init(&tokenizer, source, 1);
+
+  Token token;
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_FOR);
+  assert(token.lexeme == source);
+  assert(token.length == 3);
+  assert(token.line == 1);
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_IN);
+  assert(token.lexeme == source + 4);
+  assert(token.length == 2);
+  assert(token.line == 1);
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_SYMBOL);
+  assert(token.lexeme == source + 7);
+  assert(token.length == 4);
+  assert(token.line == 1);
+
+  token = Tokenizer_scan(&tokenizer);
+  assert(token.type == TOKEN_SYMBOL);
+  assert(token.lexeme == source + 12);
+  assert(token.length == 6);
+  assert(token.line == 1);
+}
+
 void test_Tokenizer_scan_mut() {
   const char* source = "mut";
 
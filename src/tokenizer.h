@@ -13,6 +13,8 @@ typedef enum {
   TOKEN_EQUALS,
   TOKEN_SEMICOLON,
   TOKEN_COMMA,
+  TOKEN_COLON,
+  TOKEN_BACKSLASH,
 
   TOKEN_PLUS,
   TOKEN_MINUS,
@@ -35,6 +37,9 @@ typedef enum {
   TOKEN_OPEN_BRACE,
   TOKEN_CLOSE_BRACE,
 
+  TOKEN_OPEN_BRACKET,
+  TOKEN_CLOSE_BRACKET,
+
   TOKEN_NIL,
   TOKEN_TRUE,
   TOKEN_FALSE,
@@ -47,6 +52,8 @@ typedef enum {
   TOKEN_ELSE,
   TOKEN_WHILE,
   TOKEN_UNTIL,
+  TOKEN_FOR,
+  TOKEN_IN,
 
   TOKEN_CONTINUE,
   TOKEN_BREAK,
@@ -94,10 +101,13 @@ void test_Tokenizer_scan_linebreaks_increment_line();
 void test_Tokenizer_scan_integerMathOperators();
 void test_Tokenizer_scan_semicolon();
 void test_Tokenizer_scan_comma();
+void test_Tokenizer_scan_backslash();
 void test_Tokenizer_scan_equals();
 void test_Tokenizer_scan_after_Tokenizer_peek();
 void test_Tokenizer_scan_parentheses();
 void test_Tokenizer_scan_braces();
+void test_Tokenizer_scan_brackets();
+void test_Tokenizer_scan_colon();
 void test_Tokenizer_scan_symbol();
 void test_Tokenizer_scan_nil();
 void test_Tokenizer_scan_booleans();
@@ -106,6 +116,7 @@ void test_Tokenizer_scan_not();
 void test_Tokenizer_scan_comparisonOperators();
 void test_Tokenizer_scan_booleanOperators();
 void test_Tokenizer_scan_jumpKeywords();
+void test_Tokenizer_scan_forIn();
 void test_Tokenizer_scan_mut();
 void test_Tokenizer_scan_continue();
 void test_Tokenizer_scan_breakWith();
@@ -0,0 +1,715 @@
+#include <assert.h>
+#include <string.h>
+
+#include "utf8.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+#define UTF8_HAS_AVX2_PATH
+#define UTF8_AVX2 __attribute__((target("avx2")))
+#endif
+
+static bool UTF8_hasAVX2() {
+#ifdef UTF8_HAS_AVX2_PATH
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+inline static bool UTF8_isASCIIWord(const uint8_t* bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+  return (word & 0x8080808080808080ull) == 0;
+}
+
+static bool UTF8_validateScalar(const uint8_t* bytes, size_t count) {
+  size_t i = 0;
+
+  while(i < count) {
+    if(i + 8 <= count && UTF8_isASCIIWord(bytes + i)) {
+      i += 8;
+      continue;
+    }
+
+    uint8_t lead = bytes[i];
+
+    if(lead < 0x80) {
+      i++;
+      continue;
+    }
+
+    size_t length;
+    uint32_t codePoint;
+    uint32_t minimum;
+
+    if((lead & 0xE0) == 0xC0) {
+      length = 2;
+      codePoint = lead & 0x1F;
+      minimum = 0x80;
+    } else if((lead & 0xF0) == 0xE0) {
+      length = 3;
+      codePoint = lead & 0x0F;
+      minimum = 0x800;
+    } else if((lead & 0xF8) == 0xF0) {
+      length = 4;
+      codePoint = lead & 0x07;
+      minimum = 0x10000;
+    } else {
+      // A stray continuation byte, or a lead byte no encoding uses
+      return false;
+    }
+
+    if(count - i < length) return false;
+
+    for(size_t j = 1; j < length; j++) {
+      if((bytes[i + j] & 0xC0) != 0x80) return false;
+      codePoint = (codePoint << 6) | (bytes[i + j] & 0x3F);
+    }
+
+    if(codePoint < minimum || codePoint > UTF8_MAX_CODE_POINT) return false;
+    if(codePoint >= 0xD800 && codePoint <= 0xDFFF) return false;
+
+    i += length;
+  }
+
+  return true;
+}
+
+#ifdef UTF8_HAS_AVX2_PATH
+
+/*
+ * This is the "lookup" algorithm from simdjson (Keiser and Lemire,
+ * "Validating UTF-8 In Less Than One Instruction Per Byte"). Every error in
+ * a two byte window sets a bit in each of three table lookups: on the high
+ * and low nibbles of the first byte, and the high nibble of the second. A
+ * bit which is set in all three is an error, except TWO_CONTS, which is
+ * only an error where the byte two or three back isn't a 3 or 4 byte lead.
+ */
+#define TOO_SHORT (1 << 0)
+#define TOO_LONG (1 << 1)
+#define OVERLONG_3 (1 << 2)
+#define TOO_LARGE (1 << 3)
+#define SURROGATE (1 << 4)
+#define OVERLONG_2 (1 << 5)
+#define TOO_LARGE_1000 (1 << 6)
+#define OVERLONG_4 (1 << 6)
+#define TWO_CONTS (1 << 7)
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+// _mm256_shuffle_epi8() looks up within each 128-bit lane
+#define UTF8_TABLE(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) _mm256_setr_epi8( \
+    (char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h), \
+    (char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p), \
+    (char)(a), (char)(b), (char)(c), (char)(d), (char)(e), (char)(f), (char)(g), (char)(h), \
+    (char)(i), (char)(j), (char)(k), (char)(l), (char)(m), (char)(n), (char)(o), (char)(p))
+
+UTF8_AVX2 inline static __m256i UTF8_highNibbles(__m256i input) {
+  return _mm256_and_si256(_mm256_srli_epi16(input, 4), _mm256_set1_epi8(0x0F));
+}
+
+UTF8_AVX2 static bool UTF8_validateAVX2(const uint8_t* bytes, size_t count) {
+  const __m256i byte1High = UTF8_TABLE(
+    // 0_______ ________ (ASCII)
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+    // 10______ ________ (continuation)
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+    // 1100____ ________
+    TOO_SHORT | OVERLONG_2,
+    // 1101____ ________
+    TOO_SHORT,
+    // 1110____ ________
+    TOO_SHORT | OVERLONG_3 | SURROGATE,
+    // 1111____ ________
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+  );
+
+  const __m256i byte1Low = UTF8_TABLE(
+    // ____0000 ________
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+    // ____0001 ________
+    CARRY | OVERLONG_2,
+    // ____001_ ________
+    CARRY,
+    CARRY,
+    // ____0100 ________
+    CARRY | TOO_LARGE,
+    // ____0101 ________ and above
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    // ____1101 ________
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+    CARRY | TOO_LARGE | TOO_LARGE_1000,
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+  );
+
+  const __m256i byte2High = UTF8_TABLE(
+    // ________ 0_______ (ASCII)
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+    // ________ 1000____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+    // ________ 1001____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+    // ________ 101_____
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+    // ________ 11______ (lead)
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+  );
+
+  // Nonzero in the last 3 bytes of a block if a sequence continues past it
+  const __m256i incompleteLimit = _mm256_setr_epi8(
+    (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+    (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+    (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+    (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+    (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1)
+  );
+
+  __m256i error = _mm256_setzero_si256();
+  __m256i previous = _mm256_setzero_si256();
+  __m256i previousIncomplete = _mm256_setzero_si256();
+
+  for(size_t i = 0; i < count; i += 32) {
+    __m256i input;
+
+    if(count - i >= 32) {
+      input = _mm256_loadu_si256((const __m256i*)(bytes + i));
+    } else {
+      // Zeros are ASCII, so a sequence cut off by the end is too short
+      uint8_t tail[32] = { 0 };
+      memcpy(tail, bytes + i, count - i);
+      input = _mm256_loadu_si256((const __m256i*)tail);
+    }
+
+    if(_mm256_movemask_epi8(input) == 0) {
+      // ASCII can't finish a sequence started in the previous block
+      error = _mm256_or_si256(error, previousIncomplete);
+      previousIncomplete = _mm256_setzero_si256();
+    } else {
+      // The input shifted back by 1, 2 and 3 bytes, continuing from previous
+      __m256i carried = _mm256_permute2x128_si256(previous, input, 0x21);
+      __m256i previous1 = _mm256_alignr_epi8(input, carried, 15);
+      __m256i previous2 = _mm256_alignr_epi8(input, carried, 14);
+      __m256i previous3 = _mm256_alignr_epi8(input, carried, 13);
+
+      __m256i specialCases = _mm256_and_si256(
+        _mm256_and_si256(
+          _mm256_shuffle_epi8(byte1High, UTF8_highNibbles(previous1)),
+          _mm256_shuffle_epi8(byte1Low, _mm256_and_si256(previous1, _mm256_set1_epi8(0x0F)))
+        ),
+        _mm256_shuffle_epi8(byte2High, UTF8_highNibbles(input))
+      );
+
+      // The high bit is set where a continuation must be the 2nd or 3rd
+      __m256i must23 = _mm256_or_si256(
+        _mm256_subs_epu8(previous2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+        _mm256_subs_epu8(previous3, _mm256_set1_epi8((char)(0xF0 - 0x80)))
+      );
+
+      __m256i must23With80 = _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80));
+
+      error = _mm256_or_si256(error, _mm256_xor_si256(must23With80, specialCases));
+      previousIncomplete = _mm256_subs_epu8(input, incompleteLimit);
+    }
+
+    previous = input;
+  }
+
+  error = _mm256_or_si256(error, previousIncomplete);
+  return _mm256_testz_si256(error, error);
+}
+
+#undef TOO_SHORT
+#undef TOO_LONG
+#undef OVERLONG_3
+#undef TOO_LARGE
+#undef SURROGATE
+#undef OVERLONG_2
+#undef TOO_LARGE_1000
+#undef OVERLONG_4
+#undef TWO_CONTS
+#undef CARRY
+#undef UTF8_TABLE
+
+#endif
+
+bool UTF8_validate(const uint8_t* bytes, size_t count) {
+#ifdef UTF8_HAS_AVX2_PATH
+  if(UTF8_hasAVX2()) return UTF8_validateAVX2(bytes, count);
+#endif
+
+  return UTF8_validateScalar(bytes, count);
+}
+
+inline static bool UTF8_isContinuation(uint8_t byte) {
+  return (byte & 0xC0) == 0x80;
+}
+
+static size_t UTF8_countCodePointsScalar(const uint8_t* bytes, size_t count) {
+  size_t result = 0;
+
+  for(size_t i = 0; i < count; i++) {
+    result += !UTF8_isContinuation(bytes[i]);
+  }
+
+  return result;
+}
+
+#ifdef UTF8_HAS_AVX2_PATH
+
+UTF8_AVX2 static size_t UTF8_countCodePointsAVX2(const uint8_t* bytes, size_t count) {
+  size_t result = 0;
+  size_t i = 0;
+
+  // Continuation bytes are -128 to -65 as signed bytes, and nothing else is
+  const __m256i lastContinuation = _mm256_set1_epi8(-65);
+
+  for(; count - i >= 32; i += 32) {
+    __m256i input = _mm256_loadu_si256((const __m256i*)(bytes + i));
+    uint32_t leads = _mm256_movemask_epi8(_mm256_cmpgt_epi8(input, lastContinuation));
+    result += __builtin_popcount(leads);
+  }
+
+  return result + UTF8_countCodePointsScalar(bytes + i, count - i);
+}
+
+#endif
+
+size_t UTF8_countCodePoints(const uint8_t* bytes, size_t count) {
+#ifdef UTF8_HAS_AVX2_PATH
+  if(UTF8_hasAVX2()) return UTF8_countCodePointsAVX2(bytes, count);
+#endif
+
+  return UTF8_countCodePointsScalar(bytes, count);
+}
+
+size_t UTF8_encode(uint32_t codePoint, uint8_t* out) {
+  assert(codePoint <= UTF8_MAX_CODE_POINT);
+
+  if(codePoint < 0x80) {
+    out[0] = codePoint;
+    return 1;
+  }
+
+  if(codePoint < 0x800) {
+    out[0] = 0xC0 | (codePoint >> 6);
+    out[1] = 0x80 | (codePoint & 0x3F);
+    return 2;
+  }
+
+  if(codePoint < 0x10000) {
+    out[0] = 0xE0 | (codePoint >> 12);
+    out[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+    out[2] = 0x80 | (codePoint & 0x3F);
+    return 3;
+  }
+
+  out[0] = 0xF0 | (codePoint >> 18);
+  out[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+  out[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+  out[3] = 0x80 | (codePoint & 0x3F);
+  return 4;
+}
+
+// Decodes the sequence at bytes, returning its length
+inline static size_t UTF8_decode(const uint8_t* bytes, uint32_t* codePoint) {
+  uint8_t lead = bytes[0];
+
+  if(lead < 0x80) {
+    *codePoint = lead;
+    return 1;
+  }
+
+  if(lead < 0xE0) {
+    *codePoint = ((lead & 0x1F) << 6) | (bytes[1] & 0x3F);
+    return 2;
+  }
+
+  if(lead < 0xF0) {
+    *codePoint = ((lead & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
+    return 3;
+  }
+
+  *codePoint = ((lead & 0x07) << 18)
+    | ((bytes[1] & 0x3F) << 12)
+    | ((bytes[2] & 0x3F) << 6)
+    | (bytes[3] & 0x3F);
+  return 4;
+}
+
+static size_t UTF8_toUTF32Scalar(const uint8_t* bytes, size_t count, uint32_t* out) {
+  size_t i = 0;
+  size_t written = 0;
+
+  while(i < count) {
+    if(count - i >= 8 && UTF8_isASCIIWord(bytes + i)) {
+      for(size_t j = 0; j < 8; j++) out[written + j] = bytes[i + j];
+
+      i += 8;
+      written += 8;
+    } else {
+      i += UTF8_decode(bytes + i, out + written);
+      written++;
+    }
+  }
+
+  return written;
+}
+
+#ifdef UTF8_HAS_AVX2_PATH
+
+UTF8_AVX2 static size_t UTF8_toUTF32AVX2(const uint8_t* bytes, size_t count, uint32_t* out) {
+  size_t i = 0;
+  size_t written = 0;
+
+  while(i < count) {
+    if(count - i >= 8 && UTF8_isASCIIWord(bytes + i)) {
+      // Widen each byte of an ASCII run to 32 bits, 8 at a time
+      __m128i ascii = _mm_loadl_epi64((const __m128i*)(bytes + i));
+      _mm256_storeu_si256((__m256i*)(out + written), _mm256_cvtepu8_epi32(ascii));
+
+      i += 8;
+      written += 8;
+    } else {
+      i += UTF8_decode(bytes + i, out + written);
+      written++;
+    }
+  }
+
+  return written;
+}
+
+#endif
+
+size_t UTF8_toUTF32(const uint8_t* bytes, size_t count, uint32_t* out) {
+#ifdef UTF8_HAS_AVX2_PATH
+  if(UTF8_hasAVX2()) return UTF8_toUTF32AVX2(bytes, count, out);
+#endif
+
+  return UTF8_toUTF32Scalar(bytes, count, out);
+}
+
+size_t UTF32_countUTF8Bytes(const uint32_t* codePoints, size_t count) {
+  size_t result = count;
+
+  for(size_t i = 0; i < count; i++) {
+    result += (codePoints[i] >= 0x80) + (codePoints[i] >= 0x800) + (codePoints[i] >= 0x10000);
+  }
+
+  return result;
+}
+
+static size_t UTF32_toUTF8Scalar(const uint32_t* codePoints, size_t count, uint8_t* out) {
+  size_t written = 0;
+
+  for(size_t i = 0; i < count; i++) {
+    written += UTF8_encode(codePoints[i], out + written);
+  }
+
+  return written;
+}
+
+#ifdef UTF8_HAS_AVX2_PATH
+
+UTF8_AVX2 static size_t UTF32_toUTF8AVX2(const uint32_t* codePoints, size_t count, uint8_t* out) {
+  size_t i = 0;
+  size_t written = 0;
+  const __m256i nonASCII = _mm256_set1_epi32(~0x7F);
+
+  while(i < count) {
+    if(count - i >= 8) {
+      __m256i input = _mm256_loadu_si256((const __m256i*)(codePoints + i));
+
+      if(_mm256_testz_si256(input, nonASCII)) {
+        // Narrow 8 ASCII code points to bytes
+        __m128i words = _mm_packus_epi32(
+          _mm256_castsi256_si128(input),
+          _mm256_extracti128_si256(input, 1)
+        );
+
+        _mm_storel_epi64((__m128i*)(out + written), _mm_packus_epi16(words, words));
+
+        i += 8;
+        written += 8;
+        continue;
+      }
+    }
+
+    written += UTF8_encode(codePoints[i], out + written);
+    i++;
+  }
+
+  return written;
+}
+
+#endif
+
+size_t UTF32_toUTF8(const uint32_t* codePoints, size_t count, uint8_t* out) {
+#ifdef UTF8_HAS_AVX2_PATH
+  if(UTF8_hasAVX2()) return UTF32_toUTF8AVX2(codePoints, count, out);
+#endif
+
+  return UTF32_toUTF8Scalar(codePoints, count, out);
+}
+
+int UTF32_compare(const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount) {
+  size_t count = aCount < bCount ? aCount : bCount;
+
+  for(size_t i = 0; i < count; i++) {
+    if(a[i] != b[i]) return a[i] < b[i] ? -1 : 1;
+  }
+
+  return (aCount > bCount) - (aCount < bCount);
+}
+
+#ifdef TEST
+
+#include <stdio.h>
+
+typedef struct {
+  const char* bytes;
+  size_t count;
+  bool isValid;
+} UTF8TestCase;
+
+#define UTF8_CASE(text, isValid) { text, sizeof(text) - 1, isValid }
+
+static const UTF8TestCase UTF8_TEST_CASES[] = {
+  UTF8_CASE("", true),
+  UTF8_CASE("plain ASCII", true),
+  UTF8_CASE("caf\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", true),
+  UTF8_CASE("\xED\x9F\xBF", true),          // U+D7FF, just below the surrogates
+  UTF8_CASE("\xEE\x80\x80", true),          // U+E000, just above them
+  UTF8_CASE("\xF4\x8F\xBF\xBF", true),      // U+10FFFF
+  UTF8_CASE("\x80", false),                 // Stray continuation
+  UTF8_CASE("a\xBF" "b", false),
+  UTF8_CASE("\xC3", false),                 // Truncated
+  UTF8_CASE("\xE2\x82", false),
+  UTF8_CASE("\xF0\x9F\x98", false),
+  UTF8_CASE("\xC3" "a", false),
+  UTF8_CASE("\xC0\xAF", false),             // Overlong '/'
+  UTF8_CASE("\xC1\xBF", false),
+  UTF8_CASE("\xE0\x9F\xBF", false),         // Overlong U+07FF
+  UTF8_CASE("\xF0\x8F\xBF\xBF", false),     // Overlong U+FFFF
+  UTF8_CASE("\xED\xA0\x80", false),         // U+D800
+  UTF8_CASE("\xED\xBF\xBF", false),         // U+DFFF
+  UTF8_CASE("\xF4\x90\x80\x80", false),     // U+110000
+  UTF8_CASE("\xF5\x80\x80\x80", false),
+  UTF8_CASE("\xF8\x88\x80\x80\x80", false), // 5-byte sequence
+  UTF8_CASE("\xFF", false),
+  UTF8_CASE("\xC3\xA9\xA9", false),         // Too many continuations
+};
+
+#undef UTF8_CASE
+
+/*
+ * Embeds s at every offset in a buffer of ASCII, so that sequences fall
+ * across the 32-byte blocks of the vector path.
+ */
+static void UTF8_checkAtEveryOffset(const uint8_t* s, size_t count, bool isValid) {
+  uint8_t buffer[128];
+  assert(count + 64 <= sizeof(buffer));
+
+  for(size_t offset = 0; offset < 64; offset++) {
+    memset(buffer, 'x', sizeof(buffer));
+    memcpy(buffer + offset, s, count);
+
+    // Also with the sequence at the very end of the input
+    assert(UTF8_validateScalar(buffer, offset + count) == isValid);
+    assert(UTF8_validate(buffer, offset + count) == isValid);
+    assert(UTF8_validate(buffer, sizeof(buffer)) == isValid);
+  }
+}
+
+void test_UTF8_validate_rejectsMalformedSequences() {
+  for(size_t i = 0; i < sizeof(UTF8_TEST_CASES) / sizeof(UTF8_TEST_CASES[0]); i++) {
+    const UTF8TestCase* test = &(UTF8_TEST_CASES[i]);
+    UTF8_checkAtEveryOffset((const uint8_t*)test->bytes, test->count, test->isValid);
+  }
+}
+
+void test_UTF8_validate_vectorMatchesScalar() {
+  /*
+   * Every pair of bytes after a non-ASCII lead, followed by bytes either
+   * side of the continuation ranges, checked on both sides of a block
+   * boundary.
+   */
+  const uint8_t thirdBytes[] = { 0x00, 0x7F, 0x80, 0x8F, 0x90, 0x9F, 0xA0, 0xBF, 0xC0, 0xFF };
+  uint8_t buffer[64];
+  memset(buffer, 'x', sizeof(buffer));
+
+  for(size_t lead = 0x80; lead <= 0xFF; lead++) {
+    for(size_t second = 0; second <= 0xFF; second++) {
+      for(size_t third = 0; third < sizeof(thirdBytes); third++) {
+        const uint8_t s[] = { lead, second, thirdBytes[third], 0xBF };
+
+        for(size_t count = 1; count <= 4; count++) {
+          bool scalar = UTF8_validateScalar(s, count);
+
+          // Straddling the boundary, and at the end of the input
+          memcpy(buffer + 30, s, count);
+          assert(UTF8_validate(buffer, sizeof(buffer)) == scalar);
+          assert(UTF8_validate(buffer, 30 + count) == scalar);
+          memset(buffer + 30, 'x', count);
+        }
+      }
+    }
+  }
+}
+
+void test_UTF8_toUTF32_roundTrips() {
+  const char* text = "ASCII run of text \xCE\xB1\xCE\xB2 \xE4\xB8\xAD\xE6\x96\x87 \xF0\x9F\x98\x80 and ASCII again.";
+  size_t count = strlen(text);
+
+  assert(UTF8_validate((const uint8_t*)text, count));
+
+  size_t codePointCount = UTF8_countCodePoints((const uint8_t*)text, count);
+  assert(codePointCount == count - 2 - 4 - 3);
+
+  uint32_t codePoints[64];
+  assert(UTF8_toUTF32((const uint8_t*)text, count, codePoints) == codePointCount);
+  assert(UTF8_toUTF32Scalar((const uint8_t*)text, count, codePoints + 1) == codePointCount);
+  memmove(codePoints, codePoints + 1, codePointCount * sizeof(uint32_t));
+
+  assert(codePoints[0] == 'A');
+  assert(codePoints[18] == 0x03B1);
+  assert(codePoints[21] == 0x4E2D);
+  assert(codePoints[24] == 0x1F600);
+
+  assert(UTF32_countUTF8Bytes(codePoints, codePointCount) == count);
+
+  uint8_t bytes[64];
+  assert(UTF32_toUTF8(codePoints, codePointCount, bytes) == count);
+  assert(memcmp(bytes, text, count) == 0);
+  assert(UTF32_toUTF8Scalar(codePoints, codePointCount, bytes) == count);
+  assert(memcmp(bytes, text, count) == 0);
+
+  // Code point order, which differs from the order of little endian bytes
+  uint32_t a[] = { 0x00FF };
+  uint32_t b[] = { 0x0100 };
+  assert(UTF32_compare(a, 1, b, 1) < 0);
+  assert(UTF32_compare(b, 1, a, 1) > 0);
+  assert(UTF32_compare(a, 1, a, 1) == 0);
+  assert(UTF32_compare(a, 0, a, 1) < 0);
+}
+
+#endif
+
+#ifdef BENCH
+
+#include "bench.h"
+
+typedef struct {
+  const uint8_t* bytes;
+  size_t count;
+  uint32_t* codePoints;
+  size_t codePointCount;
+  uint8_t* roundTrip;
+} UTF8Bench;
+
+static void UTF8Bench_validateScalar(void* context) {
+  UTF8Bench* bench = context;
+  bool isValid = UTF8_validateScalar(bench->bytes, bench->count);
+  assert(isValid);
+  (void)isValid;
+}
+
+static void UTF8Bench_validate(void* context) {
+  UTF8Bench* bench = context;
+  bool isValid = UTF8_validate(bench->bytes, bench->count);
+  assert(isValid);
+  (void)isValid;
+}
+
+static void UTF8Bench_toUTF32(void* context) {
+  UTF8Bench* bench = context;
+  UTF8_toUTF32(bench->bytes, bench->count, bench->codePoints);
+}
+
+static void UTF8Bench_toUTF8(void* context) {
+  UTF8Bench* bench = context;
+  UTF32_toUTF8(bench->codePoints, bench->codePointCount, bench->roundTrip);
+}
+
+/*
+ * Mixed text like our inputs: mostly ASCII markup with runs of Greek,
+ * Chinese and emoji. Results are per byte of UTF-8.
+ */
+static void UTF8Bench_init(UTF8Bench* bench) {
+  const char* pieces[] = {
+    "<p class=\"entry\">",
+    "\xCE\x9A\xCE\xB1\xCE\xBB\xCE\xB7\xCE\xBC\xCE\xAD\xCF\x81\xCE\xB1 ",
+    "\xE4\xBD\xA0\xE5\xA5\xBD\xEF\xBC\x8C\xE4\xB8\x96\xE7\x95\x8C ",
+    "\xF0\x9F\x98\x80\xF0\x9F\x8E\x89 ",
+    "plain text between the multilingual runs. ",
+  };
+
+  size_t count = Bench_parameter("FUR_BENCH_UTF8_BYTES", 1 << 20);
+  uint8_t* bytes = malloc(count);
+  size_t written = 0;
+
+  assert(bytes != NULL);
+
+  for(size_t i = 0; ; i++) {
+    const char* piece = pieces[i % (sizeof(pieces) / sizeof(pieces[0]))];
+    size_t length = strlen(piece);
+
+    if(written + length > count) break;
+
+    memcpy(bytes + written, piece, length);
+    written += length;
+  }
+
+  bench->bytes = bytes;
+  bench->count = written;
+  bench->codePointCount = UTF8_countCodePoints(bytes, written);
+  bench->codePoints = malloc(bench->codePointCount * sizeof(uint32_t));
+  bench->roundTrip = malloc(written);
+
+  assert(bench->codePoints != NULL && bench->roundTrip != NULL);
+}
+
+static void UTF8Bench_free(UTF8Bench* bench) {
+  free((void*)(bench->bytes));
+  free(bench->codePoints);
+  free(bench->roundTrip);
+}
+
+void bench_UTF8_validate() {
+  UTF8Bench bench;
+  UTF8Bench_init(&bench);
+
+  Bench_measure("UTF8_validate(scalar)", UTF8Bench_validateScalar, &bench, bench.count);
+  Bench_measure(
+    UTF8_hasAVX2() ? "UTF8_validate(avx2)" : "UTF8_validate(scalar)",
+    UTF8Bench_validate,
+    &bench,
+    bench.count
+  );
+
+  UTF8Bench_free(&bench);
+}
+
+void bench_UTF8_transcode() {
+  UTF8Bench bench;
+  UTF8Bench_init(&bench);
+
+  Bench_measure("UTF8_toUTF32", UTF8Bench_toUTF32, &bench, bench.count);
+
+  UTF8_toUTF32(bench.bytes, bench.count, bench.codePoints);
+  Bench_measure("UTF32_toUTF8", UTF8Bench_toUTF8, &bench, bench.count);
+
+  UTF8Bench_free(&bench);
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Validation and transcoding between UTF-8 and UTF-32. The loops over whole
+ * strings use AVX2 where the CPU supports it, checked at runtime so that
+ * bin/fur still runs on CPUs without it, and fall back to portable code
+ * which handles ASCII a word at a time.
+ *
+ * Only UTF8_validate() accepts untrusted input. The other UTF8_ functions
+ * assume their input is valid.
+ */
+
+#define UTF8_MAX_CODE_POINT 0x10FFFF
+
+/*
+ * Checks for overlong encodings, surrogates, code points above
+ * UTF8_MAX_CODE_POINT, and truncated or stray continuation bytes.
+ */
+bool UTF8_validate(const uint8_t* bytes, size_t count);
+
+size_t UTF8_countCodePoints(const uint8_t* bytes, size_t count);
+
+/*
+ * Writes the encoding of a code point to out, which must have room for 4
+ * bytes, and returns the number of bytes written.
+ */
+size_t UTF8_encode(uint32_t codePoint, uint8_t* out);
+
+/*
+ * Decodes count bytes into out, which must have room for
+ * UTF8_countCodePoints() code points, and returns the number written.
+ */
+size_t UTF8_toUTF32(const uint8_t* bytes, size_t count, uint32_t* out);
+
+// The number of bytes UTF32_toUTF8() writes for these code points
+size_t UTF32_countUTF8Bytes(const uint32_t* codePoints, size_t count);
+
+// Encodes count code points into out, returning the number of bytes written
+size_t UTF32_toUTF8(const uint32_t* codePoints, size_t count, uint8_t* out);
+
+// Orders by code point, like strcmp()
+int UTF32_compare(const uint32_t* a, size_t aCount, const uint32_t* b, size_t bCount);
+
+#ifdef TEST
+
+void test_UTF8_validate_rejectsMalformedSequences();
+void test_UTF8_validate_vectorMatchesScalar();
+void test_UTF8_toUTF32_roundTrips();
+
+#endif
+
+#ifdef BENCH
+
+void bench_UTF8_validate();
+void bench_UTF8_transcode();
+
+#endif
+
+#endif
@@ -5,32 +5,205 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
+#include "big_integer.h"
 #include "blob.h"
+#include "fn.h"
+#include "object.h"
+#include "output.h"
+#include "utf8.h"
 
 typedef enum {
   VALUE_BOOLEAN,
   VALUE_NATIVE_FN,
+  VALUE_NATIVE,
+  VALUE_FN,
+  VALUE_CLOSURE,
+  VALUE_STACK_CLOSURE,
+  VALUE_BOX,
   VALUE_NIL,
   VALUE_INTEGER,
-  VALUE_UTF8
+  VALUE_BIG_INTEGER,
+  VALUE_UTF8,
+  VALUE_SMALL_UTF8,
+  VALUE_UTF32,
+  VALUE_ARRAY,
+  VALUE_MAP,
+  VALUE_RANGE,
+  VALUE_STRING_BUILDER
 } ValueType;
 
 struct Value;
 typedef struct Value Value;
 
+struct ObjBox;
+typedef struct ObjBox ObjBox;
+
+struct ObjClosure;
+typedef struct ObjClosure ObjClosure;
+
+struct ObjArray;
+typedef struct ObjArray ObjArray;
+
+struct ObjMap;
+typedef struct ObjMap ObjMap;
+
+struct ObjRange;
+typedef struct ObjRange ObjRange;
+
+struct ObjStringBuilder;
+typedef struct ObjStringBuilder ObjStringBuilder;
+
+struct Native;
+typedef struct Native Native;
+
 typedef Value (*NativeFn)(uint8_t argc, Value* argv);
+typedef Value (*NativeContextFn)(void* context, uint8_t argc, Value* argv);
 
 struct Value {
   ValueType type;
   union {
     bool boolean;
     NativeFn nativeFn;
-    int32_t integer;
+    Native* native;
+    Fn* fn;
+    ObjClosure* closure;
+    size_t stackClosure;
+    ObjBox* box;
+    int64_t integer;
+    ObjBigInteger* bigInteger;
     Blob* blob;
+    uint64_t smallUTF8;
+    ObjArray* array;
+    ObjMap* map;
+    ObjRange* range;
+    ObjStringBuilder* stringBuilder;
   } as;
 };
 
+/*
+ * A mutable variable which is captured by a closure. The variable's stack
+ * slot and every closure that captures it hold the same box, so assignments
+ * through any of them are seen by all of them. Boxes are never visible to
+ * Fur code: the compiler emits the OP_*_BOXED instructions to reach through
+ * them.
+ */
+struct ObjBox {
+  Obj obj;
+  Value value;
+};
+
+/*
+ * A function along with the values of the variables it captured, copied in
+ * when the closure was created (flat closures). Captured mutable variables
+ * are copied as their boxes. Functions that capture nothing are pushed as
+ * plain VALUE_FNs, and closures which can't escape the frame creating them
+ * as VALUE_STACK_CLOSUREs, so neither allocates.
+ */
+struct ObjClosure {
+  Obj obj;
+  Fn* fn;
+  uint8_t upvalueCount;
+  Value upvalues[];
+};
+
+/*
+ * A growable array. The items live in their own allocation so that they
+ * stay contiguous as the array grows, while every Value which refers to the
+ * array keeps pointing at the header. Appends double the capacity, so they
+ * take amortized constant time.
+ */
+struct ObjArray {
+  Obj obj;
+  size_t count;
+  size_t capacity;
+  Value* items;
+};
+
+/*
+ * A hash map, operated on by the functions in map.h. Entries live in open
+ * addressing slots alongside one control byte per slot, which is MAP_EMPTY
+ * or 7 bits of the entry's hash, so that probes can check a whole group of
+ * slots for a key with one SIMD comparison before looking at any entries.
+ * Each entry caches its key's full hash, which makes growing the table and
+ * rejecting most non-matching keys cheap.
+ *
+ * There are MAP_GROUP_SIZE more control bytes than slots, mirroring the
+ * first group, so that a group can be loaded at any slot without wrapping.
+ */
+#define MAP_EMPTY 0x80
+#define MAP_GROUP_SIZE 16
+
+typedef struct {
+  uint32_t hash;
+  Value key;
+  Value value;
+} MapEntry;
+
+struct ObjMap {
+  Obj obj;
+  size_t count;
+  size_t capacity;
+  uint8_t shift;
+  uint8_t* control;
+  MapEntry* entries;
+};
+
+/*
+ * The integers from start up to but not including stop, as returned by
+ * range(). Ranges are lazy: for loops count through them without the
+ * integers ever being stored, so a range of any length takes constant
+ * memory.
+ */
+struct ObjRange {
+  Obj obj;
+  int64_t start;
+  int64_t stop;
+};
+
+// Ranges are immutable, so they're equal when their bounds are
+inline static bool ObjRange_equals(ObjRange* a, ObjRange* b) {
+  return a->start == b->start && a->stop == b->stop;
+}
+
+// The number of integers in a range, which can exceed INT64_MAX
+inline static uint64_t ObjRange_length(ObjRange* self) {
+  if(self->stop <= self->start) return 0;
+  return (uint64_t)(self->stop) - (uint64_t)(self->start);
+}
+
+/*
+ * A buffer which a UTF-8 string is built up in a piece at a time, as
+ * returned by stringBuilder(), so that building a long string doesn't make
+ * a new string for every piece. Appends double the capacity, like arrays',
+ * and finish() copies the bytes out into a string and empties the builder
+ * so that it can be reused.
+ */
+struct ObjStringBuilder {
+  Obj obj;
+  size_t count;
+  size_t capacity;
+  uint8_t* bytes;
+};
+
+/*
+ * A C function registered by the program embedding Fur, which Fur code
+ * calls by name like a builtin (see NativeList). The function receives the
+ * context pointer it was registered with and a window into the thread's
+ * stack holding its argc arguments, so calls don't copy or marshal
+ * anything. It must not keep argv after returning, nor the objects the
+ * arguments refer to, which the thread collects once they're unreachable.
+ *
+ * The name is copied, so it only needs to live until registration returns.
+ */
+struct Native {
+  NativeContextFn fn;
+  void* context;
+  size_t nameLength;
+  char name[];
+};
+
 static const Value NIL = { VALUE_NIL, { 0 } };
 static const Value TRUE = { VALUE_BOOLEAN, { true } };
 static const Value FALSE = { VALUE_BOOLEAN, { false } };
@@ -56,18 +229,199 @@ inline static NativeFn Value_asNativeFn(Value v) {
   return v.as.nativeFn;
 }
 
-inline static Value Value_fromInteger(int32_t i) {
+inline static Value Value_fromNative(Native* native) {
+  Value result;
+  result.type = VALUE_NATIVE;
+  result.as.native = native;
+  return result;
+}
+
+inline static Native* Value_asNative(Value v) {
+  assert(v.type == VALUE_NATIVE);
+  return v.as.native;
+}
+
+inline static Value Value_fromFn(Fn* fn) {
+  Value result;
+  result.type = VALUE_FN;
+  result.as.fn = fn;
+  return result;
+}
+
+inline static Fn* Value_asFn(Value v) {
+  assert(v.type == VALUE_FN);
+  return v.as.fn;
+}
+
+inline static Value Value_fromClosure(ObjClosure* closure) {
+  Value result;
+  result.type = VALUE_CLOSURE;
+  result.as.closure = closure;
+  return result;
+}
+
+inline static ObjClosure* Value_asClosure(Value v) {
+  assert(v.type == VALUE_CLOSURE);
+  return v.as.closure;
+}
+
+/*
+ * A closure which the compiler has proven never outlives the frame that
+ * creates it, so its Fn and upvalues are kept in hidden slots of that frame
+ * instead of an ObjClosure. The value is the absolute stack index of the Fn,
+ * and the upvalues follow it. Captured mutable variables which no heap
+ * closure captures stay unboxed, and are captured as the absolute stack
+ * index of their slot.
+ */
+inline static Value Value_fromStackClosure(size_t slot) {
+  Value result;
+  result.type = VALUE_STACK_CLOSURE;
+  result.as.stackClosure = slot;
+  return result;
+}
+
+inline static size_t Value_asStackClosure(Value v) {
+  assert(v.type == VALUE_STACK_CLOSURE);
+  return v.as.stackClosure;
+}
+
+inline static Value Value_fromBox(ObjBox* box) {
+  Value result;
+  result.type = VALUE_BOX;
+  result.as.box = box;
+  return result;
+}
+
+inline static ObjBox* Value_asBox(Value v) {
+  assert(v.type == VALUE_BOX);
+  return v.as.box;
+}
+
+inline static Value Value_fromArray(ObjArray* array) {
+  Value result;
+  result.type = VALUE_ARRAY;
+  result.as.array = array;
+  return result;
+}
+
+inline static ObjArray* Value_asArray(Value v) {
+  assert(v.type == VALUE_ARRAY);
+  return v.as.array;
+}
+
+inline static Value Value_fromMap(ObjMap* map) {
+  Value result;
+  result.type = VALUE_MAP;
+  result.as.map = map;
+  return result;
+}
+
+inline static ObjMap* Value_asMap(Value v) {
+  assert(v.type == VALUE_MAP);
+  return v.as.map;
+}
+
+inline static Value Value_fromRange(ObjRange* range) {
+  Value result;
+  result.type = VALUE_RANGE;
+  result.as.range = range;
+  return result;
+}
+
+inline static ObjRange* Value_asRange(Value v) {
+  assert(v.type == VALUE_RANGE);
+  return v.as.range;
+}
+
+inline static Value Value_fromStringBuilder(ObjStringBuilder* stringBuilder) {
+  Value result;
+  result.type = VALUE_STRING_BUILDER;
+  result.as.stringBuilder = stringBuilder;
+  return result;
+}
+
+inline static ObjStringBuilder* Value_asStringBuilder(Value v) {
+  assert(v.type == VALUE_STRING_BUILDER);
+  return v.as.stringBuilder;
+}
+
+inline static void ObjArray_reserve(ObjArray* self, size_t capacity) {
+  if(capacity <= self->capacity) return;
+
+  self->items = realloc(self->items, capacity * sizeof(Value));
+
+  // TODO Handle this
+  assert(self->items != NULL);
+
+  self->capacity = capacity;
+}
+
+inline static void ObjArray_append(ObjArray* self, Value item) {
+  if(self->count == self->capacity) {
+    ObjArray_reserve(self, self->capacity == 0 ? 8 : self->capacity * 2);
+  }
+
+  self->items[self->count++] = item;
+}
+
+inline static void ObjStringBuilder_reserve(ObjStringBuilder* self, size_t capacity) {
+  if(capacity <= self->capacity) return;
+
+  self->bytes = realloc(self->bytes, capacity);
+
+  // TODO Handle this
+  assert(self->bytes != NULL);
+
+  self->capacity = capacity;
+}
+
+inline static void ObjStringBuilder_append(ObjStringBuilder* self, const uint8_t* bytes, size_t count) {
+  if(count == 0) return;
+
+  if(self->count + count > self->capacity) {
+    size_t capacity = self->capacity == 0 ? 64 : self->capacity * 2;
+    if(capacity < self->count + count) capacity = self->count + count;
+
+    ObjStringBuilder_reserve(self, capacity);
+  }
+
+  memcpy(self->bytes + self->count, bytes, count);
+  self->count += count;
+}
+
+inline static Value Value_fromInteger(int64_t i) {
   Value result;
   result.type = VALUE_INTEGER;
   result.as.integer = i;
   return result;
 }
 
-inline static int32_t Value_asInteger(Value v) {
+inline static int64_t Value_asInteger(Value v) {
   assert(v.type == VALUE_INTEGER);
   return v.as.integer;
 }
 
+/*
+ * Integers which don't fit in an int64_t. Arithmetic only produces these on
+ * overflow and converts results back to VALUE_INTEGER when they fit, so the
+ * two never hold the same number.
+ */
+inline static Value Value_fromBigInteger(ObjBigInteger* bigInteger) {
+  Value result;
+  result.type = VALUE_BIG_INTEGER;
+  result.as.bigInteger = bigInteger;
+  return result;
+}
+
+inline static ObjBigInteger* Value_asBigInteger(Value v) {
+  assert(v.type == VALUE_BIG_INTEGER);
+  return v.as.bigInteger;
+}
+
+inline static bool Value_isInteger(Value v) {
+  return v.type == VALUE_INTEGER || v.type == VALUE_BIG_INTEGER;
+}
+
 inline static Value Value_fromBlob(ValueType type, Blob* b) {
   Value result;
   result.type = type;
@@ -75,59 +429,211 @@ inline static Value Value_fromBlob(ValueType type, Blob* b) {
   return result;
 }
 
+inline static Blob* Value_asBlob(Value v) {
+  assert(v.type == VALUE_UTF8 || v.type == VALUE_UTF32);
+  return v.as.blob;
+}
+
+/*
+ * UTF-8 strings of up to SMALL_UTF8_CAPACITY bytes, which are stored inline
+ * rather than in a Blob, so that short keys and tokens cost no allocation
+ * and no pointer chase. As with integers and big integers, every string
+ * that short is small, so a small string never equals a VALUE_UTF8.
+ *
+ * The first byte of smallUTF8 is the count and the rest are the bytes, with
+ * the unused ones zeroed, so two small strings are equal exactly when their
+ * smallUTF8s are. It's an integer rather than a struct of bytes so that GCC
+ * keeps Values in registers.
+ */
+#define SMALL_UTF8_CAPACITY 7
+
+inline static Value Value_fromSmallUTF8(const uint8_t* bytes, size_t count) {
+  assert(count <= SMALL_UTF8_CAPACITY);
+
+  Value result;
+  result.type = VALUE_SMALL_UTF8;
+  result.as.smallUTF8 = 0;
+
+  uint8_t* packed = (uint8_t*)&(result.as.smallUTF8);
+  packed[0] = (uint8_t)count;
+  memcpy(packed + 1, bytes, count);
+  return result;
+}
+
+static const Value EMPTY_UTF8 = { VALUE_SMALL_UTF8, { .smallUTF8 = 0 } };
+
+inline static bool Value_isUTF8(Value v) {
+  return v.type == VALUE_UTF8 || v.type == VALUE_SMALL_UTF8;
+}
+
+// The bytes of either kind of UTF-8 string, which live as long as *v does
+inline static const uint8_t* Value_utf8Bytes(const Value* v) {
+  assert(Value_isUTF8(*v));
+  return v->type == VALUE_SMALL_UTF8 ? (const uint8_t*)&(v->as.smallUTF8) + 1 : v->as.blob->bytes;
+}
+
+inline static size_t Value_utf8Count(const Value* v) {
+  assert(Value_isUTF8(*v));
+  return v->type == VALUE_SMALL_UTF8 ? *(const uint8_t*)&(v->as.smallUTF8) : v->as.blob->count;
+}
+
+// A UTF32 string's Blob holds native-endian code points
+inline static const uint32_t* Value_asCodePoints(Value v) {
+  assert(v.type == VALUE_UTF32);
+  return (const uint32_t*)(v.as.blob->bytes);
+}
+
+inline static size_t Value_codePointCount(Value v) {
+  assert(v.type == VALUE_UTF32);
+  return v.as.blob->count / sizeof(uint32_t);
+}
+
 inline static void Value_print(Value v) {
+  Output* out = Output_standard();
+
   switch(v.type) {
     case VALUE_BOOLEAN:
-      if(Value_asBoolean(v)) {
-        printf("true");
-      } else {
-        printf("false");
-      }
+      Output_writeCString(out, Value_asBoolean(v) ? "true" : "false");
       return;
 
     case VALUE_NATIVE_FN:
-      printf("<NativeFn@%p>", Value_asNativeFn(v));
+      {
+        // Rare enough that snprintf() is fine
+        char text[32];
+        snprintf(text, sizeof(text), "<NativeFn@%p>", (void*)Value_asNativeFn(v));
+        Output_writeCString(out, text);
+      }
+      return;
+
+    case VALUE_NATIVE:
+      Output_writeCString(out, "<Native ");
+      Output_write(out, (const uint8_t*)Value_asNative(v)->name, Value_asNative(v)->nameLength);
+      Output_writeByte(out, '>');
+      return;
+
+    case VALUE_FN:
+    case VALUE_CLOSURE:
+      {
+        Fn* fn = v.type == VALUE_FN ? Value_asFn(v) : Value_asClosure(v)->fn;
+
+        if(fn->nameLength == 0) {
+          Output_writeCString(out, "<Function>");
+        } else {
+          Output_writeCString(out, "<Function ");
+          Output_write(out, (const uint8_t*)fn->name, fn->nameLength);
+          Output_writeByte(out, '>');
+        }
+      }
+      return;
+
+    case VALUE_STACK_CLOSURE:
+      // The Fn is on the stack, out of reach here
+      Output_writeCString(out, "<Function>");
+      return;
+
+    case VALUE_BOX:
+      Value_print(Value_asBox(v)->value);
       return;
 
     case VALUE_NIL:
-      printf("nil");
+      Output_writeCString(out, "nil");
       return;
 
     case VALUE_INTEGER:
-      printf("%i", v.as.integer);
+      Output_writeInteger(out, v.as.integer);
+      return;
+
+    case VALUE_BIG_INTEGER:
+      BigInteger_write(out, v.as.bigInteger);
       return;
 
     case VALUE_UTF8:
+    case VALUE_SMALL_UTF8:
+      Output_writeByte(out, '\'');
+      Output_write(out, Value_utf8Bytes(&v), Value_utf8Count(&v));
+      Output_writeCString(out, "'utf8");
+      return;
+
+    case VALUE_UTF32:
+      {
+        const uint32_t* codePoints = Value_asCodePoints(v);
+        size_t count = Value_codePointCount(v);
+        uint8_t encoded[4];
+
+        Output_writeByte(out, '\'');
+
+        for(size_t i = 0; i < count; i++) {
+          Output_write(out, encoded, UTF8_encode(codePoints[i], encoded));
+        }
+
+        Output_writeCString(out, "'utf32");
+      }
+      return;
+
+    case VALUE_ARRAY:
+      {
+        ObjArray* array = Value_asArray(v);
+
+        Output_writeByte(out, '[');
+
+        for(size_t i = 0; i < array->count; i++) {
+          if(i != 0) Output_writeCString(out, ", ");
+          Value_print(array->items[i]);
+        }
+
+        Output_writeByte(out, ']');
+      }
+      return;
+
+    case VALUE_MAP:
       {
-        size_t byteCount = v.as.blob->count;
-        uint8_t* bytes = v.as.blob->bytes;
-
-        printf("'");
-
-        /*
-         * The C standard requires printf to support up to 4095 characters,
-         * but environments may have problems printing more than that in one
-         * printf() call.
-         */
-        while(byteCount > 4095) {
-          printf("%.*s", 4095, bytes);
-          byteCount -= 4095;
-          bytes += 4095;
+        ObjMap* map = Value_asMap(v);
+
+        if(map->count == 0) {
+          Output_writeCString(out, "[:]");
+          return;
+        }
+
+        bool first = true;
+        Output_writeByte(out, '[');
+
+        for(size_t i = 0; i < map->capacity; i++) {
+          if(map->control[i] == MAP_EMPTY) continue;
+
+          if(!first) Output_writeCString(out, ", ");
+          first = false;
+
+          Value_print(map->entries[i].key);
+          Output_writeCString(out, ": ");
+          Value_print(map->entries[i].value);
         }
 
-        printf("%.*s", (int)byteCount, bytes);
-        printf("'utf8");
+        Output_writeByte(out, ']');
       }
       return;
+
+    case VALUE_RANGE:
+      Output_writeCString(out, "range(");
+      Output_writeInteger(out, Value_asRange(v)->start);
+      Output_writeCString(out, ", ");
+      Output_writeInteger(out, Value_asRange(v)->stop);
+      Output_writeByte(out, ')');
+      return;
+
+    case VALUE_STRING_BUILDER:
+      Output_writeCString(out, "<StringBuilder>");
+      return;
   }
 
   assert(false);
 }
 
 inline static void Value_println(Value v) {
-  printf("  ");
+  Output* out = Output_standard();
+
+  Output_writeCString(out, "  ");
   Value_print(v);
-  printf("\n");
+  Output_writeByte(out, '\n');
 }
 
 #ifdef TEST